@@ -0,0 +1,221 @@
+//
+//  File: LockContention.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+//  Lock contention benchmark.
+//  Compares DKSpinLock, DKMutex and DKCondition with the previous
+//  yield-loop spin lock and the standard (pthread) mutex and condition.
+//
+//  build: LockContention project in DKGL.sln (Benchmarks/LockContention.vcxproj),
+//  links DK_static. run the Release build for meaningful numbers.
+//
+
+#include <stdio.h>
+#include <mutex>
+#include <condition_variable>
+#include "DKFoundation.h"
+
+using namespace DKFoundation;
+
+/// previous DKSpinLock implementation, spins with TryLock and yield.
+class YieldSpinLock
+{
+public:
+	YieldSpinLock() : state(0) {}
+	void Lock() const
+	{
+		while (!TryLock())
+			DKThread::Yield();
+	}
+	bool TryLock() const	{ return state.CompareAndSet(0, 1); }
+	void Unlock() const		{ state = 0; }
+private:
+	mutable DKAtomicNumber32 state;
+};
+
+class StdMutex
+{
+public:
+	void Lock() const		{ mutex.lock(); }
+	void Unlock() const		{ mutex.unlock(); }
+private:
+	mutable std::mutex mutex;
+};
+
+struct SharedCounter
+{
+	uint64_t value = 0;
+	uint64_t padding[7];
+};
+
+/// all threads increment a shared counter in critical section,
+/// returns million lock acquisitions per second.
+template <typename Lock>
+static double MeasureLock(int numThreads, int iterations, int work)
+{
+	Lock lock;
+	SharedCounter counter;
+	DKAtomicNumber32 ready = 0;
+	volatile bool start = false;
+
+	DKArray<DKObject<DKThread>> threads;
+	for (int t = 0; t < numThreads; ++t)
+	{
+		threads.Add(DKThread::Create(DKFunction([&]()
+		{
+			ready.Increment();
+			while (!start)
+				DKThread::Yield();
+			for (int i = 0; i < iterations; ++i)
+			{
+				lock.Lock();
+				for (int w = 0; w < work; ++w)
+					counter.value++;
+				lock.Unlock();
+			}
+		})->Invocation()));
+	}
+	while (ready < numThreads)
+		DKThread::Yield();
+
+	DKTimer timer;
+	timer.Reset();
+	start = true;
+	for (DKThread* thread : threads)
+		thread->WaitTerminate();
+	double elapsed = timer.Elapsed();
+
+	DKASSERT(counter.value == uint64_t(numThreads) * iterations * work);
+	return double(numThreads) * iterations / elapsed / 1000000.0;
+}
+
+/// two threads handing a token over with a condition,
+/// returns thousand round trips per second.
+static double MeasureDKConditionPingPong(int iterations)
+{
+	DKCondition cond;
+	int turn = 0;
+	DKObject<DKThread> thread = DKThread::Create(DKFunction([&]()
+	{
+		DKCriticalSection<DKCondition> guard(cond);
+		for (int i = 0; i < iterations; ++i)
+		{
+			while (turn != 1)
+				cond.Wait();
+			turn = 0;
+			cond.Signal();
+		}
+	})->Invocation());
+
+	DKTimer timer;
+	timer.Reset();
+	if (true)
+	{
+		DKCriticalSection<DKCondition> guard(cond);
+		for (int i = 0; i < iterations; ++i)
+		{
+			turn = 1;
+			cond.Signal();
+			while (turn != 0)
+				cond.Wait();
+		}
+	}
+	thread->WaitTerminate();
+	return iterations / timer.Elapsed() / 1000.0;
+}
+
+static double MeasureStdConditionPingPong(int iterations)
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	int turn = 0;
+	DKObject<DKThread> thread = DKThread::Create(DKFunction([&]()
+	{
+		std::unique_lock<std::mutex> guard(mutex);
+		for (int i = 0; i < iterations; ++i)
+		{
+			while (turn != 1)
+				cond.wait(guard);
+			turn = 0;
+			cond.notify_one();
+		}
+	})->Invocation());
+
+	DKTimer timer;
+	timer.Reset();
+	if (true)
+	{
+		std::unique_lock<std::mutex> guard(mutex);
+		for (int i = 0; i < iterations; ++i)
+		{
+			turn = 1;
+			cond.notify_one();
+			while (turn != 0)
+				cond.wait(guard);
+		}
+	}
+	thread->WaitTerminate();
+	return iterations / timer.Elapsed() / 1000.0;
+}
+
+/// Signal() without waiters, returns nanoseconds per call.
+static double MeasureDKSignalNoWaiter(int iterations)
+{
+	DKCondition cond;
+	DKTimer timer;
+	timer.Reset();
+	for (int i = 0; i < iterations; ++i)
+	{
+		cond.Lock();
+		cond.Signal();
+		cond.Unlock();
+	}
+	return timer.Elapsed() * 1000000000.0 / iterations;
+}
+
+static double MeasureStdSignalNoWaiter(int iterations)
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	DKTimer timer;
+	timer.Reset();
+	for (int i = 0; i < iterations; ++i)
+	{
+		mutex.lock();
+		cond.notify_one();
+		mutex.unlock();
+	}
+	return timer.Elapsed() * 1000000000.0 / iterations;
+}
+
+int main(int argc, const char* argv[])
+{
+	const int iterations = 200000;
+	const int maxThreads = Max(DKNumberOfProcessors(), 2u) * 2;
+
+	for (int work : {1, 64})
+	{
+		printf("lock: M acquisitions/sec, %d increments in section\n", work);
+		printf("%8s %14s %14s %14s %14s\n", "threads", "DKSpinLock", "YieldSpinLock", "DKMutex", "std::mutex");
+		for (int n = 1; n <= maxThreads; n *= 2)
+		{
+			printf("%8d %14.2f %14.2f %14.2f %14.2f\n", n,
+				   MeasureLock<DKSpinLock>(n, iterations / n, work),
+				   MeasureLock<YieldSpinLock>(n, iterations / n, work),
+				   MeasureLock<DKMutex>(n, iterations / n, work),
+				   MeasureLock<StdMutex>(n, iterations / n, work));
+		}
+		printf("\n");
+	}
+
+	printf("condition ping-pong: K round trips/sec\n");
+	printf("%14s %14s\n", "DKCondition", "std::condvar");
+	printf("%14.2f %14.2f\n\n", MeasureDKConditionPingPong(50000), MeasureStdConditionPingPong(50000));
+
+	printf("signal without waiter: ns/call\n");
+	printf("%14s %14s\n", "DKCondition", "std::condvar");
+	printf("%14.2f %14.2f\n", MeasureDKSignalNoWaiter(1000000), MeasureStdSignalNoWaiter(1000000));
+	return 0;
+}
@@ -0,0 +1,117 @@
+//
+//  File: SharedLockScaling.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+//  DKSharedLock read scaling benchmark.
+//  Measures read throughput of DKSharedLock policies with increasing
+//  number of reader threads, optionally with a writer.
+//
+//  build: SharedLockScaling project in DKGL.sln (Benchmarks/SharedLockScaling.vcxproj),
+//  links DK_static. run the Release build for meaningful numbers.
+//
+
+#include <stdio.h>
+#include "DKFoundation.h"
+
+using namespace DKFoundation;
+
+struct SharedTable
+{
+	enum { NumEntries = 64 };
+	uint64_t values[NumEntries];
+};
+
+/// reader threads read a shared table for duration, a writer thread
+/// updates table every writeInterval seconds (0 for no writer).
+/// returns million read sections per second.
+static double MeasureReads(DKSharedLock::Policy policy, int numReaders, double duration, double writeInterval)
+{
+	DKSharedLock lock(policy);
+	SharedTable table = {};
+	DKAtomicNumber32 ready = 0;
+	volatile bool start = false;
+	volatile bool stop = false;
+	DKAtomicNumber64 totalReads = 0;
+	DKAtomicNumber64 checksum = 0;	// keeps reads from being optimized out.
+
+	DKArray<DKObject<DKThread>> threads;
+	for (int t = 0; t < numReaders; ++t)
+	{
+		threads.Add(DKThread::Create(DKFunction([&, t]()
+		{
+			ready.Increment();
+			while (!start)
+				DKThread::Yield();
+			uint64_t reads = 0;
+			uint64_t sum = 0;
+			while (!stop)
+			{
+				for (int i = 0; i < 256; ++i)
+				{
+					DKSharedLockReadOnlySection guard(lock);
+					sum += table.values[(i + t) % SharedTable::NumEntries];
+				}
+				reads += 256;
+			}
+			totalReads.Add(static_cast<int64_t>(reads));
+			checksum.Add(static_cast<int64_t>(sum));
+		})->Invocation()));
+	}
+	if (writeInterval > 0.0)
+	{
+		threads.Add(DKThread::Create(DKFunction([&]()
+		{
+			while (!start)
+				DKThread::Yield();
+			uint64_t n = 0;
+			while (!stop)
+			{
+				if (true)
+				{
+					DKCriticalSection<DKSharedLock> guard(lock);
+					table.values[n % SharedTable::NumEntries] = n;
+					n++;
+				}
+				DKThread::Sleep(writeInterval);
+			}
+		})->Invocation()));
+	}
+	while (ready < numReaders)
+		DKThread::Yield();
+
+	DKTimer timer;
+	timer.Reset();
+	start = true;
+	DKThread::Sleep(duration);
+	stop = true;
+	for (DKThread* thread : threads)
+		thread->WaitTerminate();
+	double elapsed = timer.Elapsed();
+
+	return static_cast<double>(static_cast<int64_t>(totalReads)) / elapsed / 1000000.0;
+}
+
+int main(int argc, const char* argv[])
+{
+	const double duration = 0.5;
+	const int maxThreads = Max(DKNumberOfProcessors(), 2u) * 2;
+
+	for (double writeInterval : {0.0, 0.001})
+	{
+		if (writeInterval > 0.0)
+			printf("read: M sections/sec, with a writer every %.0f ms\n", writeInterval * 1000.0);
+		else
+			printf("read: M sections/sec, readers only\n");
+		printf("%8s %16s %16s %16s\n", "threads", "PolicyDefault", "ReaderBiased", "speedup");
+		for (int n = 1; n <= maxThreads; n *= 2)
+		{
+			double d = MeasureReads(DKSharedLock::PolicyDefault, n, duration, writeInterval);
+			double r = MeasureReads(DKSharedLock::PolicyReaderBiased, n, duration, writeInterval);
+			printf("%8d %16.2f %16.2f %15.2fx\n", n, d, r, r / d);
+		}
+		printf("\n");
+	}
+	return 0;
+}
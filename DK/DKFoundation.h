@@ -13,12 +13,24 @@
 ///  - Data Collection
 ///  - Hash, UUID
 ///  - Thread and Synchronization Objects. (Mutex, Cond, etc.)
+///  - Lock contention profiler
+///  - Scoped hot-path profiler (Chrome trace export)
+///  - Metrics registry (counters, gauges, latency histograms)
+///  - Epoch based memory reclamation (RCU)
 ///  - Stream, File, Buffer, File-system directory
-///  - XML reader / writer
+///  - Recursive directory scanner, directory change watcher (inotify)
+///  - Asynchronous file I/O (io_uring, thread-pool)
+///  - Compression (zlib, zstd, lz4), seekable compressed stream
+///  - Indexed asset package (memory-mapped, per-entry compression)
+///  - XML reader / writer, zero-copy pull parser, compact read-only DOM
 ///  - Date Time (ISO-8601 support)
 ///  - Float16(half), Rational math type
 ///  - Event-Loop, Loop Timer, Scheduler
 ///  - Operation Queue, Thread Pool
+///  - Fiber based Job System
+///  - Future, Promise (asynchronous continuations)
+///  - Coroutine task, awaitables (C++20)
+///  - Asynchronous logging (per-thread lock-free buffers)
 ///  - Error handler
 ///  - Process and environments info
 namespace DKFoundation {}
@@ -69,6 +81,10 @@ namespace DKFoundation {}
 #include "DKFoundation/DKSpinLock.h"
 #include "DKFoundation/DKThread.h"
 #include "DKFoundation/DKCondition.h"
+#include "DKFoundation/DKLockProfiler.h"
+#include "DKFoundation/DKProfiler.h"
+#include "DKFoundation/DKMetrics.h"
+#include "DKFoundation/DKEpoch.h"
 
 // stream, buffer, compressor
 #include "DKFoundation/DKData.h"
@@ -80,16 +96,23 @@ namespace DKFoundation {}
 // file, file-map, and directory
 #include "DKFoundation/DKFile.h"
 #include "DKFoundation/DKFileMap.h"
+#include "DKFoundation/DKAsyncFile.h"
 #include "DKFoundation/DKDirectory.h"
+#include "DKFoundation/DKDirectoryScanner.h"
+#include "DKFoundation/DKDirectoryWatcher.h"
 
 // compressor, archiver
 #include "DKFoundation/DKCompressor.h"
+#include "DKFoundation/DKCompressedStream.h"
 #include "DKFoundation/DKZipArchiver.h"
+#include "DKFoundation/DKPackage.h"
 #include "DKFoundation/DKZipUnarchiver.h"
 
 // XML
 #include "DKFoundation/DKXmlParser.h"
+#include "DKFoundation/DKXmlReader.h"
 #include "DKFoundation/DKXmlDocument.h"
+#include "DKFoundation/DKXmlCompactDocument.h"
 
 // date time, timer
 #include "DKFoundation/DKTimer.h"
@@ -109,6 +132,9 @@ namespace DKFoundation {}
 #include "DKFoundation/DKEventLoop.h"
 #include "DKFoundation/DKEventLoopTimer.h"
 #include "DKFoundation/DKOperationQueue.h"
+#include "DKFoundation/DKJobSystem.h"
+#include "DKFoundation/DKFuture.h"
+#include "DKFoundation/DKCoroutine.h"
 
 // etc
 #include "DKFoundation/DKEndianness.h"
@@ -10,6 +10,7 @@
 #include "DKAllocator.h"
 #include "DKObjectRefCounter.h"
 #include "DKSpinLock.h"
+#include "DKCriticalSection.h"
 
 using namespace DKFoundation;
 
@@ -56,7 +57,7 @@ DKAllocator& DKAllocator::DefaultAllocator(DKMemoryLocation loc)
 
 	if (!initialized)
 	{
-		lock.Lock();
+		DKCriticalSection<DKSpinLock> guard(lock);
 		if (!initialized)
 		{
 			hma = new HeapAllocator();
@@ -64,7 +65,6 @@ DKAllocator& DKAllocator::DefaultAllocator(DKMemoryLocation loc)
 			pma = new PoolAllocator();
 			initialized = true;
 		}
-		lock.Unlock();
 	}
 
 	switch (loc)
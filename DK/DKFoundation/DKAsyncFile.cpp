@@ -0,0 +1,699 @@
+//
+//  File: DKAsyncFile.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#endif
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "DKAsyncFile.h"
+#include "DKOperationQueue.h"
+#include "DKMutex.h"
+#include "DKQueue.h"
+#include "DKArray.h"
+#include "DKLog.h"
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define DKGL_ASYNC_IO_URING 1
+#endif
+
+namespace DKFoundation::Private
+{
+    struct AsyncIORequest
+    {
+        DKObject<DKFile> file;  // keep file open until completed.
+        intptr_t handle;
+        DKAsyncFile::RequestType type;
+        uint64_t offset;
+        int registeredBuffer;
+        DKAsyncFile::IOVector inlineVector;
+        DKAsyncFile::IOVector* vectors;
+        size_t numVectors;
+        DKObject<DKAsyncFile::Completion> completion;
+        DKEventLoop* eventLoop;
+
+        AsyncIORequest() : vectors(NULL), numVectors(0) {}
+        ~AsyncIORequest()
+        {
+            if (vectors != &inlineVector)
+                delete[] vectors;
+        }
+
+        void Complete(int64_t result)
+        {
+            if (completion)
+            {
+                if (eventLoop)
+                {
+                    DKObject<DKAsyncFile::Completion> c = completion;
+                    eventLoop->Post(DKFunction([c, result]()
+                    {
+                        c->Invoke(result);
+                    })->Invocation());
+                }
+                else
+                {
+                    completion->Invoke(result);
+                }
+            }
+        }
+
+        // synchronous positional I/O, used by thread-pool engine.
+        int64_t Perform() const
+        {
+            int64_t total = 0;
+            uint64_t pos = offset;
+#ifdef _WIN32
+            for (size_t i = 0; i < numVectors; ++i)
+            {
+                const DKAsyncFile::IOVector& v = vectors[i];
+                OVERLAPPED ov = {};
+                ov.Offset = static_cast<DWORD>(pos & 0xffffffffULL);
+                ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+                DWORD transferred = 0;
+                BOOL ret;
+                if (type == DKAsyncFile::RequestRead)
+                    ret = ::ReadFile((HANDLE)handle, v.data, static_cast<DWORD>(v.length), &transferred, &ov);
+                else
+                    ret = ::WriteFile((HANDLE)handle, v.data, static_cast<DWORD>(v.length), &transferred, &ov);
+                if (!ret)
+                {
+                    DWORD err = ::GetLastError();
+                    if (err == ERROR_HANDLE_EOF)
+                        break;
+                    return total > 0 ? total : -static_cast<int64_t>(err);
+                }
+                total += transferred;
+                pos += transferred;
+                if (transferred < v.length)
+                    break;
+            }
+#else
+            const int fd = static_cast<int>(handle);
+#if defined(__linux__)
+            static_assert(sizeof(DKAsyncFile::IOVector) == sizeof(struct iovec), "IOVector must be compatible with iovec");
+            if (numVectors > 1)
+            {
+                ssize_t r;
+                do {
+                    if (type == DKAsyncFile::RequestRead)
+                        r = ::preadv(fd, reinterpret_cast<const struct iovec*>(vectors), static_cast<int>(numVectors), static_cast<off_t>(pos));
+                    else
+                        r = ::pwritev(fd, reinterpret_cast<const struct iovec*>(vectors), static_cast<int>(numVectors), static_cast<off_t>(pos));
+                } while (r < 0 && errno == EINTR);
+                return r < 0 ? -static_cast<int64_t>(errno) : static_cast<int64_t>(r);
+            }
+#endif
+            for (size_t i = 0; i < numVectors; ++i)
+            {
+                const DKAsyncFile::IOVector& v = vectors[i];
+                ssize_t r;
+                do {
+                    if (type == DKAsyncFile::RequestRead)
+                        r = ::pread(fd, v.data, v.length, static_cast<off_t>(pos));
+                    else
+                        r = ::pwrite(fd, v.data, v.length, static_cast<off_t>(pos));
+                } while (r < 0 && errno == EINTR);
+                if (r < 0)
+                    return total > 0 ? total : -static_cast<int64_t>(errno);
+                total += r;
+                pos += r;
+                if (static_cast<size_t>(r) < v.length)
+                    break;
+            }
+#endif
+            return total;
+        }
+    };
+
+    class AsyncIOEngine
+    {
+    public:
+        virtual ~AsyncIOEngine() {}
+        virtual void Submit(AsyncIORequest** requests, size_t count) = 0;
+        virtual bool RegisterBuffers(const DKAsyncFile::IOVector* buffers, size_t count) = 0;
+        virtual void UnregisterBuffers() = 0;
+        virtual bool IsNative() const = 0;
+    };
+
+    class AsyncIOThreadPoolEngine : public AsyncIOEngine
+    {
+    public:
+        ~AsyncIOThreadPoolEngine()
+        {
+            queue.WaitForCompletion();
+        }
+        void Submit(AsyncIORequest** requests, size_t count) override
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                AsyncIORequest* req = requests[i];
+                queue.Post(DKFunction([req]()
+                {
+                    req->Complete(req->Perform());
+                    delete req;
+                })->Invocation());
+            }
+        }
+        bool RegisterBuffers(const DKAsyncFile::IOVector*, size_t) override { return true; }
+        void UnregisterBuffers() override {}
+        bool IsNative() const override { return false; }
+
+        DKOperationQueue queue;
+    };
+
+#if DKGL_ASYNC_IO_URING
+    class AsyncIOUringEngine : public AsyncIOEngine
+    {
+        enum { RingEntries = 256 };
+    public:
+        AsyncIOUringEngine()
+            : ringFd(-1)
+            , sqRing(MAP_FAILED)
+            , cqRing(MAP_FAILED)
+            , sqRingSize(0)
+            , cqRingSize(0)
+            , sqes(NULL)
+            , numRegisteredBuffers(0)
+            , inFlight(0)
+            , terminate(false)
+        {
+        }
+        ~AsyncIOUringEngine()
+        {
+            if (reaper)
+            {
+                // wake reaper thread with no-op request.
+                submitLock.Lock();
+                terminate = true;
+                io_uring_sqe* sqe = NextSQE();
+                while (sqe == NULL)
+                {
+                    Enter(0);
+                    sqe = NextSQE();
+                }
+                sqe->opcode = IORING_OP_NOP;
+                sqe->user_data = 0;
+                CommitSQE();
+                inFlight++;
+                Enter(1);
+                submitLock.Unlock();
+
+                reaper->WaitTerminate();
+                reaper = NULL;
+            }
+            if (sqes)
+                ::munmap(sqes, sqEntries * sizeof(io_uring_sqe));
+            if (cqRing != MAP_FAILED && cqRing != sqRing)
+                ::munmap(cqRing, cqRingSize);
+            if (sqRing != MAP_FAILED)
+                ::munmap(sqRing, sqRingSize);
+            if (ringFd >= 0)
+                ::close(ringFd);
+        }
+
+        bool Initialize()
+        {
+            io_uring_params params = {};
+            ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, RingEntries, &params));
+            if (ringFd < 0)
+            {
+                DKLogI("DKAsyncFile: io_uring is not available (%s), using thread-pool.", strerror(errno));
+                return false;
+            }
+            sqEntries = params.sq_entries;
+            cqEntries = params.cq_entries;
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap)
+                sqRingSize = cqRingSize = Max(sqRingSize, cqRingSize);
+
+            sqRing = ::mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED)
+                return false;
+            if (singleMap)
+                cqRing = sqRing;
+            else
+            {
+                cqRing = ::mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED)
+                    return false;
+            }
+            void* p = ::mmap(NULL, sqEntries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+            if (p == MAP_FAILED)
+                return false;
+            sqes = reinterpret_cast<io_uring_sqe*>(p);
+
+            uint8_t* sq = reinterpret_cast<uint8_t*>(sqRing);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+            uint8_t* cq = reinterpret_cast<uint8_t*>(cqRing);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            reaper = DKThread::Create(DKFunction([this]()
+            {
+                DKThread::SetCurrentThreadName(L"DKAsyncIO");
+                ReaperProc();
+            })->Invocation());
+            return reaper != NULL;
+        }
+
+        void Submit(AsyncIORequest** requests, size_t count) override
+        {
+            DKCriticalSection<DKMutex> guard(submitLock);
+            for (size_t i = 0; i < count; ++i)
+                backlog.PushBack(requests[i]);
+            SubmitBacklogNL();
+        }
+
+        bool RegisterBuffers(const DKAsyncFile::IOVector* buffers, size_t count) override
+        {
+            DKCriticalSection<DKMutex> guard(submitLock);
+            if (numRegisteredBuffers > 0)
+            {
+                ::syscall(__NR_io_uring_register, ringFd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+                numRegisteredBuffers = 0;
+            }
+            if (count > 0)
+            {
+                if (::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, buffers, static_cast<unsigned>(count)) < 0)
+                {
+                    DKLogE("DKAsyncFile: io_uring_register failed: %s", strerror(errno));
+                    return false;
+                }
+                numRegisteredBuffers = count;
+            }
+            return true;
+        }
+
+        void UnregisterBuffers() override
+        {
+            RegisterBuffers(NULL, 0);
+        }
+
+        bool IsNative() const override { return true; }
+
+    private:
+        io_uring_sqe* NextSQE()
+        {
+            unsigned tail = *sqTail;
+            unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+            if (tail - head >= sqEntries)
+                return NULL;
+            io_uring_sqe* sqe = &sqes[tail & sqMask];
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            return sqe;
+        }
+
+        void CommitSQE()
+        {
+            unsigned tail = *sqTail;
+            sqArray[tail & sqMask] = tail & sqMask;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        // submit queued entries, retries until kernel consumes all of them.
+        void Enter(unsigned toSubmit)
+        {
+            while (true)
+            {
+                int r = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, 0, 0, NULL, 0));
+                if (r >= 0)
+                {
+                    if (static_cast<unsigned>(r) >= toSubmit)
+                        break;
+                    // partially submitted. (out of resources, completion
+                    // queue is full, etc.) try again with remaining entries.
+                    toSubmit -= static_cast<unsigned>(r);
+                    if (r == 0)
+                        DKThread::Yield();
+                    continue;
+                }
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EBUSY)
+                {
+                    DKThread::Yield();
+                    continue;
+                }
+                DKLogE("DKAsyncFile: io_uring_enter failed: %s", strerror(errno));
+                break;
+            }
+        }
+
+        // number of requests in flight is limited by completion queue size.
+        void SubmitBacklogNL()
+        {
+            unsigned queued = 0;
+            AsyncIORequest* req = NULL;
+            while (inFlight + queued < cqEntries && backlog.Count() > 0)
+            {
+                io_uring_sqe* sqe = NextSQE();
+                if (sqe == NULL)
+                {
+                    Enter(queued);
+                    inFlight += queued;
+                    queued = 0;
+                    continue;
+                }
+                backlog.PopFront(req);
+
+                sqe->fd = static_cast<int>(req->handle);
+                sqe->off = req->offset;
+                sqe->user_data = reinterpret_cast<uint64_t>(req);
+                if (req->registeredBuffer >= 0 && static_cast<size_t>(req->registeredBuffer) < numRegisteredBuffers && req->numVectors == 1)
+                {
+                    sqe->opcode = req->type == DKAsyncFile::RequestRead ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                    sqe->addr = reinterpret_cast<uint64_t>(req->vectors[0].data);
+                    sqe->len = static_cast<uint32_t>(req->vectors[0].length);
+                    sqe->buf_index = static_cast<uint16_t>(req->registeredBuffer);
+                }
+                else
+                {
+                    sqe->opcode = req->type == DKAsyncFile::RequestRead ? IORING_OP_READV : IORING_OP_WRITEV;
+                    sqe->addr = reinterpret_cast<uint64_t>(req->vectors);
+                    sqe->len = static_cast<uint32_t>(req->numVectors);
+                }
+                CommitSQE();
+                queued++;
+            }
+            if (queued > 0)
+            {
+                Enter(queued);
+                inFlight += queued;
+            }
+        }
+
+        void ReaperProc()
+        {
+            DKArray<AsyncIORequest*> requests;
+            DKArray<int64_t> results;
+            while (true)
+            {
+                unsigned head = *cqHead;
+                unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                if (head == tail)
+                {
+                    int r = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0));
+                    if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    {
+                        DKLogE("DKAsyncFile: io_uring_enter failed: %s", strerror(errno));
+                        break;
+                    }
+                    continue;
+                }
+
+                unsigned numCompleted = tail - head;
+                requests.Clear();
+                results.Clear();
+                for (; head != tail; ++head)
+                {
+                    const io_uring_cqe& cqe = cqes[head & cqMask];
+                    if (cqe.user_data)
+                    {
+                        requests.Add(reinterpret_cast<AsyncIORequest*>(cqe.user_data));
+                        results.Add(cqe.res);
+                    }
+                }
+                __atomic_store_n(cqHead, tail, __ATOMIC_RELEASE);
+
+                submitLock.Lock();
+                inFlight -= numCompleted;
+                SubmitBacklogNL();
+                bool exit = terminate && inFlight == 0 && backlog.Count() == 0;
+                submitLock.Unlock();
+
+                for (size_t i = 0; i < requests.Count(); ++i)
+                {
+                    requests.Value(i)->Complete(results.Value(i));
+                    delete requests.Value(i);
+                }
+                if (exit)
+                    break;
+            }
+        }
+
+        int ringFd;
+        unsigned sqEntries;
+        unsigned cqEntries;
+        void* sqRing;
+        void* cqRing;
+        size_t sqRingSize;
+        size_t cqRingSize;
+        unsigned* sqHead;
+        unsigned* sqTail;
+        unsigned sqMask;
+        unsigned* sqArray;
+        io_uring_sqe* sqes;
+        unsigned* cqHead;
+        unsigned* cqTail;
+        unsigned cqMask;
+        io_uring_cqe* cqes;
+
+        size_t numRegisteredBuffers;
+        DKMutex submitLock;
+        DKQueue<AsyncIORequest*> backlog;
+        unsigned inFlight;
+        bool terminate;
+        DKObject<DKThread> reaper;
+    };
+#endif
+
+    template <typename Fn> static DKFuture<int64_t> AsyncFileFuture(Fn&& fn)
+    {
+        DKPromise<int64_t> promise;
+        DKFuture<int64_t> future = promise.Future();
+        if (!fn(DKFunction([promise](int64_t result)
+        {
+            promise.SetValue(result);
+        })))
+        {
+            promise.Cancel();
+        }
+        return future;
+    }
+
+    // Engine is shared by all files, created on first use.
+    struct AsyncIOEngineHolder
+    {
+        DKMutex lock;
+        AsyncIOEngine* engine = NULL;
+
+        ~AsyncIOEngineHolder()
+        {
+            delete engine;
+        }
+        AsyncIOEngine* Engine()
+        {
+            DKCriticalSection<DKMutex> guard(lock);
+            if (engine == NULL)
+            {
+#if DKGL_ASYNC_IO_URING
+                AsyncIOUringEngine* uring = new AsyncIOUringEngine();
+                if (uring->Initialize())
+                    engine = uring;
+                else
+                    delete uring;
+#endif
+                if (engine == NULL)
+                    engine = new AsyncIOThreadPoolEngine();
+            }
+            return engine;
+        }
+    };
+    static AsyncIOEngine* GetAsyncIOEngine()
+    {
+        static DKAllocator::Maintainer init;
+        static AsyncIOEngineHolder holder;
+        return holder.Engine();
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+DKAsyncFile::DKAsyncFile()
+{
+}
+
+DKAsyncFile::~DKAsyncFile()
+{
+}
+
+DKObject<DKAsyncFile> DKAsyncFile::Open(const DKString& path, DKFile::ModeOpen mode, DKFile::ModeShare share)
+{
+	DKObject<DKFile> file = DKFile::Create(path, mode, share);
+	if (file)
+	{
+		DKObject<DKAsyncFile> f = DKObject<DKAsyncFile>::New();
+		f->file = file;
+		return f;
+	}
+	return NULL;
+}
+
+bool DKAsyncFile::Read(uint64_t offset, void* buffer, size_t length, Completion* completion, DKEventLoop* eventLoop)
+{
+	Request req;
+	req.type = RequestRead;
+	req.offset = offset;
+	req.buffer = buffer;
+	req.length = length;
+	req.completion = completion;
+	req.eventLoop = eventLoop;
+	return Submit(&req, 1) == 1;
+}
+
+bool DKAsyncFile::Write(uint64_t offset, const void* buffer, size_t length, Completion* completion, DKEventLoop* eventLoop)
+{
+	Request req;
+	req.type = RequestWrite;
+	req.offset = offset;
+	req.buffer = const_cast<void*>(buffer);
+	req.length = length;
+	req.completion = completion;
+	req.eventLoop = eventLoop;
+	return Submit(&req, 1) == 1;
+}
+
+bool DKAsyncFile::ReadV(uint64_t offset, const IOVector* vectors, size_t count, Completion* completion, DKEventLoop* eventLoop)
+{
+	Request req;
+	req.type = RequestRead;
+	req.offset = offset;
+	req.vectors = vectors;
+	req.numVectors = count;
+	req.completion = completion;
+	req.eventLoop = eventLoop;
+	return Submit(&req, 1) == 1;
+}
+
+bool DKAsyncFile::WriteV(uint64_t offset, const IOVector* vectors, size_t count, Completion* completion, DKEventLoop* eventLoop)
+{
+	Request req;
+	req.type = RequestWrite;
+	req.offset = offset;
+	req.vectors = vectors;
+	req.numVectors = count;
+	req.completion = completion;
+	req.eventLoop = eventLoop;
+	return Submit(&req, 1) == 1;
+}
+
+DKFuture<int64_t> DKAsyncFile::Read(uint64_t offset, void* buffer, size_t length)
+{
+	return AsyncFileFuture([&](Completion* c) { return Read(offset, buffer, length, c); });
+}
+
+DKFuture<int64_t> DKAsyncFile::Write(uint64_t offset, const void* buffer, size_t length)
+{
+	return AsyncFileFuture([&](Completion* c) { return Write(offset, buffer, length, c); });
+}
+
+DKFuture<int64_t> DKAsyncFile::ReadV(uint64_t offset, const IOVector* vectors, size_t count)
+{
+	return AsyncFileFuture([&](Completion* c) { return ReadV(offset, vectors, count, c); });
+}
+
+DKFuture<int64_t> DKAsyncFile::WriteV(uint64_t offset, const IOVector* vectors, size_t count)
+{
+	return AsyncFileFuture([&](Completion* c) { return WriteV(offset, vectors, count, c); });
+}
+
+size_t DKAsyncFile::Submit(const Request* requests, size_t count)
+{
+	if (file == NULL || requests == NULL || count == 0)
+		return 0;
+
+	DKArray<AsyncIORequest*> reqs;
+	reqs.Reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Request& r = requests[i];
+		if (r.type == RequestWrite && !file->IsWritable())
+		{
+			DKLogE("DKAsyncFile: file is not writable.");
+			continue;
+		}
+		if (r.vectors ? r.numVectors == 0 : r.buffer == NULL)
+			continue;
+
+		AsyncIORequest* req = new AsyncIORequest();
+		req->file = file;
+		req->handle = file->file;
+		req->type = r.type;
+		req->offset = r.offset;
+		req->registeredBuffer = r.registeredBuffer;
+		if (r.vectors)
+		{
+			// copy vectors, caller's array could be released before submitted.
+			req->numVectors = r.numVectors;
+			req->vectors = new IOVector[r.numVectors];
+			for (size_t n = 0; n < r.numVectors; ++n)
+				req->vectors[n] = r.vectors[n];
+		}
+		else
+		{
+			req->inlineVector = { r.buffer, r.length };
+			req->vectors = &req->inlineVector;
+			req->numVectors = 1;
+		}
+		req->completion = r.completion;
+		req->eventLoop = r.eventLoop;
+		reqs.Add(req);
+	}
+	if (reqs.Count() > 0)
+		GetAsyncIOEngine()->Submit((AsyncIORequest**)reqs, reqs.Count());
+	return reqs.Count();
+}
+
+uint64_t DKAsyncFile::Length() const
+{
+	if (file)
+		return file->TotalLength();
+	return 0;
+}
+
+const DKString& DKAsyncFile::Path() const
+{
+	if (file)
+		return file->Path();
+	static const DKString empty = L"";
+	return empty;
+}
+
+bool DKAsyncFile::RegisterBuffers(const IOVector* buffers, size_t count)
+{
+	return GetAsyncIOEngine()->RegisterBuffers(buffers, count);
+}
+
+void DKAsyncFile::UnregisterBuffers()
+{
+	GetAsyncIOEngine()->UnregisterBuffers();
+}
+
+bool DKAsyncFile::IsNativeAsyncIO()
+{
+	return GetAsyncIOEngine()->IsNative();
+}
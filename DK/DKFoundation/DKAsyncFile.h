@@ -0,0 +1,103 @@
+//
+//  File: DKAsyncFile.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKFunction.h"
+#include "DKFile.h"
+#include "DKFuture.h"
+#include "DKEventLoop.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Asynchronous positional file I/O.
+
+	 Requests are submitted through io_uring on Linux, or performed by
+	 background thread pool on other platforms (or if io_uring is not
+	 available). Many requests can be in flight from single thread, and
+	 multiple requests can be submitted at once with Submit().
+
+	 Completion result is number of bytes transferred, or negative value
+	 on error. (-errno) A read can transfer fewer bytes than requested,
+	 like pread.
+	 Completion can be delivered by
+	   - callback: invoked on I/O completion thread.
+	   - callback with event-loop: posted to given event-loop.
+	   - future: returned from overloaded functions without callback.
+
+	 @note
+	  Buffers must be valid until the request is completed.
+	  Registered buffers are shared by all DKAsyncFile objects, request with
+	  registered buffer index must use memory inside of that buffer.
+	 */
+	class DKGL_API DKAsyncFile
+	{
+	public:
+		using Completion = DKFunctionSignature<void (int64_t)>;
+
+		using IOVector = DKStream::IOVector;
+		enum RequestType
+		{
+			RequestRead,
+			RequestWrite,
+		};
+		/// request for batched submission.
+		struct Request
+		{
+			RequestType type = RequestRead;
+			uint64_t offset = 0;
+			void* buffer = NULL;			///< single buffer
+			size_t length = 0;
+			const IOVector* vectors = NULL;	///< vectored I/O if not NULL (buffer is ignored)
+			size_t numVectors = 0;
+			int registeredBuffer = -1;		///< index of registered buffer, -1 if not registered
+			DKObject<Completion> completion;
+			DKEventLoop* eventLoop = NULL;	///< post completion to event-loop
+		};
+
+		DKAsyncFile();
+		~DKAsyncFile();
+
+		static DKObject<DKAsyncFile> Open(const DKString& path, DKFile::ModeOpen mode, DKFile::ModeShare share = DKFile::ModeShareAll);
+
+		bool Read(uint64_t offset, void* buffer, size_t length, Completion* completion, DKEventLoop* eventLoop = NULL);
+		bool Write(uint64_t offset, const void* buffer, size_t length, Completion* completion, DKEventLoop* eventLoop = NULL);
+		bool ReadV(uint64_t offset, const IOVector* vectors, size_t count, Completion* completion, DKEventLoop* eventLoop = NULL);
+		bool WriteV(uint64_t offset, const IOVector* vectors, size_t count, Completion* completion, DKEventLoop* eventLoop = NULL);
+
+		DKFuture<int64_t> Read(uint64_t offset, void* buffer, size_t length);
+		DKFuture<int64_t> Write(uint64_t offset, const void* buffer, size_t length);
+		DKFuture<int64_t> ReadV(uint64_t offset, const IOVector* vectors, size_t count);
+		DKFuture<int64_t> WriteV(uint64_t offset, const IOVector* vectors, size_t count);
+
+		/// submit requests with single system call (if possible).
+		/// @return number of requests submitted.
+		size_t Submit(const Request* requests, size_t count);
+
+		uint64_t Length() const;
+		const DKString& Path() const;
+
+		/// Register buffers to reduce per-request mapping cost.
+		/// Replaces previously registered buffers. Do not call while requests
+		/// using registered buffers are in flight.
+		static bool RegisterBuffers(const IOVector* buffers, size_t count);
+		static void UnregisterBuffers();
+
+		/// determine io_uring is used for I/O.
+		static bool IsNativeAsyncIO();
+
+	private:
+		DKAsyncFile(const DKAsyncFile&) = delete;
+		DKAsyncFile& operator = (const DKAsyncFile&) = delete;
+
+		DKObject<DKFile> file;
+	};
+}
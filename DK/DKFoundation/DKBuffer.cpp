@@ -5,8 +5,19 @@
 //  Copyright (c) 2004-2019 Hongtae Kim. All rights reserved.
 //
 
-#include <ctype.h>
-#include <wctype.h>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define DKBASE64_AVX2 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DKBASE64_AVX2_TARGET
+#else
+#define DKBASE64_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DKBASE64_NEON 1
+#endif
 
 #define LIBXML_STATIC
 #include "../Libs/libxml2/include/libxml/nanohttp.h"
@@ -23,129 +34,353 @@
 namespace DKFoundation::Private
 {
     // base64 encode/decode
-    template <typename BaseCharT> struct Base64;
-    template <> struct Base64<char>
+    static constexpr char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // decoding table: 0~63 for base64 characters,
+    // Base64Whitespace for whitespaces, Base64Invalid for others (including padding)
+    enum : uint8_t { Base64Whitespace = 0x40, Base64Invalid = 0x80 };
+    struct Base64DecodingTable
     {
-        static const char* Base64Chars()
+        uint8_t values[256];
+        constexpr Base64DecodingTable() : values()
         {
-            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        }
-        static FORCEINLINE bool IsBase64(char c)
-        {
-            return ((c == '+') || (c == '/') || isalnum(c));
+            for (int i = 0; i < 256; ++i)
+                values[i] = Base64Invalid;
+            for (int i = 0; i < 64; ++i)
+                values[uint8_t(base64Chars[i])] = uint8_t(i);
+            values[uint8_t(' ')] = Base64Whitespace;
+            values[uint8_t('\t')] = Base64Whitespace;
+            values[uint8_t('\r')] = Base64Whitespace;
+            values[uint8_t('\n')] = Base64Whitespace;
         }
     };
-    template <> struct Base64<wchar_t>
+    static constexpr Base64DecodingTable base64Table;
+
+    enum : size_t { Base64StreamBufferSize = 0x4000 };
+
+#if DKBASE64_AVX2
+    static bool Base64AVX2Supported()
     {
-        static const wchar_t* Base64Chars()
-        {
-            return L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        }
-        static FORCEINLINE bool IsBase64(wchar_t c)
+#ifdef _MSC_VER
+        static const bool supported = []()->bool
         {
-            return ((c == L'+') || (c == '/') || iswalnum(c));
-        }
-    };
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            if ((info[2] & (1 << 27)) == 0)	// OSXSAVE
+                return false;
+            if ((_xgetbv(0) & 0x6) != 0x6)		// XMM, YMM state enabled by OS
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;	// AVX2
+        }();
+#else
+        static const bool supported = __builtin_cpu_supports("avx2");
+#endif
+        return supported;
+    }
 
-    template <typename BaseCharT> void Base64Encode(unsigned char const* bytes_to_encode, size_t in_len, DKArray<BaseCharT>& output)
+    // encode 24 bytes to 32 characters, reads 28 bytes.
+    DKBASE64_AVX2_TARGET static FORCEINLINE __m256i Base64EncodeAVX2Block(const uint8_t* src)
     {
-        output.Clear();
-        output.Reserve(((in_len * 4) / 3) + 3);
-
-        int i = 0;
-        int j = 0;
-        unsigned char char_array_3[3];
-        unsigned char char_array_4[4];
-
-        while (in_len--) {
-            char_array_3[i++] = *(bytes_to_encode++);
-            if (i == 3) {
-                char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-                char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-                char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-                char_array_4[3] = char_array_3[2] & 0x3f;
-
-                for (i = 0; (i < 4); i++)
-                    output.Add(Base64<BaseCharT>::Base64Chars()[char_array_4[i]]);
-                i = 0;
-            }
+        const __m256i input = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12)), 1);
+
+        // split 3 bytes into 4 indices of 6 bits.
+        const __m256i in = _mm256_shuffle_epi8(input, _mm256_setr_epi8(
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        // translate indices to ASCII with offset of each range.
+        // 0~25: 'A', 26~51: 'a', 52~61: '0', 62: '+', 63: '/'
+        const __m256i offsets = _mm256_setr_epi8(
+            65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+            65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+        return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+    }
+
+    // returns number of bytes encoded. (multiple of 24)
+    DKBASE64_AVX2_TARGET static size_t Base64EncodeAVX2(const uint8_t* src, size_t length, char* output)
+    {
+        size_t i = 0;
+        for (; i + 28 <= length; i += 24)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), Base64EncodeAVX2Block(src + i));
+            output += 32;
         }
+        return i;
+    }
 
-        if (i)
+    // decode 32 characters to 24 bytes, writes 32 bytes.
+    // returns number of characters decoded. (multiple of 32)
+    DKBASE64_AVX2_TARGET static size_t Base64DecodeAVX2(const char* src, size_t length, uint8_t* output, size_t capacity)
+    {
+        const __m256i lutLo = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+        const __m256i lutHi = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m256i lutRoll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i mask2F = _mm256_set1_epi8(0x2f);
+
+        size_t i = 0;
+        size_t o = 0;
+        for (; i + 32 <= length && o + 32 <= capacity; i += 32, o += 24)
         {
-            for (j = i; j < 3; j++)
-                char_array_3[j] = '\0';
+            __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+
+            // validate with nibbles, block with padding, whitespace or
+            // invalid characters are decoded by scalar decoder.
+            const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+            const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+            const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+            const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+            if (!_mm256_testz_si256(lo, hi))
+                break;
 
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
+            const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+            const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+            str = _mm256_add_epi8(str, roll);
+
+            // pack 4 indices of 6 bits into 3 bytes.
+            const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+            __m256i out = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+            out = _mm256_shuffle_epi8(out, _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            out = _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + o), out);
+        }
+        return i;
+    }
+#endif
+
+#if DKBASE64_NEON
+    FORCEINLINE uint8x16x4_t Base64LoadTable(const uint8_t* table)
+    {
+        uint8x16x4_t t;
+        t.val[0] = vld1q_u8(table);
+        t.val[1] = vld1q_u8(table + 16);
+        t.val[2] = vld1q_u8(table + 32);
+        t.val[3] = vld1q_u8(table + 48);
+        return t;
+    }
 
-            for (j = 0; (j < i + 1); j++)
-                output.Add(Base64<BaseCharT>::Base64Chars()[char_array_4[j]]);
+    // returns number of bytes encoded. (multiple of 48)
+    static size_t Base64EncodeNEON(const uint8_t* src, size_t length, char* output)
+    {
+        const uint8x16x4_t table = Base64LoadTable(reinterpret_cast<const uint8_t*>(base64Chars));
+        const uint8x16_t mask = vdupq_n_u8(0x3f);
 
-            while ((i++ < 3))
-                output.Add('=');
+        size_t i = 0;
+        for (; i + 48 <= length; i += 48)
+        {
+            const uint8x16x3_t in = vld3q_u8(src + i);
+            uint8x16x4_t out;
+            out.val[0] = vshrq_n_u8(in.val[0], 2);
+            out.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+            out.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+            out.val[3] = vandq_u8(in.val[2], mask);
+            out.val[0] = vqtbl4q_u8(table, out.val[0]);
+            out.val[1] = vqtbl4q_u8(table, out.val[1]);
+            out.val[2] = vqtbl4q_u8(table, out.val[2]);
+            out.val[3] = vqtbl4q_u8(table, out.val[3]);
+            vst4q_u8(reinterpret_cast<uint8_t*>(output), out);
+            output += 64;
         }
-        //return output;
+        return i;
     }
 
-    template <typename BaseCharT> bool Base64Decode(const BaseCharT* encoded_string, size_t in_len, DKBuffer* output)
+    // returns number of characters decoded. (multiple of 64)
+    static size_t Base64DecodeNEON(const char* src, size_t length, uint8_t* output, size_t capacity)
     {
-        auto IndexOfBase64Char = [](BaseCharT c) -> int
+        const uint8x16x4_t table0 = Base64LoadTable(base64Table.values);
+        const uint8x16x4_t table1 = Base64LoadTable(base64Table.values + 64);
+        const uint8x16_t offset = vdupq_n_u8(64);
+        const uint8x16_t ascii = vdupq_n_u8(0x80);
+
+        size_t i = 0;
+        size_t o = 0;
+        for (; i + 64 <= length && o + 48 <= capacity; i += 64, o += 48)
         {
-            for (int i = 0; i < 64; ++i)
-                if (c == Base64<BaseCharT>::Base64Chars()[i])
-                    return i;
-            return -1;
-        };
-
-        int i = 0;
-        int j = 0;
-        int in_ = 0;
-        char char_array_4[4], char_array_3[3];
-        DKArray<char> result;
-        result.Reserve((in_len * 3) / 4 + 3);
-
-        while (in_len-- && (encoded_string[in_] != '=') && Base64<BaseCharT>::IsBase64(encoded_string[in_]))
-        {
-            char_array_4[i++] = static_cast<char>(encoded_string[in_]); in_++;
-            if (i == 4)
+            const uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(src + i));
+            uint8x16x4_t v;
+            uint8x16_t error = vdupq_n_u8(0);
+            for (int k = 0; k < 4; ++k)
             {
-                for (i = 0; i < 4; ++i)
-                    char_array_4[i] = IndexOfBase64Char(char_array_4[i]);
-
-                char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+                v.val[k] = vqtbx4q_u8(vqtbl4q_u8(table0, in.val[k]), table1, vsubq_u8(in.val[k], offset));
+                error = vorrq_u8(error, vorrq_u8(v.val[k], vandq_u8(in.val[k], ascii)));
+            }
+            if (vmaxvq_u8(error) > 63)
+                break;
 
-                for (i = 0; (i < 3); i++)
-                    result.Add(char_array_3[i]);
+            uint8x16x3_t out;
+            out.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+            out.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+            out.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+            vst3q_u8(output + o, out);
+        }
+        return i;
+    }
+#endif
 
-                i = 0;
-            }
+    // output must have Base64EncodedLength(length) bytes.
+    static size_t Base64Encode(const uint8_t* src, size_t length, char* output)
+    {
+        size_t i = 0;
+#if DKBASE64_AVX2
+        if (Base64AVX2Supported())
+            i = Base64EncodeAVX2(src, length, output);
+#elif DKBASE64_NEON
+        i = Base64EncodeNEON(src, length, output);
+#endif
+        char* p = output + (i / 3) * 4;
+        for (; i + 3 <= length; i += 3)
+        {
+            const uint32_t v = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | src[i + 2];
+            p[0] = base64Chars[v >> 18];
+            p[1] = base64Chars[(v >> 12) & 0x3f];
+            p[2] = base64Chars[(v >> 6) & 0x3f];
+            p[3] = base64Chars[v & 0x3f];
+            p += 4;
         }
+        if (i < length)
+        {
+            uint32_t v = uint32_t(src[i]) << 16;
+            if (i + 1 < length)
+                v |= uint32_t(src[i + 1]) << 8;
+            p[0] = base64Chars[v >> 18];
+            p[1] = base64Chars[(v >> 12) & 0x3f];
+            p[2] = (i + 1 < length) ? base64Chars[(v >> 6) & 0x3f] : '=';
+            p[3] = '=';
+            p += 4;
+        }
+        return p - output;
+    }
 
-        if (i) {
-            for (j = i; j < 4; j++)
-                char_array_4[j] = 0;
+    // decodes input in pieces, whitespaces are skipped.
+    // decoding stops at padding or invalid character.
+    struct Base64Decoder
+    {
+        uint32_t bits = 0;
+        int count = 0;
+        bool finished = false;
 
-            for (j = 0; j < 4; j++)
-                char_array_4[j] = IndexOfBase64Char(char_array_4[j]);
+        // decode blocks of 4 characters without whitespace,
+        // returns number of characters decoded.
+        static size_t DecodeBlocks(const char* src, size_t length, uint8_t* output, size_t capacity)
+        {
+            size_t i = 0;
+#if DKBASE64_AVX2
+            if (Base64AVX2Supported())
+                i = Base64DecodeAVX2(src, length, output, capacity);
+#elif DKBASE64_NEON
+            i = Base64DecodeNEON(src, length, output, capacity);
+#endif
+            output += (i / 4) * 3;
+            const uint8_t* table = base64Table.values;
+            for (; i + 4 <= length; i += 4)
+            {
+                const uint32_t a = table[uint8_t(src[i])];
+                const uint32_t b = table[uint8_t(src[i + 1])];
+                const uint32_t c = table[uint8_t(src[i + 2])];
+                const uint32_t d = table[uint8_t(src[i + 3])];
+                if ((a | b | c | d) & (Base64Whitespace | Base64Invalid))
+                    break;
+                const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+                output[0] = uint8_t(v >> 16);
+                output[1] = uint8_t(v >> 8);
+                output[2] = uint8_t(v);
+                output += 3;
+            }
+            return i;
+        }
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+        // output must have Base64DecodedLength(length) bytes,
+        // returns end of output.
+        uint8_t* Decode(const char* src, size_t length, uint8_t* output, uint8_t* outputEnd)
+        {
+            const uint8_t* table = base64Table.values;
+            size_t i = 0;
+            while (i < length && !finished)
+            {
+                if (count == 0)
+                {
+                    size_t n = DecodeBlocks(src + i, length - i, output, outputEnd - output);
+                    i += n;
+                    output += (n / 4) * 3;
+                    if (i >= length)
+                        break;
+                }
+                const uint8_t v = table[uint8_t(src[i++])];
+                if (v < 64)
+                {
+                    bits = (bits << 6) | v;
+                    if (++count == 4)
+                    {
+                        output[0] = uint8_t(bits >> 16);
+                        output[1] = uint8_t(bits >> 8);
+                        output[2] = uint8_t(bits);
+                        output += 3;
+                        bits = 0;
+                        count = 0;
+                    }
+                }
+                else if (v == Base64Invalid)
+                {
+                    finished = true;
+                }
+            }
+            return output;
+        }
 
-            for (j = 0; (j < i - 1); j++)
-                result.Add(char_array_3[j]);
+        // flush remaining bits, returns end of output.
+        uint8_t* Finish(uint8_t* output)
+        {
+            if (count == 2)
+            {
+                *output++ = uint8_t(bits >> 4);
+            }
+            else if (count == 3)
+            {
+                *output++ = uint8_t(bits >> 10);
+                *output++ = uint8_t(bits >> 2);
+            }
+            bits = 0;
+            count = 0;
+            finished = true;
+            return output;
         }
-        if (result.Count())
+    };
+
+    // decode wide characters, characters out of ASCII range are invalid.
+    template <typename CharT>
+    static uint8_t* Base64DecodeWide(Base64Decoder& decoder, const CharT* src, size_t length, uint8_t* output, uint8_t* outputEnd)
+    {
+        char buffer[1024];
+        while (length > 0 && !decoder.finished)
         {
-            output->SetContent((const char*)result, result.Count());
-            return true;
+            size_t n = Min(length, sizeof(buffer));
+            for (size_t i = 0; i < n; ++i)
+                buffer[i] = uint32_t(src[i]) < 0x80 ? char(src[i]) : char(0x80);
+            output = decoder.Decode(buffer, n, output, outputEnd);
+            src += n;
+            length -= n;
         }
-        return false;
+        return output;
     }
 
     static DKObject<DKBuffer> GetHTTPContent(const DKString& url, DKAllocator& alloc)
@@ -269,7 +504,7 @@ DKBuffer::DKBuffer(const DKBuffer& b)
 	, contentLength(0)
 	, allocator(b.allocator)
 {
-	SetContent(b.contentPtr, b.contentLength);
+	SetContent(&b);
 }
 
 DKBuffer::DKBuffer(DKBuffer&& b)
@@ -279,6 +514,7 @@ DKBuffer::DKBuffer(DKBuffer&& b)
 {
 	this->contentPtr = b.contentPtr;
 	this->contentLength = b.contentLength;
+	this->sharedContent = static_cast<DKObject<DKData>&&>(b.sharedContent);
 	b.contentPtr = NULL;
 	b.contentLength = 0;
 }
@@ -296,8 +532,7 @@ DKBuffer::~DKBuffer()
 	}
 #endif
 
-	if (contentPtr)
-		allocator->Dealloc(contentPtr);
+	ReleaseContent();
 }
 
 size_t DKBuffer::Length() const
@@ -310,7 +545,22 @@ bool DKBuffer::SetLength(size_t len)
 	if (contentLength != len)
 	{
 		DKCriticalSection<DKSharedLock> guard(this->sharedLock);
-		if (len > 0)
+		if (sharedContent && len > 0)
+		{
+			void* p = this->allocator->Alloc(len);
+			if (p == NULL)
+			{
+				DKLog("DKBuffer error: Out of memory!");
+				return false;
+			}
+			const void* src = sharedContent->LockShared();
+			memcpy(p, src, Min(len, contentLength));
+			sharedContent->UnlockShared();
+			ReleaseContent();
+			contentPtr = p;
+			contentLength = len;
+		}
+		else if (len > 0)
 		{
 			void* p = this->allocator->Realloc(contentPtr, len);
 			if (p)
@@ -326,10 +576,7 @@ bool DKBuffer::SetLength(size_t len)
 		}
 		else
 		{
-			if (contentPtr)
-				allocator->Dealloc(contentPtr);
-			contentPtr = NULL;
-			contentLength = 0;
+			ReleaseContent();
 		}
 	}
 	return true;
@@ -341,12 +588,14 @@ bool DKBuffer::Base64Encode(DKStringU8& strOut) const
 	const void* p = this->LockShared();
 	size_t inputLength = this->Length();
 	if (p && inputLength > 0)
-	{	
-		DKArray<char> result;
-		Private::Base64Encode((const unsigned char*)p, inputLength, result);
-		if (result.Count() > 0)
+	{
+		size_t length = Base64EncodedLength(inputLength);
+		char* result = (char*)DKMalloc(length);
+		if (result)
 		{
-			strOut.SetValue((const char*)result, result.Count());
+			Private::Base64Encode((const uint8_t*)p, inputLength, result);
+			strOut.SetValue(result, length);
+			DKFree(result);
 			ret = true;
 		}
 	}
@@ -357,15 +606,26 @@ bool DKBuffer::Base64Encode(DKStringU8& strOut) const
 bool DKBuffer::Base64Encode(DKStringW& strOut) const
 {
 	bool ret = false;
-	const void* p = this->LockShared();
+	const uint8_t* p = (const uint8_t*)this->LockShared();
 	size_t inputLength = this->Length();
 	if (p && inputLength > 0)
 	{
-		DKArray<wchar_t> result;
-		Private::Base64Encode((const unsigned char*)p, inputLength, result);
-		if (result.Count() > 0)
+		DKUniCharW* result = (DKUniCharW*)DKMalloc(sizeof(DKUniCharW) * Base64EncodedLength(inputLength));
+		if (result)
 		{
-			strOut.SetValue((const wchar_t*)result, result.Count());
+			// encode pieces to stack buffer and widen.
+			char buffer[1024];
+			const size_t pieceLength = sizeof(buffer) / 4 * 3;
+			size_t length = 0;
+			for (size_t i = 0; i < inputLength; i += pieceLength)
+			{
+				size_t n = Private::Base64Encode(p + i, Min(pieceLength, inputLength - i), buffer);
+				for (size_t k = 0; k < n; ++k)
+					result[length + k] = (DKUniCharW)buffer[k];
+				length += n;
+			}
+			strOut.SetValue(result, length);
+			DKFree(result);
 			ret = true;
 		}
 	}
@@ -373,22 +633,140 @@ bool DKBuffer::Base64Encode(DKStringW& strOut) const
 	return ret;
 }
 
+size_t DKBuffer::Base64Encode(DKStream* output) const
+{
+	if (output == NULL || !output->IsWritable())
+		return 0;
+
+	size_t total = 0;
+	const uint8_t* p = (const uint8_t*)this->LockShared();
+	size_t inputLength = this->Length();
+	if (p && inputLength > 0)
+	{
+		char* buffer = (char*)DKMalloc(Private::Base64StreamBufferSize);
+		if (buffer)
+		{
+			const size_t pieceLength = Private::Base64StreamBufferSize / 4 * 3;
+			for (size_t i = 0; i < inputLength; i += pieceLength)
+			{
+				size_t n = Private::Base64Encode(p + i, Min(pieceLength, inputLength - i), buffer);
+				size_t written = output->Write(buffer, n);
+				if (written != n)
+				{
+					if (written != (size_t)-1)
+						total += written;
+					break;
+				}
+				total += n;
+			}
+			DKFree(buffer);
+		}
+	}
+	this->UnlockShared();
+	return total;
+}
+
 DKObject<DKBuffer> DKBuffer::Base64Decode(const DKStringU8& str, DKAllocator& alloc)
 {
-	DKObject<DKBuffer> buff = DKOBJECT_NEW DKBuffer(alloc);
-	if (Private::Base64Decode((const char*)str, str.Bytes(), buff))
-		return buff;
+	size_t inputLength = str.Bytes();
+	if (inputLength > 0)
+	{
+		DKObject<DKBuffer> buff = DKOBJECT_NEW DKBuffer(NULL, Base64DecodedLength(inputLength), alloc);
+		uint8_t* p = (uint8_t*)buff->LockExclusive();
+		Private::Base64Decoder decoder;
+		uint8_t* end = decoder.Decode((const char*)str, inputLength, p, p + buff->contentLength);
+		end = decoder.Finish(end);
+		buff->UnlockExclusive();
+
+		if (end > p && buff->SetLength(end - p))
+			return buff;
+	}
 	return NULL;
 }
 
 DKObject<DKBuffer> DKBuffer::Base64Decode(const DKStringW& str, DKAllocator& alloc)
 {
+	size_t inputLength = str.Length();
+	if (inputLength > 0)
+	{
+		DKObject<DKBuffer> buff = DKOBJECT_NEW DKBuffer(NULL, Base64DecodedLength(inputLength), alloc);
+		uint8_t* p = (uint8_t*)buff->LockExclusive();
+		Private::Base64Decoder decoder;
+		uint8_t* end = Private::Base64DecodeWide(decoder, (const DKUniCharW*)str, inputLength, p, p + buff->contentLength);
+		end = decoder.Finish(end);
+		buff->UnlockExclusive();
+
+		if (end > p && buff->SetLength(end - p))
+			return buff;
+	}
+	return NULL;
+}
+
+DKObject<DKBuffer> DKBuffer::Base64Decode(DKStream* input, DKAllocator& alloc)
+{
+	if (input == NULL || !input->IsReadable())
+		return NULL;
+
+	char* buffer = (char*)DKMalloc(Private::Base64StreamBufferSize);
+	if (buffer == NULL)
+		return NULL;
+
 	DKObject<DKBuffer> buff = DKOBJECT_NEW DKBuffer(alloc);
-	if (Private::Base64Decode((const wchar_t*)str, str.Length(), buff))
+	size_t length = 0;
+	Private::Base64Decoder decoder;
+	while (!decoder.finished)
+	{
+		size_t n = input->Read(buffer, Private::Base64StreamBufferSize);
+		if (n == 0 || n == (size_t)-1)
+			break;
+
+		// space for remaining bits of previous piece and Finish().
+		size_t required = length + Base64DecodedLength(n + 4);
+		if (required > buff->contentLength && !buff->SetLength(Max(required, buff->contentLength * 2)))
+		{
+			length = 0;
+			break;
+		}
+		uint8_t* p = (uint8_t*)buff->LockExclusive();
+		uint8_t* end = decoder.Decode(buffer, n, p + length, p + buff->contentLength);
+		if (decoder.finished)
+			end = decoder.Finish(end);
+		length = end - p;
+		buff->UnlockExclusive();
+	}
+	DKFree(buffer);
+
+	if (decoder.count > 0)
+	{
+		uint8_t* p = (uint8_t*)buff->LockExclusive();
+		length = decoder.Finish(p + length) - p;
+		buff->UnlockExclusive();
+	}
+
+	if (length > 0 && buff->SetLength(length))
 		return buff;
 	return NULL;
 }
 
+size_t DKBuffer::Base64Encode(const void* p, size_t length, char* output)
+{
+	if (p && length > 0 && output)
+		return Private::Base64Encode((const uint8_t*)p, length, output);
+	return 0;
+}
+
+size_t DKBuffer::Base64Decode(const char* str, size_t length, void* output)
+{
+	if (str && length > 0 && output)
+	{
+		uint8_t* p = (uint8_t*)output;
+		Private::Base64Decoder decoder;
+		uint8_t* end = decoder.Decode(str, length, p, p + Base64DecodedLength(length));
+		return decoder.Finish(end) - p;
+	}
+	return 0;
+}
+
 DKObject<DKBuffer> DKBuffer::Compress(const DKCompressor& compressor, DKAllocator& alloc) const
 {
 	const void* p = this->LockShared();
@@ -402,12 +780,17 @@ DKObject<DKBuffer> DKBuffer::Compress(const DKCompressor& compressor, const void
 {
 	if (p && len > 0)
 	{
-		DKObject<DKBuffer> output = DKBuffer::Create(0, 0, alloc);
-		DKBufferStream outputStream(output);
-		DKDataStream inputStream(DKData::StaticData(p, len));
-
-		if (compressor.Compress(&inputStream, &outputStream))
-			return outputStream.Buffer();
+		// compress into single allocation, shrink after compression.
+		size_t bound = compressor.CompressBound(len);
+		DKObject<DKBuffer> output = DKBuffer::Create(0, bound, alloc);
+		if (output && output->Length() == bound)
+		{
+			void* ptr = output->LockExclusive();
+			size_t compressed = compressor.Compress(p, len, ptr, bound);
+			output->UnlockExclusive();
+			if (compressed != DKCompressor::SizeError && output->SetLength(compressed))
+				return output;
+		}
 	}
 	return NULL;
 }
@@ -426,6 +809,24 @@ DKObject<DKBuffer> DKBuffer::Decompress(const void* p, size_t len, DKAllocator&
 {
 	if (p && len > 4)
 	{
+		size_t length = DKCompressor::DecompressedSize(p, len);
+		if (length == DKCompressor::SizeError)
+			return NULL;
+		if (length != DKCompressor::SizeUnknown)
+		{
+			// decompress directly into single allocation.
+			DKObject<DKBuffer> output = DKBuffer::Create(0, length, alloc);
+			if (output && output->Length() == length)
+			{
+				void* ptr = output->LockExclusive();
+				size_t decompressed = DKCompressor::Decompress(p, len, ptr, length);
+				output->UnlockExclusive();
+				if (decompressed == length)
+					return output;
+			}
+			return NULL;
+		}
+
 		DKObject<DKBuffer> output = DKBuffer::Create(0, 0, alloc);
 		DKBufferStream outputStream(output);
 		DKDataStream inputStream(DKData::StaticData(p, len));
@@ -485,7 +886,7 @@ DKObject<DKBuffer> DKBuffer::Create(const void* p, size_t s, DKAllocator& alloc)
 DKObject<DKBuffer> DKBuffer::Create(const DKData* p, DKAllocator& alloc)
 {
 	DKObject<DKBuffer> data = DKObject<DKBuffer>::Alloc(alloc);
-	data->SetContent(p);
+	data->SetContent(p);	// shares content if p is immutable.
 	return data;
 }
 
@@ -515,7 +916,7 @@ size_t DKBuffer::SetContent(const void* p, size_t s)
 {
 	DKCriticalSection<DKSharedLock> guard(this->sharedLock);
 
-	if (contentLength == s)
+	if (contentLength == s && sharedContent == nullptr)
 	{
 		if (s > 0 && p)
 		{
@@ -537,19 +938,14 @@ size_t DKBuffer::SetContent(const void* p, size_t s)
 			else
 				memset(ptr, 0, s);
 
-			if (contentPtr)
-				allocator->Dealloc(contentPtr);
+			ReleaseContent();
 
 			this->contentPtr = ptr;
 			this->contentLength = s;
 		}
 		else
 		{
-			if (contentPtr)
-				allocator->Dealloc(contentPtr);
-
-			contentPtr = NULL;
-			contentLength = 0;
+			ReleaseContent();
 		}
 	}
 	return contentLength;
@@ -558,7 +954,15 @@ size_t DKBuffer::SetContent(const void* p, size_t s)
 size_t DKBuffer::SetContent(const DKData* buff)
 {
 	size_t ret = 0;
-	if (buff)
+	if (buff == this)
+	{
+		ret = Length();
+	}
+	else if (buff && ShareContent(buff))
+	{
+		ret = Length();
+	}
+	else if (buff)
 	{
 		const void* p = buff->LockShared();
 		ret = SetContent(p, buff->Length());
@@ -583,12 +987,12 @@ DKBuffer& DKBuffer::operator = (DKBuffer&& b)
 	{
 		DKCriticalSection<DKSharedLock> guard(this->sharedLock);
 
-		if (this->contentPtr)
-			this->allocator->Dealloc(this->contentPtr);
+		ReleaseContent();
 
 		this->contentPtr = b.contentPtr;
 		this->contentLength = b.contentLength;
 		this->allocator = b.allocator;
+		this->sharedContent = static_cast<DKObject<DKData>&&>(b.sharedContent);
 		b.contentPtr = NULL;
 		b.contentLength = 0;
 	}
@@ -616,13 +1020,13 @@ void DKBuffer::SwitchAllocator(DKAllocator& alloc)
 	{
 		DKCriticalSection<DKSharedLock> guard(this->sharedLock);
 
-		if (contentLength > 0)
+		if (contentPtr)
 		{
 			void* p = alloc.Alloc(contentLength);
 			memcpy(p, contentPtr, contentLength);
 
-			this->contentPtr = p;
 			this->allocator->Dealloc(contentPtr);
+			this->contentPtr = p;
 		}
 		this->allocator = &alloc;
 	}
@@ -635,7 +1039,9 @@ DKAllocator& DKBuffer::Allocator() const
 
 void* DKBuffer::LockContent()
 {
-	return contentPtr;
+	if (DetachContent())
+		return contentPtr;
+	return NULL;
 }
 
 void DKBuffer::UnlockContent()
@@ -645,6 +1051,8 @@ void DKBuffer::UnlockContent()
 const void* DKBuffer::LockShared() const
 {
 	sharedLock.LockShared();
+	if (sharedContent)
+		return sharedContent->LockShared();
 	return contentPtr;
 }
 
@@ -652,8 +1060,21 @@ bool DKBuffer::TryLockShared(const void ** ptr) const
 {
 	if (sharedLock.TryLockShared())
 	{
-		if (ptr)
+		if (sharedContent)
+		{
+			const void* p = NULL;
+			if (!sharedContent->TryLockShared(&p))
+			{
+				sharedLock.UnlockShared();
+				return false;
+			}
+			if (ptr)
+				*ptr = p;
+		}
+		else if (ptr)
+		{
 			*ptr = contentPtr;
+		}
 		return true;
 	}
 	return false;
@@ -661,13 +1082,17 @@ bool DKBuffer::TryLockShared(const void ** ptr) const
 
 void DKBuffer::UnlockShared() const
 {
+	if (sharedContent)
+		sharedContent->UnlockShared();
 	sharedLock.UnlockShared();
 }
 
 void* DKBuffer::LockExclusive()
 {
 	sharedLock.Lock();
-	return contentPtr;
+	if (DetachContent())
+		return contentPtr;
+	return NULL;
 }
 
 bool DKBuffer::TryLockExclusive(void ** ptr)
@@ -675,7 +1100,9 @@ bool DKBuffer::TryLockExclusive(void ** ptr)
 	if (sharedLock.TryLock())
 	{
 		if (ptr)
-			*ptr = contentPtr;
+			*ptr = DetachContent() ? contentPtr : NULL;
+		else
+			DetachContent();
 		return true;
 	}
 	return false;
@@ -685,3 +1112,65 @@ void DKBuffer::UnlockExclusive()
 {
 	sharedLock.Unlock();
 }
+
+void DKBuffer::ReleaseContent()
+{
+	if (sharedContent)
+		sharedContent = NULL;
+	else if (contentPtr)
+		allocator->Dealloc(contentPtr);
+	contentPtr = NULL;
+	contentLength = 0;
+}
+
+bool DKBuffer::DetachContent()
+{
+	if (sharedContent)
+	{
+		void* p = allocator->Alloc(contentLength);
+		if (p == NULL)
+		{
+			DKLog("DKBuffer error: Out of memory!");
+			return false;
+		}
+		const void* src = sharedContent->LockShared();
+		memcpy(p, src, contentLength);
+		sharedContent->UnlockShared();
+		sharedContent = NULL;
+		contentPtr = p;
+	}
+	return true;
+}
+
+bool DKBuffer::ShareContent(const DKData* data)
+{
+	DKObject<DKData> source = NULL;
+	const DKBuffer* buffer = dynamic_cast<const DKBuffer*>(data);
+	if (buffer)
+	{
+		// share source of other buffer, if it has.
+		buffer->sharedLock.LockShared();
+		source = buffer->sharedContent;
+		buffer->sharedLock.UnlockShared();
+	}
+	else if (data->IsReadable() && !data->IsWritable() && !data->IsTransient())
+	{
+		source = const_cast<DKData*>(data);
+		if (!source.IsManaged())
+			source = NULL;
+	}
+
+	if (source)
+	{
+		size_t length = source->Length();
+		DKCriticalSection<DKSharedLock> guard(this->sharedLock);
+		ReleaseContent();
+		if (length > 0)
+		{
+			this->sharedContent = source;
+			this->contentLength = length;
+		}
+		return true;
+	}
+	return false;
+}
@@ -23,6 +23,10 @@ namespace DKFoundation
 	///
 	/// @note
 	///  Encode means 'encode with base64' in this class
+	///
+	///  Content of immutable (not writable, not transient) data object is
+	///  shared instead of copied, buffer makes private copy on first
+	///  modification. (copy-on-write)
 	class DKGL_API DKBuffer : public DKData
 	{
 	public:
@@ -46,10 +50,25 @@ namespace DKFoundation
 		static DKObject<DKBuffer> Decompress(const void* p, size_t len, DKAllocator& alloc = DKAllocator::DefaultAllocator());
 
 		/// base64 encode / decode
+		/// encoder and decoder use SIMD instructions (AVX2, NEON) if available.
+		/// decoder skips whitespaces, stops at padding or invalid character.
 		bool Base64Encode(DKStringU8& strOut) const;
 		bool Base64Encode(DKStringW& strOut) const;
+		/// write encoded text to stream, returns number of characters written.
+		size_t Base64Encode(DKStream* output) const;
 		static DKObject<DKBuffer> Base64Decode(const DKStringU8& str, DKAllocator& alloc = DKAllocator::DefaultAllocator());
 		static DKObject<DKBuffer> Base64Decode(const DKStringW& str, DKAllocator& alloc = DKAllocator::DefaultAllocator());
+		/// decode text from stream until padding or end of stream.
+		static DKObject<DKBuffer> Base64Decode(DKStream* input, DKAllocator& alloc = DKAllocator::DefaultAllocator());
+
+		/// encode to preallocated memory, output must have Base64EncodedLength(length) bytes.
+		/// returns number of characters written. (output is not null-terminated)
+		static size_t Base64Encode(const void* p, size_t length, char* output);
+		/// decode to preallocated memory, output must have Base64DecodedLength(length) bytes.
+		/// returns number of bytes written.
+		static size_t Base64Decode(const char* str, size_t length, void* output);
+		static constexpr size_t Base64EncodedLength(size_t length) { return (length + 2) / 3 * 4; }
+		static constexpr size_t Base64DecodedLength(size_t length) { return (length + 3) / 4 * 3; }
 
 		/// create object from file or URL.
 		static DKObject<DKBuffer> Create(const DKString& url, DKAllocator& alloc = DKAllocator::DefaultAllocator());
@@ -84,9 +103,14 @@ namespace DKFoundation
 		void UnlockContent();
 
 	private:
+		void ReleaseContent();
+		bool DetachContent();
+		bool ShareContent(const DKData*);
+
 		void*	contentPtr;
 		size_t	contentLength;
 		DKSharedLock sharedLock;
 		DKAllocator* allocator;
+		DKObject<DKData> sharedContent; ///< immutable source of content (copy-on-write)
 	};
 }
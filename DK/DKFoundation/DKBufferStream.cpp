@@ -33,7 +33,7 @@ DKBufferStream::~DKBufferStream()
 
 DKStream::Position DKBufferStream::SetCurrentPosition(Position p)
 {
-	if (p < TotalLength())
+	if (p <= TotalLength())
 		this->offset = p;
 	else
 		return PositionError;
@@ -131,6 +131,91 @@ size_t DKBufferStream::Write(const void* p, size_t s)
 	return 0;
 }
 
+size_t DKBufferStream::ReadAt(Position pos, void* p, size_t s)
+{
+	IOVector v = { p, s };
+	return ReadVAt(pos, &v, 1);
+}
+
+size_t DKBufferStream::WriteAt(Position pos, const void* p, size_t s)
+{
+	IOVector v = { const_cast<void*>(p), s };
+	return WriteVAt(pos, &v, 1);
+}
+
+size_t DKBufferStream::ReadV(const IOVector* v, size_t count)
+{
+	if (this->data)
+	{
+		Position pos = CurrentPosition();
+		size_t bytesRead = ReadVAt(pos, v, count);
+		this->offset = pos + bytesRead;
+		return bytesRead;
+	}
+	this->offset = 0;
+	return 0;
+}
+
+size_t DKBufferStream::WriteV(const IOVector* v, size_t count)
+{
+	size_t bytesWritten = WriteVAt(this->offset, v, count);
+	if (bytesWritten != PositionError)
+		this->offset += bytesWritten;
+	return bytesWritten;
+}
+
+size_t DKBufferStream::ReadVAt(Position pos, const IOVector* v, size_t count)
+{
+	size_t bytesRead = 0;
+	if (this->data)
+	{
+		const char* ptr = reinterpret_cast<const char*>(this->data->LockShared());
+		size_t contentSize = this->data->Length();
+		for (size_t i = 0; i < count && pos < contentSize; ++i)
+		{
+			size_t s = Min(v[i].length, size_t(contentSize - pos));
+			memcpy(v[i].data, &ptr[pos], s);
+			pos += s;
+			bytesRead += s;
+		}
+		this->data->UnlockShared();
+	}
+	return bytesRead;
+}
+
+size_t DKBufferStream::WriteVAt(Position pos, const IOVector* v, size_t count)
+{
+	size_t length = 0;
+	for (size_t i = 0; i < count; ++i)
+		length += v[i].length;
+	if (length == 0)
+		return 0;
+
+	if (this->data == NULL)
+		this->data = DKBuffer::Create(NULL, 0);
+
+	size_t contentSize1 = this->data->Length();
+	size_t contentSize2 = pos + length;
+	if (contentSize2 > contentSize1) // extend
+	{
+		if (!this->data->SetLength(contentSize2))
+		{
+			return PositionError;
+		}
+	}
+
+	unsigned char* ptr = reinterpret_cast<unsigned char*>(this->data->LockExclusive());
+	if (pos > contentSize1) // fill gap with zero
+		::memset(&ptr[contentSize1], 0, pos - contentSize1);
+	for (size_t i = 0; i < count; ++i)
+	{
+		::memcpy(&ptr[pos], v[i].data, v[i].length);
+		pos += v[i].length;
+	}
+	this->data->UnlockExclusive();
+	return length;
+}
+
 void DKBufferStream::ResetStream(const void* p, size_t s)
 {
 	if (p && s)
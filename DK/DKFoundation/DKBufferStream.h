@@ -32,6 +32,13 @@ namespace DKFoundation
 		size_t Read(void* p, size_t s) override;
 		size_t Write(const void* p, size_t s) override;
 
+		size_t ReadAt(Position pos, void* p, size_t s) override;
+		size_t WriteAt(Position pos, const void* p, size_t s) override;
+		size_t ReadV(const IOVector* v, size_t count) override;
+		size_t WriteV(const IOVector* v, size_t count) override;
+		size_t ReadVAt(Position pos, const IOVector* v, size_t count) override;
+		size_t WriteVAt(Position pos, const IOVector* v, size_t count) override;
+
 		bool IsReadable() const override { return true; }
 		bool IsSeekable() const override { return true; }
 		bool IsWritable() const override { return true; }
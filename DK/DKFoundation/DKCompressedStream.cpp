@@ -0,0 +1,504 @@
+//
+//  File: DKCompressedStream.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKCompressedStream.h"
+#include "DKBuffer.h"
+#include "DKBufferStream.h"
+#include "DKDataStream.h"
+#include "DKEndianness.h"
+#include "DKMutex.h"
+#include "DKCriticalSection.h"
+#include "DKLog.h"
+
+// zstd seekable format.
+// seek table is skippable frame at the end of container.
+//  [skippable magic][frame size][entries: compressed size, decompressed size]...
+//  [number of frames][descriptor][seekable magic]
+#define SEEKTABLE_SKIPPABLE_MAGIC   0x184D2A5EU
+#define SEEKTABLE_FOOTER_MAGIC      0x8F92EAB1U
+#define SEEKTABLE_FOOTER_SIZE       9
+#define SEEKTABLE_CHECKSUM_FLAG     0x80
+#define SEEKTABLE_MAX_FRAME_SIZE    0x40000000U
+
+namespace DKFoundation::Private
+{
+    struct CompressedStreamFrame
+    {
+        uint64_t compressedOffset;
+        uint64_t decompressedOffset;
+        uint32_t compressedSize;
+        uint32_t decompressedSize;
+    };
+
+    struct CompressedStreamCachedFrame
+    {
+        size_t index;
+        DKObject<DKBuffer> data;
+    };
+
+    struct CompressedStreamContext
+    {
+        DKObject<DKStream> source;
+        DKObject<DKCompressor::Dictionary> dictionary;
+        DKArray<CompressedStreamFrame> frames;
+        uint64_t totalLength;
+
+        DKMutex sourceLock;
+        DKMutex cacheLock;
+        DKArray<CompressedStreamCachedFrame> cache;  // LRU, most recent at end
+        size_t cacheSize;
+
+        // returns index of frame which contains pos.
+        size_t FindFrame(uint64_t pos) const
+        {
+            size_t begin = 0;
+            size_t end = frames.Count();
+            while (begin < end)
+            {
+                size_t mid = (begin + end) / 2;
+                const CompressedStreamFrame& f = frames.Value(mid);
+                if (pos < f.decompressedOffset)
+                    end = mid;
+                else if (pos >= f.decompressedOffset + f.decompressedSize)
+                    begin = mid + 1;
+                else
+                    return mid;
+            }
+            return frames.Count();
+        }
+
+        void PurgeCache(size_t maxCount)
+        {
+            DKArray<CompressedStreamCachedFrame> purged;
+            {
+                DKCriticalSection<DKMutex> guard(cacheLock);
+                if (cache.Count() > maxCount)
+                {
+                    size_t count = cache.Count() - maxCount;
+                    purged.Reserve(count);
+                    for (size_t i = 0; i < count; ++i)
+                        purged.Add(cache.Value(i));
+                    cache.Remove(0, count);
+                }
+            }
+            // buffers are released after unlock.
+        }
+
+        DKObject<DKBuffer> DecodeFrame(size_t index)
+        {
+            const CompressedStreamFrame& frame = frames.Value(index);
+
+            DKObject<DKBuffer> compressed = DKBuffer::Create(NULL, frame.compressedSize);
+            if (compressed == NULL || compressed->Length() != frame.compressedSize)
+            {
+                DKLogE("DKCompressedStream Error: Out of memory!");
+                return NULL;
+            }
+            {
+                DKCriticalSection<DKMutex> guard(sourceLock);
+                void* p = compressed->LockExclusive();
+                size_t read = source->ReadAt(frame.compressedOffset, p, frame.compressedSize);
+                compressed->UnlockExclusive();
+                if (read != frame.compressedSize)
+                {
+                    DKLogE("DKCompressedStream Error: Input stream error!");
+                    return NULL;
+                }
+            }
+
+            DKObject<DKBuffer> decompressed = DKBuffer::Create(NULL, 0);
+            DKDataStream input(compressed);
+            DKBufferStream output(decompressed);
+            if (!DKCompressor::Decompress(&input, &output, dictionary))
+            {
+                DKLogE("DKCompressedStream Error: Failed to decompress frame %zu", index);
+                return NULL;
+            }
+            if (decompressed->Length() != frame.decompressedSize)
+            {
+                DKLogE("DKCompressedStream Error: Frame %zu size mismatch", index);
+                return NULL;
+            }
+            return decompressed;
+        }
+
+        DKObject<DKBuffer> Frame(size_t index)
+        {
+            {
+                DKCriticalSection<DKMutex> guard(cacheLock);
+                for (size_t i = cache.Count(); i > 0; --i)
+                {
+                    if (cache.Value(i - 1).index == index)
+                    {
+                        CompressedStreamCachedFrame f = cache.Value(i - 1);
+                        if (i < cache.Count())
+                        {
+                            cache.Remove(i - 1);
+                            cache.Add(f);
+                        }
+                        return f.data;
+                    }
+                }
+            }
+            // decode without lock. other threads can decode same frame,
+            // in that case, cached frame is replaced.
+            DKObject<DKBuffer> data = DecodeFrame(index);
+            if (data)
+            {
+                {
+                    DKCriticalSection<DKMutex> guard(cacheLock);
+                    for (size_t i = 0; i < cache.Count(); ++i)
+                    {
+                        if (cache.Value(i).index == index)
+                        {
+                            cache.Remove(i);
+                            break;
+                        }
+                    }
+                    if (cacheSize > 0)
+                        cache.Add({ index, data });
+                }
+                PurgeCache(cacheSize);
+            }
+            return data;
+        }
+
+        bool LoadSeekTable()
+        {
+            uint64_t sourceLength = source->TotalLength();
+            if (sourceLength == DKStream::PositionError || sourceLength < SEEKTABLE_FOOTER_SIZE + 8)
+                return false;
+
+            uint8_t footer[SEEKTABLE_FOOTER_SIZE];
+            if (source->ReadAt(sourceLength - SEEKTABLE_FOOTER_SIZE, footer, SEEKTABLE_FOOTER_SIZE) != SEEKTABLE_FOOTER_SIZE)
+                return false;
+
+            auto readUInt32 = [](const uint8_t* p)->uint32_t
+            {
+                uint32_t v;
+                memcpy(&v, p, sizeof(v));
+                return DKLittleEndianToSystem(v);
+            };
+            if (readUInt32(&footer[5]) != SEEKTABLE_FOOTER_MAGIC)
+                return false;
+
+            const uint32_t numFrames = readUInt32(&footer[0]);
+            const uint8_t descriptor = footer[4];
+            const size_t entrySize = (descriptor & SEEKTABLE_CHECKSUM_FLAG) ? 12 : 8;
+            const uint64_t tableSize = uint64_t(numFrames) * entrySize + SEEKTABLE_FOOTER_SIZE + 8;
+            if (tableSize > sourceLength)
+                return false;
+
+            DKObject<DKBuffer> table = DKBuffer::Create(NULL, size_t(tableSize));
+            if (table == NULL || table->Length() != tableSize)
+                return false;
+
+            uint8_t* p = reinterpret_cast<uint8_t*>(table->LockExclusive());
+            bool result = false;
+            if (source->ReadAt(sourceLength - tableSize, p, size_t(tableSize)) == tableSize &&
+                readUInt32(&p[0]) == SEEKTABLE_SKIPPABLE_MAGIC &&
+                readUInt32(&p[4]) == tableSize - 8)
+            {
+                // frames are stored right before seek table, container
+                // can be placed after other data in source.
+                uint64_t compressedLength = 0;
+                const uint8_t* entry = &p[8];
+                for (uint32_t i = 0; i < numFrames; ++i)
+                {
+                    compressedLength += readUInt32(&entry[0]);
+                    entry += entrySize;
+                }
+                if (compressedLength <= sourceLength - tableSize)
+                {
+                    result = true;
+                    frames.Reserve(numFrames);
+                    uint64_t compressedOffset = sourceLength - tableSize - compressedLength;
+                    uint64_t decompressedOffset = 0;
+                    entry = &p[8];
+                    for (uint32_t i = 0; i < numFrames; ++i)
+                    {
+                        CompressedStreamFrame frame = {
+                            compressedOffset,
+                            decompressedOffset,
+                            readUInt32(&entry[0]),
+                            readUInt32(&entry[4]),
+                        };
+                        if (frame.decompressedSize > 0)  // skip empty frames.
+                            frames.Add(frame);
+                        compressedOffset += frame.compressedSize;
+                        decompressedOffset += frame.decompressedSize;
+                        entry += entrySize;
+                    }
+                    totalLength = decompressedOffset;
+                }
+                else
+                {
+                    DKLogE("DKCompressedStream Error: Invalid seek table.");
+                }
+            }
+            table->UnlockExclusive();
+            return result;
+        }
+    };
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+DKCompressedStreamWriter::DKCompressedStreamWriter(DKStream* s, DKCompressor::Method m, size_t fs, DKCompressor::Dictionary* d)
+	: output(s)
+	, compressor(m, d)
+	, frameBuffer(NULL)
+	, frameSize(Clamp(fs, size_t(1), size_t(SEEKTABLE_MAX_FRAME_SIZE)))
+	, frameLength(0)
+	, totalLength(0)
+	, baseOffset(0)
+	, compressedLength(0)
+	, finalized(false)
+	, failed(false)
+{
+	if (output && output->IsWritable())
+	{
+		baseOffset = output->CurrentPosition();
+		frameBuffer = DKMalloc(frameSize);
+	}
+	if (frameBuffer == NULL)
+		failed = true;
+}
+
+DKCompressedStreamWriter::~DKCompressedStreamWriter()
+{
+	Finalize();
+	if (frameBuffer)
+		DKFree(frameBuffer);
+}
+
+size_t DKCompressedStreamWriter::Write(const void* p, size_t s)
+{
+	if (finalized || failed)
+		return PositionError;
+
+	size_t written = 0;
+	while (written < s)
+	{
+		size_t n = Min(s - written, frameSize - frameLength);
+		memcpy(&reinterpret_cast<uint8_t*>(frameBuffer)[frameLength], &reinterpret_cast<const uint8_t*>(p)[written], n);
+		frameLength += n;
+		written += n;
+		if (frameLength == frameSize)
+		{
+			if (!WriteFrame())
+				return PositionError;
+		}
+	}
+	totalLength += written;
+	return written;
+}
+
+bool DKCompressedStreamWriter::WriteFrame()
+{
+	DKASSERT_DEBUG(frameLength > 0);
+
+	DKObject<DKBuffer> compressed = DKBuffer::Create(NULL, 0);
+	DKObject<DKData> frameData = DKData::StaticData(frameBuffer, frameLength, true);
+	DKDataStream input(frameData);
+	DKBufferStream bufferStream(compressed);
+	if (compressor.Compress(&input, &bufferStream))
+	{
+		size_t compressedSize = compressed->Length();
+		const void* ptr = compressed->LockShared();
+		size_t n = output->Write(ptr, compressedSize);
+		compressed->UnlockShared();
+		if (n == compressedSize && compressedSize <= 0xffffffffU)
+		{
+			frames.Add({ uint32_t(compressedSize), uint32_t(frameLength) });
+			compressedLength += compressedSize;
+			frameLength = 0;
+			return true;
+		}
+		DKLogE("DKCompressedStreamWriter Error: Output stream error!");
+	}
+	else
+	{
+		DKLogE("DKCompressedStreamWriter Error: Compression failed!");
+	}
+	failed = true;
+	return false;
+}
+
+bool DKCompressedStreamWriter::Finalize()
+{
+	if (finalized)
+		return !failed;
+	finalized = true;
+
+	if (failed)
+		return false;
+	if (frameLength > 0 && !WriteFrame())
+		return false;
+
+	// frames must be contiguous from base offset, seek table is located
+	// relative to it. (the reader finds frames from end of the container)
+	if (baseOffset != PositionError)
+	{
+		Position pos = output->CurrentPosition();
+		if (pos != PositionError && pos - baseOffset != compressedLength)
+		{
+			DKLogE("DKCompressedStreamWriter Error: Output stream position mismatch!");
+			failed = true;
+			return false;
+		}
+	}
+
+	// seek table
+	const size_t tableSize = frames.Count() * 8 + SEEKTABLE_FOOTER_SIZE + 8;
+	DKObject<DKBuffer> table = DKBuffer::Create(NULL, tableSize);
+	uint8_t* p = reinterpret_cast<uint8_t*>(table->LockExclusive());
+	auto writeUInt32 = [&p](uint32_t v)
+	{
+		v = DKSystemToLittleEndian(v);
+		memcpy(p, &v, sizeof(v));
+		p += sizeof(v);
+	};
+	writeUInt32(SEEKTABLE_SKIPPABLE_MAGIC);
+	writeUInt32(uint32_t(tableSize - 8));
+	for (const FrameEntry& e : frames)
+	{
+		writeUInt32(e.compressedSize);
+		writeUInt32(e.decompressedSize);
+	}
+	writeUInt32(uint32_t(frames.Count()));
+	*p++ = 0;	// descriptor, no checksum.
+	writeUInt32(SEEKTABLE_FOOTER_MAGIC);
+	table->UnlockExclusive();
+
+	const void* ptr = table->LockShared();
+	size_t n = output->Write(ptr, tableSize);
+	table->UnlockShared();
+	if (n != tableSize)
+	{
+		DKLogE("DKCompressedStreamWriter Error: Output stream error!");
+		failed = true;
+	}
+	return !failed;
+}
+
+#define COMPRESSED_STREAM_IMPL	reinterpret_cast<CompressedStreamContext*>(this->impl)
+
+DKCompressedStream::DKCompressedStream()
+	: impl(NULL)
+	, position(0)
+{
+}
+
+DKCompressedStream::~DKCompressedStream()
+{
+	delete COMPRESSED_STREAM_IMPL;
+}
+
+DKObject<DKCompressedStream> DKCompressedStream::Open(DKStream* source, size_t cacheSize, DKCompressor::Dictionary* dictionary)
+{
+	if (source == NULL || !source->IsReadable() || !source->IsSeekable())
+		return NULL;
+
+	CompressedStreamContext* ctxt = new CompressedStreamContext();
+	ctxt->source = source;
+	ctxt->dictionary = dictionary;
+	ctxt->totalLength = 0;
+	ctxt->cacheSize = cacheSize;
+	if (!ctxt->LoadSeekTable())
+	{
+		DKLogE("DKCompressedStream Error: Source is not seekable compressed stream.");
+		delete ctxt;
+		return NULL;
+	}
+	DKObject<DKCompressedStream> stream = DKObject<DKCompressedStream>::New();
+	stream->impl = ctxt;
+	return stream;
+}
+
+DKStream::Position DKCompressedStream::SetCurrentPosition(Position p)
+{
+	if (p > TotalLength())
+		return PositionError;
+	position = p;
+	return position;
+}
+
+DKStream::Position DKCompressedStream::CurrentPosition() const
+{
+	return position;
+}
+
+DKStream::Position DKCompressedStream::RemainLength() const
+{
+	Position total = TotalLength();
+	return position < total ? total - position : 0;
+}
+
+DKStream::Position DKCompressedStream::TotalLength() const
+{
+	return COMPRESSED_STREAM_IMPL->totalLength;
+}
+
+size_t DKCompressedStream::Read(void* p, size_t s)
+{
+	size_t n = ReadAt(position, p, s);
+	if (n != PositionError)
+		position += n;
+	return n;
+}
+
+size_t DKCompressedStream::ReadAt(Position pos, void* p, size_t s)
+{
+	CompressedStreamContext* ctxt = COMPRESSED_STREAM_IMPL;
+	size_t bytesRead = 0;
+	size_t index = ctxt->FindFrame(pos);
+	while (bytesRead < s && index < ctxt->frames.Count())
+	{
+		const CompressedStreamFrame& frame = ctxt->frames.Value(index);
+		DKObject<DKBuffer> data = ctxt->Frame(index);
+		if (data == NULL)
+			return bytesRead > 0 ? bytesRead : PositionError;
+
+		size_t offset = size_t(pos - frame.decompressedOffset);
+		size_t n = Min(s - bytesRead, size_t(frame.decompressedSize) - offset);
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(data->LockShared());
+		memcpy(&reinterpret_cast<uint8_t*>(p)[bytesRead], &src[offset], n);
+		data->UnlockShared();
+
+		bytesRead += n;
+		pos += n;
+		index++;
+	}
+	return bytesRead;
+}
+
+size_t DKCompressedStream::NumberOfFrames() const
+{
+	return COMPRESSED_STREAM_IMPL->frames.Count();
+}
+
+void DKCompressedStream::SetCacheSize(size_t n)
+{
+	CompressedStreamContext* ctxt = COMPRESSED_STREAM_IMPL;
+	{
+		DKCriticalSection<DKMutex> guard(ctxt->cacheLock);
+		ctxt->cacheSize = n;
+	}
+	ctxt->PurgeCache(n);
+}
+
+size_t DKCompressedStream::CacheSize() const
+{
+	return COMPRESSED_STREAM_IMPL->cacheSize;
+}
+
+void DKCompressedStream::PurgeCache()
+{
+	COMPRESSED_STREAM_IMPL->PurgeCache(0);
+}
@@ -0,0 +1,138 @@
+//
+//  File: DKCompressedStream.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKStream.h"
+#include "DKObject.h"
+#include "DKArray.h"
+#include "DKCompressor.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Writes seekable compressed container.
+
+	 Input is split into frames of fixed size, each frame is compressed
+	 independently with DKCompressor. Seek table is appended to the end of
+	 output as skippable frame. (zstd seekable format)
+	 With DKCompressor::Zstd, output can be decompressed with zstd tools
+	 or DKCompressor::Decompress as a whole.
+
+	 Container begins at current position of output stream, existing data
+	 before it is preserved. Output must not be written by others until
+	 finalized, frames must be contiguous.
+
+	 @code
+	  DKCompressedStreamWriter writer(fileStream, DKCompressor::Zstd);
+	  writer.Write(data, length);
+	  writer.Finalize();	// write last frame and seek table.
+	 @endcode
+	 @see DKCompressedStream
+	 */
+	class DKGL_API DKCompressedStreamWriter : public DKStream
+	{
+	public:
+		enum { DefaultFrameSize = 0x40000 };
+
+		DKCompressedStreamWriter(DKStream* output, DKCompressor::Method method, size_t frameSize = DefaultFrameSize, DKCompressor::Dictionary* dictionary = NULL);
+		~DKCompressedStreamWriter();	///< calls Finalize()
+
+		/// compress remaining data and write seek table.
+		/// stream cannot be written after finalized.
+		bool Finalize();
+
+		Position SetCurrentPosition(Position p) override	{ return PositionError; }
+		Position CurrentPosition() const override			{ return totalLength; }
+		Position RemainLength() const override				{ return 0; }
+		Position TotalLength() const override				{ return totalLength; }
+
+		size_t Read(void* p, size_t s) override				{ return 0; }
+		size_t Write(const void* p, size_t s) override;
+
+		bool IsReadable() const override { return false; }
+		bool IsWritable() const override { return !finalized && output != NULL; }
+		bool IsSeekable() const override { return false; }
+
+		size_t NumberOfFrames() const { return frames.Count(); }
+
+	private:
+		DKCompressedStreamWriter(const DKCompressedStreamWriter&) = delete;
+		DKCompressedStreamWriter& operator = (const DKCompressedStreamWriter&) = delete;
+
+		bool WriteFrame();
+
+		struct FrameEntry
+		{
+			uint32_t compressedSize;
+			uint32_t decompressedSize;
+		};
+		DKObject<DKStream> output;
+		DKCompressor compressor;
+		DKArray<FrameEntry> frames;
+		void* frameBuffer;
+		size_t frameSize;
+		size_t frameLength;
+		Position totalLength;
+		Position baseOffset;		///< output position of first frame.
+		uint64_t compressedLength;	///< compressed bytes written from baseOffset.
+		bool finalized;
+		bool failed;
+	};
+
+	/**
+	 @brief
+	 Read-only seekable stream of compressed container.
+
+	 Source must be seekable container written by DKCompressedStreamWriter
+	 (or zstd seekable format). Container must end at the end of source,
+	 data before container is ignored. Reading at any position decompresses
+	 only frames containing requested range, decoded frames are kept in
+	 small LRU cache.
+	 ReadAt() does not use current position and can be called from
+	 multiple threads.
+	 */
+	class DKGL_API DKCompressedStream : public DKStream
+	{
+	public:
+		~DKCompressedStream();
+
+		/// open container, returns NULL if source is not valid container.
+		/// cacheSize: number of decoded frames cached.
+		static DKObject<DKCompressedStream> Open(DKStream* source, size_t cacheSize = 4, DKCompressor::Dictionary* dictionary = NULL);
+
+		Position SetCurrentPosition(Position p) override;
+		Position CurrentPosition() const override;
+		Position RemainLength() const override;
+		Position TotalLength() const override;
+
+		size_t Read(void* p, size_t s) override;
+		size_t Write(const void* p, size_t s) override { return 0; }
+		size_t ReadAt(Position pos, void* p, size_t s) override;
+		size_t WriteAt(Position pos, const void* p, size_t s) override { return 0; }
+
+		bool IsReadable() const override { return true; }
+		bool IsWritable() const override { return false; }
+		bool IsSeekable() const override { return true; }
+
+		size_t NumberOfFrames() const;
+		void SetCacheSize(size_t);
+		size_t CacheSize() const;
+		/// remove decoded frames from cache.
+		void PurgeCache();
+
+	private:
+		DKCompressedStream();
+		DKCompressedStream(const DKCompressedStream&) = delete;
+		DKCompressedStream& operator = (const DKCompressedStream&) = delete;
+
+		void* impl;
+		Position position;
+		friend class DKObject<DKCompressedStream>;
+	};
+}
@@ -10,7 +10,9 @@
 
 #include "../Libs/zlib/zlib.h"
 
+#define ZSTD_STATIC_LINKING_ONLY
 #include "../Libs/zstd/lib/zstd.h"
+#include "../Libs/zstd/lib/dictBuilder/zdict.h"
 
 #include "../Libs/lz4/lib/lz4.h"
 #include "../Libs/lz4/lib/lz4hc.h"
@@ -20,9 +22,24 @@
 #include "DKCompressor.h"
 #include "DKEndianness.h"
 #include "DKLog.h"
+#include "DKMap.h"
+#include "DKMutex.h"
+#include "DKCriticalSection.h"
+#include "DKDataStream.h"
+#include "DKMetrics.h"
 
 #define COMPRESSION_CHUNK_SIZE 0x40000
 
+// LZ4 frame with dictionary. (lz4 frame format does not support dictionary)
+// Header is LZ4 skippable frame which contains signature, dictionary ID
+// and block size, followed by blocks of [uint32 compressed-size][data],
+// terminated with zero size and CRC32 of content.
+#define LZ4_DICT_FRAME_MAGIC        0x184D2A5DU
+#define LZ4_DICT_FRAME_SIGNATURE    0x34444B44U // 'DKD4'
+#define LZ4_DICT_FRAME_HEADER_SIZE  20
+#define LZ4_DICT_BLOCK_SIZE         0x10000
+#define LZ4_DICT_MAX_SIZE           0x10000     // LZ4 uses last 64KB of dictionary
+
 namespace DKFoundation::Private
 {
     struct CompressorBuffer
@@ -43,7 +60,301 @@ namespace DKFoundation::Private
         }
     };
 
-    static bool CompressDeflate(DKStream* input, DKStream* output, int level)
+    class CompressorDictionary
+    {
+    public:
+        DKObject<DKData> content;   // immutable copy, address is stable.
+        const void* data;
+        size_t length;
+        uint32_t id;
+        uLong adler;    // zlib dictionary ID
+
+        CompressorDictionary(const void* p, size_t len)
+            : data(NULL), length(0), id(0), adler(0)
+            , zstdCDict{ NULL, NULL }, zstdDDict(NULL), lz4Stream(NULL)
+        {
+            void* buffer = DKMalloc(len);
+            if (buffer)
+            {
+                memcpy(buffer, p, len);
+                content = DKData::StaticData(buffer, len, true, DKFunction([buffer]
+                {
+                    DKFree(buffer);
+                })->Invocation());
+                data = buffer;
+                length = len;
+                id = ZDICT_getDictID(data, length);
+                adler = adler32(adler32(0L, Z_NULL, 0), (const Bytef*)data, (uInt)length);
+            }
+        }
+        ~CompressorDictionary()
+        {
+            for (ZSTD_CDict* cdict : zstdCDict)
+            {
+                if (cdict)
+                    ZSTD_freeCDict(cdict);
+            }
+            if (zstdDDict)
+                ZSTD_freeDDict(zstdDDict);
+            if (lz4Stream)
+                LZ4_freeStream(lz4Stream);
+        }
+
+        // digested dictionaries are created on first use, and
+        // shared by all threads (read-only) until dictionary is destroyed.
+        const ZSTD_CDict* ZstdCDict(int level)
+        {
+            int index = level > ZSTD_CLEVEL_DEFAULT ? 1 : 0;
+            DKCriticalSection<DKMutex> guard(lock);
+            if (zstdCDict[index] == NULL)
+            {
+                zstdCDict[index] = ZSTD_createCDict_advanced(data, length,
+                                                             ZSTD_dlm_byRef,
+                                                             ZSTD_dct_auto,
+                                                             ZSTD_getCParams(level, 0, length),
+                                                             ZSTD_defaultCMem);
+                if (zstdCDict[index] == NULL)
+                    DKLogE("DKCompressor Error: ZSTD_createCDict failed");
+            }
+            return zstdCDict[index];
+        }
+        const ZSTD_DDict* ZstdDDict()
+        {
+            DKCriticalSection<DKMutex> guard(lock);
+            if (zstdDDict == NULL)
+            {
+                zstdDDict = ZSTD_createDDict_byReference(data, length);
+                if (zstdDDict == NULL)
+                    DKLogE("DKCompressor Error: ZSTD_createDDict failed");
+            }
+            return zstdDDict;
+        }
+        const LZ4_stream_t* LZ4Stream()
+        {
+            DKCriticalSection<DKMutex> guard(lock);
+            if (lz4Stream == NULL)
+            {
+                lz4Stream = LZ4_createStream();
+                if (lz4Stream)
+                {
+                    const char* dict;
+                    int dictSize;
+                    LZ4Dictionary(dict, dictSize);
+                    LZ4_loadDict(lz4Stream, dict, dictSize);
+                }
+                else
+                    DKLogE("DKCompressor Error: Out of memory!");
+            }
+            return lz4Stream;
+        }
+        void LZ4Dictionary(const char*& dict, int& dictSize) const
+        {
+            size_t s = Min(length, size_t(LZ4_DICT_MAX_SIZE));
+            dict = &reinterpret_cast<const char*>(data)[length - s];
+            dictSize = int(s);
+        }
+
+    private:
+        DKMutex lock;
+        ZSTD_CDict* zstdCDict[2];   // default, max
+        ZSTD_DDict* zstdDDict;
+        LZ4_stream_t* lz4Stream;
+    };
+
+    struct CompressorDictionaryRegistry
+    {
+        struct Entry
+        {
+            DKObject<DKCompressor::Dictionary> dictionary;
+            CompressorDictionary* dict;
+        };
+        DKMutex lock;
+        DKMap<uint32_t, Entry> entries;
+
+        bool Find(uint32_t id, Entry& entry)
+        {
+            DKCriticalSection<DKMutex> guard(lock);
+            if (auto p = entries.Find(id); p)
+            {
+                entry = p->value;
+                return true;
+            }
+            return false;
+        }
+        bool FindAdler32(uLong adler, Entry& entry)
+        {
+            bool found = false;
+            DKCriticalSection<DKMutex> guard(lock);
+            entries.EnumerateForward([&](decltype(entries)::Pair& pair, bool* stop)
+            {
+                if (pair.value.dict->adler == adler)
+                {
+                    entry = pair.value;
+                    found = true;
+                    *stop = true;
+                }
+            });
+            return found;
+        }
+
+        static CompressorDictionaryRegistry& Instance()
+        {
+            static CompressorDictionaryRegistry registry;
+            return registry;
+        }
+    };
+
+    // compression contexts cached per thread.
+    // context is detached from cache while in use, nested call creates new one.
+    struct CompressorThreadContext
+    {
+        ZSTD_CCtx* zstdCCtx = NULL;
+        ZSTD_DCtx* zstdDCtx = NULL;
+        LZ4F_compressionContext_t lz4CCtx = NULL;
+        LZ4F_decompressionContext_t lz4DCtx = NULL;
+
+        ~CompressorThreadContext()
+        {
+            if (zstdCCtx)
+                ZSTD_freeCCtx(zstdCCtx);
+            if (zstdDCtx)
+                ZSTD_freeDCtx(zstdDCtx);
+            if (lz4CCtx)
+                LZ4F_freeCompressionContext(lz4CCtx);
+            if (lz4DCtx)
+                LZ4F_freeDecompressionContext(lz4DCtx);
+        }
+        static CompressorThreadContext& Instance()
+        {
+            static thread_local CompressorThreadContext context;
+            return context;
+        }
+
+        static ZSTD_CCtx* AcquireZstdCCtx()
+        {
+            ZSTD_CCtx* cctx = Instance().zstdCCtx;
+            Instance().zstdCCtx = NULL;
+            return cctx ? cctx : ZSTD_createCCtx();
+        }
+        static void ReleaseZstdCCtx(ZSTD_CCtx* cctx)
+        {
+            if (Instance().zstdCCtx == NULL)
+            {
+                ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+                Instance().zstdCCtx = cctx;
+            }
+            else
+                ZSTD_freeCCtx(cctx);
+        }
+        static ZSTD_DCtx* AcquireZstdDCtx()
+        {
+            ZSTD_DCtx* dctx = Instance().zstdDCtx;
+            Instance().zstdDCtx = NULL;
+            return dctx ? dctx : ZSTD_createDCtx();
+        }
+        static void ReleaseZstdDCtx(ZSTD_DCtx* dctx)
+        {
+            if (Instance().zstdDCtx == NULL)
+            {
+                ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+                Instance().zstdDCtx = dctx;
+            }
+            else
+                ZSTD_freeDCtx(dctx);
+        }
+        static LZ4F_compressionContext_t AcquireLZ4CCtx()
+        {
+            LZ4F_compressionContext_t cctx = Instance().lz4CCtx;
+            Instance().lz4CCtx = NULL;
+            if (cctx == NULL && LZ4F_isError(LZ4F_createCompressionContext(&cctx, LZ4F_VERSION)))
+                cctx = NULL;
+            return cctx;
+        }
+        static void ReleaseLZ4CCtx(LZ4F_compressionContext_t cctx)
+        {
+            if (Instance().lz4CCtx == NULL)
+                Instance().lz4CCtx = cctx;
+            else
+                LZ4F_freeCompressionContext(cctx);
+        }
+        static LZ4F_decompressionContext_t AcquireLZ4DCtx()
+        {
+            LZ4F_decompressionContext_t dctx = Instance().lz4DCtx;
+            Instance().lz4DCtx = NULL;
+            if (dctx == NULL && LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+                dctx = NULL;
+            return dctx;
+        }
+        // context must be at the end of frame, (or not used)
+        // lz4 cannot reset decompression context.
+        static void ReleaseLZ4DCtx(LZ4F_decompressionContext_t dctx)
+        {
+            if (Instance().lz4DCtx == NULL)
+                Instance().lz4DCtx = dctx;
+            else
+                LZ4F_freeDecompressionContext(dctx);
+        }
+    };
+
+    // write-only stream of fixed size memory.
+    struct CompressorMemoryStream : public DKStream
+    {
+        uint8_t* data;
+        size_t length;
+        size_t offset;
+
+        CompressorMemoryStream(void* p, size_t len)
+            : data(reinterpret_cast<uint8_t*>(p)), length(len), offset(0)
+        {
+        }
+        Position SetCurrentPosition(Position p) override { return PositionError; }
+        Position CurrentPosition() const override { return offset; }
+        Position RemainLength() const override { return length - offset; }
+        Position TotalLength() const override { return length; }
+        size_t Read(void* p, size_t s) override { return 0; }
+        size_t Write(const void* p, size_t s) override
+        {
+            if (s > length - offset)
+                return PositionError;
+            memcpy(&data[offset], p, s);
+            offset += s;
+            return s;
+        }
+        bool IsReadable() const override { return false; }
+        bool IsWritable() const override { return true; }
+        bool IsSeekable() const override { return false; }
+    };
+
+    template <typename Fn>
+    static size_t TransferToMemory(const void* input, size_t inputLength, void* output, size_t outputLength, Fn&& fn)
+    {
+        DKDataStream inputStream(DKData::StaticData(input, inputLength));
+        CompressorMemoryStream outputStream(output, outputLength);
+        if (fn(&inputStream, &outputStream))
+            return outputStream.offset;
+        return DKCompressor::SizeError;
+    }
+
+    // find dictionary with ID in zstd frame header.
+    // returns false if frame requires dictionary which is not available.
+    static bool ResolveZstdDictionary(const void* p, size_t n, CompressorDictionary*& dict, CompressorDictionaryRegistry::Entry& entry)
+    {
+        uint32_t dictID = ZSTD_getDictID_fromFrame(p, n);
+        if (dictID == 0)
+            dict = NULL;
+        else if (dict == NULL || dict->id != dictID)
+        {
+            if (!CompressorDictionaryRegistry::Instance().Find(dictID, entry))
+            {
+                DKLogE("DKCompressor Error: Cannot find dictionary (ID: %u)", dictID);
+                return false;
+            }
+            dict = entry.dict;
+        }
+        return true;
+    }
+
+    static bool CompressDeflate(DKStream* input, DKStream* output, int level, CompressorDictionary* dict)
     {
         CompressorBuffer inputBuffer(COMPRESSION_CHUNK_SIZE);
         CompressorBuffer outputBuffer(COMPRESSION_CHUNK_SIZE);
@@ -62,6 +373,15 @@ namespace DKFoundation::Private
 
         int compressLevel = level;	// Z_DEFAULT_COMPRESSION is 6
         err = deflateInit(&stream, compressLevel);
+        if (err == Z_OK && dict)
+        {
+            err = deflateSetDictionary(&stream, (const Bytef*)dict->data, (uInt)dict->length);
+            if (err != Z_OK)
+            {
+                DKLogE("DKCompressor Error: deflateSetDictionary failed: %s", zError(err));
+                deflateEnd(&stream);
+            }
+        }
         if (err == Z_OK)
         {
             int flush = Z_NO_FLUSH;
@@ -104,7 +424,7 @@ namespace DKFoundation::Private
         return err == Z_STREAM_END;
     }
 
-    static bool DecompressDeflate(DKStream* input, DKStream* output)
+    static bool DecompressDeflate(DKStream* input, DKStream* output, CompressorDictionary* dict)
     {
         CompressorBuffer inputBuffer(COMPRESSION_CHUNK_SIZE);
         CompressorBuffer outputBuffer(COMPRESSION_CHUNK_SIZE);
@@ -149,7 +469,30 @@ namespace DKFoundation::Private
                 err = inflate(&stream, Z_NO_FLUSH);
                 DKASSERT_DEBUG(err != Z_STREAM_ERROR);
 
-                if (err == Z_NEED_DICT || err == Z_DATA_ERROR || err == Z_MEM_ERROR)
+                if (err == Z_NEED_DICT)
+                {
+                    // stream.adler is adler32 checksum of dictionary.
+                    CompressorDictionaryRegistry::Entry entry = {};
+                    if (dict == NULL || dict->adler != stream.adler)
+                    {
+                        dict = NULL;
+                        if (CompressorDictionaryRegistry::Instance().FindAdler32(stream.adler, entry))
+                            dict = entry.dict;
+                    }
+                    if (dict == NULL)
+                    {
+                        DKLogE("DKCompressor Error: Cannot find dictionary (adler32: 0x%08x)", (uint32_t)stream.adler);
+                        break;
+                    }
+                    err = inflateSetDictionary(&stream, (const Bytef*)dict->data, (uInt)dict->length);
+                    if (err != Z_OK)
+                    {
+                        DKLogE("DKCompressor Error: inflateSetDictionary failed: %s", zError(err));
+                        break;
+                    }
+                    continue;
+                }
+                if (err == Z_DATA_ERROR || err == Z_MEM_ERROR)
                     break;
 
                 size_t write = outputBuffer.bufferSize - stream.avail_out;
@@ -174,7 +517,7 @@ namespace DKFoundation::Private
         return false;
     }
 
-    static bool CompressZstd(DKStream* input, DKStream* output, int level)
+    static bool CompressZstd(DKStream* input, DKStream* output, int level, CompressorDictionary* dict)
     {
         CompressorBuffer inputBuffer(ZSTD_CStreamInSize());
         CompressorBuffer outputBuffer(ZSTD_CStreamOutSize());
@@ -197,13 +540,18 @@ namespace DKFoundation::Private
         };
         ZSTD_CStream* const cstream = ZSTD_createCStream_advanced(customMem);
 #else
-        ZSTD_CStream* const cstream = ZSTD_createCStream();
+        ZSTD_CStream* const cstream = CompressorThreadContext::AcquireZstdCCtx();
 #endif
         if (cstream)
         {
             bool result = false;
-            size_t const initResult = ZSTD_initCStream(cstream, level);
-            if (ZSTD_isError(initResult))
+            const ZSTD_CDict* cdict = dict ? dict->ZstdCDict(level) : NULL;
+            size_t const initResult = cdict ? ZSTD_initCStream_usingCDict(cstream, cdict) : ZSTD_initCStream(cstream, level);
+            if (dict && cdict == NULL)
+            {
+                DKLogE("DKCompressor::Compress error: Invalid dictionary");
+            }
+            else if (ZSTD_isError(initResult))
             {
                 DKLogE("DKCompressor::Compress error: ZSTD_initCStream failed: %s",
                        ZSTD_getErrorName(initResult));
@@ -269,7 +617,7 @@ namespace DKFoundation::Private
                     }
                 }
             }
-            ZSTD_freeCStream(cstream);
+            CompressorThreadContext::ReleaseZstdCCtx(cstream);
             return result;
         }
         else
@@ -279,7 +627,7 @@ namespace DKFoundation::Private
         return false;
     }
 
-    static bool DecompressZstd(DKStream* input, DKStream* output)
+    static bool DecompressZstd(DKStream* input, DKStream* output, CompressorDictionary* dict)
     {
         CompressorBuffer inputBuffer(ZSTD_DStreamInSize());
         CompressorBuffer outputBuffer(ZSTD_DStreamOutSize());
@@ -302,13 +650,18 @@ namespace DKFoundation::Private
         };
         ZSTD_DStream* const dstream = ZSTD_createDStream_advanced(customMem);
 #else
-        ZSTD_DStream* const dstream = ZSTD_createDStream();
+        ZSTD_DStream* const dstream = CompressorThreadContext::AcquireZstdDCtx();
 #endif
         if (dstream)
         {
             bool result = false;
-            size_t const initResult = ZSTD_initDStream(dstream);
-            if (ZSTD_isError(initResult))
+            const ZSTD_DDict* ddict = dict ? dict->ZstdDDict() : NULL;
+            size_t const initResult = ddict ? ZSTD_initDStream_usingDDict(dstream, ddict) : ZSTD_initDStream(dstream);
+            if (dict && ddict == NULL)
+            {
+                DKLogE("DKCompressor::Decompress error: Invalid dictionary");
+            }
+            else if (ZSTD_isError(initResult))
             {
                 DKLogE("DKCompressor::Compress error: ZSTD_initDStream failed: %s",
                        ZSTD_getErrorName(initResult));
@@ -342,6 +695,11 @@ namespace DKFoundation::Private
                                 break;
                             }
                         }
+                        if (!result)
+                            break;
+                        // end of frame, continue if input has next frame. (concatenated frames)
+                        if (toRead == 0)
+                            toRead = inputBuffer.bufferSize;
                     }
                     else
                     {
@@ -355,7 +713,7 @@ namespace DKFoundation::Private
                 }
             }
 
-            ZSTD_freeDStream(dstream);
+            CompressorThreadContext::ReleaseZstdDCtx(dstream);
             return result;
         }
         else
@@ -365,7 +723,7 @@ namespace DKFoundation::Private
         return false;
     }
 
-    static bool CompressLZ4(DKStream* input, DKStream* output, int level)
+    static LZ4F_preferences_t LZ4FramePreferences(int level)
     {
         LZ4F_preferences_t prefs = {};
         prefs.autoFlush = 1;
@@ -373,6 +731,12 @@ namespace DKFoundation::Private
         prefs.frameInfo.blockMode = LZ4F_blockLinked;	// for better compression ratio.
         prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled; // to detect data corruption.
         prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+        return prefs;
+    }
+
+    static bool CompressLZ4(DKStream* input, DKStream* output, int level)
+    {
+        LZ4F_preferences_t prefs = LZ4FramePreferences(level);
 
         size_t inputBufferSize = size_t(1) << (8 + (2 * prefs.frameInfo.blockSizeID));
         size_t outputBufferSize = LZ4F_compressFrameBound(inputBufferSize, &prefs);;
@@ -386,10 +750,8 @@ namespace DKFoundation::Private
             return false;
         }
 
-        LZ4F_compressionContext_t ctx;
-        LZ4F_errorCode_t err = LZ4F_createCompressionContext(&ctx, LZ4F_VERSION);
-
-        if (!LZ4F_isError(err))
+        LZ4F_compressionContext_t ctx = CompressorThreadContext::AcquireLZ4CCtx();
+        if (ctx)
         {
             bool result = false;
 
@@ -455,13 +817,13 @@ namespace DKFoundation::Private
             {
                 DKLog("DKCompressor Error: Input stream error!");
             }
-            err = LZ4F_freeCompressionContext(ctx);
-            DKASSERT_DEBUG(!LZ4F_isError(err));
+            // LZ4F_compressBegin resets context, it can be reused after error.
+            CompressorThreadContext::ReleaseLZ4CCtx(ctx);
             return result;
         }
         else
         {
-            DKLog("DKCompressor Error: LZ4 Encoder error: %s", LZ4F_getErrorName(err));
+            DKLog("DKCompressor Error: LZ4 Encoder error!");
         }
         return false;
     }
@@ -480,16 +842,15 @@ namespace DKFoundation::Private
         const uint32_t lz4_Header = DKSystemToLittleEndian(0x184D2204U);
         const uint32_t lz4_SkipHeader = DKSystemToLittleEndian(0x184D2A50U);
 
-        LZ4F_decompressionContext_t ctx;
-        LZ4F_errorCode_t err = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
-        if (!LZ4F_isError(err))
+        LZ4F_decompressionContext_t ctx = CompressorThreadContext::AcquireLZ4DCtx();
+        if (ctx)
         {
             size_t inputSize = 0;
             size_t processed = 0;
             size_t inSize, outSize;
             uint8_t* const inData = reinterpret_cast<uint8_t*>(inputBuffer.buffer);
             bool decodeError = false;
-            LZ4F_errorCode_t nextToLoad;
+            LZ4F_errorCode_t nextToLoad = 0;
 
             while (!decodeError)
             {
@@ -545,6 +906,12 @@ namespace DKFoundation::Private
                                 decodeError = true;
                                 break;
                             }
+                            else if (inputSize == 0)
+                            {
+                                DKLog("DKCompressor Error: Lz4 input stream ended before end of frame!\n");
+                                decodeError = true;
+                                break;
+                            }
                         }
                     } while (nextToLoad);
                 }
@@ -571,10 +938,11 @@ namespace DKFoundation::Private
                     {
                         uint32_t bytesToSkip = reinterpret_cast<const uint32_t*>(&inData[processed])[1];
                         bytesToSkip = DKLittleEndianToSystem(bytesToSkip);
+                        size_t frameSize = size_t(bytesToSkip) + 8; // including header
                         size_t remains = inputSize - processed;
-                        if (bytesToSkip > remains)
+                        if (frameSize > remains)
                         {
-                            size_t offset = bytesToSkip - remains;
+                            size_t offset = frameSize - remains;
                             if (input->SetCurrentPosition(input->CurrentPosition() + offset) == DKStream::PositionError)
                             {
                                 DKLog("DKCompressor Error: Lz4 input stream cannot process skip frame!\n");
@@ -582,9 +950,17 @@ namespace DKFoundation::Private
                                 break;
                             }
                             inputSize = 0;
+                            processed = 0;
                         }
                         else
-                            processed += bytesToSkip;
+                        {
+                            processed += frameSize;
+                            if (processed == inputSize)
+                            {
+                                inputSize = 0;
+                                processed = 0;
+                            }
+                        }
                     }
                 }
                 else
@@ -594,14 +970,476 @@ namespace DKFoundation::Private
                     break;
                 }
             }
-            err = LZ4F_freeDecompressionContext(ctx);
-            DKASSERT_DEBUG(!LZ4F_isError(err));
-
+            if (!decodeError && nextToLoad == 0)
+            {
+                CompressorThreadContext::ReleaseLZ4DCtx(ctx);
+            }
+            else
+            {
+                // context is in the middle of frame.
+                LZ4F_freeDecompressionContext(ctx);
+            }
             return !decodeError;
         }
+        DKLog("DKCompressor Error: LZ4 Decoder error!");
         return false;
     }
 
+    static bool CompressLZ4Dict(DKStream* input, DKStream* output, int level, CompressorDictionary* dict)
+    {
+        const size_t blockSize = LZ4_DICT_BLOCK_SIZE;
+        CompressorBuffer inputBuffer(blockSize * 2);  // double buffer, previous block is referenced.
+        CompressorBuffer outputBuffer(LZ4_COMPRESSBOUND(blockSize));
+
+        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        {
+            DKLogE("DKCompressor Error: Out of memory!");
+            return false;
+        }
+
+        LZ4_stream_t* stream = NULL;
+        LZ4_streamHC_t* streamHC = NULL;
+        if (level > 0)
+        {
+            streamHC = LZ4_createStreamHC();
+            if (streamHC)
+            {
+                const char* dictData;
+                int dictSize;
+                dict->LZ4Dictionary(dictData, dictSize);
+                LZ4_resetStreamHC(streamHC, level);
+                LZ4_loadDictHC(streamHC, dictData, dictSize);
+            }
+        }
+        else
+        {
+            const LZ4_stream_t* digested = dict->LZ4Stream();
+            if (digested)
+            {
+                stream = LZ4_createStream();
+                if (stream)
+                    memcpy(stream, digested, sizeof(LZ4_stream_t));
+            }
+        }
+        if (stream == NULL && streamHC == NULL)
+        {
+            DKLogE("DKCompressor Error: Out of memory!");
+            return false;
+        }
+
+        auto writeUInt32 = [output](uint32_t value)->bool
+        {
+            value = DKSystemToLittleEndian(value);
+            return output->Write(&value, sizeof(value)) == sizeof(value);
+        };
+
+        bool result = false;
+        uint32_t header[LZ4_DICT_FRAME_HEADER_SIZE / 4] = {
+            LZ4_DICT_FRAME_MAGIC,
+            LZ4_DICT_FRAME_HEADER_SIZE - 8, // size of skippable frame
+            LZ4_DICT_FRAME_SIGNATURE,
+            dict->id,
+            (uint32_t)blockSize,
+        };
+        for (uint32_t& v : header)
+            v = DKSystemToLittleEndian(v);
+        if (output->Write(header, sizeof(header)) == sizeof(header))
+        {
+            result = true;
+            uLong crc = crc32(0L, Z_NULL, 0);
+            int index = 0;
+            while (result)
+            {
+                char* block = &reinterpret_cast<char*>(inputBuffer.buffer)[blockSize * index];
+                size_t inputSize = 0;
+                while (inputSize < blockSize)
+                {
+                    size_t read = input->Read(&block[inputSize], blockSize - inputSize);
+                    if (read == DKStream::PositionError)
+                    {
+                        DKLogE("DKCompressor Error: Input stream error!");
+                        result = false;
+                        break;
+                    }
+                    if (read == 0)
+                        break;
+                    inputSize += read;
+                }
+                if (!result || inputSize == 0)
+                    break;
+
+                crc = crc32(crc, (const Bytef*)block, (uInt)inputSize);
+
+                char* out = reinterpret_cast<char*>(outputBuffer.buffer);
+                int outputSize = streamHC ?
+                    LZ4_compress_HC_continue(streamHC, block, out, (int)inputSize, (int)outputBuffer.bufferSize) :
+                    LZ4_compress_fast_continue(stream, block, out, (int)inputSize, (int)outputBuffer.bufferSize, 1);
+                if (outputSize <= 0)
+                {
+                    DKLogE("DKCompressor Error: LZ4 Encoding error!");
+                    result = false;
+                    break;
+                }
+                if (!writeUInt32((uint32_t)outputSize) ||
+                    output->Write(out, outputSize) != size_t(outputSize))
+                {
+                    DKLogE("DKCompressor Error: Output stream error!");
+                    result = false;
+                    break;
+                }
+                index = index ^ 1;
+            }
+            if (result)
+            {
+                // end mark, checksum
+                result = writeUInt32(0) && writeUInt32((uint32_t)crc);
+                if (!result)
+                    DKLogE("DKCompressor Error: Output stream error!");
+            }
+        }
+        else
+        {
+            DKLogE("DKCompressor Error: Output stream error!");
+        }
+
+        if (stream)
+            LZ4_freeStream(stream);
+        if (streamHC)
+            LZ4_freeStreamHC(streamHC);
+        return result;
+    }
+
+    static bool DecompressLZ4Dict(DKStream* input, DKStream* output, CompressorDictionary* dict)
+    {
+        uint32_t header[LZ4_DICT_FRAME_HEADER_SIZE / 4];
+        if (input->Read(header, sizeof(header)) != sizeof(header))
+        {
+            DKLogE("DKCompressor Error: Input stream error!");
+            return false;
+        }
+        for (uint32_t& v : header)
+            v = DKLittleEndianToSystem(v);
+        DKASSERT_DEBUG(header[0] == LZ4_DICT_FRAME_MAGIC);
+        DKASSERT_DEBUG(header[2] == LZ4_DICT_FRAME_SIGNATURE);
+
+        const uint32_t dictID = header[3];
+        const size_t blockSize = header[4];
+        if (blockSize == 0 || blockSize > LZ4_DICT_BLOCK_SIZE)
+        {
+            DKLogE("DKCompressor Error: Invalid LZ4 block size: %u", (uint32_t)blockSize);
+            return false;
+        }
+
+        CompressorDictionaryRegistry::Entry entry = {};
+        if (dict == NULL || dict->id != dictID)
+        {
+            dict = NULL;
+            if (CompressorDictionaryRegistry::Instance().Find(dictID, entry))
+                dict = entry.dict;
+        }
+        if (dict == NULL)
+        {
+            DKLogE("DKCompressor Error: Cannot find dictionary (ID: %u)", dictID);
+            return false;
+        }
+
+        CompressorBuffer inputBuffer(LZ4_COMPRESSBOUND(blockSize));
+        CompressorBuffer outputBuffer(blockSize * 2);
+
+        if (inputBuffer.buffer == nullptr || outputBuffer.buffer == nullptr)
+        {
+            DKLogE("DKCompressor Error: Out of memory!");
+            return false;
+        }
+
+        auto readUInt32 = [input](uint32_t& value)->bool
+        {
+            if (input->Read(&value, sizeof(value)) == sizeof(value))
+            {
+                value = DKLittleEndianToSystem(value);
+                return true;
+            }
+            return false;
+        };
+
+        const char* dictData;
+        int dictSize;
+        dict->LZ4Dictionary(dictData, dictSize);
+
+        LZ4_streamDecode_t stream = {};
+        LZ4_setStreamDecode(&stream, dictData, dictSize);
+
+        uLong crc = crc32(0L, Z_NULL, 0);
+        int index = 0;
+        while (true)
+        {
+            uint32_t inputSize;
+            if (!readUInt32(inputSize))
+            {
+                DKLogE("DKCompressor Error: Input stream error!");
+                return false;
+            }
+            if (inputSize == 0)
+                break;
+            if (inputSize > inputBuffer.bufferSize ||
+                input->Read(inputBuffer.buffer, inputSize) != inputSize)
+            {
+                DKLogE("DKCompressor Error: Input stream error!");
+                return false;
+            }
+            char* block = &reinterpret_cast<char*>(outputBuffer.buffer)[blockSize * index];
+            int outputSize = LZ4_decompress_safe_continue(&stream,
+                                                          reinterpret_cast<const char*>(inputBuffer.buffer),
+                                                          block, (int)inputSize, (int)blockSize);
+            if (outputSize < 0)
+            {
+                DKLogE("DKCompressor Error: LZ4 Decoding error!");
+                return false;
+            }
+            crc = crc32(crc, (const Bytef*)block, (uInt)outputSize);
+            if (output->Write(block, outputSize) != size_t(outputSize))
+            {
+                DKLogE("DKCompressor Error: Output stream error!");
+                return false;
+            }
+            index = index ^ 1;
+        }
+        uint32_t checksum;
+        if (!readUInt32(checksum))
+        {
+            DKLogE("DKCompressor Error: Input stream error!");
+            return false;
+        }
+        if (checksum != (uint32_t)crc)
+        {
+            DKLogE("DKCompressor Error: LZ4 checksum mismatch!");
+            return false;
+        }
+        return true;
+    }
+
+    static bool IsLZ4DictFrame(const void* p, size_t n)
+    {
+        if (n >= 12)
+        {
+            const uint32_t* header = reinterpret_cast<const uint32_t*>(p);
+            return DKLittleEndianToSystem(header[0]) == LZ4_DICT_FRAME_MAGIC &&
+                DKLittleEndianToSystem(header[2]) == LZ4_DICT_FRAME_SIGNATURE;
+        }
+        return false;
+    }
+
+    static size_t CompressZstdMemory(const void* input, size_t inputLength, void* output, size_t outputLength, int level, CompressorDictionary* dict)
+    {
+        ZSTD_CCtx* cctx = CompressorThreadContext::AcquireZstdCCtx();
+        if (cctx == NULL)
+        {
+            DKLogE("DKCompressor::Compress error: ZSTD_createCCtx failed");
+            return DKCompressor::SizeError;
+        }
+        size_t result = DKCompressor::SizeError;
+        const ZSTD_CDict* cdict = dict ? dict->ZstdCDict(level) : NULL;
+        if (dict && cdict == NULL)
+        {
+            DKLogE("DKCompressor::Compress error: Invalid dictionary");
+        }
+        else
+        {
+            size_t n = cdict ?
+                ZSTD_compress_usingCDict(cctx, output, outputLength, input, inputLength, cdict) :
+                ZSTD_compressCCtx(cctx, output, outputLength, input, inputLength, level);
+            if (ZSTD_isError(n))
+                DKLogE("DKCompressor::Compress error: %s", ZSTD_getErrorName(n));
+            else
+                result = n;
+        }
+        CompressorThreadContext::ReleaseZstdCCtx(cctx);
+        return result;
+    }
+
+    static size_t DecompressZstdMemory(const void* input, size_t inputLength, void* output, size_t outputLength, CompressorDictionary* dict)
+    {
+        CompressorDictionaryRegistry::Entry entry = {};
+        if (!ResolveZstdDictionary(input, inputLength, dict, entry))
+            return DKCompressor::SizeError;
+
+        const ZSTD_DDict* ddict = dict ? dict->ZstdDDict() : NULL;
+        if (dict && ddict == NULL)
+        {
+            DKLogE("DKCompressor::Decompress error: Invalid dictionary");
+            return DKCompressor::SizeError;
+        }
+        ZSTD_DCtx* dctx = CompressorThreadContext::AcquireZstdDCtx();
+        if (dctx == NULL)
+        {
+            DKLogE("DKCompressor::Decompress error: ZSTD_createDCtx failed");
+            return DKCompressor::SizeError;
+        }
+        size_t result = DKCompressor::SizeError;
+        size_t n = ddict ?
+            ZSTD_decompress_usingDDict(dctx, output, outputLength, input, inputLength, ddict) :
+            ZSTD_decompressDCtx(dctx, output, outputLength, input, inputLength);
+        if (ZSTD_isError(n))
+            DKLogE("DKCompressor::Decompress error: %s", ZSTD_getErrorName(n));
+        else
+            result = n;
+        CompressorThreadContext::ReleaseZstdDCtx(dctx);
+        return result;
+    }
+
+    static LZ4F_blockSizeID_t LZ4BlockSizeID(size_t length)
+    {
+        // smallest block which can hold entire input.
+        for (LZ4F_blockSizeID_t bsid : { LZ4F_max64KB, LZ4F_max256KB, LZ4F_max1MB })
+        {
+            if (length <= (size_t(1) << (8 + (2 * bsid))))
+                return bsid;
+        }
+        return LZ4F_max4MB;
+    }
+
+    static size_t CompressLZ4Memory(const void* input, size_t inputLength, void* output, size_t outputLength, int level)
+    {
+        LZ4F_preferences_t prefs = LZ4FramePreferences(level);
+        prefs.frameInfo.blockSizeID = LZ4BlockSizeID(inputLength);
+        prefs.frameInfo.contentSize = inputLength;
+
+        LZ4F_compressionContext_t cctx = CompressorThreadContext::AcquireLZ4CCtx();
+        if (cctx == NULL)
+        {
+            DKLogE("DKCompressor Error: LZ4 Encoder error!");
+            return DKCompressor::SizeError;
+        }
+
+        uint8_t* out = reinterpret_cast<uint8_t*>(output);
+        size_t result = DKCompressor::SizeError;
+        size_t headerSize = LZ4F_compressBegin(cctx, out, outputLength, &prefs);
+        if (!LZ4F_isError(headerSize))
+        {
+            size_t pos = headerSize;
+            size_t n = LZ4F_compressUpdate(cctx, &out[pos], outputLength - pos, input, inputLength, NULL);
+            if (!LZ4F_isError(n))
+            {
+                pos += n;
+                n = LZ4F_compressEnd(cctx, &out[pos], outputLength - pos, NULL);
+                if (!LZ4F_isError(n))
+                    result = pos + n;
+            }
+            if (LZ4F_isError(n))
+                DKLogE("DKCompressor Error: LZ4 Encoding error: %s", LZ4F_getErrorName(n));
+        }
+        else
+        {
+            DKLogE("DKCompressor Error: LZ4 Encoder error: %s", LZ4F_getErrorName(headerSize));
+        }
+        CompressorThreadContext::ReleaseLZ4CCtx(cctx);
+        return result;
+    }
+
+    static size_t DecompressLZ4Memory(const void* input, size_t inputLength, void* output, size_t outputLength)
+    {
+        LZ4F_decompressionContext_t dctx = CompressorThreadContext::AcquireLZ4DCtx();
+        if (dctx == NULL)
+        {
+            DKLogE("DKCompressor Error: LZ4 Decoder error!");
+            return DKCompressor::SizeError;
+        }
+
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(input);
+        uint8_t* out = reinterpret_cast<uint8_t*>(output);
+        size_t inputPos = 0;
+        size_t outputPos = 0;
+        size_t nextToLoad = 0;
+        while (inputPos < inputLength)
+        {
+            size_t inSize = inputLength - inputPos;
+            size_t outSize = outputLength - outputPos;
+            nextToLoad = LZ4F_decompress(dctx, &out[outputPos], &outSize, &in[inputPos], &inSize, NULL);
+            if (LZ4F_isError(nextToLoad))
+            {
+                DKLogE("DKCompressor Error: LZ4 Decoding error: %s", LZ4F_getErrorName(nextToLoad));
+                break;
+            }
+            if (inSize == 0 && outSize == 0)
+            {
+                DKLogE("DKCompressor Error: Output buffer is too small!");
+                break;
+            }
+            inputPos += inSize;
+            outputPos += outSize;
+        }
+        if (inputPos == inputLength && nextToLoad == 0)
+        {
+            CompressorThreadContext::ReleaseLZ4DCtx(dctx);
+            return outputPos;
+        }
+        // context is in the middle of frame.
+        LZ4F_freeDecompressionContext(dctx);
+        return DKCompressor::SizeError;
+    }
+
+    // sum of content size of LZ4 frames.
+    static size_t LZ4ContentSize(const void* p, size_t n)
+    {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(p);
+        auto readUInt32 = [data](size_t offset)->uint32_t
+        {
+            uint32_t v;
+            memcpy(&v, &data[offset], sizeof(v));
+            return DKLittleEndianToSystem(v);
+        };
+
+        uint64_t totalSize = 0;
+        size_t pos = 0;
+        while (pos < n)
+        {
+            if (n - pos < 8)
+                return DKCompressor::SizeError;
+            uint32_t magic = readUInt32(pos);
+            if ((magic & 0xfffffff0U) == 0x184D2A50U) // skippable frame
+            {
+                pos += size_t(readUInt32(pos + 4)) + 8;
+                continue;
+            }
+            if (magic != 0x184D2204U)
+                return DKCompressor::SizeError;
+
+            const uint8_t flags = data[pos + 4];
+            const bool blockChecksum = (flags & 0x10) != 0;
+            const bool contentSize = (flags & 0x08) != 0;
+            const bool contentChecksum = (flags & 0x04) != 0;
+            if (!contentSize)
+                return DKCompressor::SizeUnknown;
+            if (n - pos < 15)
+                return DKCompressor::SizeError;
+
+            uint64_t frameContentSize;
+            memcpy(&frameContentSize, &data[pos + 6], sizeof(frameContentSize));
+            totalSize += DKLittleEndianToSystem(frameContentSize);
+
+            pos += 15;  // magic, flags, block-desc, content-size, header-checksum
+            while (true) // skip blocks
+            {
+                if (n - pos < 4)
+                    return DKCompressor::SizeError;
+                uint32_t blockSize = readUInt32(pos);
+                pos += 4;
+                if (blockSize == 0) // end mark
+                    break;
+                pos += size_t(blockSize & 0x7fffffffU) + (blockChecksum ? 4 : 0);
+                if (pos > n)
+                    return DKCompressor::SizeError;
+            }
+            if (contentChecksum)
+                pos += 4;
+        }
+        if (pos > n)
+            return DKCompressor::SizeError;
+        if (totalSize >= DKCompressor::SizeUnknown)
+            return DKCompressor::SizeUnknown;
+        return size_t(totalSize);
+    }
+
     static bool DetectMethod(void* p, size_t n, DKCompressor::Method& m)
     {
         if (p)
@@ -640,12 +1478,222 @@ namespace DKFoundation::Private
         return false;
     }
 
+    // metrics of all compressors.
+    struct CompressorMetrics
+    {
+        DKMetrics::Counter* compressed = DKMetrics::RegisterCounter("DKCompressor.Compressed");
+        DKMetrics::Counter* decompressed = DKMetrics::RegisterCounter("DKCompressor.Decompressed");
+        DKMetrics::Counter* failures = DKMetrics::RegisterCounter("DKCompressor.Failures");
+        DKMetrics::Counter* compressInput = DKMetrics::RegisterCounter("DKCompressor.CompressInputBytes");
+        DKMetrics::Counter* compressOutput = DKMetrics::RegisterCounter("DKCompressor.CompressOutputBytes");
+        DKMetrics::Counter* decompressInput = DKMetrics::RegisterCounter("DKCompressor.DecompressInputBytes");
+        DKMetrics::Counter* decompressOutput = DKMetrics::RegisterCounter("DKCompressor.DecompressOutputBytes");
+        DKMetrics::Histogram* compressTime = DKMetrics::RegisterHistogram("DKCompressor.CompressTime");
+        DKMetrics::Histogram* decompressTime = DKMetrics::RegisterHistogram("DKCompressor.DecompressTime");
+
+        static CompressorMetrics& Get()
+        {
+            static CompressorMetrics metrics;
+            return metrics;
+        }
+        void Compressed(bool result, uint64_t inputBytes, uint64_t outputBytes, DKTimer::Tick start)
+        {
+            compressTime->RecordTicks(DKTimer::SystemTick() - start);
+            if (result)
+                compressed->Increment();
+            else
+                failures->Increment();
+            compressInput->Increment(inputBytes);
+            compressOutput->Increment(outputBytes);
+        }
+        void Decompressed(bool result, uint64_t inputBytes, uint64_t outputBytes, DKTimer::Tick start)
+        {
+            decompressTime->RecordTicks(DKTimer::SystemTick() - start);
+            if (result)
+                decompressed->Increment();
+            else
+                failures->Increment();
+            decompressInput->Increment(inputBytes);
+            decompressOutput->Increment(outputBytes);
+        }
+    };
+
+    // counts bytes transferred through source stream.
+    struct CompressorMeteredStream : public DKStream
+    {
+        DKStream* source;
+        uint64_t bytes;
+
+        CompressorMeteredStream(DKStream* s) : source(s), bytes(0) {}
+
+        Position SetCurrentPosition(Position p) override { return source->SetCurrentPosition(p); }
+        Position CurrentPosition() const override { return source->CurrentPosition(); }
+        Position RemainLength() const override { return source->RemainLength(); }
+        Position TotalLength() const override { return source->TotalLength(); }
+
+        size_t Read(void* p, size_t s) override
+        {
+            size_t r = source->Read(p, s);
+            if (r <= s)     // not an error
+                bytes += r;
+            return r;
+        }
+        size_t Write(const void* p, size_t s) override
+        {
+            size_t r = source->Write(p, s);
+            if (r <= s)
+                bytes += r;
+            return r;
+        }
+
+        bool IsReadable() const override { return source->IsReadable(); }
+        bool IsWritable() const override { return source->IsWritable(); }
+        bool IsSeekable() const override { return source->IsSeekable(); }
+    };
 }
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
-DKCompressor::DKCompressor(Method m)
+#define DICTIONARY_IMPL(d)	reinterpret_cast<CompressorDictionary*>((d)->impl)
+
+DKCompressor::Dictionary::Dictionary()
+	: impl(NULL)
+{
+}
+
+DKCompressor::Dictionary::~Dictionary()
+{
+	delete DICTIONARY_IMPL(this);
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Train(const DKData* const* samples, size_t count, size_t maxSize)
+{
+	size_t totalSize = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (samples[i])
+			totalSize += samples[i]->Length();
+	}
+	if (totalSize == 0 || maxSize == 0)
+	{
+		DKLogE("DKCompressor::Dictionary::Train error: No samples.");
+		return NULL;
+	}
+
+	CompressorBuffer sampleBuffer(totalSize);
+	CompressorBuffer sizeBuffer(sizeof(size_t) * count);
+	CompressorBuffer dictBuffer(maxSize);
+	if (sampleBuffer.buffer == nullptr || sizeBuffer.buffer == nullptr || dictBuffer.buffer == nullptr)
+	{
+		DKLogE("DKCompressor Error: Out of memory!");
+		return NULL;
+	}
+
+	// samples are concatenated for dictionary builder.
+	uint8_t* dst = reinterpret_cast<uint8_t*>(sampleBuffer.buffer);
+	size_t* sampleSizes = reinterpret_cast<size_t*>(sizeBuffer.buffer);
+	unsigned int numSamples = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (samples[i] == NULL)
+			continue;
+		size_t length = samples[i]->Length();
+		if (length > 0)
+		{
+			const void* p = samples[i]->LockShared();
+			memcpy(dst, p, length);
+			samples[i]->UnlockShared();
+			dst += length;
+			sampleSizes[numSamples++] = length;
+		}
+	}
+
+	size_t dictSize = ZDICT_trainFromBuffer(dictBuffer.buffer, dictBuffer.bufferSize,
+											sampleBuffer.buffer, sampleSizes, numSamples);
+	if (ZDICT_isError(dictSize))
+	{
+		DKLogE("DKCompressor::Dictionary::Train error: %s", ZDICT_getErrorName(dictSize));
+		return NULL;
+	}
+	return Create(DKData::StaticData(dictBuffer.buffer, dictSize));
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Create(const DKData* data)
+{
+	if (data == NULL || data->Length() == 0)
+		return NULL;
+
+	const void* p = data->LockShared();
+	CompressorDictionary* dict = new CompressorDictionary(p, data->Length());
+	data->UnlockShared();
+
+	if (dict->data == NULL)
+	{
+		DKLogE("DKCompressor Error: Out of memory!");
+		delete dict;
+		return NULL;
+	}
+	if (dict->id == 0)
+	{
+		// raw content without dictionary header. (ID required for registry)
+		DKLogE("DKCompressor::Dictionary::Create error: Invalid dictionary format.");
+		delete dict;
+		return NULL;
+	}
+	DKObject<Dictionary> dictionary = DKObject<Dictionary>::New();
+	dictionary->impl = dict;
+	return dictionary;
+}
+
+uint32_t DKCompressor::Dictionary::ID() const
+{
+	return DICTIONARY_IMPL(this)->id;
+}
+
+const DKData* DKCompressor::Dictionary::Data() const
+{
+	return DICTIONARY_IMPL(this)->content;
+}
+
+bool DKCompressor::Dictionary::Register(Dictionary* dictionary)
+{
+	if (dictionary)
+	{
+		CompressorDictionaryRegistry::Entry entry = { dictionary, DICTIONARY_IMPL(dictionary) };
+		if (entry.dictionary)	// unmanaged object cannot be registered.
+		{
+			CompressorDictionaryRegistry& registry = CompressorDictionaryRegistry::Instance();
+			DKCriticalSection<DKMutex> guard(registry.lock);
+			registry.entries.Update(entry.dict->id, entry);
+			return true;
+		}
+	}
+	return false;
+}
+
+void DKCompressor::Dictionary::Unregister(uint32_t id)
+{
+	CompressorDictionaryRegistry::Entry entry = {};
+	CompressorDictionaryRegistry& registry = CompressorDictionaryRegistry::Instance();
+	DKCriticalSection<DKMutex> guard(registry.lock);
+	if (auto p = registry.entries.Find(id); p)
+	{
+		entry = p->value;	// release after unlock.
+		registry.entries.Remove(id);
+	}
+}
+
+DKObject<DKCompressor::Dictionary> DKCompressor::Dictionary::Find(uint32_t id)
+{
+	CompressorDictionaryRegistry::Entry entry = {};
+	if (CompressorDictionaryRegistry::Instance().Find(id, entry))
+		return entry.dictionary;
+	return NULL;
+}
+
+DKCompressor::DKCompressor(Method m, Dictionary* d)
 	: method(m)
+	, dictionary(d)
 {
 }
 
@@ -654,27 +1702,42 @@ DKCompressor::~DKCompressor()
 }
 
 bool DKCompressor::Compress(DKStream* input, DKStream* output) const
+{
+	CompressorMeteredStream in(input);
+	CompressorMeteredStream out(output);
+	DKTimer::Tick start = DKTimer::SystemTick();
+	bool result = CompressStream(input ? &in : NULL, output ? &out : NULL);
+	CompressorMetrics::Get().Compressed(result, in.bytes, out.bytes, start);
+	return result;
+}
+
+bool DKCompressor::CompressStream(DKStream* input, DKStream* output) const
 {
 	if (input == NULL || input->IsReadable() == false)
 		return false;
 	if (output == NULL || output->IsWritable() == false)
 		return false;
 
+    CompressorDictionary* dict = dictionary ? DICTIONARY_IMPL(dictionary.Ptr()) : NULL;
     switch (method)
     {
     case Zlib:
-        return CompressDeflate(input, output, 5); // Z_DEFAULT_COMPRESSION is 6
+        return CompressDeflate(input, output, 5, dict); // Z_DEFAULT_COMPRESSION is 6
         break;
     case Zstd:
-        return CompressZstd(input, output, ZSTD_CLEVEL_DEFAULT);
+        return CompressZstd(input, output, ZSTD_CLEVEL_DEFAULT, dict);
         break;
     case ZstdMax:
-        return CompressZstd(input, output, 19);// Clamp(19, int(ZSTD_CLEVEL_DEFAULT), ZSTD_maxCLevel()));
+        return CompressZstd(input, output, 19, dict);// Clamp(19, int(ZSTD_CLEVEL_DEFAULT), ZSTD_maxCLevel()));
         break;
     case LZ4:
+        if (dict)
+            return CompressLZ4Dict(input, output, 0, dict);
         return CompressLZ4(input, output, 0);
         break;
     case LZ4HC:
+        if (dict)
+            return CompressLZ4Dict(input, output, 9, dict);
         return CompressLZ4(input, output, 9); // 0 for LZ4 fast, 9 for LZ4HC
         break;
     }
@@ -683,6 +1746,21 @@ bool DKCompressor::Compress(DKStream* input, DKStream* output) const
 }
 
 bool DKCompressor::Decompress(DKStream* input, DKStream* output)
+{
+	return Decompress(input, output, NULL);
+}
+
+bool DKCompressor::Decompress(DKStream* input, DKStream* output, Dictionary* dictionary)
+{
+	CompressorMeteredStream in(input);
+	CompressorMeteredStream out(output);
+	DKTimer::Tick start = DKTimer::SystemTick();
+	bool result = DecompressStream(input ? &in : NULL, output ? &out : NULL, dictionary);
+	CompressorMetrics::Get().Decompressed(result, in.bytes, out.bytes, start);
+	return result;
+}
+
+bool DKCompressor::DecompressStream(DKStream* input, DKStream* output, Dictionary* dictionary)
 {
 	if (input == NULL || input->IsReadable() == false)
 		return false;
@@ -769,17 +1847,29 @@ bool DKCompressor::Decompress(DKStream* input, DKStream* output)
         return false;
     }
 
+    CompressorDictionary* dict = dictionary ? DICTIONARY_IMPL(dictionary) : NULL;
+
+    if (IsLZ4DictFrame(bufferedInputStream.preloadedData, bufferedInputStream.preloadedLength))
+        return DecompressLZ4Dict(&bufferedInputStream, output, dict);
+
     Method method;
     if (DetectMethod(bufferedInputStream.preloadedData, bufferedInputStream.preloadedLength, method))
     {
         switch (method)
         {
         case Zlib:
-            return DecompressDeflate(&bufferedInputStream, output);
+            return DecompressDeflate(&bufferedInputStream, output, dict);
             break;
         case Zstd:
         case ZstdMax:
-            return DecompressZstd(&bufferedInputStream, output);
+            {
+                CompressorDictionaryRegistry::Entry entry = {};
+                if (!ResolveZstdDictionary(bufferedInputStream.preloadedData,
+                                           bufferedInputStream.preloadedLength,
+                                           dict, entry))
+                    return false;
+                return DecompressZstd(&bufferedInputStream, output, dict);
+            }
             break;
         case LZ4:
         case LZ4HC:
@@ -790,3 +1880,157 @@ bool DKCompressor::Decompress(DKStream* input, DKStream* output)
     DKLogE("DKCompressor Error: Unknown format!");
     return false;
 }
+
+size_t DKCompressor::CompressBound(size_t inputLength) const
+{
+	switch (method)
+	{
+	case Zlib:
+		return compressBound(uLong(inputLength)) + 4; // + dictionary ID
+	case Zstd:
+	case ZstdMax:
+		return ZSTD_compressBound(inputLength);
+	case LZ4:
+	case LZ4HC:
+		if (dictionary)
+		{
+			size_t numBlocks = (inputLength + LZ4_DICT_BLOCK_SIZE - 1) / LZ4_DICT_BLOCK_SIZE;
+			return LZ4_DICT_FRAME_HEADER_SIZE + numBlocks * (4 + LZ4_COMPRESSBOUND(LZ4_DICT_BLOCK_SIZE)) + 8;
+		}
+		else
+		{
+			LZ4F_preferences_t prefs = LZ4FramePreferences(method == LZ4HC ? 9 : 0);
+			prefs.frameInfo.blockSizeID = LZ4BlockSizeID(inputLength);
+			prefs.frameInfo.contentSize = inputLength;
+			return LZ4F_compressFrameBound(inputLength, &prefs);
+		}
+	}
+	return 0;
+}
+
+size_t DKCompressor::Compress(const void* input, size_t inputLength, void* output, size_t outputLength) const
+{
+	DKTimer::Tick start = DKTimer::SystemTick();
+	size_t result = CompressMemory(input, inputLength, output, outputLength);
+	bool succeeded = result != SizeError;
+	CompressorMetrics::Get().Compressed(succeeded, inputLength, succeeded ? result : 0, start);
+	return result;
+}
+
+size_t DKCompressor::CompressMemory(const void* input, size_t inputLength, void* output, size_t outputLength) const
+{
+	if (input == NULL && inputLength > 0)
+		return SizeError;
+	if (output == NULL)
+		return SizeError;
+
+	CompressorDictionary* dict = dictionary ? DICTIONARY_IMPL(dictionary.Ptr()) : NULL;
+	switch (method)
+	{
+	case Zlib:
+		return TransferToMemory(input, inputLength, output, outputLength, [dict](DKStream* in, DKStream* out)
+		{
+			return CompressDeflate(in, out, 5, dict);
+		});
+	case Zstd:
+		return CompressZstdMemory(input, inputLength, output, outputLength, ZSTD_CLEVEL_DEFAULT, dict);
+	case ZstdMax:
+		return CompressZstdMemory(input, inputLength, output, outputLength, 19, dict);
+	case LZ4:
+	case LZ4HC:
+		{
+			int level = method == LZ4HC ? 9 : 0;
+			if (dict)
+			{
+				return TransferToMemory(input, inputLength, output, outputLength, [dict, level](DKStream* in, DKStream* out)
+				{
+					return CompressLZ4Dict(in, out, level, dict);
+				});
+			}
+			return CompressLZ4Memory(input, inputLength, output, outputLength, level);
+		}
+	}
+	DKLogE("DKCompressor::Compress error: Unknown format.");
+	return SizeError;
+}
+
+size_t DKCompressor::DecompressedSize(const void* input, size_t inputLength)
+{
+	if (input == NULL || inputLength < 4)
+		return SizeError;
+
+	if (IsLZ4DictFrame(input, inputLength))
+		return SizeUnknown;
+
+	Method method;
+	if (DetectMethod(const_cast<void*>(input), inputLength, method))
+	{
+		switch (method)
+		{
+		case Zlib:
+			return SizeUnknown;
+		case Zstd:
+		case ZstdMax:
+			{
+				unsigned long long size = ZSTD_findDecompressedSize(input, inputLength);
+				if (size == ZSTD_CONTENTSIZE_ERROR)
+					return SizeError;
+				if (size >= SizeUnknown)
+					return SizeUnknown;
+				return size_t(size);
+			}
+		case LZ4:
+		case LZ4HC:
+			return LZ4ContentSize(input, inputLength);
+		}
+	}
+	return SizeError;
+}
+
+size_t DKCompressor::Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, Dictionary* dictionary)
+{
+	DKTimer::Tick start = DKTimer::SystemTick();
+	size_t result = DecompressMemory(input, inputLength, output, outputLength, dictionary);
+	bool succeeded = result != SizeError;
+	CompressorMetrics::Get().Decompressed(succeeded, inputLength, succeeded ? result : 0, start);
+	return result;
+}
+
+size_t DKCompressor::DecompressMemory(const void* input, size_t inputLength, void* output, size_t outputLength, Dictionary* dictionary)
+{
+	if (input == NULL || inputLength < 4)
+		return SizeError;
+	if (output == NULL && outputLength > 0)
+		return SizeError;
+
+	CompressorDictionary* dict = dictionary ? DICTIONARY_IMPL(dictionary) : NULL;
+
+	if (IsLZ4DictFrame(input, inputLength))
+	{
+		return TransferToMemory(input, inputLength, output, outputLength, [dict](DKStream* in, DKStream* out)
+		{
+			return DecompressLZ4Dict(in, out, dict);
+		});
+	}
+
+	Method method;
+	if (DetectMethod(const_cast<void*>(input), inputLength, method))
+	{
+		switch (method)
+		{
+		case Zlib:
+			return TransferToMemory(input, inputLength, output, outputLength, [dict](DKStream* in, DKStream* out)
+			{
+				return DecompressDeflate(in, out, dict);
+			});
+		case Zstd:
+		case ZstdMax:
+			return DecompressZstdMemory(input, inputLength, output, outputLength, dict);
+		case LZ4:
+		case LZ4HC:
+			return DecompressLZ4Memory(input, inputLength, output, outputLength);
+		}
+	}
+	DKLogE("DKCompressor Error: Unknown format!");
+	return SizeError;
+}
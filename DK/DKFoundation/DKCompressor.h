@@ -9,11 +9,26 @@
 #include "../DKInclude.h"
 #include "DKStream.h"
 #include "DKFunction.h"
+#include "DKObject.h"
+#include "DKData.h"
 
 namespace DKFoundation
 {
 	/** @brief
 	 A compression utility class, supports ZLib, Zstd, LZ4 compression.
+
+	 A dictionary improves compression ratio and speed of small data.
+	 Dictionary ID is recorded in compressed data, Decompress() finds
+	 dictionary from registry with the ID.
+
+	 Memory to memory functions use compression contexts cached per thread,
+	 and decompress directly into output if content size is known.
+	 @code
+	  DKObject<DKCompressor::Dictionary> dict = DKCompressor::Dictionary::Train(samples, numSamples);
+	  DKCompressor::Dictionary::Register(dict);
+	  DKCompressor(DKCompressor::Zstd, dict).Compress(input, output);
+	  DKCompressor::Decompress(input2, output2);
+	 @endcode
 	 */
 	class DKCompressor
 	{
@@ -30,13 +45,75 @@ namespace DKFoundation
             BestRatio = ZstdMax,
             Fastest = LZ4,
 		};
-		DKCompressor(Method);
+
+		/// Prepared dictionary, shared by multiple threads.
+		/// Digested tables for each method are created once, on first use.
+		class DKGL_API Dictionary
+		{
+		public:
+			~Dictionary();
+
+			/// train dictionary from samples. (zstd dictionary builder)
+			/// Samples should be many small data which have common patterns,
+			/// total size of samples should be about 100 times of maxSize.
+			static DKObject<Dictionary> Train(const DKData* const* samples, size_t count, size_t maxSize = 0x1b800);
+			/// load dictionary saved from Data() or created by zstd.
+			static DKObject<Dictionary> Create(const DKData* data);
+
+			uint32_t ID() const;
+			/// dictionary content, can be saved to file.
+			const DKData* Data() const;
+
+			/// dictionary registry for decompression.
+			/// replaces registered dictionary with same ID.
+			static bool Register(Dictionary*);
+			static void Unregister(uint32_t id);
+			static DKObject<Dictionary> Find(uint32_t id);
+
+		private:
+			Dictionary();
+			Dictionary(const Dictionary&) = delete;
+			Dictionary& operator = (const Dictionary&) = delete;
+			void* impl;
+			friend class DKObject<Dictionary>;
+			friend class DKCompressor;
+		};
+
+		DKCompressor(Method, Dictionary* dictionary = NULL);
 		~DKCompressor();
 
 		bool Compress(DKStream* input, DKStream* output) const;
+		/// decompress, dictionary is found from registry if data requires.
 		static bool Decompress(DKStream* input, DKStream* output);
+		static bool Decompress(DKStream* input, DKStream* output, Dictionary* dictionary);
+
+		enum : size_t
+		{
+			SizeError = ~size_t(0),
+			SizeUnknown = ~size_t(0) - 1,
+		};
+		/// maximum length of compressed data from input of given length.
+		size_t CompressBound(size_t inputLength) const;
+		/// compress memory to memory in single call, content size is
+		/// recorded in compressed data. (Zstd, LZ4)
+		/// output should be CompressBound(inputLength) bytes at least.
+		/// @return compressed length, or SizeError if failed.
+		size_t Compress(const void* input, size_t inputLength, void* output, size_t outputLength) const;
+
+		/// decompressed length recorded in compressed data.
+		/// @return SizeUnknown if not recorded, SizeError if not valid data.
+		static size_t DecompressedSize(const void* input, size_t inputLength);
+		/// decompress memory to memory in single call.
+		/// @return decompressed length, or SizeError if failed. (or output is too small)
+		static size_t Decompress(const void* input, size_t inputLength, void* output, size_t outputLength, Dictionary* dictionary = NULL);
 
 	private:
+		bool CompressStream(DKStream* input, DKStream* output) const;
+		static bool DecompressStream(DKStream* input, DKStream* output, Dictionary* dictionary);
+		size_t CompressMemory(const void* input, size_t inputLength, void* output, size_t outputLength) const;
+		static size_t DecompressMemory(const void* input, size_t inputLength, void* output, size_t outputLength, Dictionary* dictionary);
+
 		Method method;
+		DKObject<Dictionary> dictionary;
 	};
 }
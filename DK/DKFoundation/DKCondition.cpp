@@ -7,6 +7,13 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #else // pthread
 #include <pthread.h>
 #include <sys/time.h>
@@ -14,10 +21,13 @@
 #endif
 
 #include "DKCondition.h"
+#include "DKCriticalSection.h"
 #include "DKLog.h"
 
 namespace DKFoundation::Private
 {
+    void LockProfilerAddConditionWait(uint64_t ticks);
+
 #ifdef _WIN32
     class ConditionImpl
     {
@@ -66,6 +76,137 @@ namespace DKFoundation::Private
         mutable CRITICAL_SECTION section;
         mutable CONDITION_VARIABLE cond;
     };
+#elif defined(__linux__)
+    /// futex based condition, mutex state and sequence number are
+    /// 32-bit futex words. no system call if there is no contention.
+    class ConditionImpl
+    {
+    public:
+        enum State
+        {
+            StateFree = 0,
+            StateLocked = 1,
+            StateContended = 2, ///< locked, and there might be waiting threads.
+        };
+        ConditionImpl()
+            : state(StateFree)
+            , sequence(0)
+            , waiters(0)
+#ifdef DKGL_DEBUG_ENABLED
+            , ownerId(0)
+#endif
+        {
+        }
+        ~ConditionImpl()
+        {
+            DKASSERT_DEBUG(state == StateFree);
+        }
+        void Wait() const
+        {
+            int seq = BeginWait();
+            syscall(SYS_futex, &sequence, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+            EndWait();
+        }
+        bool WaitTimeout(double t) const
+        {
+            struct timespec ts;
+            long sec = static_cast<long>(t);
+            ts.tv_sec = sec;
+            ts.tv_nsec = static_cast<long>((t - sec) * 1000000000.0);
+
+            int seq = BeginWait();
+            long ret = syscall(SYS_futex, &sequence, FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+            bool timedOut = ret != 0 && errno == ETIMEDOUT;
+            EndWait();
+            return !timedOut;
+        }
+        void Signal() const
+        {
+            // waiters is incremented before reading sequence, waker skips
+            // system call only if waiter will see the new sequence.
+            __atomic_add_fetch(&sequence, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0)
+                syscall(SYS_futex, &sequence, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        }
+        void Broadcast() const
+        {
+            // Requeue waiters to mutex is not safe without internal lock,
+            // all waiters will be woken up and relock with contended state.
+            __atomic_add_fetch(&sequence, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0)
+                syscall(SYS_futex, &sequence, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+        }
+        void Lock() const
+        {
+#ifdef DKGL_DEBUG_ENABLED
+            if (ownerId == pthread_self())
+            {
+                // Dead lock.
+                DKERROR_THROW_DEBUG("dead lock detected.");
+            }
+#endif
+            int s = StateFree;
+            if (!__atomic_compare_exchange_n(&state, &s, StateLocked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                LockContended();
+#ifdef DKGL_DEBUG_ENABLED
+            ownerId = pthread_self();
+#endif
+        }
+        bool TryLock() const
+        {
+            int s = StateFree;
+            if (__atomic_compare_exchange_n(&state, &s, StateLocked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            {
+#ifdef DKGL_DEBUG_ENABLED
+                ownerId = pthread_self();
+#endif
+                return true;
+            }
+            return false;
+        }
+        void Unlock() const
+        {
+#ifdef DKGL_DEBUG_ENABLED
+            if (ownerId != pthread_self())
+            {
+                DKERROR_THROW_DEBUG("The current thread does not hold a lock on mutex.");
+            }
+            ownerId = 0;
+#endif
+            if (__atomic_exchange_n(&state, StateFree, __ATOMIC_RELEASE) == StateContended)
+                syscall(SYS_futex, &state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        }
+    private:
+        int BeginWait() const
+        {
+            // read sequence with lock, signal after unlock changes sequence
+            // and futex-wait returns immediately.
+            __atomic_add_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+            int seq = __atomic_load_n(&sequence, __ATOMIC_SEQ_CST);
+            Unlock();
+            return seq;
+        }
+        void EndWait() const
+        {
+            __atomic_sub_fetch(&waiters, 1, __ATOMIC_RELAXED);
+            // there might be other woken threads, relock with contended state.
+            LockContended();
+#ifdef DKGL_DEBUG_ENABLED
+            ownerId = pthread_self();
+#endif
+        }
+        void LockContended() const
+        {
+            while (__atomic_exchange_n(&state, StateContended, __ATOMIC_ACQUIRE) != StateFree)
+                syscall(SYS_futex, &state, FUTEX_WAIT_PRIVATE, StateContended, NULL, NULL, 0);
+        }
+        mutable int state;
+        mutable int sequence;
+        mutable int waiters;    ///< threads in Wait(), Signal() skips wake if zero.
+#ifdef DKGL_DEBUG_ENABLED
+        mutable pthread_t ownerId;
+#endif
+    };
 #else
     class ConditionImpl
     {
@@ -171,12 +312,26 @@ DKCondition::~DKCondition()
 void DKCondition::Wait() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (lockProfilerEnabled)
+	{
+		uint64_t t = LockProfilerTick();
+		reinterpret_cast<ConditionImpl*>(impl)->Wait();
+		LockProfilerAddConditionWait(LockProfilerTick() - t);
+		return;
+	}
 	reinterpret_cast<ConditionImpl*>(impl)->Wait();
 }
 
 bool DKCondition::WaitTimeout(double t) const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (lockProfilerEnabled)
+	{
+		uint64_t t0 = LockProfilerTick();
+		bool result = reinterpret_cast<ConditionImpl*>(impl)->WaitTimeout(Max(t, 0.0));
+		LockProfilerAddConditionWait(LockProfilerTick() - t0);
+		return result;
+	}
 	return reinterpret_cast<ConditionImpl*>(impl)->WaitTimeout(Max(t, 0.0));
 }
 
@@ -0,0 +1,414 @@
+//
+//  File: DKCoroutine.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+
+// Coroutines require C++20. (-std=c++20, /std:c++20 or later)
+// DK.xcodeproj and DK_static.vcxproj build with C++17, so this header is
+// empty unless the project or application is built with C++20.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#	define DKGL_COROUTINE_ENABLED 1
+#else
+#	define DKGL_COROUTINE_ENABLED 0
+#endif
+
+#if DKGL_COROUTINE_ENABLED
+#include <coroutine>
+#include <exception>
+#include <new>
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKMemory.h"
+#include "DKFixedSizeAllocator.h"
+#include "DKDateTime.h"
+#include "DKEventLoop.h"
+#include "DKOperationQueue.h"
+#include "DKFuture.h"
+
+namespace DKFoundation
+{
+	template <typename T = void> class DKTask;
+
+	namespace Private
+	{
+		/// operation which resumes a suspended coroutine.
+		/// allocated from fixed-size allocator, not from heap.
+		class CoroutineResumeOperation : public DKOperation
+		{
+		public:
+			CoroutineResumeOperation(std::coroutine_handle<> h) : handle(h) {}
+			void Perform() const override
+			{
+				handle.resume();
+			}
+			static DKObject<DKOperation> Create(std::coroutine_handle<> h)
+			{
+				DKAllocator& alloc = DKFixedSizeAllocator<sizeof(CoroutineResumeOperation), alignof(CoroutineResumeOperation), 1024>::AllocatorInstance();
+				return new(alloc) CoroutineResumeOperation(h);
+			}
+		private:
+			std::coroutine_handle<> handle;
+		};
+
+		/// coroutine frames are allocated from DKFoundation memory pool.
+		struct CoroutineFrameAllocator
+		{
+			static void* operator new(size_t size)
+			{
+				void* p = DKMemoryPoolAlloc(size);
+				if (p == NULL)
+					throw std::bad_alloc();
+				return p;
+			}
+			static void operator delete(void* p, size_t)
+			{
+				DKMemoryPoolFree(p);
+			}
+		};
+
+		class TaskPromiseBase : public CoroutineFrameAllocator
+		{
+		public:
+			struct FinalAwaiter
+			{
+				bool await_ready() const noexcept { return false; }
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+				{
+					std::coroutine_handle<> cont = h.promise().continuation;
+					if (cont)
+						return cont;
+					return std::noop_coroutine();
+				}
+				void await_resume() const noexcept {}
+			};
+
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			FinalAwaiter final_suspend() const noexcept { return {}; }
+			void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+			std::coroutine_handle<> continuation;
+			std::exception_ptr exception;
+		};
+
+		template <typename T> class TaskPromise : public TaskPromiseBase
+		{
+		public:
+			TaskPromise() : hasValue(false) {}
+			~TaskPromise()
+			{
+				if (hasValue)
+					reinterpret_cast<T*>(storage)->~T();
+			}
+			DKTask<T> get_return_object();
+			template <typename U> void return_value(U&& v)
+			{
+				new(static_cast<void*>(storage)) T(std::forward<U>(v));
+				hasValue = true;
+			}
+			T& Result()
+			{
+				if (exception)
+					std::rethrow_exception(exception);
+				DKASSERT_DEBUG(hasValue);
+				return *reinterpret_cast<T*>(storage);
+			}
+		private:
+			alignas(T) unsigned char storage[sizeof(T)];
+			bool hasValue;
+		};
+		template <> class TaskPromise<void> : public TaskPromiseBase
+		{
+		public:
+			DKTask<void> get_return_object();
+			void return_void() {}
+			void Result()
+			{
+				if (exception)
+					std::rethrow_exception(exception);
+			}
+		};
+
+		/// fire-and-forget coroutine, used to detach DKTask.
+		struct DetachedCoroutine
+		{
+			struct promise_type : public CoroutineFrameAllocator
+			{
+				DetachedCoroutine get_return_object() const noexcept { return {}; }
+				std::suspend_never initial_suspend() const noexcept { return {}; }
+				std::suspend_never final_suspend() const noexcept { return {}; }
+				void return_void() const noexcept {}
+				void unhandled_exception() const noexcept {}
+			};
+		};
+
+		struct ResumeOnQueueAwaiter
+		{
+			DKOperationQueue* queue;
+			bool await_ready() const noexcept { return queue == NULL; }
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				queue->Post(CoroutineResumeOperation::Create(h));
+			}
+			void await_resume() const noexcept {}
+		};
+		struct ResumeOnEventLoopAwaiter
+		{
+			DKEventLoop* eventLoop;
+			double delay;
+			bool await_ready() const
+			{
+				return eventLoop == NULL || (delay <= 0.0 && eventLoop->IsWrokingThread());
+			}
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				eventLoop->Post(CoroutineResumeOperation::Create(h), delay);
+			}
+			void await_resume() const noexcept {}
+		};
+		struct ResumeAtEventLoopAwaiter
+		{
+			DKEventLoop* eventLoop;
+			DKDateTime date;
+			bool await_ready() const noexcept { return eventLoop == NULL; }
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				eventLoop->Post(CoroutineResumeOperation::Create(h), date);
+			}
+			void await_resume() const noexcept {}
+		};
+		struct OperationSyncAwaiter
+		{
+			DKObject<DKOperationQueue::OperationSync> sync;
+			bool await_ready() const
+			{
+				if (sync == NULL)
+					return true;
+				auto state = const_cast<DKOperationQueue::OperationSync*>(sync.Ptr())->OperationState();
+				return state == DKOperationQueue::OperationSync::StateProcessed ||
+					state == DKOperationQueue::OperationSync::StateCancelled;
+			}
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				const_cast<DKOperationQueue::OperationSync*>(sync.Ptr())->AddCompletionHandler(CoroutineResumeOperation::Create(h));
+			}
+			bool await_resume() const
+			{
+				if (sync)
+					return const_cast<DKOperationQueue::OperationSync*>(sync.Ptr())->OperationState() == DKOperationQueue::OperationSync::StateProcessed;
+				return false;
+			}
+		};
+		struct PendingStateAwaiter
+		{
+			DKObject<DKEventLoop::PendingState> state;
+			bool await_ready() const
+			{
+				return state == NULL || state->IsDone() || state->IsRevoked();
+			}
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				state->AddCompletionHandler(CoroutineResumeOperation::Create(h));
+			}
+			bool await_resume() const
+			{
+				return state && state->IsDone();
+			}
+		};
+		template <typename T> struct FutureAwaiter
+		{
+			DKFuture<T> future;
+			bool await_ready() const { return future.IsSettled(); }
+			void await_suspend(std::coroutine_handle<> h) const
+			{
+				future.AddCompletionHandler(CoroutineResumeOperation::Create(h));
+			}
+			/// raise exception if future was cancelled.
+			typename DKFuture<T>::Reference await_resume() const
+			{
+				return future.Value();
+			}
+		};
+	}
+
+	/**
+	 @brief
+	 Coroutine return type.
+	 A task is started lazily, when it is awaited by other coroutine or detached
+	 by Detach() or Start(). The coroutine frame is allocated from the
+	 DKFoundation memory pool. (DKMemoryPoolAlloc)
+
+	 Awaitable objects:
+	  - DKTask<T>
+	  - DKFuture<T> (raise exception if cancelled)
+	  - DKObject<DKOperationQueue::OperationSync> (returns Sync() result)
+	  - DKObject<DKEventLoop::PendingState> (returns Result() result)
+	  - DKResumeOn(DKOperationQueue*), DKResumeOn(DKEventLoop*)
+	  - DKResumeAfter(DKEventLoop*, delay), DKResumeAt(DKEventLoop*, date)
+
+	 @code
+	  DKTask<DKObject<DKImage>> LoadImage(DKString path)
+	  {
+	      co_await DKResumeOn(&ioQueue);
+	      DKObject<DKData> data = DKFile::Create(path, ...)->Read(...);
+	      co_await DKResumeOn(&workQueue);
+	      DKObject<DKImage> image = DKImage::Create(data);
+	      co_await DKResumeOn(mainLoop);
+	      co_return image;
+	  }
+	  LoadImage(path).Start();
+	 @endcode
+
+	 @note
+	  This feature requires C++20 coroutine. (DKGL_COROUTINE_ENABLED)
+	  It is off by default, the project files build with C++17.
+	 */
+	template <typename T> class DKTask
+	{
+	public:
+		using promise_type = Private::TaskPromise<T>;
+		using Handle = std::coroutine_handle<promise_type>;
+
+		DKTask() : handle(nullptr) {}
+		DKTask(DKTask&& t) : handle(t.handle) { t.handle = nullptr; }
+		~DKTask()
+		{
+			if (handle)
+				handle.destroy();
+		}
+		DKTask& operator = (DKTask&& t)
+		{
+			if (this != &t)
+			{
+				if (handle)
+					handle.destroy();
+				handle = t.handle;
+				t.handle = nullptr;
+			}
+			return *this;
+		}
+
+		bool IsValid() const	{ return (bool)handle; }
+		bool IsDone() const		{ return handle && handle.done(); }
+
+		struct Awaiter
+		{
+			Handle handle;
+			bool await_ready() const noexcept { return !handle || handle.done(); }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) const noexcept
+			{
+				handle.promise().continuation = cont;
+				return handle;
+			}
+			T await_resume() const
+			{
+				DKASSERT_DESC(handle, "Invalid task");
+				if constexpr (std::is_void<T>::value)
+					handle.promise().Result();
+				else
+					return std::move(handle.promise().Result());
+			}
+		};
+		Awaiter operator co_await() const noexcept { return Awaiter{ handle }; }
+
+		/// Start task without awaiting, returns future of result.
+		/// This task object will be invalidated.
+		/// If the task finished with an exception, the future will be cancelled.
+		DKFuture<T> Detach()
+		{
+			DKPromise<T> promise;
+			DKFuture<T> future = promise.Future();
+			DetachTask(std::move(*this), std::move(promise));
+			return future;
+		}
+		/// Start task without awaiting. (fire and forget)
+		void Start()
+		{
+			Detach();
+		}
+
+	private:
+		explicit DKTask(Handle h) : handle(h) {}
+		static Private::DetachedCoroutine DetachTask(DKTask task, DKPromise<T> promise)
+		{
+			try {
+				if constexpr (std::is_void<T>::value)
+				{
+					co_await task;
+					promise.SetValue();
+				}
+				else
+				{
+					promise.SetValue(co_await task);
+				}
+			} catch (...) {
+				promise.Cancel();
+			}
+		}
+
+		DKTask(const DKTask&) = delete;
+		DKTask& operator = (const DKTask&) = delete;
+
+		Handle handle;
+		friend promise_type;
+	};
+
+	namespace Private
+	{
+		template <typename T> DKTask<T> TaskPromise<T>::get_return_object()
+		{
+			return DKTask<T>(DKTask<T>::Handle::from_promise(*this));
+		}
+		inline DKTask<void> TaskPromise<void>::get_return_object()
+		{
+			return DKTask<void>(DKTask<void>::Handle::from_promise(*this));
+		}
+	}
+
+	/// Resume coroutine on given operation-queue.
+	inline Private::ResumeOnQueueAwaiter DKResumeOn(DKOperationQueue* queue)
+	{
+		return { queue };
+	}
+	/// Resume coroutine on given event-loop.
+	/// If the coroutine is running on the event-loop thread already, it will not be suspended.
+	inline Private::ResumeOnEventLoopAwaiter DKResumeOn(DKEventLoop* eventLoop)
+	{
+		return { eventLoop, 0.0 };
+	}
+	/// Resume coroutine on given event-loop after delay. (system-tick-based)
+	inline Private::ResumeOnEventLoopAwaiter DKResumeAfter(DKEventLoop* eventLoop, double delay)
+	{
+		return { eventLoop, Max(delay, 0.0) };
+	}
+	/// Resume coroutine on given event-loop at given date. (system-date-based)
+	inline Private::ResumeAtEventLoopAwaiter DKResumeAt(DKEventLoop* eventLoop, const DKDateTime& date)
+	{
+		return { eventLoop, date };
+	}
+
+	/// Wait for operation, returns true if operation has been processed.
+	/// The coroutine will be resumed on the thread which finishes the operation.
+	inline Private::OperationSyncAwaiter operator co_await(const DKObject<DKOperationQueue::OperationSync>& sync)
+	{
+		return { sync };
+	}
+	/// Wait for operation, returns true if operation has been processed.
+	/// The coroutine will be resumed on the thread which finishes the operation.
+	inline Private::PendingStateAwaiter operator co_await(const DKObject<DKEventLoop::PendingState>& state)
+	{
+		return { state };
+	}
+	/// Wait for future, returns result or raise exception if cancelled.
+	/// The coroutine will be resumed on the thread which settles the result.
+	template <typename T> Private::FutureAwaiter<T> operator co_await(const DKFuture<T>& future)
+	{
+		return { future };
+	}
+}
+#endif // DKGL_COROUTINE_ENABLED
@@ -10,6 +10,40 @@
 
 namespace DKFoundation
 {
+	class DKSpinLock;
+	class DKMutex;
+	class DKLock;
+	class DKCondition;
+	class DKSharedLock;
+
+	namespace Private
+	{
+		/// Lock profiling hooks, see DKLockProfiler.
+		extern DKGL_API volatile bool lockProfilerEnabled;
+		DKGL_API uint64_t LockProfilerTick();
+		DKGL_API void LockProfilerRecord(const void* lock, uint64_t waitTicks, uint64_t holdTicks, bool contended);
+		/// ticks calling thread spent blocked in DKCondition::Wait(),
+		/// excluded from hold time of condition sections.
+		DKGL_API uint64_t LockProfilerConditionWaitTicks();
+
+		/// lock types to be profiled. (DKDummyLock or others are not)
+		template <typename T> struct LockProfiling { enum { Supported = false }; };
+		template <> struct LockProfiling<DKSpinLock> { enum { Supported = true }; };
+		template <> struct LockProfiling<DKMutex> { enum { Supported = true }; };
+		template <> struct LockProfiling<DKLock> { enum { Supported = true }; };
+		template <> struct LockProfiling<DKCondition> { enum { Supported = true }; };
+		template <> struct LockProfiling<DKSharedLock> { enum { Supported = true }; };
+
+		/// wait and hold time of a scoped lock section.
+		struct LockProfilingSection
+		{
+			uint64_t acquired;
+			uint64_t waitTicks;
+			uint64_t conditionWaitTicks;
+			bool contended;
+		};
+	}
+
 	/**
 	 @brief Synchronization utility. proved automatic locking with context scope based.
 	 Use combination with DKLock, DKMutex, DKSpinLock, DKSharedLock, etc.
@@ -31,22 +65,55 @@ namespace DKFoundation
 	
 	 @note
 	  Do not confuse with Win32 CriticalSection object, this is unrelated to that.
+	  Locking is profiled by this object, if DKLockProfiler is enabled.
 	 */
 	template <typename T> class DKCriticalSection
 	{
 	public:
 		DKCriticalSection(const T& lockObject)
 			: lock(lockObject)
+			, profiling(false)
+			, profile{}
 		{
+			if constexpr (Private::LockProfiling<T>::Supported)
+			{
+				if (Private::lockProfilerEnabled)
+				{
+					profiling = true;
+					uint64_t t = Private::LockProfilerTick();
+					profile.contended = !lock.TryLock();
+					if (profile.contended)
+						lock.Lock();
+					profile.acquired = Private::LockProfilerTick();
+					profile.waitTicks = profile.acquired - t;
+					if constexpr (std::is_same<T, DKCondition>::value)
+						profile.conditionWaitTicks = Private::LockProfilerConditionWaitTicks();
+					return;
+				}
+			}
 			lock.Lock();
 		}
 		~DKCriticalSection()
 		{
-			lock.Unlock();
+			if (profiling)
+			{
+				uint64_t holdTicks = Private::LockProfilerTick() - profile.acquired;
+				if constexpr (std::is_same<T, DKCondition>::value)
+				{
+					uint64_t blocked = Private::LockProfilerConditionWaitTicks() - profile.conditionWaitTicks;
+					holdTicks = holdTicks > blocked ? holdTicks - blocked : 0;
+				}
+				lock.Unlock();
+				Private::LockProfilerRecord(&lock, profile.waitTicks, holdTicks, profile.contended);
+			}
+			else
+				lock.Unlock();
 		}
 	private:
 		DKCriticalSection(const DKCriticalSection&) = delete;
 		DKCriticalSection& operator = (const DKCriticalSection&) = delete;
 		const T& lock;
+		bool profiling;
+		Private::LockProfilingSection profile;
 	};
 }
@@ -7,9 +7,79 @@
 
 #include "DKData.h"
 #include "DKFile.h"
+#include "DKBuffer.h"
 #include "DKFunction.h"
 
+namespace DKFoundation::Private
+{
+    // view of range, shares storage and lock with source.
+    struct SubdataView : public DKData
+    {
+        DKObject<DKData> source;
+        size_t offset;
+        size_t length;
+
+        size_t Length() const override
+        {
+            size_t sourceLength = source->Length();
+            if (sourceLength > offset)
+                return Min(length, sourceLength - offset);
+            return 0;
+        }
+        bool IsReadable() const override { return source->IsReadable(); }
+        bool IsWritable() const override { return source->IsWritable(); }
+        bool IsExcutable() const override { return source->IsExcutable(); }
+        bool IsTransient() const override { return source->IsTransient(); }
+
+        const void* LockShared() const override
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(source->LockShared());
+            return p ? p + offset : NULL;
+        }
+        bool TryLockShared(const void** ptr) const override
+        {
+            const void* p = NULL;
+            if (source->TryLockShared(&p))
+            {
+                if (ptr)
+                    *ptr = p ? reinterpret_cast<const uint8_t*>(p) + offset : NULL;
+                return true;
+            }
+            return false;
+        }
+        void UnlockShared() const override { source->UnlockShared(); }
+
+        void* LockExclusive() override
+        {
+            uint8_t* p = reinterpret_cast<uint8_t*>(source->LockExclusive());
+            return p ? p + offset : NULL;
+        }
+        bool TryLockExclusive(void** ptr) override
+        {
+            void* p = NULL;
+            if (source->TryLockExclusive(&p))
+            {
+                if (ptr)
+                    *ptr = p ? reinterpret_cast<uint8_t*>(p) + offset : NULL;
+                return true;
+            }
+            return false;
+        }
+        void UnlockExclusive() override { source->UnlockExclusive(); }
+
+        DKObject<DKData> Subdata(size_t off, size_t len) const override
+        {
+            // view of view refers the source directly.
+            size_t viewLength = Length();
+            off = Min(off, viewLength);
+            len = Min(len, viewLength - off);
+            return source->Subdata(offset + off, len);
+        }
+    };
+}
+
 using namespace DKFoundation;
+using namespace DKFoundation::Private;
 
 
 DKObject<DKData> DKData::StaticData(void* p, size_t len, bool readonly, DKOperation* cleanup)
@@ -205,3 +275,26 @@ DKObject<DKData> DKData::ImmutableData() const
 	}
 	return NULL;
 }
+
+DKObject<DKData> DKData::Subdata(size_t offset, size_t length) const
+{
+	size_t contentLength = this->Length();
+	offset = Min(offset, contentLength);
+	length = Min(length, contentLength - offset);
+
+	DKObject<DKData> source = const_cast<DKData*>(this);
+	if (source.IsManaged())
+	{
+		DKObject<SubdataView> view = DKObject<SubdataView>::New();
+		view->source = source;
+		view->offset = offset;
+		view->length = length;
+		return view.SafeCast<DKData>();
+	}
+
+	// object is not ref-counted, view can not retain it.
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(this->LockShared());
+	DKObject<DKData> data = DKBuffer::Create(p ? p + offset : NULL, length).SafeCast<DKData>();
+	this->UnlockShared();
+	return data;
+}
@@ -66,6 +66,14 @@ namespace DKFoundation
 		/// Clone immutable data object.
 		virtual DKObject<DKData> ImmutableData() const;
 
+		/// Create a view of given range without copying content.
+		/// The view shares storage and lock of this object, and retains this
+		/// object. Range is clamped to Length(), and view length is clamped
+		/// again if this object is resized later.
+		/// @note
+		///  If this object is not allocated with DKObject, returns a copy.
+		virtual DKObject<DKData> Subdata(size_t offset, size_t length = ~size_t(0)) const;
+
 
 		DKData(DKData&&) = delete;
 		DKData(const DKData&) = delete;
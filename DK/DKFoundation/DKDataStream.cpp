@@ -33,7 +33,7 @@ DKDataStream::~DKDataStream()
 
 DKStream::Position DKDataStream::SetCurrentPosition(Position p)
 {
-	if (p < TotalLength())
+	if (p <= TotalLength())
 		this->offset = p;
 	else
 		return PositionError;
@@ -105,6 +105,59 @@ size_t DKDataStream::Write(const void* p, size_t s)
 	return 0;
 }
 
+size_t DKDataStream::ReadAt(Position pos, void* p, size_t s)
+{
+	IOVector v = { p, s };
+	return ReadVAt(pos, &v, 1);
+}
+
+size_t DKDataStream::WriteAt(Position pos, const void* p, size_t s)
+{
+	return 0;
+}
+
+size_t DKDataStream::ReadV(const IOVector* v, size_t count)
+{
+	if (this->data)
+	{
+		Position pos = CurrentPosition();
+		size_t bytesRead = ReadVAt(pos, v, count);
+		this->offset = pos + bytesRead;
+		return bytesRead;
+	}
+	this->offset = 0;
+	return 0;
+}
+
+size_t DKDataStream::WriteV(const IOVector* v, size_t count)
+{
+	return 0;
+}
+
+size_t DKDataStream::ReadVAt(Position pos, const IOVector* v, size_t count)
+{
+	size_t bytesRead = 0;
+	if (this->data)
+	{
+		const char* ptr = reinterpret_cast<const char*>(this->data->LockShared());
+		size_t contentSize = this->data->Length();
+		for (size_t i = 0; i < count && pos < contentSize; ++i)
+		{
+			size_t s = Min(v[i].length, size_t(contentSize - pos));
+			memcpy(v[i].data, &ptr[pos], s);
+			pos += s;
+			bytesRead += s;
+		}
+		this->data->UnlockShared();
+	}
+	return bytesRead;
+}
+
+size_t DKDataStream::WriteVAt(Position pos, const IOVector* v, size_t count)
+{
+	return 0;
+}
+
 DKData* DKDataStream::Data()
 {
 	return this->data;
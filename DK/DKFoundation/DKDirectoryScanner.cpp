@@ -0,0 +1,455 @@
+//
+//  File: DKDirectoryScanner.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <dirent.h>
+	#include <unistd.h>
+	#ifdef __linux__
+		#include <sys/syscall.h>
+	#endif
+	#ifdef __APPLE__
+		#define st_mtim st_mtimespec
+	#endif
+#endif
+
+#include "DKDirectoryScanner.h"
+#include "DKStringU8.h"
+#include "DKOperationQueue.h"
+#include "DKFunction.h"
+#include "DKMutex.h"
+#include "DKCriticalSection.h"
+#include "DKSet.h"
+#include "DKLog.h"
+
+namespace DKFoundation::Private
+{
+    using ScannerEntry = DKDirectoryScanner::Entry;
+
+#ifdef __linux__
+    struct LinuxDirEntry64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+#endif
+#ifndef _WIN32
+    struct ScannerDirectoryId
+    {
+        uint64_t device;
+        uint64_t inode;
+    };
+    struct ScannerDirectoryIdComparator
+    {
+        int operator () (const ScannerDirectoryId& lhs, const ScannerDirectoryId& rhs) const
+        {
+            if (lhs.device != rhs.device)
+                return lhs.device > rhs.device ? 1 : -1;
+            if (lhs.inode != rhs.inode)
+                return lhs.inode > rhs.inode ? 1 : -1;
+            return 0;
+        }
+    };
+#endif
+
+    struct ScannerPendingDirectory
+    {
+        DKStringU8 path;
+        uint32_t depth;
+    };
+
+    // result of single operation, merged into scanner at once.
+    struct ScannerLocalResult
+    {
+        DKArray<ScannerEntry> entries;
+        DKArray<char> paths;
+        DKArray<ScannerPendingDirectory> pending;
+
+        // append path to buffer, returns offset of path.
+        size_t AppendPath(const DKStringU8& dir, const char* name, size_t nameLength, uint32_t& nameOffset)
+        {
+            size_t offset = paths.Count();
+            size_t dirLength = dir.Bytes();
+            if (dirLength > 0)
+            {
+                paths.Add((const char*)(const DKUniChar8*)dir, dirLength);
+                paths.Add('/');
+            }
+            nameOffset = uint32_t(paths.Count() - offset);
+            paths.Add(name, nameLength);
+            paths.Add('\0');
+            return offset;
+        }
+    };
+
+    struct ScannerContext
+    {
+        DKDirectoryScanner::Options options;
+        DKOperationQueue queue;
+
+        DKMutex lock;
+        DKArray<ScannerEntry>* entries;
+        DKArray<char>* paths;
+        size_t errors;
+        size_t parallelism;
+#ifdef _WIN32
+        DKString root;
+#else
+        int rootFd;
+        DKSet<ScannerDirectoryId, DKDummyLock, ScannerDirectoryIdComparator> visited;
+#endif
+
+        void Post(const DKStringU8& dir, uint32_t depth)
+        {
+            queue.Post(DKFunction([this, dir, depth]()
+            {
+                ScanTree(dir, depth);
+            })->Invocation());
+        }
+
+        // Scan sub-directories in current operation, post sub-directory to
+        // queue only if other threads are waiting for work. (reduce overhead
+        // of operation and merging for small directories)
+        void ScanTree(const DKStringU8& dir, uint32_t depth)
+        {
+            ScannerLocalResult result;
+            result.pending.Add({ dir, depth });
+            while (result.pending.Count() > 0)
+            {
+                ScannerPendingDirectory pd = result.pending.Value(result.pending.Count() - 1);
+                result.pending.Remove(result.pending.Count() - 1);
+                const size_t numPending = result.pending.Count();
+
+                ScanDirectory(result, pd.path, pd.depth);
+
+                while (result.pending.Count() > numPending + 1 && queue.QueueLength() < parallelism)
+                {
+                    ScannerPendingDirectory& next = result.pending.Value(numPending);
+                    Post(next.path, next.depth);
+                    result.pending.Remove(numPending);
+                }
+            }
+            Commit(result);
+        }
+
+        void Commit(ScannerLocalResult& result)
+        {
+            DKCriticalSection<DKMutex> guard(lock);
+            const size_t base = paths->Count();
+            for (ScannerEntry& e : result.entries)
+                e.pathOffset += base;
+            entries->Add(result.entries);
+            paths->Add(result.paths);
+        }
+
+        void Failed(const DKStringU8& dir)
+        {
+            DKLogE("DKDirectoryScanner Error: Cannot read directory: %s\n", (const char*)(const DKUniChar8*)dir);
+            DKCriticalSection<DKMutex> guard(lock);
+            errors++;
+        }
+
+        bool IsHidden(const char* name) const
+        {
+            return name[0] == '.';
+        }
+
+        // Add entry to result and post sub-directory scan.
+        void AddEntry(ScannerLocalResult& result, const DKStringU8& dir, uint32_t depth,
+                      const char* name, size_t nameLength,
+                      DKDirectoryScanner::EntryType type, uint64_t size, int64_t mtime, bool descend)
+        {
+            const size_t numPaths = result.paths.Count();
+            ScannerEntry e;
+            e.pathOffset = result.AppendPath(dir, name, nameLength, e.nameOffset);
+            e.pathLength = uint32_t(result.paths.Count() - e.pathOffset - 1);
+            e.depth = depth;
+            e.type = type;
+            e.size = size;
+            e.modificationTime = mtime;
+
+            if (descend && options.recursive && depth < options.maxDepth)
+                result.pending.Add({ DKStringU8((const DKUniChar8*)&result.paths.Value(e.pathOffset), e.pathLength), depth + 1 });
+
+            if (type != DKDirectoryScanner::EntryDirectory || options.includeDirectories)
+                result.entries.Add(e);
+            else
+                result.paths.Remove(numPaths, result.paths.Count() - numPaths);
+        }
+
+#ifdef _WIN32
+        void ScanDirectory(ScannerLocalResult& result, const DKStringU8& dir, uint32_t depth)
+        {
+            DKString path = root;
+            if (dir.Bytes() > 0)
+            {
+                DKString sub(dir);
+                sub.Replace(L'/', L'\\');
+                path.Append(L"\\");
+                path.Append(sub);
+            }
+            path.Append(L"\\*");
+
+            WIN32_FIND_DATAW data;
+            HANDLE h = ::FindFirstFileExW((const wchar_t*)path, FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+            if (h == INVALID_HANDLE_VALUE)
+            {
+                Failed(dir);
+                return;
+            }
+            do
+            {
+                const wchar_t* name = data.cFileName;
+                if (name[0] == L'.' && (name[1] == 0 || (name[1] == L'.' && name[2] == 0)))
+                    continue;
+                if (!options.includeHidden && (name[0] == L'.' || (data.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)))
+                    continue;
+
+                DKDirectoryScanner::EntryType type = DKDirectoryScanner::EntryFile;
+                bool descend = false;
+                if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+                {
+                    type = DKDirectoryScanner::EntrySymlink;
+                    descend = options.followSymlinks && (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+                }
+                else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    type = DKDirectoryScanner::EntryDirectory;
+                    descend = true;
+                }
+                uint64_t size = 0;
+                int64_t mtime = 0;
+                if (options.queryAttributes)
+                {
+                    size = (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                    int64_t ft = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+                    mtime = (ft - 116444736000000000LL) * 100; // 100ns since 1601 to ns since 1970
+                }
+                DKStringU8 nameUTF8(name);
+                AddEntry(result, dir, depth, (const char*)(const DKUniChar8*)nameUTF8, nameUTF8.Bytes(), type, size, mtime, descend);
+            } while (::FindNextFileW(h, &data));
+            ::FindClose(h);
+        }
+#else
+        void ScanEntry(ScannerLocalResult& result, const DKStringU8& dir, uint32_t depth, int fd, const char* name, unsigned char dtype)
+        {
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                return;
+            if (!options.includeHidden && IsHidden(name))
+                return;
+
+            DKDirectoryScanner::EntryType type;
+            switch (dtype)
+            {
+            case DT_REG:    type = DKDirectoryScanner::EntryFile;       break;
+            case DT_DIR:    type = DKDirectoryScanner::EntryDirectory;  break;
+            case DT_LNK:    type = DKDirectoryScanner::EntrySymlink;    break;
+            default:        type = DKDirectoryScanner::EntryOther;      break;
+            }
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            // stat only if needed. (file-system may not provide d_type)
+            if (options.queryAttributes || dtype == DT_UNKNOWN)
+            {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    return;     // removed while scanning
+                if (S_ISREG(st.st_mode))        type = DKDirectoryScanner::EntryFile;
+                else if (S_ISDIR(st.st_mode))   type = DKDirectoryScanner::EntryDirectory;
+                else if (S_ISLNK(st.st_mode))   type = DKDirectoryScanner::EntrySymlink;
+                else                            type = DKDirectoryScanner::EntryOther;
+                size = uint64_t(st.st_size);
+                mtime = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+            }
+            bool descend = type == DKDirectoryScanner::EntryDirectory;
+            if (type == DKDirectoryScanner::EntrySymlink && options.followSymlinks)
+            {
+                struct stat st;
+                descend = fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+            }
+            AddEntry(result, dir, depth, name, strlen(name), type, size, mtime, descend);
+        }
+
+        void ScanDirectory(ScannerLocalResult& result, const DKStringU8& dir, uint32_t depth)
+        {
+            const char* path = dir.Bytes() > 0 ? (const char*)(const DKUniChar8*)dir : ".";
+            int fd = openat(rootFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                Failed(dir);
+                return;
+            }
+            if (options.followSymlinks)     // prevent cycles
+            {
+                struct stat st;
+                if (fstat(fd, &st) == 0)
+                {
+                    ScannerDirectoryId id = { uint64_t(st.st_dev), uint64_t(st.st_ino) };
+                    DKCriticalSection<DKMutex> guard(lock);
+                    if (visited.Contains(id))
+                    {
+                        close(fd);
+                        return;
+                    }
+                    visited.Insert(id);
+                }
+            }
+
+#ifdef __linux__
+            alignas(8) char buffer[0x8000];
+            for (;;)
+            {
+                long n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+                if (n <= 0)
+                    break;
+                for (long pos = 0; pos < n; )
+                {
+                    const LinuxDirEntry64* d = reinterpret_cast<const LinuxDirEntry64*>(&buffer[pos]);
+                    ScanEntry(result, dir, depth, fd, d->d_name, d->d_type);
+                    pos += d->d_reclen;
+                }
+            }
+            close(fd);
+#else
+            DIR* dp = fdopendir(fd);
+            if (dp == NULL)
+            {
+                close(fd);
+                Failed(dir);
+                return;
+            }
+            while (struct dirent* ep = readdir(dp))
+                ScanEntry(result, dir, depth, dirfd(dp), ep->d_name, ep->d_type);
+            closedir(dp);
+#endif
+        }
+#endif
+    };
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+DKDirectoryScanner::Options::Options()
+	: recursive(true)
+	, includeDirectories(true)
+	, includeHidden(true)
+	, followSymlinks(false)
+	, queryAttributes(true)
+	, sorted(true)
+	, maxDepth(~uint32_t(0))
+	, maxConcurrency(0)
+{
+}
+
+DKDirectoryScanner::DKDirectoryScanner()
+	: errors(0)
+{
+}
+
+DKDirectoryScanner::~DKDirectoryScanner()
+{
+}
+
+bool DKDirectoryScanner::Scan(const DKString& path)
+{
+	return Scan(path, Options());
+}
+
+bool DKDirectoryScanner::Scan(const DKString& path, const Options& options)
+{
+	Clear();
+
+	ScannerContext ctxt;
+	ctxt.options = options;
+	ctxt.entries = &entries;
+	ctxt.paths = &paths;
+	ctxt.errors = 0;
+	if (options.maxConcurrency > 0)
+		ctxt.queue.SetMaxConcurrentOperations(options.maxConcurrency);
+	ctxt.parallelism = ctxt.queue.MaxConcurrentOperations();
+
+#ifdef _WIN32
+	ctxt.root = path;
+	while (ctxt.root.Length() > 0 && (ctxt.root.Right(ctxt.root.Length() - 1) == L"\\" || ctxt.root.Right(ctxt.root.Length() - 1) == L"/"))
+		ctxt.root = ctxt.root.Left(ctxt.root.Length() - 1);
+	if (ctxt.root.Left(1) == L"/")	// virtual root ("/C:\")
+		ctxt.root = ctxt.root.Right(1);
+	DWORD attr = ::GetFileAttributesW((const wchar_t*)ctxt.root);
+	if (attr == INVALID_FILE_ATTRIBUTES || !(attr & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+#else
+	ctxt.rootFd = open((const char*)(const DKUniChar8*)DKStringU8(path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (ctxt.rootFd < 0)
+		return false;
+#endif
+	rootPath = path;
+
+	ctxt.Post(DKStringU8(), 0);
+	ctxt.queue.WaitForCompletion();
+	errors = ctxt.errors;
+#ifndef _WIN32
+	close(ctxt.rootFd);
+#endif
+
+	if (options.sorted && entries.Count() > 1)
+	{
+		// sort entries, rebuild path buffer in order.
+		const char* p = paths;
+		entries.Sort([p](const Entry& lhs, const Entry& rhs)
+		{
+			return strcmp(&p[lhs.pathOffset], &p[rhs.pathOffset]) < 0;
+		});
+		DKArray<char> sortedPaths;
+		sortedPaths.Reserve(paths.Count());
+		for (Entry& e : entries)
+		{
+			size_t offset = sortedPaths.Count();
+			sortedPaths.Add(&paths.Value(e.pathOffset), e.pathLength + 1);
+			e.pathOffset = offset;
+		}
+		paths = static_cast<DKArray<char>&&>(sortedPaths);
+	}
+	return true;
+}
+
+void DKDirectoryScanner::Clear()
+{
+	rootPath = L"";
+	entries.Clear();
+	paths.Clear();
+	errors = 0;
+}
+
+DKString DKDirectoryScanner::PathStringAt(size_t index) const
+{
+	const Entry& e = entries.Value(index);
+	return DKString(DKStringU8((const DKUniChar8*)&paths.Value(e.pathOffset), e.pathLength));
+}
+
+DKString DKDirectoryScanner::AbsolutePathAt(size_t index) const
+{
+	return rootPath.FilePathStringByAppendingPath(PathStringAt(index));
+}
+
+uint64_t DKDirectoryScanner::TotalFileSize() const
+{
+	uint64_t size = 0;
+	for (const Entry& e : entries)
+	{
+		if (e.type == EntryFile)
+			size += e.size;
+	}
+	return size;
+}
@@ -0,0 +1,105 @@
+//
+//  File: DKDirectoryScanner.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKString.h"
+#include "DKArray.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Recursive directory scanner.
+
+	 Scans directory tree from given root, sub-directories are scanned in
+	 parallel with DKOperationQueue. Results are stored in compact arrays:
+	 entry records and single UTF-8 path buffer. (paths are relative to root,
+	 separated with '/' and null-terminated)
+	 On Linux, directories are read with getdents64 and attributes are
+	 queried with fstatat relative to directory descriptor.
+
+	 @code
+	  DKDirectoryScanner scanner;
+	  if (scanner.Scan("/data/contents"))
+	  {
+		  for (size_t i = 0; i < scanner.NumberOfEntries(); ++i)
+		  {
+			  const DKDirectoryScanner::Entry& e = scanner.EntryAt(i);
+			  if (e.type == DKDirectoryScanner::EntryFile)
+				  printf("%s (%llu bytes)\n", scanner.PathAt(i), e.size);
+		  }
+	  }
+	 @endcode
+	 @note
+	  path argument must be absolute-path.
+	 */
+	class DKGL_API DKDirectoryScanner
+	{
+	public:
+		enum EntryType : uint8_t
+		{
+			EntryFile = 0,
+			EntryDirectory,
+			EntrySymlink,
+			EntryOther,
+		};
+		struct Entry
+		{
+			size_t pathOffset;			///< offset of path in path buffer
+			uint32_t pathLength;		///< bytes of path (without null-terminator)
+			uint32_t nameOffset;		///< offset of file-name in path
+			uint32_t depth;				///< 0 for entries in root directory
+			EntryType type;
+			uint64_t size;				///< file size, 0 if attributes are not queried
+			int64_t modificationTime;	///< nanoseconds since 1970-01-01 UTC
+		};
+		struct Options
+		{
+			bool recursive;
+			bool includeDirectories;	///< add directory entries to result
+			bool includeHidden;			///< include names begin with '.'
+			bool followSymlinks;		///< scan into symbolic linked directories
+			bool queryAttributes;		///< query size and modification time
+			bool sorted;				///< sort entries by path
+			uint32_t maxDepth;
+			size_t maxConcurrency;		///< 0 for default
+
+			Options();
+		};
+
+		DKDirectoryScanner();
+		~DKDirectoryScanner();
+
+		bool Scan(const DKString& path);
+		bool Scan(const DKString& path, const Options& options);
+		void Clear();
+
+		const DKString& RootPath() const	{ return rootPath; }
+		size_t NumberOfEntries() const		{ return entries.Count(); }
+		const Entry& EntryAt(size_t index) const	{ return entries.Value(index); }
+		/// relative path of entry (UTF-8)
+		const char* PathAt(size_t index) const		{ return &paths.Value(entries.Value(index).pathOffset); }
+		const char* NameAt(size_t index) const		{ return PathAt(index) + entries.Value(index).nameOffset; }
+		DKString PathStringAt(size_t index) const;
+		DKString AbsolutePathAt(size_t index) const;
+
+		/// number of directories could not be read.
+		size_t NumberOfErrors() const		{ return errors; }
+		/// total bytes of files.
+		uint64_t TotalFileSize() const;
+
+	private:
+		DKDirectoryScanner(const DKDirectoryScanner&) = delete;
+		DKDirectoryScanner& operator = (const DKDirectoryScanner&) = delete;
+
+		DKString rootPath;
+		DKArray<Entry> entries;
+		DKArray<char> paths;
+		size_t errors;
+	};
+}
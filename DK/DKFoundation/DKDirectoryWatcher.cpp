@@ -0,0 +1,352 @@
+//
+//  File: DKDirectoryWatcher.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <sys/eventfd.h>
+	#include <poll.h>
+	#include <unistd.h>
+	#include <errno.h>
+	#include <time.h>
+	#include <math.h>
+#endif
+
+#include "DKDirectoryWatcher.h"
+#include "DKDirectoryScanner.h"
+#include "DKStringU8.h"
+#include "DKThread.h"
+#include "DKMutex.h"
+#include "DKCriticalSection.h"
+#include "DKMap.h"
+#include "DKArray.h"
+#include "DKLog.h"
+
+#ifdef __linux__
+#define WATCHER_EVENT_MASK	(IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK)
+
+namespace DKFoundation::Private
+{
+    using WatcherEvent = DKDirectoryWatcher::Event;
+
+    struct WatcherContext
+    {
+        int fd;
+        int wakeFd;
+        bool recursive;
+        double latency;
+        DKStringU8 root;
+        DKObject<DKDirectoryWatcher::Callback> callback;
+        DKObject<DKEventLoop> eventLoop;
+        DKObject<DKThread> thread;
+
+        DKMutex lock;   // watches can be accessed from other thread.
+        DKMap<int, DKStringU8> watches;
+
+        // pending events, accessed by watcher thread only.
+        DKArray<WatcherEvent> events;
+        DKMap<DKString, size_t> eventIndex;
+        double deadline;
+
+        static double Now()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return double(ts.tv_sec) + double(ts.tv_nsec) * 0.000000001;
+        }
+
+        static DKStringU8 JoinPath(const DKStringU8& dir, const DKStringU8& name)
+        {
+            if (dir.Bytes() == 0)
+                return name;
+            if (name.Bytes() == 0)
+                return dir;
+            DKStringU8 path = dir;
+            path += (DKUniChar8)'/';
+            path += name;
+            return path;
+        }
+
+        bool AddWatch(const DKStringU8& rel)
+        {
+            DKStringU8 path = JoinPath(root, rel);
+            int wd = inotify_add_watch(fd, (const char*)(const DKUniChar8*)path, WATCHER_EVENT_MASK);
+            if (wd < 0)
+            {
+                DKLogE("DKDirectoryWatcher Error: inotify_add_watch failed for %s (errno:%d)\n", (const char*)(const DKUniChar8*)path, errno);
+                return false;
+            }
+            DKCriticalSection<DKMutex> guard(lock);
+            watches.Update(wd, rel);
+            return true;
+        }
+
+        // watch directory and sub-directories, report contents as created if needed.
+        bool AddTree(const DKStringU8& rel, bool report)
+        {
+            if (!AddWatch(rel))
+                return false;
+            if (recursive)
+            {
+                DKDirectoryScanner::Options options;
+                options.queryAttributes = false;
+                options.sorted = report;
+                DKDirectoryScanner scanner;
+                if (scanner.Scan(DKString(JoinPath(root, rel)), options))
+                {
+                    for (size_t i = 0; i < scanner.NumberOfEntries(); ++i)
+                    {
+                        const DKDirectoryScanner::Entry& e = scanner.EntryAt(i);
+                        DKStringU8 path = JoinPath(rel, DKStringU8((const DKUniChar8*)scanner.PathAt(i), e.pathLength));
+                        bool dir = e.type == DKDirectoryScanner::EntryDirectory;
+                        if (dir)
+                            AddWatch(path);
+                        if (report)
+                            AddEvent(DKDirectoryWatcher::EventCreated, dir, path);
+                    }
+                }
+            }
+            return true;
+        }
+
+        void RemoveTree(const DKStringU8& rel)
+        {
+            const char* prefix = (const char*)(const DKUniChar8*)rel;
+            const size_t prefixLength = rel.Bytes();
+            DKArray<int> removed;
+            DKCriticalSection<DKMutex> guard(lock);
+            watches.EnumerateForward([&](DKMap<int, DKStringU8>::Pair& pair, bool*)
+            {
+                const char* path = (const char*)(const DKUniChar8*)pair.value;
+                if (pair.value.Bytes() >= prefixLength && strncmp(path, prefix, prefixLength) == 0 &&
+                    (path[prefixLength] == '/' || path[prefixLength] == '\0'))
+                    removed.Add(pair.key);
+            });
+            for (int wd : removed)
+            {
+                inotify_rm_watch(fd, wd);
+                watches.Remove(wd);
+            }
+        }
+
+        void AddEvent(DKDirectoryWatcher::EventType type, bool dir, const DKStringU8& rel)
+        {
+            DKString path(rel);
+            if (auto p = eventIndex.Find(path); p)
+            {
+                const WatcherEvent& e = events.Value(p->value);
+                if (e.type == type || (e.type == DKDirectoryWatcher::EventCreated && type == DKDirectoryWatcher::EventModified))
+                    return;     // coalesce
+            }
+            if (events.Count() == 0)
+                deadline = Now() + latency;
+            eventIndex.Update(path, events.Count());
+            events.Add({ type, dir, path });
+        }
+
+        void ProcessEvent(const struct inotify_event* ev)
+        {
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                AddEvent(DKDirectoryWatcher::EventOverflow, false, DKStringU8());
+                return;
+            }
+
+            DKStringU8 dirPath;
+            bool found = false;
+            {
+                DKCriticalSection<DKMutex> guard(lock);
+                if (auto p = watches.Find(ev->wd); p)
+                {
+                    dirPath = p->value;
+                    found = true;
+                }
+                if (ev->mask & IN_IGNORED)
+                    watches.Remove(ev->wd);
+            }
+            if (!found || (ev->mask & IN_IGNORED))
+                return;
+
+            if (ev->mask & IN_DELETE_SELF)
+            {
+                if (dirPath.Bytes() == 0)   // root removed.
+                    AddEvent(DKDirectoryWatcher::EventRemoved, true, dirPath);
+                return;
+            }
+
+            const bool dir = (ev->mask & IN_ISDIR) != 0;
+            DKStringU8 path = JoinPath(dirPath, DKStringU8((const DKUniChar8*)ev->name));
+            if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+            {
+                AddEvent(DKDirectoryWatcher::EventCreated, dir, path);
+                if (dir && recursive)
+                    AddTree(path, true);
+            }
+            else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+            {
+                AddEvent(DKDirectoryWatcher::EventRemoved, dir, path);
+                if (dir && recursive)
+                    RemoveTree(path);
+            }
+            else if (ev->mask & (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE))
+            {
+                AddEvent(DKDirectoryWatcher::EventModified, dir, path);
+            }
+        }
+
+        void Deliver()
+        {
+            DKArray<WatcherEvent> batch = static_cast<DKArray<WatcherEvent>&&>(events);
+            events.Clear();
+            eventIndex.Clear();
+
+            if (eventLoop)
+            {
+                DKObject<DKDirectoryWatcher::Callback> cb = callback;
+                eventLoop->Post(DKFunction([cb, batch]()
+                {
+                    cb->Invoke(batch, batch.Count());
+                })->Invocation());
+            }
+            else
+            {
+                callback->Invoke(batch, batch.Count());
+            }
+        }
+
+        void ThreadProc()
+        {
+            alignas(struct inotify_event) char buffer[0x10000];
+            for (;;)
+            {
+                int timeout = -1;
+                if (events.Count() > 0)
+                    timeout = int(ceil(Max(deadline - Now(), 0.0) * 1000.0));
+
+                struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+                int r = poll(fds, 2, timeout);
+                if (r < 0 && errno != EINTR)
+                {
+                    DKLogE("DKDirectoryWatcher Error: poll failed (errno:%d)\n", errno);
+                    break;
+                }
+                if (fds[1].revents & POLLIN)
+                    break;
+                if (fds[0].revents & POLLIN)
+                {
+                    ssize_t n = read(fd, buffer, sizeof(buffer));
+                    for (ssize_t pos = 0; pos < n; )
+                    {
+                        const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(&buffer[pos]);
+                        ProcessEvent(ev);
+                        pos += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+                if (events.Count() > 0 && Now() >= deadline)
+                    Deliver();
+            }
+            if (events.Count() > 0)
+                Deliver();
+        }
+    };
+}
+using namespace DKFoundation::Private;
+#endif
+
+using namespace DKFoundation;
+
+#define WATCHER_IMPL	reinterpret_cast<WatcherContext*>(this->impl)
+
+DKDirectoryWatcher::DKDirectoryWatcher()
+	: impl(NULL)
+{
+}
+
+DKDirectoryWatcher::~DKDirectoryWatcher()
+{
+	Stop();
+}
+
+bool DKDirectoryWatcher::Start(const DKString& path, bool recursive, Callback* callback, DKEventLoop* eventLoop, double latency)
+{
+	Stop();
+	if (callback == NULL)
+		return false;
+#ifdef __linux__
+	WatcherContext* ctxt = new WatcherContext();
+	ctxt->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	ctxt->wakeFd = eventfd(0, EFD_CLOEXEC);
+	ctxt->recursive = recursive;
+	ctxt->latency = Max(latency, 0.0);
+	ctxt->root = DKStringU8(path);
+	ctxt->callback = callback;
+	ctxt->eventLoop = eventLoop;
+	ctxt->deadline = 0;
+
+	if (ctxt->fd >= 0 && ctxt->wakeFd >= 0 && ctxt->AddTree(DKStringU8(), false))
+	{
+		ctxt->thread = DKThread::Create(DKFunction(ctxt, &WatcherContext::ThreadProc)->Invocation());
+		if (ctxt->thread)
+		{
+			this->impl = ctxt;
+			return true;
+		}
+	}
+	DKLogE("DKDirectoryWatcher Error: Cannot watch directory: %ls\n", (const wchar_t*)path);
+	if (ctxt->fd >= 0)
+		close(ctxt->fd);
+	if (ctxt->wakeFd >= 0)
+		close(ctxt->wakeFd);
+	delete ctxt;
+#else
+	DKLogE("DKDirectoryWatcher Error: Not supported on this platform.\n");
+#endif
+	return false;
+}
+
+void DKDirectoryWatcher::Stop()
+{
+#ifdef __linux__
+	WatcherContext* ctxt = WATCHER_IMPL;
+	if (ctxt)
+	{
+		uint64_t value = 1;
+		if (write(ctxt->wakeFd, &value, sizeof(value)) == sizeof(value))
+			ctxt->thread->WaitTerminate();
+		close(ctxt->fd);
+		close(ctxt->wakeFd);
+		delete ctxt;
+		this->impl = NULL;
+	}
+#endif
+}
+
+bool DKDirectoryWatcher::IsRunning() const
+{
+	return this->impl != NULL;
+}
+
+size_t DKDirectoryWatcher::NumberOfWatches() const
+{
+#ifdef __linux__
+	WatcherContext* ctxt = WATCHER_IMPL;
+	if (ctxt)
+	{
+		DKCriticalSection<DKMutex> guard(ctxt->lock);
+		return ctxt->watches.Count();
+	}
+#endif
+	return 0;
+}
+
+bool DKDirectoryWatcher::IsSupported()
+{
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
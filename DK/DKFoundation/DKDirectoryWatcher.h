@@ -0,0 +1,72 @@
+//
+//  File: DKDirectoryWatcher.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKFunction.h"
+#include "DKEventLoop.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Monitors changes of directory tree.
+
+	 Changes are collected by background thread and delivered in batches.
+	 Events within latency are delivered together, repeated events for same
+	 path are coalesced. (ex: multiple writes to single file)
+	 Callback is posted to event-loop if given, or invoked on watcher thread.
+
+	 When sub-directory is created or moved into watched tree, its contents
+	 are reported as created. Moving file out of tree is reported as removed.
+	 EventOverflow means some events were lost, rescan tree if needed.
+
+	 @note
+	  Implemented with inotify, supported on Linux only.
+	  Start() fails on other platforms. (IsSupported() returns false)
+	 */
+	class DKGL_API DKDirectoryWatcher
+	{
+	public:
+		enum EventType : uint8_t
+		{
+			EventCreated = 0,
+			EventRemoved,
+			EventModified,
+			EventOverflow,
+		};
+		struct Event
+		{
+			EventType type;
+			bool directory;
+			DKString path;		///< relative to watched directory, separated with '/'
+		};
+		using Callback = DKFunctionSignature<void (const Event*, size_t)>;
+
+		DKDirectoryWatcher();
+		~DKDirectoryWatcher();		///< calls Stop()
+
+		/// start monitoring directory. path must be absolute-path.
+		/// latency: seconds to collect events into single batch.
+		bool Start(const DKString& path, bool recursive, Callback* callback, DKEventLoop* eventLoop = NULL, double latency = 0.1);
+		void Stop();
+		bool IsRunning() const;
+
+		/// number of watching directories
+		size_t NumberOfWatches() const;
+
+		static bool IsSupported();
+
+	private:
+		DKDirectoryWatcher(const DKDirectoryWatcher&) = delete;
+		DKDirectoryWatcher& operator = (const DKDirectoryWatcher&) = delete;
+
+		void* impl;
+	};
+}
@@ -0,0 +1,523 @@
+//
+//  File: DKEpoch.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include <new>
+#include "DKEpoch.h"
+#include "DKAtomicNumber64.h"
+#include "DKSpinLock.h"
+#include "DKCondition.h"
+#include "DKThread.h"
+#include "DKFunction.h"
+#include "DKLog.h"
+
+namespace DKFoundation::Private
+{
+    enum
+    {
+        EpochBatchSize = 64,
+        EpochMaxPendingBatches = 32,
+    };
+
+    struct EpochRetired
+    {
+        void* p;
+        DKEpoch::Deleter deleter;
+        void* context;
+    };
+
+    // Retired objects of one thread, tagged with global epoch when the batch
+    // is moved to pending list. It can be reclaimed after two epochs advanced.
+    struct EpochBatch
+    {
+        EpochBatch* next;
+        int64_t epoch;
+        size_t count;
+        EpochRetired items[EpochBatchSize];
+    };
+
+    // Per-thread record, records are never removed from list while domain
+    // is alive. (released record can be reused by other thread)
+    struct alignas(64) EpochRecord
+    {
+        DKAtomicNumber64 state;     // (epoch << 1) | 1 if pinned, 0 if not.
+        uint32_t nesting;
+        DKThread::ThreadId owner;
+        EpochBatch* batch;
+        EpochRecord* next;
+    };
+
+    class EpochDomain;
+    // Allocator for batch nodes. The domain reclaims retired objects when
+    // allocator chain is purged. (DKAllocatorChain::Cleanup)
+    class EpochAllocator : public DKAllocator
+    {
+    public:
+        EpochAllocator(EpochDomain* d) : domain(d) {}
+        void* Alloc(size_t s) override { return DKMemoryHeapAlloc(s); }
+        void* Realloc(void* p, size_t s) override { return DKMemoryHeapRealloc(p, s); }
+        void Dealloc(void* p) override { DKMemoryHeapFree(p); }
+        DKMemoryLocation Location() const override { return DKMemoryLocationHeap; }
+        size_t Purge() override;
+
+        EpochDomain* domain;
+    };
+
+    static DKAtomicNumber64 epochDomainCounter = 0;
+    static DKSpinLock epochDomainsLock;
+    static EpochDomain* epochDomains = NULL;
+
+    class EpochDomain
+    {
+    public:
+        EpochDomain(double interval)
+            : domainId(epochDomainCounter.Increment() + 1)
+            , globalEpoch(0)
+            , retiredCount(0)
+            , records(NULL)
+            , pendingFirst(NULL)
+            , pendingLast(NULL)
+            , numPendingBatches(0)
+            , terminate(false)
+            , prevDomain(NULL)
+            , nextDomain(NULL)
+        {
+            allocator = new EpochAllocator(this);
+
+            epochDomainsLock.Lock();
+            nextDomain = epochDomains;
+            if (epochDomains)
+                epochDomains->prevDomain = this;
+            epochDomains = this;
+            epochDomainsLock.Unlock();
+
+            if (interval > 0.0)
+            {
+                thread = DKThread::Create(DKFunction([this, interval]()
+                {
+                    DKThread::SetCurrentThreadName(L"DKEpochReclaim");
+                    ReclaimThreadProc(interval);
+                })->Invocation());
+            }
+        }
+
+        ~EpochDomain()
+        {
+            if (thread)
+            {
+                reclaimCond.Lock();
+                terminate = true;
+                reclaimCond.Broadcast();
+                reclaimCond.Unlock();
+                thread->WaitTerminate();
+                thread = NULL;
+            }
+
+            epochDomainsLock.Lock();
+            if (prevDomain)
+                prevDomain->nextDomain = nextDomain;
+            else
+                epochDomains = nextDomain;
+            if (nextDomain)
+                nextDomain->prevDomain = prevDomain;
+            epochDomainsLock.Unlock();
+
+            // no more readers, reclaim all objects regardless of epoch.
+            size_t reclaimed = 0;
+            for (EpochRecord* r = records; r; )
+            {
+                DKASSERT_DESC_DEBUG(r->nesting == 0, "DKEpoch destroyed while thread is pinned!");
+                if (r->batch)
+                    reclaimed += ReclaimBatch(r->batch);
+                EpochRecord* next = r->next;
+                delete r;
+                r = next;
+            }
+            for (EpochBatch* b = pendingFirst; b; )
+            {
+                EpochBatch* next = b->next;
+                reclaimed += ReclaimBatch(b);
+                b = next;
+            }
+            retiredCount.Add(-static_cast<int64_t>(reclaimed));
+            DKASSERT_DEBUG(retiredCount == 0);
+            delete allocator;
+        }
+
+        EpochRecord* ThreadRecord();
+        void ReleaseThread(DKThread::ThreadId tid);
+
+        void Pin()
+        {
+            EpochRecord* r = ThreadRecord();
+            if (r->nesting++ == 0)
+            {
+                // exchange with full barrier, following loads of shared data
+                // must not be reordered before publishing this state.
+                r->state = (static_cast<int64_t>(globalEpoch) << 1) | 1;
+            }
+        }
+
+        void Unpin()
+        {
+            EpochRecord* r = ThreadRecord();
+            DKASSERT_DESC_DEBUG(r->nesting > 0, "DKEpoch is not pinned!");
+            if (--r->nesting == 0)
+            {
+                r->state = 0;
+                if (r->batch && IsBatchAged(r->batch))
+                    FlushBatch(r);
+            }
+        }
+
+        bool IsPinned()
+        {
+            return ThreadRecord()->nesting > 0;
+        }
+
+        void Retire(void* p, DKEpoch::Deleter deleter, void* context)
+        {
+            EpochRecord* r = ThreadRecord();
+            EpochBatch* batch = r->batch;
+            if (batch == NULL)
+            {
+                batch = new(allocator->Alloc(sizeof(EpochBatch))) EpochBatch();
+                batch->epoch = globalEpoch;  // epoch of first item, to flush aged batch.
+                r->batch = batch;
+            }
+            batch->items[batch->count++] = { p, deleter, context };
+            retiredCount.Increment();
+
+            if (batch->count == EpochBatchSize || IsBatchAged(batch))
+            {
+                // reclaim inline if background thread falls behind.
+                if (FlushBatch(r) > EpochMaxPendingBatches || !thread)
+                    Reclaim();
+                else
+                    TryAdvance();
+            }
+        }
+
+        // advance global epoch if all pinned threads observed current epoch.
+        bool TryAdvance()
+        {
+            int64_t e = globalEpoch;
+            registryLock.Lock();
+            for (EpochRecord* r = records; r; r = r->next)
+            {
+                int64_t s = r->state;
+                if ((s & 1) && (s >> 1) != e)
+                {
+                    registryLock.Unlock();
+                    return false;
+                }
+            }
+            registryLock.Unlock();
+            return globalEpoch.CompareAndSet(e, e + 1);
+        }
+
+        size_t Reclaim()
+        {
+            EpochRecord* r = ThreadRecord();
+            if (r->batch && r->nesting == 0)
+                FlushBatch(r);
+
+            if (TryAdvance())
+                TryAdvance();
+
+            // batches are ordered by epoch in pending list.
+            int64_t e = globalEpoch;
+            EpochBatch* list = NULL;
+            pendingLock.Lock();
+            if (pendingFirst && pendingFirst->epoch + 2 <= e)
+            {
+                list = pendingFirst;
+                EpochBatch* last = pendingFirst;
+                while (last->next && last->next->epoch + 2 <= e)
+                    last = last->next;
+                pendingFirst = last->next;
+                if (pendingFirst == NULL)
+                    pendingLast = NULL;
+                last->next = NULL;
+                for (EpochBatch* b = list; b; b = b->next)
+                    numPendingBatches--;
+            }
+            pendingLock.Unlock();
+
+            size_t reclaimed = 0;
+            while (list)
+            {
+                EpochBatch* next = list->next;
+                reclaimed += ReclaimBatch(list);
+                list = next;
+            }
+            if (reclaimed > 0)
+                retiredCount.Add(-static_cast<int64_t>(reclaimed));
+            return reclaimed;
+        }
+
+        void Synchronize()
+        {
+            EpochRecord* r = ThreadRecord();
+            DKASSERT_DESC_DEBUG(r->nesting == 0, "DKEpoch::Synchronize() cannot be called while pinned!");
+            if (r->nesting > 0)
+            {
+                DKLogE("DKEpoch::Synchronize() cannot be called while pinned!");
+                return;
+            }
+            if (r->batch)
+                FlushBatch(r);
+
+            const int64_t target = static_cast<int64_t>(globalEpoch) + 2;
+            while (globalEpoch < target)
+            {
+                if (!TryAdvance())
+                    DKThread::Yield();
+            }
+            Reclaim();
+        }
+
+        size_t PurgeAllocator()
+        {
+            // purged bytes of batch nodes (estimated)
+            size_t reclaimed = Reclaim();
+            return (reclaimed + EpochBatchSize - 1) / EpochBatchSize * sizeof(EpochBatch);
+        }
+
+        const uint64_t domainId;
+        DKAtomicNumber64 globalEpoch;
+        DKAtomicNumber64 retiredCount;
+        DKObject<DKThread> thread;
+
+    private:
+        bool IsBatchAged(EpochBatch* batch)
+        {
+            return batch->epoch + 2 <= static_cast<int64_t>(globalEpoch);
+        }
+
+        // returns number of pending batches.
+        size_t FlushBatch(EpochRecord* r)
+        {
+            EpochBatch* batch = r->batch;
+            r->batch = NULL;
+            batch->next = NULL;
+
+            // batch is tagged with lock, to keep pending list ordered by epoch.
+            pendingLock.Lock();
+            batch->epoch = globalEpoch;
+            if (pendingLast)
+                pendingLast->next = batch;
+            else
+                pendingFirst = batch;
+            pendingLast = batch;
+            size_t pending = ++numPendingBatches;
+            pendingLock.Unlock();
+            return pending;
+        }
+
+        size_t ReclaimBatch(EpochBatch* batch)
+        {
+            size_t count = batch->count;
+            for (size_t i = 0; i < count; ++i)
+            {
+                EpochRetired& item = batch->items[i];
+                item.deleter(item.p, item.context);
+            }
+            batch->~EpochBatch();
+            allocator->Dealloc(batch);
+            return count;
+        }
+
+        void ReclaimThreadProc(double interval)
+        {
+            reclaimCond.Lock();
+            while (!terminate)
+            {
+                reclaimCond.WaitTimeout(interval);
+                if (terminate)
+                    break;
+                reclaimCond.Unlock();
+                Reclaim();
+                reclaimCond.Lock();
+            }
+            reclaimCond.Unlock();
+        }
+
+        EpochRecord* records;
+        DKSpinLock registryLock;
+
+        EpochBatch* pendingFirst;
+        EpochBatch* pendingLast;
+        size_t numPendingBatches;
+        DKSpinLock pendingLock;
+
+        EpochAllocator* allocator;
+        DKCondition reclaimCond;
+        bool terminate;
+
+    public:
+        EpochDomain* prevDomain;
+        EpochDomain* nextDomain;
+    };
+
+    // Cache of last used domain record, and releases records of all domains
+    // when the thread exits.
+    struct EpochThreadLocal
+    {
+        uint64_t domainId = 0;
+        EpochRecord* record = NULL;
+
+        ~EpochThreadLocal()
+        {
+            DKThread::ThreadId tid = DKThread::CurrentThreadId();
+            epochDomainsLock.Lock();
+            for (EpochDomain* d = epochDomains; d; d = d->nextDomain)
+                d->ReleaseThread(tid);
+            epochDomainsLock.Unlock();
+        }
+    };
+    static thread_local EpochThreadLocal epochThreadLocal;
+
+    EpochRecord* EpochDomain::ThreadRecord()
+    {
+        EpochThreadLocal& tl = epochThreadLocal;
+        if (tl.domainId == domainId)
+            return tl.record;
+
+        DKThread::ThreadId tid = DKThread::CurrentThreadId();
+        EpochRecord* record = NULL;
+        EpochRecord* unused = NULL;
+
+        registryLock.Lock();
+        for (EpochRecord* r = records; r; r = r->next)
+        {
+            if (r->owner == tid)
+            {
+                record = r;
+                break;
+            }
+            if (unused == NULL && r->owner == DKThread::invalidId)
+                unused = r;
+        }
+        if (record == NULL)
+        {
+            record = unused;
+            if (record == NULL)
+            {
+                record = new EpochRecord();
+                record->state = 0;
+                record->nesting = 0;
+                record->batch = NULL;
+                record->next = records;
+                records = record;
+            }
+            record->owner = tid;
+        }
+        registryLock.Unlock();
+
+        tl.domainId = domainId;
+        tl.record = record;
+        return record;
+    }
+
+    void EpochDomain::ReleaseThread(DKThread::ThreadId tid)
+    {
+        registryLock.Lock();
+        for (EpochRecord* r = records; r; r = r->next)
+        {
+            if (r->owner == tid)
+            {
+                DKASSERT_DESC_DEBUG(r->nesting == 0, "Thread exited while DKEpoch is pinned!");
+                r->nesting = 0;
+                r->state = 0;
+                if (r->batch)
+                    FlushBatch(r);
+                r->owner = DKThread::invalidId;
+                break;
+            }
+        }
+        registryLock.Unlock();
+    }
+
+    size_t EpochAllocator::Purge()
+    {
+        return domain->PurgeAllocator();
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+#define EPOCH_DOMAIN    reinterpret_cast<EpochDomain*>(impl)
+
+DKEpoch::DKEpoch(double backgroundInterval)
+	: impl(new EpochDomain(backgroundInterval))
+{
+}
+
+DKEpoch::~DKEpoch()
+{
+	delete EPOCH_DOMAIN;
+}
+
+void DKEpoch::Pin() const
+{
+	EPOCH_DOMAIN->Pin();
+}
+
+void DKEpoch::Unpin() const
+{
+	EPOCH_DOMAIN->Unpin();
+}
+
+bool DKEpoch::IsPinned() const
+{
+	return EPOCH_DOMAIN->IsPinned();
+}
+
+void DKEpoch::Retire(void* p, Deleter deleter, void* context) const
+{
+	if (p)
+	{
+		DKASSERT_DEBUG(deleter != NULL);
+		EPOCH_DOMAIN->Retire(p, deleter, context);
+	}
+}
+
+void DKEpoch::Retire(void* p, DKAllocator& allocator) const
+{
+	Retire(p, [](void* ptr, void* alloc)
+	{
+		static_cast<DKAllocator*>(alloc)->Dealloc(ptr);
+	}, &allocator);
+}
+
+void DKEpoch::Synchronize() const
+{
+	EPOCH_DOMAIN->Synchronize();
+}
+
+size_t DKEpoch::Reclaim() const
+{
+	return EPOCH_DOMAIN->Reclaim();
+}
+
+uint64_t DKEpoch::CurrentEpoch() const
+{
+	return static_cast<uint64_t>(static_cast<int64_t>(EPOCH_DOMAIN->globalEpoch));
+}
+
+size_t DKEpoch::PendingCount() const
+{
+	return static_cast<size_t>(static_cast<int64_t>(EPOCH_DOMAIN->retiredCount));
+}
+
+DKEpoch& DKEpoch::DefaultDomain()
+{
+	static DKAllocator::Maintainer init;
+	static DKEpoch domain;
+	return domain;
+}
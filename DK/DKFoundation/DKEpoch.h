@@ -0,0 +1,113 @@
+//
+//  File: DKEpoch.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKAllocator.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Epoch based memory reclamation domain. (RCU style)
+
+	 Readers pin the domain while accessing shared lock-free data.
+	 Writers unlink objects from shared data, and retire them instead of
+	 freeing immediately. Retired objects are reclaimed after all readers
+	 which could have seen them are unpinned. (after two epochs)
+
+	 Pin/Unpin touches only the per-thread record of the domain.
+	 Retired objects are collected in per-thread batches, and reclaimed on
+	 background thread periodically, or by calling Reclaim() or Synchronize().
+	 Retired objects are also reclaimed when DKAllocatorChain::Cleanup()
+	 is called, the domain has an allocator in allocator chain.
+
+	 @code
+	  // reader
+	  {
+	      DKEpochSection section(DKEpoch::DefaultDomain());
+	      Node* node = head;  // load shared pointer
+	      ...                 // node is valid until the section ends.
+	  }
+	  // writer
+	  Node* old = ExchangeHead(newNode);
+	  DKEpoch::DefaultDomain().Retire(old);   // deleted later.
+	 @endcode
+
+	 @note
+	  Do not call Synchronize() while the current thread is pinned.
+	  A thread which is pinned for long time delays all reclamation of the domain.
+	 */
+	class DKGL_API DKEpoch
+	{
+	public:
+		typedef void (*Deleter)(void* p, void* context);
+
+		/// backgroundInterval: interval (in seconds) of background reclaimer thread,
+		/// zero or negative value to disable background thread.
+		DKEpoch(double backgroundInterval = 0.01);
+		~DKEpoch();
+
+		/// enter read-side section, can be nested.
+		void Pin() const;
+		/// leave read-side section.
+		void Unpin() const;
+		/// determine current thread is pinned.
+		bool IsPinned() const;
+
+		/// retire object, deleter will be called with context after grace period.
+		void Retire(void* p, Deleter deleter, void* context = NULL) const;
+		/// retire memory allocated by allocator. (deallocated with allocator)
+		void Retire(void* p, DKAllocator& allocator) const;
+		/// retire object allocated by new operator.
+		template <typename T> void Retire(T* obj) const
+		{
+			Retire(obj, [](void* p, void*) { delete static_cast<T*>(p); });
+		}
+		/// retire object allocated with allocator. (by operator new(size_t, DKAllocator&))
+		template <typename T> void Retire(T* obj, DKAllocator& allocator) const
+		{
+			Retire(obj, [](void* p, void* alloc)
+			{
+				static_cast<T*>(p)->~T();
+				static_cast<DKAllocator*>(alloc)->Dealloc(p);
+			}, &allocator);
+		}
+
+		/// wait for grace period and reclaim all objects retired before.
+		/// current thread must not be pinned.
+		void Synchronize() const;
+		/// reclaim objects which passed grace period, non-blocking.
+		/// returns number of reclaimed objects.
+		size_t Reclaim() const;
+
+		uint64_t CurrentEpoch() const;
+		/// number of retired objects not reclaimed yet.
+		size_t PendingCount() const;
+
+		/// global domain with background reclaimer.
+		static DKEpoch& DefaultDomain();
+
+	private:
+		DKEpoch(const DKEpoch&) = delete;
+		DKEpoch& operator = (const DKEpoch&) = delete;
+		void* impl;
+	};
+
+	/// context scope based read-side section of DKEpoch.
+	class DKEpochSection
+	{
+	public:
+		DKEpochSection(const DKEpoch& e) : epoch(e) { epoch.Pin(); }
+		~DKEpochSection() { epoch.Unpin(); }
+
+	private:
+		DKEpochSection(const DKEpochSection&) = delete;
+		DKEpochSection& operator = (const DKEpochSection&) = delete;
+		const DKEpoch& epoch;
+	};
+}
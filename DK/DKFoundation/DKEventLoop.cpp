@@ -13,6 +13,9 @@
 #include "DKFunction.h"
 #include "DKLog.h"
 #include "DKCondition.h"
+#include "DKProfiler.h"
+#include "DKMetrics.h"
+#include "DKLockProfiler.h"
 
 namespace DKFoundation::Private
 {
@@ -73,7 +76,32 @@ namespace DKFoundation::Private
         return found;
     }
 
+    // default number of operations can be dispatched per round.
+    static const size_t defaultLaneBudgets[DKEventLoop::NumPriorities] = { 64, 16, 4 };
+
     static DKCondition resultCond;
+
+    // metrics of all event loops.
+    struct EventLoopMetrics
+    {
+        DKMetrics::Counter* posted = DKMetrics::RegisterCounter("DKEventLoop.Posted");
+        DKMetrics::Counter* coalesced = DKMetrics::RegisterCounter("DKEventLoop.Coalesced");
+        DKMetrics::Counter* dispatched = DKMetrics::RegisterCounter("DKEventLoop.Dispatched");
+        DKMetrics::Counter* revoked = DKMetrics::RegisterCounter("DKEventLoop.Revoked");
+        DKMetrics::Gauge* pending = DKMetrics::RegisterGauge("DKEventLoop.Pending");
+        DKMetrics::Histogram* dispatchTime = DKMetrics::RegisterHistogram("DKEventLoop.DispatchTime");
+
+        static EventLoopMetrics& Get()
+        {
+            static EventLoopMetrics metrics;
+            return metrics;
+        }
+        void Post(size_t n = 1)
+        {
+            posted->Increment(n);
+            pending->Add(static_cast<int64_t>(n));
+        }
+    };
     struct EventLoopPendingState : public DKEventLoop::PendingState
     {
         enum State
@@ -84,6 +112,7 @@ namespace DKFoundation::Private
             StateRevoked,
         };
         mutable State state;
+        mutable DKArray<DKObject<DKOperation>> handlers; // guarded by resultCond
 
         EventLoopPendingState() : state(StatePending)
         {
@@ -100,20 +129,51 @@ namespace DKFoundation::Private
         }
         void LeaveOperation() const
         {
-            DKCriticalSection<DKCondition> guard(resultCond);
+            resultCond.Lock();
             DKASSERT(state == StateProcessing);
             state = StateProcessed;
             resultCond.Broadcast();
+            DKArray<DKObject<DKOperation>> ops = std::move(handlers);
+            resultCond.Unlock();
+
+            for (DKObject<DKOperation>& op : ops)
+                op->Perform();
         }
         bool Revoke() const override
         {
-            DKCriticalSection<DKCondition> guard(resultCond);
+            resultCond.Lock();
             if (state == StatePending)
             {
                 state = StateRevoked;
                 resultCond.Broadcast();
+                DKArray<DKObject<DKOperation>> ops = std::move(handlers);
+                resultCond.Unlock();
+                EventLoopMetrics::Get().revoked->Increment();
+
+                for (DKObject<DKOperation>& op : ops)
+                    op->Perform();
+                return true;
+            }
+            bool revoked = state == StateRevoked;
+            resultCond.Unlock();
+            return revoked;
+        }
+        void AddCompletionHandler(const DKOperation* handler) const override
+        {
+            if (handler == NULL)
+                return;
+
+            resultCond.Lock();
+            if (state == StateProcessed || state == StateRevoked)
+            {
+                resultCond.Unlock();
+                handler->Perform();
+            }
+            else
+            {
+                handlers.Add(const_cast<DKOperation*>(handler));
+                resultCond.Unlock();
             }
-            return state == StateRevoked;
         }
         bool Result() const override
         {
@@ -159,6 +219,12 @@ DKEventLoop::DKEventLoop()
 , commandQueueTick(&DKEventLoop::InternalCommandCompareOrder)
 , commandQueueTime(&DKEventLoop::InternalCommandCompareOrder)
 {
+	for (int i = 0; i < NumPriorities; ++i)
+	{
+		laneBudgets[i] = defaultLaneBudgets[i];
+		laneDispatched[i] = 0;
+	}
+	DKLockProfiler::SetName(&commandQueueCond, "DKEventLoop::commandQueueCond");
 }
 
 DKEventLoop::~DKEventLoop()
@@ -169,6 +235,7 @@ DKEventLoop::~DKEventLoop()
 	}
 
 	RevokeAll();
+	DKLockProfiler::Unregister(&commandQueueCond);
 }
 
 bool DKEventLoop::Run()
@@ -202,6 +269,7 @@ bool DKEventLoop::IsRunning() const
 
 void DKEventLoop::InternalPostCommand(const InternalCommandTick& cmd)
 {
+	EventLoopMetrics::Get().Post();
 	DKCriticalSection<DKCondition> guard(commandQueueCond);
 	commandQueueTick.Insert(cmd);
 	commandQueueCond.Signal();
@@ -209,6 +277,7 @@ void DKEventLoop::InternalPostCommand(const InternalCommandTick& cmd)
 
 void DKEventLoop::InternalPostCommand(const InternalCommandTime& cmd)
 {
+	EventLoopMetrics::Get().Post();
 	DKCriticalSection<DKCondition> guard(commandQueueCond);
 	commandQueueTime.Insert(cmd);
 	commandQueueCond.Signal();
@@ -295,6 +364,122 @@ DKObject<DKEventLoop::PendingState> DKEventLoop::Post(const DKOperation* operati
 	return NULL;
 }
 
+DKObject<DKEventLoop::PendingState> DKEventLoop::Post(const DKOperation* operation, Priority priority)
+{
+	DKASSERT_DEBUG(priority >= 0 && priority < NumPriorities);
+
+	if (operation)
+	{
+		InternalCommandLane cmd;
+		cmd.operation = const_cast<DKOperation*>(operation);
+		cmd.state = DKOBJECT_NEW EventLoopPendingState();
+		cmd.key = 0;
+
+		DKObject<PendingState> state = cmd.state;
+
+		EventLoopMetrics::Get().Post();
+		DKCriticalSection<DKCondition> guard(commandQueueCond);
+		commandQueueLanes[priority].PushBack(std::move(cmd));
+		commandQueueCond.Signal();
+		return state;
+	}
+	return Post(NULL);
+}
+
+DKObject<DKEventLoop::PendingState> DKEventLoop::PostCoalesced(uint64_t key, const DKOperation* operation, Priority priority)
+{
+	DKASSERT_DEBUG(priority >= 0 && priority < NumPriorities);
+
+	if (key == 0)
+		return Post(operation, priority);
+
+	if (operation)
+	{
+		DKCriticalSection<DKCondition> guard(commandQueueCond);
+		if (auto p = coalescedCommands.Find(key); p)
+		{
+			// replace operation of pending command, the command stays in
+			// the lane which it was posted first.
+			p->value.operation = const_cast<DKOperation*>(operation);
+			EventLoopMetrics::Get().coalesced->Increment();
+			return p->value.state;
+		}
+
+		InternalCommand cmd;
+		cmd.operation = const_cast<DKOperation*>(operation);
+		cmd.state = DKOBJECT_NEW EventLoopPendingState();
+		coalescedCommands.Insert(key, cmd);
+		EventLoopMetrics::Get().Post();
+
+		// lane command has key only, operation will be taken from the map.
+		InternalCommandLane laneCmd;
+		laneCmd.key = key;
+		commandQueueLanes[priority].PushBack(std::move(laneCmd));
+		commandQueueCond.Signal();
+		return cmd.state;
+	}
+	return Post(NULL);
+}
+
+size_t DKEventLoop::PostBatch(const DKOperation* const* operations, size_t count, Priority priority)
+{
+	DKASSERT_DEBUG(priority >= 0 && priority < NumPriorities);
+
+	size_t numPosted = 0;
+	if (operations && count > 0)
+	{
+		DKCriticalSection<DKCondition> guard(commandQueueCond);
+		DKQueue<InternalCommandLane>& lane = commandQueueLanes[priority];
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (operations[i])
+			{
+				InternalCommandLane cmd;
+				cmd.operation = const_cast<DKOperation*>(operations[i]);
+				cmd.key = 0;
+				lane.PushBack(std::move(cmd));
+				numPosted++;
+			}
+		}
+		if (numPosted > 0)
+		{
+			EventLoopMetrics::Get().Post(numPosted);
+			commandQueueCond.Signal();
+		}
+	}
+	return numPosted;
+}
+
+size_t DKEventLoop::PostBatch(std::initializer_list<const DKOperation*> operations, Priority priority)
+{
+	return PostBatch(operations.begin(), operations.size(), priority);
+}
+
+size_t DKEventLoop::PostBatch(const DKArray<DKObject<DKOperation>>& operations, Priority priority)
+{
+	DKArray<const DKOperation*> ops;
+	ops.Reserve(operations.Count());
+	for (const DKObject<DKOperation>& op : operations)
+		ops.Add(op);
+	return PostBatch((const DKOperation* const*)ops, ops.Count(), priority);
+}
+
+void DKEventLoop::SetPriorityBudget(Priority priority, size_t budget)
+{
+	DKASSERT_DEBUG(priority >= 0 && priority < NumPriorities);
+
+	DKCriticalSection<DKCondition> guard(commandQueueCond);
+	laneBudgets[priority] = Max(budget, size_t(1));
+}
+
+size_t DKEventLoop::PriorityBudget(Priority priority) const
+{
+	DKASSERT_DEBUG(priority >= 0 && priority < NumPriorities);
+
+	DKCriticalSection<DKCondition> guard(commandQueueCond);
+	return laneBudgets[priority];
+}
+
 bool DKEventLoop::Process(const DKOperation* op)
 {
 	if (op)
@@ -315,26 +500,57 @@ bool DKEventLoop::Process(const DKOperation* op)
 
 size_t DKEventLoop::RevokeAll()
 {
-	DKCriticalSection<DKCondition> guard(this->commandQueueCond);
+	// Revoke states after unlocking the queue, because completion handlers
+	// of revoked states can post new operations to this event-loop.
+	DKArray<DKObject<PendingState>> states;
 
-	//DKTimer::Tick tick = DKTimer::SystemTick();
+	size_t numItems = 0;
+	if (true)
+	{
+		DKCriticalSection<DKCondition> guard(this->commandQueueCond);
+		numItems = this->commandQueueTick.Count() + this->commandQueueTime.Count();
+		for (const DKQueue<InternalCommandLane>& lane : this->commandQueueLanes)
+			numItems += lane.Count();
+		states.Reserve(numItems);
+
+		for (const InternalCommand& ic : this->commandQueueTick)
+			states.Add(ic.state);
+		for (const InternalCommand& ic : this->commandQueueTime)
+			states.Add(ic.state);
+		for (DKQueue<InternalCommandLane>& lane : this->commandQueueLanes)
+		{
+			InternalCommandLane ic;
+			while (lane.PopFront(ic))
+			{
+				if (ic.key)
+				{
+					if (auto p = this->coalescedCommands.Find(ic.key); p)
+						states.Add(p->value.state);
+				}
+				else
+				{
+					states.Add(ic.state);
+				}
+			}
+		}
+
+		this->commandQueueTick.Clear();
+		this->commandQueueTime.Clear();
+		this->coalescedCommands.Clear();
+	}
 
-	size_t numItems = this->commandQueueTick.Count() + this->commandQueueTime.Count();
+	EventLoopMetrics::Get().pending->Add(-static_cast<int64_t>(numItems));
 
-	auto revoke = [](const InternalCommand& ic)
+	// operations with state are counted by Revoke().
+	size_t numStateless = 0;
+	for (DKObject<PendingState>& state : states)
 	{
-		const EventLoopPendingState* state = ic.state.StaticCast<EventLoopPendingState>();
 		if (state)
-			state->Revoke();
-	};
-
-	for (const InternalCommand& ic : this->commandQueueTick)
-		revoke(ic);
-	for (const InternalCommand& ic : this->commandQueueTime)
-		revoke(ic);
-
-	this->commandQueueTick.Clear();
-	this->commandQueueTime.Clear();
+			state.StaticCast<EventLoopPendingState>()->Revoke();
+		else
+			numStateless++;
+	}
+	EventLoopMetrics::Get().revoked->Increment(numStateless);
 	return numItems;
 }
 
@@ -348,6 +564,15 @@ bool DKEventLoop::GetNextLoopIntervalNL(double* d) const
 	double tickDelay = 0;
 	double timeDelay = 0;
 
+	for (const DKQueue<InternalCommandLane>& lane : commandQueueLanes)
+	{
+		if (lane.Count() > 0)
+		{
+			*d = 0.0;
+			return true;
+		}
+	}
+
 	numTickCmd = commandQueueTick.Count();
 	numTimeCmd = commandQueueTime.Count();
 
@@ -447,32 +672,74 @@ bool DKEventLoop::Dispatch()
 	DKObject<DKOperation> operation = NULL;
 	DKObject<PendingState> state = NULL;
 
-	commandQueueCond.Lock();
-
-	DKDateTime currentTime = DKDateTime::Now();
-	DKTimer::Tick currentTick = DKTimer::SystemTick();
-
-	if (operation == NULL && this->commandQueueTick.Count() > 0)
-	{
-		const InternalCommandTick& cmd = this->commandQueueTick.Value(0);
-		if (cmd.fire <= currentTick)
-		{
-			operation = cmd.operation;
-			state = cmd.state;
-			this->commandQueueTick.Remove(0);
-		}
-	}
-	if (operation == NULL && this->commandQueueTime.Count() > 0)
+	if (true)
 	{
-		const InternalCommandTime& cmd = this->commandQueueTime.Value(0);
-		if (cmd.fire <= currentTime)
+		DKCriticalSection<DKCondition> guard(commandQueueCond);
+		DKDateTime currentTime = DKDateTime::Now();
+		DKTimer::Tick currentTick = DKTimer::SystemTick();
+
+		// Each lane dispatches operations up to its budget, higher priority first.
+		// A new round begins when no lane can dispatch within its budget.
+		for (int round = 0; round < 2 && operation == NULL; ++round)
 		{
-			operation = cmd.operation;
-			state = cmd.state;
-			this->commandQueueTime.Remove(0);
+			for (int lane = 0; lane < NumPriorities && operation == NULL; ++lane)
+			{
+				if (this->laneDispatched[lane] >= this->laneBudgets[lane])
+					continue;
+
+				if (lane == PriorityNormal)
+				{
+					if (operation == NULL && this->commandQueueTick.Count() > 0)
+					{
+						const InternalCommandTick& cmd = this->commandQueueTick.Value(0);
+						if (cmd.fire <= currentTick)
+						{
+							operation = cmd.operation;
+							state = cmd.state;
+							this->commandQueueTick.Remove(0);
+						}
+					}
+					if (operation == NULL && this->commandQueueTime.Count() > 0)
+					{
+						const InternalCommandTime& cmd = this->commandQueueTime.Value(0);
+						if (cmd.fire <= currentTime)
+						{
+							operation = cmd.operation;
+							state = cmd.state;
+							this->commandQueueTime.Remove(0);
+						}
+					}
+				}
+				if (operation == NULL)
+				{
+					InternalCommandLane cmd;
+					if (this->commandQueueLanes[lane].PopFront(cmd))
+					{
+						if (cmd.key)
+						{
+							auto p = this->coalescedCommands.Find(cmd.key);
+							DKASSERT_DEBUG(p);
+							operation = p->value.operation;
+							state = p->value.state;
+							this->coalescedCommands.Remove(cmd.key);
+						}
+						else
+						{
+							operation = cmd.operation;
+							state = cmd.state;
+						}
+					}
+				}
+				if (operation)
+					this->laneDispatched[lane]++;
+			}
+			if (operation == NULL)
+			{
+				for (size_t& n : this->laneDispatched)
+					n = 0;
+			}
 		}
 	}
-	commandQueueCond.Unlock();
 
 	if (operation)
 	{
@@ -487,19 +754,19 @@ bool DKEventLoop::Dispatch()
 				el->PerformOperation(op);
 			}
 		};
+		DKPROFILE_SCOPE("DKEventLoop::Dispatch");
+		EventLoopMetrics& metrics = EventLoopMetrics::Get();
+		metrics.pending->Decrement();
 		OpWrapper op(this, operation);
 		EventLoopPendingState* stateCallback = state.StaticCast<EventLoopPendingState>();
-		if (stateCallback)
-		{
-			if (stateCallback->EnterOperation())
-			{
-				Private::PerformOperationInsidePool(&op);
-				stateCallback->LeaveOperation();
-			}
-		}
-		else
+		// revoked operation is counted by Revoke(), not dispatched.
+		if (stateCallback == NULL || stateCallback->EnterOperation())
 		{
+			metrics.dispatched->Increment();
+			DKMetrics::Histogram::ScopedTimer timer(metrics.dispatchTime);
 			Private::PerformOperationInsidePool(&op);
+			if (stateCallback)
+				stateCallback->LeaveOperation();
 		}
 
 		return true;
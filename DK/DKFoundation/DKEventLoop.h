@@ -13,6 +13,8 @@
 #include "DKDateTime.h"
 #include "DKSpinLock.h"
 #include "DKOrderedArray.h"
+#include "DKQueue.h"
+#include "DKMap.h"
 #include "DKTimer.h"
 #include "DKCondition.h"
 
@@ -39,6 +41,14 @@ namespace DKFoundation
 	   time-based: system time based, calling operation at specified system time.
 				   if system time has changed, calling operations will adjusted.
 
+	 Immediate operations can be posted to priority lanes. Dispatch takes
+	 operations from higher priority lane first, but each lane can dispatch
+	 operations up to its budget per round, lower lanes are not starved.
+	 Delayed (tick-based, time-based) operations belong to PriorityNormal lane.
+	 PostBatch() enqueues many operations with single lock and single signal.
+	 PostCoalesced() collapses repeated operations with same key (ex: redraw)
+	 into one, only the last operation posted will be performed.
+
 	 @note
 	  To make Event-Loop working on a new thread, create a DKThread object and call
 	  'DKEventLoop::Run()' inside new working thread.
@@ -72,6 +82,20 @@ namespace DKFoundation
 			virtual bool IsDone() const = 0;
 			virtual bool IsRevoked() const = 0;
 			virtual bool IsPending() const = 0;
+			/// Register a handler to be performed when the operation has been
+			/// processed or revoked. The handler is performed on the thread
+			/// which finishes the operation, or performed immediately if the
+			/// operation has been finished already.
+			virtual void AddCompletionHandler(const DKOperation* handler) const = 0;
+		};
+
+		/// priority lanes of immediate operations.
+		enum Priority
+		{
+			PriorityHigh = 0,
+			PriorityNormal,
+			PriorityLow,
+			NumPriorities,
 		};
 
 		DKEventLoop();
@@ -115,6 +139,26 @@ namespace DKFoundation
 		/// @param runAfter specific date/time to execute operation
 		virtual DKObject<PendingState> Post(const DKOperation* operation, const DKDateTime& runAfter);
 
+		/// Enqueue operation to priority lane and return immediately.
+		/// The operation will be performed as fast as possible.
+		DKObject<PendingState> Post(const DKOperation* operation, Priority priority);
+		/// Enqueue operation with coalescing key.
+		/// If an operation with same key is pending, the pending operation is
+		/// replaced with given operation, and returns state of pending one.
+		/// (key 0 is not coalesced)
+		DKObject<PendingState> PostCoalesced(uint64_t key, const DKOperation* operation, Priority priority = PriorityNormal);
+		/// Enqueue operations with single lock and single signal.
+		/// Operations posted with batch have no pending state.
+		/// @return number of operations posted.
+		size_t PostBatch(const DKOperation* const* operations, size_t count, Priority priority = PriorityNormal);
+		size_t PostBatch(std::initializer_list<const DKOperation*> operations, Priority priority = PriorityNormal);
+		size_t PostBatch(const DKArray<DKObject<DKOperation>>& operations, Priority priority = PriorityNormal);
+
+		/// Set number of operations can be dispatched from the lane per round.
+		/// (minimum value is 1)
+		void SetPriorityBudget(Priority priority, size_t budget);
+		size_t PriorityBudget(Priority priority) const;
+
 		/// Enqueue operation and wait until done.
 		/// if the function called on working-thread, the operation will be executed immediately.
 		/// @param operation an operation object.
@@ -166,9 +210,15 @@ namespace DKFoundation
 		void InternalPostCommand(const InternalCommandTick& cmd);
 		void InternalPostCommand(const InternalCommandTime& cmd);
 
+		struct InternalCommandLane : public InternalCommand { uint64_t key; };
+
 		DKCondition								commandQueueCond;
 		DKOrderedArray<InternalCommandTick>		commandQueueTick;
 		DKOrderedArray<InternalCommandTime>		commandQueueTime;
+		DKQueue<InternalCommandLane>			commandQueueLanes[NumPriorities];
+		DKMap<uint64_t, InternalCommand>		coalescedCommands;
+		size_t									laneBudgets[NumPriorities];
+		size_t									laneDispatched[NumPriorities];
 
 		DKThread::ThreadId	threadId;
 		bool				running;
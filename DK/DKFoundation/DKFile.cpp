@@ -17,6 +17,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h>
 #endif
 
 #include "DKFile.h"
@@ -30,6 +32,190 @@ namespace DKFoundation::Private
 #ifdef _WIN32
     DKString GetWin32ErrorString(DWORD dwError);
 #endif
+
+    constexpr size_t FileIOPlatformMaxSize = 0x7fffffff;
+
+    // positional transfer, does not use file position. (except Win32)
+    // returns bytes transferred or -1 if failed before any transfer.
+    static size_t FileTransferAt(intptr_t file, bool write, uint64_t pos, void* p, size_t s)
+    {
+        uint8_t* cp = reinterpret_cast<uint8_t*>(p);
+        size_t total = 0;
+        while (total < s)
+        {
+            size_t toTransfer = Min(s - total, FileIOPlatformMaxSize);
+            uint64_t offset = pos + total;
+#ifdef _WIN32
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)(offset & 0xffffffff);
+            ov.OffsetHigh = (DWORD)(offset >> 32);
+            DWORD num = 0;
+            BOOL result = write ?
+                ::WriteFile((HANDLE)file, cp + total, (DWORD)toTransfer, &num, &ov) :
+                ::ReadFile((HANDLE)file, cp + total, (DWORD)toTransfer, &num, &ov);
+            if (result == 0)
+            {
+                if (::GetLastError() == ERROR_HANDLE_EOF)
+                    break;
+                return total > 0 ? total : (size_t)-1;
+            }
+#else
+            ssize_t num = write ?
+                ::pwrite((int)file, cp + total, toTransfer, (off_t)offset) :
+                ::pread((int)file, cp + total, toTransfer, (off_t)offset);
+            if (num < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return total > 0 ? total : (size_t)-1;
+            }
+#endif
+            if (num == 0)
+                break;
+            total += num;
+        }
+        return total;
+    }
+
+    // sequential transfer, uses file position.
+    // returns bytes transferred or -1 if failed before any transfer.
+    static size_t FileTransfer(intptr_t file, bool write, void* p, size_t s)
+    {
+        uint8_t* cp = reinterpret_cast<uint8_t*>(p);
+        size_t total = 0;
+        while (total < s)
+        {
+            size_t toTransfer = Min(s - total, FileIOPlatformMaxSize);
+#ifdef _WIN32
+            DWORD num = 0;
+            BOOL result = write ?
+                ::WriteFile((HANDLE)file, cp + total, (DWORD)toTransfer, &num, 0) :
+                ::ReadFile((HANDLE)file, cp + total, (DWORD)toTransfer, &num, 0);
+            if (result == 0)
+                return total > 0 ? total : (size_t)-1;
+#else
+            ssize_t num = write ?
+                ::write((int)file, cp + total, toTransfer) :
+                ::read((int)file, cp + total, toTransfer);
+            if (num < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return total > 0 ? total : (size_t)-1;
+            }
+#endif
+            if (num == 0)
+                break;
+            total += num;
+        }
+        return total;
+    }
+
+    // vectored transfer, at position if pos is not PositionError.
+    // stops at first short transfer.
+    static size_t FileTransferV(intptr_t file, bool write, uint64_t pos, const DKStream::IOVector* v, size_t count)
+    {
+        const bool positional = pos != DKStream::PositionError;
+        size_t total = 0;
+#ifdef _WIN32
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (v[i].length == 0)
+                continue;
+            size_t num = positional ?
+                FileTransferAt(file, write, pos + total, v[i].data, v[i].length) :
+                FileTransfer(file, write, v[i].data, v[i].length);
+            if (num == (size_t)-1)
+                return total > 0 ? total : num;
+            total += num;
+            if (num < v[i].length)
+                break;
+        }
+#else
+        constexpr size_t maxVectors = 64;
+        struct iovec iov[maxVectors];
+
+        size_t index = 0;
+        while (index < count)
+        {
+            // collect vectors, up to platform limits.
+            size_t numVectors = 0;
+            size_t requested = 0;
+            while (index < count && numVectors < maxVectors && numVectors < IOV_MAX)
+            {
+                if (v[index].length > FileIOPlatformMaxSize - requested)
+                    break;
+                if (v[index].length > 0)
+                {
+                    iov[numVectors].iov_base = v[index].data;
+                    iov[numVectors].iov_len = v[index].length;
+                    requested += v[index].length;
+                    numVectors++;
+                }
+                index++;
+            }
+            if (numVectors == 0)
+            {
+                if (index < count && v[index].length > 0)
+                {
+                    // single vector larger than platform limit.
+                    size_t num = positional ?
+                        FileTransferAt(file, write, pos + total, v[index].data, v[index].length) :
+                        FileTransfer(file, write, v[index].data, v[index].length);
+                    if (num == (size_t)-1)
+                        return total > 0 ? total : num;
+                    total += num;
+                    if (num < v[index].length)
+                        break;
+                    index++;
+                }
+                continue;
+            }
+
+            ssize_t num;
+            do
+            {
+                if (positional)
+                {
+#if defined(__linux__) || defined(__FreeBSD__)
+                    num = write ?
+                        ::pwritev((int)file, iov, (int)numVectors, (off_t)(pos + total)) :
+                        ::preadv((int)file, iov, (int)numVectors, (off_t)(pos + total));
+#else
+                    // preadv/pwritev not available, transfer each vector.
+                    num = 0;
+                    for (size_t i = 0; i < numVectors; ++i)
+                    {
+                        size_t n = FileTransferAt(file, write, pos + total + num, iov[i].iov_base, iov[i].iov_len);
+                        if (n == (size_t)-1)
+                        {
+                            if (num == 0)
+                                num = -1;
+                            break;
+                        }
+                        num += n;
+                        if (n < iov[i].iov_len)
+                            break;
+                    }
+#endif
+                }
+                else
+                {
+                    num = write ?
+                        ::writev((int)file, iov, (int)numVectors) :
+                        ::readv((int)file, iov, (int)numVectors);
+                }
+            } while (num < 0 && errno == EINTR);
+
+            if (num < 0)
+                return total > 0 ? total : (size_t)-1;
+            total += num;
+            if ((size_t)num < requested)
+                break;
+        }
+#endif
+        return total;
+    }
 }
 
 #define DKFILE_INVALID_FILE_HANDLE		(-1)
@@ -560,6 +746,60 @@ size_t DKFile::Write(DKStream* s)
 	return 0;
 }
 
+size_t DKFile::ReadAt(Position pos, void* p, size_t s)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE)
+		return (size_t)-1;
+	if (p == NULL || s == 0)
+		return 0;
+	return FileTransferAt(this->file, false, pos, p, s);
+}
+
+size_t DKFile::WriteAt(Position pos, const void* p, size_t s)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE)
+		return (size_t)-1;
+	if (p == NULL || s == 0)
+		return 0;
+	return FileTransferAt(this->file, true, pos, const_cast<void*>(p), s);
+}
+
+size_t DKFile::ReadV(const IOVector* v, size_t count)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE)
+		return (size_t)-1;
+	if (v == NULL || count == 0)
+		return 0;
+	return FileTransferV(this->file, false, PositionError, v, count);
+}
+
+size_t DKFile::WriteV(const IOVector* v, size_t count)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE)
+		return (size_t)-1;
+	if (v == NULL || count == 0)
+		return 0;
+	return FileTransferV(this->file, true, PositionError, v, count);
+}
+
+size_t DKFile::ReadVAt(Position pos, const IOVector* v, size_t count)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE || pos == PositionError)
+		return (size_t)-1;
+	if (v == NULL || count == 0)
+		return 0;
+	return FileTransferV(this->file, false, pos, v, count);
+}
+
+size_t DKFile::WriteVAt(Position pos, const IOVector* v, size_t count)
+{
+	if (this->file == DKFILE_INVALID_FILE_HANDLE || pos == PositionError)
+		return (size_t)-1;
+	if (v == NULL || count == 0)
+		return 0;
+	return FileTransferV(this->file, true, pos, v, count);
+}
+
 bool DKFile::GetInfo(const DKString& file, FileInfo& info)
 {
 	if (file.Length() == 0)
@@ -71,6 +71,16 @@ namespace DKFoundation
 		size_t Write(const DKData *p);
 		size_t Write(DKStream* s);
 
+		/// positional and vectored I/O. (pread, pwrite, preadv, pwritev)
+		/// positional functions do not change current position, except Win32
+		/// which moves file pointer after synchronous I/O with offset.
+		size_t ReadAt(Position pos, void* p, size_t s) override;
+		size_t WriteAt(Position pos, const void* p, size_t s) override;
+		size_t ReadV(const IOVector* v, size_t count) override;
+		size_t WriteV(const IOVector* v, size_t count) override;
+		size_t ReadVAt(Position pos, const IOVector* v, size_t count) override;
+		size_t WriteVAt(Position pos, const IOVector* v, size_t count) override;
+
 		bool GetInfo(FileInfo& info) const; ///< get file info (for this object)
 		FileInfo GetInfo() const;
 
@@ -93,5 +103,6 @@ namespace DKFoundation
 
 		DKFile(const DKFile&) = delete;
 		DKFile& operator = (const DKFile&) = delete;
+		friend class DKAsyncFile;
 	};
 }
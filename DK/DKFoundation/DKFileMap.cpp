@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <sys/file.h>
 #endif
 
 #include "DKFile.h"
@@ -24,12 +25,84 @@
 #include "DKFileMap.h"
 #include "DKUtils.h"
 #include "DKUuid.h"
+#include "DKArray.h"
+#include "DKMutex.h"
 
 namespace DKFoundation::Private
 {
 #ifdef _WIN32
     DKString GetWin32ErrorString(DWORD dwError);
 #endif
+    // mapped range of file, unmapped when released.
+    struct FileMapWindow
+    {
+        void* baseAddress;
+        uint64_t offset;
+        size_t length;
+
+        ~FileMapWindow()
+        {
+#ifdef _WIN32
+            if (::UnmapViewOfFile(baseAddress) == FALSE)
+            {
+                DKLog("UnmapViewOfFile failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+            }
+#else
+            if (::munmap(baseAddress, length) != 0)
+            {
+                DKLog("munmap failed:%s\n", strerror(errno));
+            }
+#endif
+        }
+    };
+    // window object shares mapped range.
+    struct FileMapWindowData : public DKData
+    {
+        DKObject<FileMapWindow> window;
+        uint8_t* ptr;
+        size_t length;
+        bool writable;
+        DKSharedLock lock;
+
+        size_t Length() const override { return length; }
+        bool IsReadable() const override { return true; }
+        bool IsWritable() const override { return writable; }
+        bool IsExcutable() const override { return false; }
+        bool IsTransient() const override { return false; }
+
+        const void* LockShared() const override { lock.LockShared(); return ptr; }
+        bool TryLockShared(const void** p) const override
+        {
+            if (lock.TryLockShared())
+            {
+                if (p)
+                    *p = ptr;
+                return true;
+            }
+            return false;
+        }
+        void UnlockShared() const override { lock.UnlockShared(); }
+
+        void* LockExclusive() override
+        {
+            if (!writable)
+                return NULL;
+            lock.Lock();
+            return ptr;
+        }
+        bool TryLockExclusive(void** p) override
+        {
+            if (writable && lock.TryLock())
+            {
+                if (p)
+                    *p = ptr;
+                return true;
+            }
+            return false;
+        }
+        void UnlockExclusive() override { lock.Unlock(); }
+    };
+
     struct FileMapContext
     {
 #ifdef _WIN32
@@ -43,21 +116,116 @@ namespace DKFoundation::Private
 #endif
         void* baseAddress;
         size_t length;
+
+        uint32_t options = DKFileMap::MapOptionDefault;
+        DKFileMap::AccessHint accessHint = DKFileMap::AccessNormal;
+
+        // cached windows, most recently used one is at the end.
+        DKMutex windowLock;
+        DKArray<DKObject<FileMapWindow>> windows;
+        size_t windowCacheLimit = 16;
+
+        void PurgeWindows(size_t maxUnused)
+        {
+            // remove least recently used windows which are not in use.
+            size_t numUnused = 0;
+            for (const DKObject<FileMapWindow>& w : windows)
+            {
+                if (!w.IsShared())
+                    numUnused++;
+            }
+            for (size_t i = 0; i < windows.Count() && numUnused > maxUnused; )
+            {
+                if (windows.Value(i).IsShared())
+                {
+                    ++i;
+                }
+                else
+                {
+                    windows.Remove(i);
+                    numUnused--;
+                }
+            }
+        }
     };
+
+    static size_t FileMapGranularity()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO sysInfo;
+        ::GetSystemInfo(&sysInfo);
+        return sysInfo.dwAllocationGranularity;
+#else
+        return (size_t)::sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+#ifndef _WIN32
+    static int FileMapPosixAdvice(DKFileMap::AccessHint hint)
+    {
+        switch (hint)
+        {
+        case DKFileMap::AccessSequential:   return POSIX_MADV_SEQUENTIAL;
+        case DKFileMap::AccessRandom:       return POSIX_MADV_RANDOM;
+        case DKFileMap::AccessWillNeed:     return POSIX_MADV_WILLNEED;
+        case DKFileMap::AccessDontNeed:     return POSIX_MADV_DONTNEED;
+        default:                            break;
+        }
+        return POSIX_MADV_NORMAL;
+    }
+
+    // madvise for range of mapped region, range is aligned to pages.
+    static bool FileMapAdviseRange(void* base, size_t offset, size_t length, int advice)
+    {
+        size_t pageSize = FileMapGranularity();
+        size_t begin = offset - (offset % pageSize);
+        int err = ::posix_madvise(reinterpret_cast<uint8_t*>(base) + begin, length + (offset - begin), advice);
+        if (err != 0)
+        {
+            DKLog("posix_madvise failed:%s\n", strerror(err));
+            return false;
+        }
+        return true;
+    }
+
+    static void FileMapAdviseFile(int fd, uint64_t offset, size_t length, DKFileMap::AccessHint hint)
+    {
+#if defined(__linux__)
+        int advice = POSIX_FADV_NORMAL;
+        switch (hint)
+        {
+        case DKFileMap::AccessSequential:   advice = POSIX_FADV_SEQUENTIAL; break;
+        case DKFileMap::AccessRandom:       advice = POSIX_FADV_RANDOM;     break;
+        case DKFileMap::AccessWillNeed:     advice = POSIX_FADV_WILLNEED;   break;
+        case DKFileMap::AccessDontNeed:     advice = POSIX_FADV_DONTNEED;   break;
+        default:                            break;
+        }
+        ::posix_fadvise(fd, (off_t)offset, (off_t)length, advice);
+#elif defined(__APPLE__) && defined(__MACH__)
+        if (hint == DKFileMap::AccessWillNeed)
+        {
+            struct radvisory ra;
+            ra.ra_offset = (off_t)offset;
+            ra.ra_count = (int)Min<size_t>(length, 0x7fffffff);
+            ::fcntl(fd, F_RDADVISE, &ra);
+        }
+#endif
+    }
+#endif
 }
 
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
 DKFileMap::DKFileMap()
-	: mapContext(NULL)
-	, mappedPtr(NULL)
+	: mappedPtr(NULL)
+	, mapContext(NULL)
 {
 }
 
 DKFileMap::~DKFileMap()
 {
-	DKASSERT_DEBUG(mappedPtr == NULL);
+	DKASSERT_DEBUG(mappedPtr == NULL || IsPersistent());
 
 	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
 	if (ctxt)
@@ -105,7 +273,7 @@ DKFileMap::~DKFileMap()
 const void* DKFileMap::LockShared() const
 {
 	lock.LockShared();
-	DKCriticalSection<DKSpinLock> guard(spinLock);
+	DKCriticalSection<DKMutex> guard(mapLock);
 	if (mappedPtr == NULL)
 		mappedPtr = MapContent();
 	return mappedPtr;
@@ -115,7 +283,7 @@ bool DKFileMap::TryLockShared(const void** ptr) const
 {
 	if (lock.TryLockShared())
 	{
-		DKCriticalSection<DKSpinLock> guard(spinLock);
+		DKCriticalSection<DKMutex> guard(mapLock);
 		if (mappedPtr == NULL)
 			mappedPtr = MapContent();
 
@@ -130,9 +298,9 @@ void DKFileMap::UnlockShared() const
 {
 	lock.UnlockShared();
 
-	if (lock.TryLock())
+	if (!IsPersistent() && lock.TryLock())
 	{
-		DKCriticalSection<DKSpinLock> guard(spinLock);
+		DKCriticalSection<DKMutex> guard(mapLock);
 		if (mappedPtr)
 			UnmapContent();
 		mappedPtr = NULL;
@@ -143,7 +311,7 @@ void DKFileMap::UnlockShared() const
 void* DKFileMap::LockExclusive()
 {
 	lock.Lock();
-	DKCriticalSection<DKSpinLock> guard(spinLock);
+	DKCriticalSection<DKMutex> guard(mapLock);
 	if (mappedPtr == NULL)
 		mappedPtr = MapContent();
 	return mappedPtr;
@@ -153,7 +321,7 @@ bool DKFileMap::TryLockExclusive(void** ptr)
 {
 	if (lock.TryLock())
 	{
-		DKCriticalSection<DKSpinLock> guard(spinLock);
+		DKCriticalSection<DKMutex> guard(mapLock);
 		if (mappedPtr == NULL)
 			mappedPtr = MapContent();
 		if (ptr)
@@ -165,13 +333,24 @@ bool DKFileMap::TryLockExclusive(void** ptr)
 
 void DKFileMap::UnlockExclusive()
 {
-	DKCriticalSection<DKSpinLock> guard(spinLock);
-	if (mappedPtr)
-		UnmapContent();
-	mappedPtr = NULL;
+	if (!IsPersistent())
+	{
+		DKCriticalSection<DKMutex> guard(mapLock);
+		if (mappedPtr)
+			UnmapContent();
+		mappedPtr = NULL;
+	}
 	lock.Unlock();
 }
 
+bool DKFileMap::IsPersistent() const
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+		return (ctxt->options & MapOptionPersistent) != 0;
+	return false;
+}
+
 void* DKFileMap::MapContent() const
 {
 	// map, commit
@@ -188,13 +367,46 @@ void* DKFileMap::MapContent() const
 		{
 			DKLog("MapViewOfFile failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
 		}
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+		else if (ctxt->options & MapOptionPopulate)
+		{
+			WIN32_MEMORY_RANGE_ENTRY range = { ctxt->baseAddress, ctxt->length };
+			::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+		}
+#endif
 #else
-		ctxt->baseAddress = ::mmap(0, ctxt->length, ctxt->prot, ctxt->flags, ctxt->file, 0);
+		int flags = ctxt->flags;
+#ifdef MAP_POPULATE
+		if (ctxt->options & MapOptionPopulate)
+			flags |= MAP_POPULATE;
+#endif
+		ctxt->baseAddress = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		// explicit huge pages are available for anonymous mapping only,
+		// and fails if huge pages are not reserved.
+		if ((ctxt->options & MapOptionHugePages) && ctxt->file == -1)
+			ctxt->baseAddress = ::mmap(0, ctxt->length, ctxt->prot, flags | MAP_HUGETLB, ctxt->file, 0);
+#endif
+		if (ctxt->baseAddress == MAP_FAILED)
+			ctxt->baseAddress = ::mmap(0, ctxt->length, ctxt->prot, flags, ctxt->file, 0);
 		if (ctxt->baseAddress == MAP_FAILED)
 		{
 			ctxt->baseAddress = NULL;
 			DKLog("mmap failed:%s\n", strerror(errno));
 		}
+		else
+		{
+#ifdef MADV_HUGEPAGE
+			if (ctxt->options & MapOptionHugePages)
+				::madvise(ctxt->baseAddress, ctxt->length, MADV_HUGEPAGE); // transparent huge pages
+#endif
+#ifndef MAP_POPULATE
+			if (ctxt->options & MapOptionPopulate)
+				::posix_madvise(ctxt->baseAddress, ctxt->length, POSIX_MADV_WILLNEED);
+#endif
+			if (ctxt->accessHint != AccessNormal)
+				::posix_madvise(ctxt->baseAddress, ctxt->length, FileMapPosixAdvice(ctxt->accessHint));
+		}
 #endif
 		return ctxt->baseAddress;
 	}
@@ -288,6 +500,360 @@ bool DKFileMap::IsTransient() const
 	return true;
 }
 
+void DKFileMap::SetMapOptions(uint32_t options)
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+	{
+		DKCriticalSection<DKMutex> guard(mapLock);
+		ctxt->options = options;
+	}
+}
+
+uint32_t DKFileMap::MapOptions() const
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+		return ctxt->options;
+	return MapOptionDefault;
+}
+
+bool DKFileMap::Advise(AccessHint hint, size_t offset, size_t length)
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt == NULL)
+		return false;
+
+	DKCriticalSection<DKMutex> guard(mapLock);
+	if (offset >= ctxt->length)
+		return false;
+	length = Min(length, ctxt->length - offset);
+
+	if (offset == 0 && length == ctxt->length &&
+		(hint == AccessNormal || hint == AccessSequential || hint == AccessRandom))
+		ctxt->accessHint = hint;
+
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+	if (hint == AccessWillNeed && ctxt->baseAddress)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = { reinterpret_cast<uint8_t*>(ctxt->baseAddress) + offset, length };
+		if (!::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0))
+		{
+			DKLog("PrefetchVirtualMemory failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+			return false;
+		}
+	}
+#endif
+	return true;
+#else
+	bool result = true;
+	if (ctxt->baseAddress)
+		result = FileMapAdviseRange(ctxt->baseAddress, offset, length, FileMapPosixAdvice(hint));
+	if (ctxt->file != -1)
+		FileMapAdviseFile(ctxt->file, offset, length, hint);
+	return result;
+#endif
+}
+
+bool DKFileMap::Prefetch(size_t offset, size_t length)
+{
+	return Advise(AccessWillNeed, offset, length);
+}
+
+bool DKFileMap::Flush(size_t offset, size_t length, bool wait)
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt == NULL || !IsWritable())
+		return false;
+
+	// shared lock prevents content from being unmapped.
+	lock.LockShared();
+	void* baseAddress = NULL;
+	if (offset < ctxt->length)
+	{
+		DKCriticalSection<DKMutex> guard(mapLock);
+		baseAddress = ctxt->baseAddress;
+		length = Min(length, ctxt->length - offset);
+	}
+	else
+	{
+		length = 0;
+	}
+
+	bool result = true;
+#ifdef _WIN32
+	if (baseAddress && length > 0)
+	{
+		if (::FlushViewOfFile(reinterpret_cast<uint8_t*>(baseAddress) + offset, length) == FALSE)
+		{
+			DKLog("FlushViewOfFile failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+			result = false;
+		}
+	}
+	if (result && wait && ctxt->file != INVALID_HANDLE_VALUE)
+	{
+		if (::FlushFileBuffers(ctxt->file) == FALSE)
+		{
+			DKLog("FlushFileBuffers failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+			result = false;
+		}
+	}
+#else
+	if (baseAddress && length > 0)
+	{
+		size_t pageSize = FileMapGranularity();
+		size_t begin = offset - (offset % pageSize);
+		if (::msync(reinterpret_cast<uint8_t*>(baseAddress) + begin, length + (offset - begin), wait ? MS_SYNC : MS_ASYNC) != 0)
+		{
+			DKLog("msync failed:%s\n", strerror(errno));
+			result = false;
+		}
+	}
+	else if (wait && ctxt->file != -1)
+	{
+		// not mapped, modified pages are in page cache already.
+		if (::fsync(ctxt->file) != 0)
+		{
+			DKLog("fsync failed:%s\n", strerror(errno));
+			result = false;
+		}
+	}
+#endif
+	lock.UnlockShared();
+	return result;
+}
+
+bool DKFileMap::SetLength(size_t length)
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt == NULL || length == 0 || !IsWritable())
+		return false;
+
+	DKCriticalSection<DKSharedLock> lockGuard(lock);
+	DKCriticalSection<DKMutex> guard(mapLock);
+
+	const size_t oldLength = ctxt->length;
+	if (length == oldLength)
+		return true;
+
+	// windows can be invalid after file is truncated.
+	// windows in use are not unmapped, but removed from cache if they
+	// exceed new length, to not be reused for new windows.
+	ctxt->windowLock.Lock();
+	ctxt->PurgeWindows(0);
+	if (length < oldLength)
+	{
+		for (size_t i = 0; i < ctxt->windows.Count(); )
+		{
+			const DKObject<FileMapWindow>& w = ctxt->windows.Value(i);
+			if (w->offset + w->length > length)
+				ctxt->windows.Remove(i);
+			else
+				++i;
+		}
+	}
+	ctxt->windowLock.Unlock();
+
+#ifdef _WIN32
+	if (ctxt->file == INVALID_HANDLE_VALUE)
+	{
+		DKLog("DKFileMap: virtual map cannot be resized.\n");
+		return false;
+	}
+	bool remap = ctxt->baseAddress != NULL;
+	if (remap)
+		UnmapContent();
+	if (::CloseHandle(ctxt->map) == FALSE)
+	{
+		DKLog("CloseHandle failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+	}
+	ctxt->map = NULL;
+
+	bool result = true;
+	LARGE_INTEGER mapLength;
+	mapLength.QuadPart = length;
+	if (length < oldLength)
+	{
+		if (::SetFilePointerEx(ctxt->file, mapLength, NULL, FILE_BEGIN) == FALSE || ::SetEndOfFile(ctxt->file) == FALSE)
+		{
+			DKLog("SetEndOfFile failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+			mapLength.QuadPart = oldLength;
+			result = false;
+		}
+	}
+	ctxt->map = ::CreateFileMappingW(ctxt->file, NULL, PAGE_READWRITE, mapLength.HighPart, mapLength.LowPart, NULL);
+	if (ctxt->map == NULL)
+	{
+		DKLog("CreateFileMapping failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+		DKERROR_THROW_DEBUG("CreateFileMapping failed");
+		mappedPtr = NULL;
+		return false;
+	}
+	ctxt->length = (size_t)mapLength.QuadPart;
+	if (remap)
+		mappedPtr = MapContent();
+	return result;
+#else
+	if (ctxt->file != -1 && length > oldLength)
+	{
+		if (::ftruncate(ctxt->file, length) != 0)
+		{
+			DKLog("ftruncate failed:%s\n", strerror(errno));
+			return false;
+		}
+	}
+	if (ctxt->baseAddress)
+	{
+#if defined(__linux__)
+		void* p = ::mremap(ctxt->baseAddress, oldLength, length, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED)
+		{
+			DKLog("mremap failed:%s\n", strerror(errno));
+			return false;
+		}
+		ctxt->baseAddress = p;
+#else
+		void* p = ::mmap(0, length, ctxt->prot, ctxt->flags, ctxt->file, 0);
+		if (p == MAP_FAILED)
+		{
+			DKLog("mmap failed:%s\n", strerror(errno));
+			return false;
+		}
+		if (ctxt->file == -1) // anonymous memory, copy content.
+			memcpy(p, ctxt->baseAddress, Min(length, oldLength));
+		::munmap(ctxt->baseAddress, oldLength);
+		ctxt->baseAddress = p;
+#endif
+		mappedPtr = ctxt->baseAddress;
+	}
+	if (ctxt->file != -1 && length < oldLength)
+	{
+		if (::ftruncate(ctxt->file, length) != 0)
+			DKLog("ftruncate failed:%s\n", strerror(errno));
+	}
+	ctxt->length = length;
+	return true;
+#endif
+}
+
+DKObject<DKData> DKFileMap::Window(size_t offset, size_t length) const
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt == NULL || length == 0)
+		return NULL;
+
+	size_t contentLength;
+	if (true)
+	{
+		DKCriticalSection<DKMutex> guard(mapLock);
+		contentLength = ctxt->length;
+	}
+	if (offset >= contentLength)
+		return NULL;
+	length = Min(length, contentLength - offset);
+
+#ifndef _WIN32
+	if (ctxt->file == -1) // anonymous memory cannot be mapped separately.
+		return Subdata(offset, length);
+#endif
+
+	DKCriticalSection<DKMutex> guard(ctxt->windowLock);
+
+	DKObject<FileMapWindow> window = NULL;
+	for (size_t i = 0; i < ctxt->windows.Count(); ++i)
+	{
+		const DKObject<FileMapWindow>& w = ctxt->windows.Value(i);
+		if (w->offset <= offset && offset + length <= w->offset + w->length)
+		{
+			window = w;
+			if (i + 1 < ctxt->windows.Count())	// move to end (most recently used)
+			{
+				ctxt->windows.Remove(i);
+				ctxt->windows.Add(window);
+			}
+			break;
+		}
+	}
+	if (window == NULL)
+	{
+		// map range aligned with allocation granularity.
+		size_t granularity = FileMapGranularity();
+		uint64_t mapOffset = offset - (offset % granularity);
+		size_t mapLength = offset + length - (size_t)mapOffset;
+		if (mapLength % granularity)
+			mapLength += granularity - (mapLength % granularity);
+		mapLength = Min(mapLength, contentLength - (size_t)mapOffset);
+
+#ifdef _WIN32
+		void* p = ::MapViewOfFile(ctxt->map, ctxt->access, (DWORD)(mapOffset >> 32), (DWORD)(mapOffset & 0xffffffff), mapLength);
+		if (p == NULL)
+		{
+			DKLog("MapViewOfFile failed:%ls\n", (const wchar_t*)GetWin32ErrorString(::GetLastError()));
+			return NULL;
+		}
+#else
+		int flags = ctxt->flags;
+#ifdef MAP_POPULATE
+		if (ctxt->options & MapOptionPopulate)
+			flags |= MAP_POPULATE;
+#endif
+		void* p = ::mmap(0, mapLength, ctxt->prot, flags, ctxt->file, (off_t)mapOffset);
+		if (p == MAP_FAILED)
+		{
+			DKLog("mmap failed:%s\n", strerror(errno));
+			return NULL;
+		}
+		if (ctxt->accessHint != AccessNormal)
+			::posix_madvise(p, mapLength, FileMapPosixAdvice(ctxt->accessHint));
+#endif
+		window = DKObject<FileMapWindow>::New();
+		window->baseAddress = p;
+		window->offset = mapOffset;
+		window->length = mapLength;
+		ctxt->windows.Add(window);
+	}
+
+	DKObject<FileMapWindowData> data = DKObject<FileMapWindowData>::New();
+	data->window = window;
+	data->ptr = reinterpret_cast<uint8_t*>(window->baseAddress) + (offset - window->offset);
+	data->length = length;
+	data->writable = IsWritable();
+
+	// windows referenced by data objects are not counted.
+	ctxt->PurgeWindows(ctxt->windowCacheLimit);
+	return data.SafeCast<DKData>();
+}
+
+void DKFileMap::SetWindowCacheLimit(size_t numWindows)
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+	{
+		DKCriticalSection<DKMutex> guard(ctxt->windowLock);
+		ctxt->windowCacheLimit = numWindows;
+		ctxt->PurgeWindows(numWindows);
+	}
+}
+
+size_t DKFileMap::WindowCacheLimit() const
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+		return ctxt->windowCacheLimit;
+	return 0;
+}
+
+void DKFileMap::PurgeWindows() const
+{
+	FileMapContext* ctxt = reinterpret_cast<FileMapContext*>(this->mapContext);
+	if (ctxt)
+	{
+		DKCriticalSection<DKMutex> guard(ctxt->windowLock);
+		ctxt->PurgeWindows(0);
+	}
+}
+
 DKObject<DKFileMap> DKFileMap::Open(const DKString &file, size_t size, bool writable)
 {
 	if (file.Length() == 0)
@@ -8,7 +8,8 @@
 #pragma once
 #include "../DKInclude.h"
 #include "DKObject.h"
-#include "DKSpinLock.h"
+#include "DKMutex.h"
+#include "DKSharedLock.h"
 #include "DKString.h"
 #include "DKData.h"
 #include "DKStream.h"
@@ -17,9 +18,11 @@ namespace DKFoundation
 {
 	/// @brief
 	/// mapping file and memory to provide random-access of file contents.
-	/// good for large file access randomly. cannot be resized already mapped.
+	/// good for large file access randomly.
 	///
-	/// To map range (not entire contents) use DKFile::MapContentRange.
+	/// To map range (not entire contents) use Window() or DKFile::MapContentRange.
+	/// Windows are cached and recently used windows stay mapped, this is
+	/// useful for huge files which are not suitable to map entirely.
 	///
 	/// Mapping modes:
 	///  - read only (entire size or desired length)
@@ -35,6 +38,22 @@ namespace DKFoundation
 	class DKGL_API DKFileMap : public DKData
 	{
 	public:
+		enum AccessHint
+		{
+			AccessNormal = 0,
+			AccessSequential,
+			AccessRandom,
+			AccessWillNeed,
+			AccessDontNeed,
+		};
+		enum MapOption : uint32_t
+		{
+			MapOptionDefault = 0,
+			MapOptionPersistent = 1 << 0,	///< keep content mapped after unlocked
+			MapOptionPopulate = 1 << 1,		///< prefault pages when mapped (MAP_POPULATE)
+			MapOptionHugePages = 1 << 2,	///< use huge pages if possible (not supported on Win32)
+		};
+
 		DKFileMap();
 		~DKFileMap();
 
@@ -61,14 +80,49 @@ namespace DKFoundation
 		bool TryLockExclusive(void** ptr) override;
 		void UnlockExclusive() override;
 
+		/// mapping options, applied from next mapping.
+		/// content is unmapped when unlocked, unless MapOptionPersistent is set.
+		void SetMapOptions(uint32_t options);
+		uint32_t MapOptions() const;
+
+		/// access pattern hint for range. (madvise, fadvise)
+		/// Normal, Sequential and Random for entire content are also
+		/// applied to subsequent mappings.
+		bool Advise(AccessHint hint, size_t offset = 0, size_t length = ~size_t(0));
+		/// read range into page cache asynchronously.
+		bool Prefetch(size_t offset, size_t length);
+		/// write modified pages of range back to file.
+		/// if wait is false, schedule writing and returns immediately.
+		bool Flush(size_t offset = 0, size_t length = ~size_t(0), bool wait = true);
+
+		/// resize file and mapping. (writable only)
+		/// mapped content is resized in place if possible (mremap on Linux),
+		/// mapped address can be changed. Do not call while content is locked.
+		/// Windows in use are not unmapped when shrinking, accessing range
+		/// of a window beyond new length raises SIGBUS. (shrinking fails on
+		/// Windows while windows are in use) Release windows before shrinking.
+		bool SetLength(size_t length);
+
+		/// map range of content as separate window.
+		/// a window can be larger than requested range, aligned with
+		/// allocation granularity. Windows which are not in use are kept
+		/// mapped up to window cache limit, least recently used one is
+		/// unmapped first.
+		DKObject<DKData> Window(size_t offset, size_t length) const;
+		void SetWindowCacheLimit(size_t numWindows);
+		size_t WindowCacheLimit() const;
+		/// unmap cached windows which are not in use.
+		void PurgeWindows() const;
+
 	private:
 		void* MapContent() const;
 		void UnmapContent() const;
+		bool IsPersistent() const;
 		mutable void* mappedPtr;
 
 		void* mapContext;
 		DKSharedLock lock;
-		DKSpinLock spinLock;
+		DKMutex mapLock;	// mapping state, held across mmap/madvise/mremap.
 
 		DKFileMap(const DKFileMap&) = delete;
 		DKFileMap& operator = (const DKFileMap&) = delete;
@@ -324,6 +324,12 @@ namespace DKFoundation
 			return numChunks * MaxUnitsPerChunk;
 		}
 
+		/// lock object, to register a name to DKLockProfiler.
+		const Lock& LockObject() const
+		{
+			return lock;
+		}
+
 		DKFixedSizeAllocator()
 			: chunkTable(NULL)
 			, cachedChunk(NULL)
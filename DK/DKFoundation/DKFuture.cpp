@@ -0,0 +1,193 @@
+//
+//  File: DKFuture.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKFuture.h"
+#include "DKCondition.h"
+#include "DKFunction.h"
+#include "DKTimer.h"
+
+namespace DKFoundation::Private
+{
+    // Waiting threads are rare, so all states share one condition.
+    // A state signals this condition only if there are waiting threads.
+    static DKCondition futureStateCond;
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+FutureStateBase::FutureStateBase()
+	: state(StatePending)
+	, numWaiters(0)
+	, numPromises(0)
+{
+}
+
+FutureStateBase::~FutureStateBase()
+{
+	DKASSERT_DEBUG(numWaiters == 0);
+	DKASSERT_DEBUG(continuations.IsEmpty());
+}
+
+bool FutureStateBase::IsSettled() const
+{
+	State s = CurrentState();
+	return s == StateFulfilled || s == StateCancelled;
+}
+
+void FutureStateBase::Wait() const
+{
+	if (IsSettled())
+		return;
+
+	FutureStateBase* self = const_cast<FutureStateBase*>(this);
+	self->numWaiters.Increment();
+	futureStateCond.Lock();
+	while (!IsSettled())
+		futureStateCond.Wait();
+	futureStateCond.Unlock();
+	self->numWaiters.Decrement();
+}
+
+bool FutureStateBase::WaitTimeout(double t) const
+{
+	if (IsSettled())
+		return true;
+
+	FutureStateBase* self = const_cast<FutureStateBase*>(this);
+	self->numWaiters.Increment();
+	futureStateCond.Lock();
+	if (!IsSettled() && t > 0.0)
+	{
+		DKTimer timer;
+		timer.Reset();
+		double remains = t;
+		while (!IsSettled() && remains > 0.0)
+		{
+			futureStateCond.WaitTimeout(remains);
+			remains = t - timer.Elapsed();
+		}
+	}
+	bool result = IsSettled();
+	futureStateCond.Unlock();
+	self->numWaiters.Decrement();
+	return result;
+}
+
+void FutureStateBase::AddContinuation(const DKOperation* op)
+{
+	if (op == NULL)
+		return;
+
+	lock.Lock();
+	if (!IsSettled())
+	{
+		continuations.Add(const_cast<DKOperation*>(op));
+		lock.Unlock();
+	}
+	else
+	{
+		lock.Unlock();
+		op->Perform();
+	}
+}
+
+bool FutureStateBase::BeginFulfill()
+{
+	return state.CompareAndSet(StatePending, StateSettling);
+}
+
+void FutureStateBase::EndFulfill()
+{
+	DKASSERT_DEBUG(CurrentState() == StateSettling);
+	Settle(StateFulfilled);
+}
+
+void FutureStateBase::AbortFulfill()
+{
+	DKASSERT_DEBUG(CurrentState() == StateSettling);
+	Settle(StateCancelled);
+}
+
+bool FutureStateBase::Cancel()
+{
+	if (state.CompareAndSet(StatePending, StateSettling))
+	{
+		Settle(StateCancelled);
+		return true;
+	}
+	return false;
+}
+
+void FutureStateBase::Settle(State s)
+{
+	// take continuations with lock, state can not be modified by others
+	// because it is in StateSettling.
+	lock.Lock();
+	state = s;
+	DKArray<DKObject<DKOperation>> ops = std::move(continuations);
+	lock.Unlock();
+
+	if (numWaiters > 0)
+	{
+		futureStateCond.Lock();
+		futureStateCond.Broadcast();
+		futureStateCond.Unlock();
+	}
+	for (DKObject<DKOperation>& op : ops)
+		op->Perform();
+}
+
+void FutureStateBase::RetainPromise()
+{
+	numPromises.Increment();
+}
+
+void FutureStateBase::ReleasePromise()
+{
+	if (numPromises.Decrement() == 1)
+		Cancel();	// broken promise.
+}
+
+void FutureStateBase::Dispatch(DKOperationQueue* queue, DKEventLoop* eventLoop, const DKOperation* op)
+{
+	if (queue)
+		queue->Post(const_cast<DKOperation*>(op));
+	else if (eventLoop)
+		eventLoop->Post(op);
+	else
+		op->Perform();
+}
+
+DKFuture<bool> DKFoundation::DKMakeFuture(DKOperationQueue::OperationSync* sync)
+{
+	if (sync == NULL)
+		return DKFuture<bool>::Cancelled();
+
+	DKPromise<bool> promise;
+	DKFuture<bool> future = promise.Future();
+	// handler is performed by sync object, sync object must not be retained.
+	sync->AddCompletionHandler(DKFunction([promise, sync]()
+	{
+		promise.SetValue(sync->OperationState() == DKOperationQueue::OperationSync::StateProcessed);
+	})->Invocation());
+	return future;
+}
+
+DKFuture<bool> DKFoundation::DKMakeFuture(DKEventLoop::PendingState* state)
+{
+	if (state == NULL)
+		return DKFuture<bool>::Cancelled();
+
+	DKPromise<bool> promise;
+	DKFuture<bool> future = promise.Future();
+	state->AddCompletionHandler(DKFunction([promise, state]()
+	{
+		promise.SetValue(state->IsDone());
+	})->Invocation());
+	return future;
+}
@@ -0,0 +1,548 @@
+//
+//  File: DKFuture.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include <new>
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKArray.h"
+#include "DKSpinLock.h"
+#include "DKAtomicNumber32.h"
+#include "DKOperationQueue.h"
+#include "DKEventLoop.h"
+
+namespace DKFoundation
+{
+	template <typename T> class DKFuture;
+	template <typename T> class DKPromise;
+
+	namespace Private
+	{
+		/// shared state between DKPromise and DKFuture. (type independent part)
+		class DKGL_API FutureStateBase
+		{
+		public:
+			enum State : DKAtomicNumber32::Value
+			{
+				StatePending = 0,
+				StateSettling,		///< value is being constructed.
+				StateFulfilled,
+				StateCancelled,
+			};
+
+			FutureStateBase();
+			virtual ~FutureStateBase();
+
+			State CurrentState() const { return static_cast<State>(static_cast<DKAtomicNumber32::Value>(state)); }
+			bool IsSettled() const;
+
+			void Wait() const;
+			bool WaitTimeout(double t) const;
+
+			/// Enqueue an operation to be performed when state has been settled.
+			/// If the state has been settled already, operation will be performed immediately.
+			void AddContinuation(const DKOperation* op);
+
+			bool BeginFulfill();
+			void EndFulfill();
+			void AbortFulfill();
+			bool Cancel();
+
+			void RetainPromise();
+			void ReleasePromise();
+
+			/// post operation to queue or event-loop. (perform immediately if both are NULL)
+			static void Dispatch(DKOperationQueue* queue, DKEventLoop* eventLoop, const DKOperation* op);
+
+		private:
+			void Settle(State s);
+
+			DKAtomicNumber32 state;
+			DKAtomicNumber32 numWaiters;
+			DKAtomicNumber32 numPromises;
+			DKSpinLock lock;
+			DKArray<DKObject<DKOperation>> continuations;
+
+			FutureStateBase(const FutureStateBase&) = delete;
+			FutureStateBase& operator = (const FutureStateBase&) = delete;
+		};
+
+		template <typename T> class FutureState : public FutureStateBase
+		{
+		public:
+			FutureState() {}
+			~FutureState()
+			{
+				if (CurrentState() == StateFulfilled)
+					Value().~T();
+			}
+			template <typename... Args> bool Fulfill(Args&&... args)
+			{
+				if (BeginFulfill())
+				{
+					try {
+						new(static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+					} catch (...) {
+						AbortFulfill();
+						throw;
+					}
+					EndFulfill();
+					return true;
+				}
+				return false;
+			}
+			T& Value()
+			{
+				return *reinterpret_cast<T*>(storage);
+			}
+		private:
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+		template <> class FutureState<void> : public FutureStateBase
+		{
+		public:
+			bool Fulfill()
+			{
+				if (BeginFulfill())
+				{
+					EndFulfill();
+					return true;
+				}
+				return false;
+			}
+			void Value() {}
+		};
+
+		template <typename T> struct FutureUnwrap
+		{
+			enum { IsFuture = false };
+			using Type = T;
+		};
+		template <typename T> struct FutureUnwrap<DKFuture<T>>
+		{
+			enum { IsFuture = true };
+			using Type = T;
+		};
+		template <typename T, typename Fn> struct FutureContinuationResult
+		{
+			using Type = decltype(std::declval<Fn&>()(std::declval<T&>()));
+		};
+		template <typename Fn> struct FutureContinuationResult<void, Fn>
+		{
+			using Type = decltype(std::declval<Fn&>()());
+		};
+
+		/// Continuation object which is enqueued into source state.
+		/// This object is reused when dispatching to a queue or an event-loop,
+		/// so one continuation costs one allocation.
+		template <typename T, typename Fn> class FutureContinuation : public DKOperation
+		{
+		public:
+			using Result = typename FutureContinuationResult<T, Fn>::Type;
+			using Unwrap = FutureUnwrap<Result>;
+			using ValueType = typename Unwrap::Type;
+
+			FutureContinuation(FutureState<T>* s, Fn&& fn, DKOperationQueue* q, DKEventLoop* e)
+				: source(s), function(std::forward<Fn>(fn)), queue(q), eventLoop(e), dispatched(false)
+			{
+			}
+			void Perform() const override
+			{
+				if (!dispatched && (queue || eventLoop))
+				{
+					dispatched = true;
+					FutureStateBase::Dispatch(queue, eventLoop, this);
+					return;
+				}
+				const_cast<FutureContinuation*>(this)->Run();
+			}
+
+			DKPromise<ValueType> promise;
+
+		private:
+			void Run()
+			{
+				DKObject<FutureState<T>> src = std::move(source);
+				if (src && src->CurrentState() == FutureStateBase::StateFulfilled)
+				{
+					if constexpr (std::is_void<T>::value)
+						Complete([this]() { return function(); });
+					else
+						Complete([this, &src]() { return function(src->Value()); });
+				}
+				else
+				{
+					promise.Cancel();
+				}
+			}
+			template <typename Invoke> void Complete(Invoke&& invoke)
+			{
+				if constexpr (std::is_void<Result>::value)
+				{
+					invoke();
+					promise.SetValue();
+				}
+				else if constexpr (Unwrap::IsFuture)
+				{
+					Result next = invoke();
+					promise.Forward(next);
+				}
+				else
+				{
+					promise.SetValue(invoke());
+				}
+			}
+
+			DKObject<FutureState<T>> source;
+			Fn function;
+			DKOperationQueue* queue;
+			DKEventLoop* eventLoop;
+			mutable bool dispatched;
+		};
+	}
+
+	/**
+	 @brief
+	 A result of an asynchronous operation which will be available later.
+	 DKFuture object shares the state with DKPromise, that provides a result.
+
+	 You can wait for result (blocking) with Wait() or Value(), or you can
+	 attach continuations with Then() which will be performed when the result
+	 is available, without blocking any thread.
+	 A continuation can be performed on specified DKOperationQueue or
+	 DKEventLoop, or performed on the thread that settles the result.
+
+	 The result is stored in shared state directly, it will not be allocated
+	 separately. A continuation receives the result as lvalue reference,
+	 and the continuation may move the value if it is the only consumer.
+
+	 If the promise has been cancelled or destroyed without a result, the future
+	 becomes 'cancelled' and continuations will not be called, but all futures
+	 returned by Then() are cancelled also.
+
+	 @code
+	  DKFuture<DKObject<DKData>> data = DKAsync(&queue, [&]() { return LoadFile(path); });
+	  data.Then(&queue, [](DKObject<DKData>& d) { return Decode(d); })
+	      .Then(mainLoop, [](DKObject<Image>& img) { CreateTexture(img); });
+	 @endcode
+
+	 @see DKPromise, DKAsync, DKWhenAll, DKWhenAny
+	 */
+	template <typename T> class DKFuture
+	{
+		using State = Private::FutureState<T>;
+	public:
+		using ValueType = T;
+		using Reference = typename std::add_lvalue_reference<T>::type;
+
+		DKFuture() {}
+		DKFuture(const DKFuture&) = default;
+		DKFuture(DKFuture&&) = default;
+		DKFuture& operator = (const DKFuture&) = default;
+		DKFuture& operator = (DKFuture&&) = default;
+
+		bool IsValid() const		{ return state != NULL; }
+		/// result has been set.
+		bool IsReady() const		{ return state && state->CurrentState() == State::StateFulfilled; }
+		/// promise was cancelled or broken.
+		bool IsCancelled() const	{ return state && state->CurrentState() == State::StateCancelled; }
+		/// result has been set or cancelled.
+		bool IsSettled() const		{ return state && state->IsSettled(); }
+
+		/// wait until result has been settled.
+		void Wait() const
+		{
+			DKASSERT_DEBUG(state);
+			if (state)
+				state->Wait();
+		}
+		/// wait until settled or timed-out, returns true if settled.
+		bool WaitTimeout(double t) const
+		{
+			if (state)
+				return state->WaitTimeout(t);
+			return false;
+		}
+		/// wait and get result. raise exception if cancelled.
+		Reference Value() const
+		{
+			DKASSERT_DESC(state, "Invalid future");
+			state->Wait();
+			if (state->CurrentState() != State::StateFulfilled)
+				DKERROR_THROW("Future has been cancelled.");
+			return SharedState()->Value();
+		}
+		/// wait and move result out of shared state. raise exception if cancelled.
+		/// this future will be invalidated.
+		T Take()
+		{
+			DKObject<State> s = std::move(state);
+			DKASSERT_DESC(s, "Invalid future");
+			s->Wait();
+			if (s->CurrentState() != State::StateFulfilled)
+				DKERROR_THROW("Future has been cancelled.");
+			if constexpr (!std::is_void<T>::value)
+				return std::move(s->Value());
+		}
+
+		/// Register a handler to be performed when the result has been settled.
+		/// (fulfilled or cancelled) The handler is performed on the thread which
+		/// settles the result, or performed immediately if settled already.
+		void AddCompletionHandler(const DKOperation* handler) const
+		{
+			DKASSERT_DESC(state, "Invalid future");
+			SharedState()->AddContinuation(handler);
+		}
+
+		/// Attach continuation to be performed on the thread which settles result.
+		/// If result is available already, continuation will be performed immediately.
+		/// Function can return a value, void or another DKFuture (will be unwrapped).
+		template <typename Fn> auto Then(Fn&& fn) const
+		{
+			return Then(static_cast<DKOperationQueue*>(NULL), static_cast<DKEventLoop*>(NULL), std::forward<Fn>(fn));
+		}
+		/// Attach continuation to be performed on given operation-queue.
+		template <typename Fn> auto Then(DKOperationQueue* queue, Fn&& fn) const
+		{
+			return Then(queue, static_cast<DKEventLoop*>(NULL), std::forward<Fn>(fn));
+		}
+		/// Attach continuation to be performed on given event-loop.
+		template <typename Fn> auto Then(DKEventLoop* eventLoop, Fn&& fn) const
+		{
+			return Then(static_cast<DKOperationQueue*>(NULL), eventLoop, std::forward<Fn>(fn));
+		}
+
+		/// Create a future which is ready with given value.
+		template <typename... Args> static DKFuture Ready(Args&&... args)
+		{
+			DKPromise<T> promise;
+			promise.SetValue(std::forward<Args>(args)...);
+			return promise.Future();
+		}
+		/// Create a future which is cancelled.
+		static DKFuture Cancelled()
+		{
+			DKPromise<T> promise;
+			promise.Cancel();
+			return promise.Future();
+		}
+
+	private:
+		template <typename Fn> auto Then(DKOperationQueue* queue, DKEventLoop* eventLoop, Fn&& fn) const
+		{
+			using Continuation = Private::FutureContinuation<T, _UnRefCV<Fn>>;
+			using Result = DKFuture<typename Continuation::ValueType>;
+
+			DKASSERT_DESC(state, "Invalid future");
+			DKObject<Continuation> cont = DKOBJECT_NEW Continuation(SharedState(), _UnRefCV<Fn>(std::forward<Fn>(fn)), queue, eventLoop);
+			Result result = cont->promise.Future();
+			SharedState()->AddContinuation(cont);
+			return result;
+		}
+
+		DKFuture(State* s) : state(s) {}
+		State* SharedState() const { return const_cast<State*>(state.Ptr()); }
+		DKObject<State> state;
+
+		template <typename U> friend class DKPromise;
+		template <typename U> friend class DKFuture;
+		template <typename U> friend DKFuture<void> DKWhenAll(const DKArray<DKFuture<U>>&);
+		template <typename U> friend DKFuture<size_t> DKWhenAny(const DKArray<DKFuture<U>>&);
+		template <typename... Us> friend DKFuture<void> DKWhenAll(const DKFuture<Us>&...);
+	};
+
+	/**
+	 @brief
+	 Provider of DKFuture result.
+	 A promise can be copied (ex: captured by DKFunction), all copies share same
+	 state. When the last promise has been destroyed without setting a result,
+	 the state becomes 'cancelled'.
+	 */
+	template <typename T> class DKPromise
+	{
+		using State = Private::FutureState<T>;
+	public:
+		DKPromise() : state(DKOBJECT_NEW State())
+		{
+			state->RetainPromise();
+		}
+		DKPromise(const DKPromise& p) : state(p.state)
+		{
+			if (state)
+				state->RetainPromise();
+		}
+		DKPromise(DKPromise&& p) : state(std::move(p.state))
+		{
+		}
+		~DKPromise()
+		{
+			if (state)
+				state->ReleasePromise();
+		}
+		DKPromise& operator = (const DKPromise& p)
+		{
+			if (state != p.state)
+			{
+				if (p.state)
+					p.state->RetainPromise();
+				if (state)
+					state->ReleasePromise();
+				state = p.state;
+			}
+			return *this;
+		}
+		DKPromise& operator = (DKPromise&& p)
+		{
+			if (this != &p)
+			{
+				if (state)
+					state->ReleasePromise();
+				state = std::move(p.state);
+			}
+			return *this;
+		}
+
+		/// set result and release waiting threads, perform continuations.
+		/// returns false if result has been set or cancelled already.
+		template <typename... Args> bool SetValue(Args&&... args) const
+		{
+			if (state)
+				return SharedState()->Fulfill(std::forward<Args>(args)...);
+			return false;
+		}
+		/// cancel promise, futures will be 'cancelled'.
+		bool Cancel() const
+		{
+			if (state)
+				return SharedState()->Cancel();
+			return false;
+		}
+		/// returns future object shares state with this.
+		DKFuture<T> Future() const
+		{
+			return DKFuture<T>(SharedState());
+		}
+		/// settle with result of other future. (used by unwrapping continuation)
+		void Forward(const DKFuture<T>& future) const
+		{
+			if (future.IsValid())
+			{
+				DKPromise promise(*this);
+				future.Then([promise](auto&&... v) { promise.SetValue(std::move(v)...); });
+			}
+			else
+			{
+				Cancel();
+			}
+		}
+
+	private:
+		State* SharedState() const { return const_cast<State*>(state.Ptr()); }
+		DKObject<State> state;
+	};
+
+	namespace Private
+	{
+		/// Shared by all sources of DKWhenAll.
+		class FutureJoin : public DKOperation
+		{
+		public:
+			FutureJoin(size_t count) : remains(static_cast<DKAtomicNumber32::Value>(count)) {}
+			void Perform() const override
+			{
+				if (remains.Decrement() == 1)
+					promise.SetValue();
+			}
+			mutable DKAtomicNumber32 remains;
+			mutable DKPromise<void> promise;
+		};
+
+		/// Shared by all sources of DKWhenAny.
+		class FutureSelect : public DKOperation
+		{
+		public:
+			void Perform() const override
+			{
+				if (selected.CompareAndSet(0, 1))
+				{
+					for (size_t i = 0; i < sources.Count(); ++i)
+					{
+						if (sources.Value(i)->IsSettled())
+						{
+							promise.SetValue(i);
+							break;
+						}
+					}
+				}
+			}
+			DKArray<DKObject<FutureStateBase>> sources;
+			mutable DKAtomicNumber32 selected;
+			mutable DKPromise<size_t> promise;
+		};
+	}
+
+	/// Run function on given operation-queue, returns future of result.
+	template <typename Fn> auto DKAsync(DKOperationQueue* queue, Fn&& fn)
+	{
+		return DKFuture<void>::Ready().Then(queue, std::forward<Fn>(fn));
+	}
+	/// Run function on given event-loop, returns future of result.
+	template <typename Fn> auto DKAsync(DKEventLoop* eventLoop, Fn&& fn)
+	{
+		return DKFuture<void>::Ready().Then(eventLoop, std::forward<Fn>(fn));
+	}
+
+	/// returns future which is ready when all given futures are settled.
+	/// given futures can be fulfilled or cancelled, check each future for result.
+	template <typename T> DKFuture<void> DKWhenAll(const DKArray<DKFuture<T>>& futures)
+	{
+		DKObject<Private::FutureJoin> join = DKOBJECT_NEW Private::FutureJoin(futures.Count() + 1);
+		DKFuture<void> result = join->promise.Future();
+		for (const DKFuture<T>& f : futures)
+		{
+			DKASSERT_DESC(f.state, "Invalid future");
+			f.SharedState()->AddContinuation(join);
+		}
+		join->Perform();
+		return result;
+	}
+	template <typename... Ts> DKFuture<void> DKWhenAll(const DKFuture<Ts>&... futures)
+	{
+		DKObject<Private::FutureJoin> join = DKOBJECT_NEW Private::FutureJoin(sizeof...(Ts) + 1);
+		DKFuture<void> result = join->promise.Future();
+		(futures.SharedState()->AddContinuation(join), ...);
+		join->Perform();
+		return result;
+	}
+	/// returns future of index of the first settled future.
+	/// if array is empty, returned future is cancelled.
+	template <typename T> DKFuture<size_t> DKWhenAny(const DKArray<DKFuture<T>>& futures)
+	{
+		if (futures.IsEmpty())
+			return DKFuture<size_t>::Cancelled();
+
+		DKObject<Private::FutureSelect> select = DKOBJECT_NEW Private::FutureSelect();
+		select->sources.Reserve(futures.Count());
+		for (const DKFuture<T>& f : futures)
+		{
+			DKASSERT_DESC(f.state, "Invalid future");
+			select->sources.Add(f.SharedState());
+		}
+		DKFuture<size_t> result = select->promise.Future();
+		for (const DKFuture<T>& f : futures)
+			f.SharedState()->AddContinuation(select);
+		return result;
+	}
+
+	/// Adapt OperationSync. The result is same as OperationSync::Sync(),
+	/// true if operation has been processed, false if cancelled.
+	DKGL_API DKFuture<bool> DKMakeFuture(DKOperationQueue::OperationSync* sync);
+	/// Adapt PendingState. The result is same as PendingState::Result(),
+	/// true if operation has been processed, false if revoked.
+	DKGL_API DKFuture<bool> DKMakeFuture(DKEventLoop::PendingState* state);
+}
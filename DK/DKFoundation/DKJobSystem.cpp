@@ -0,0 +1,769 @@
+//
+//  File: DKJobSystem.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "DKJobSystem.h"
+#include "DKThread.h"
+#include "DKCondition.h"
+#include "DKQueue.h"
+#include "DKArray.h"
+#include "DKFunction.h"
+#include "DKMemory.h"
+#include "DKUtils.h"
+#include "DKLog.h"
+#include "DKProfiler.h"
+
+#if defined(_WIN32)
+#define DKGL_JOB_FIBER_WIN32 1
+#elif defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define DKGL_JOB_FIBER_ASM 1
+#endif
+
+#if defined(DKGL_JOB_FIBER_WIN32) || defined(DKGL_JOB_FIBER_ASM)
+#define DKGL_JOB_FIBER_ENABLED 1
+#else
+#define DKGL_JOB_FIBER_ENABLED 0
+#endif
+
+#if DKGL_JOB_FIBER_ASM
+// Switch context: save callee-saved registers on current stack,
+// store stack pointer to 'from', load stack pointer 'to' and restore registers.
+// New fiber starts at DKJobFiberEntry with function and argument in
+// callee-saved registers.
+extern "C" void DKJobFiberSwitchContext(void** from, void* to);
+extern "C" void DKJobFiberEntry();
+#if defined(__x86_64__)
+asm(R"(
+    .pushsection .text
+    .globl DKJobFiberSwitchContext
+    .hidden DKJobFiberSwitchContext
+    .type DKJobFiberSwitchContext, @function
+    .align 16
+DKJobFiberSwitchContext:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size DKJobFiberSwitchContext, .-DKJobFiberSwitchContext
+
+    .globl DKJobFiberEntry
+    .hidden DKJobFiberEntry
+    .type DKJobFiberEntry, @function
+    .align 16
+DKJobFiberEntry:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size DKJobFiberEntry, .-DKJobFiberEntry
+    .popsection
+)");
+#elif defined(__aarch64__)
+asm(R"(
+    .pushsection .text
+    .globl DKJobFiberSwitchContext
+    .hidden DKJobFiberSwitchContext
+    .type DKJobFiberSwitchContext, %function
+    .align 4
+DKJobFiberSwitchContext:
+    sub sp, sp, #0xa0
+    stp x19, x20, [sp, #0x00]
+    stp x21, x22, [sp, #0x10]
+    stp x23, x24, [sp, #0x20]
+    stp x25, x26, [sp, #0x30]
+    stp x27, x28, [sp, #0x40]
+    stp x29, x30, [sp, #0x50]
+    stp d8,  d9,  [sp, #0x60]
+    stp d10, d11, [sp, #0x70]
+    stp d12, d13, [sp, #0x80]
+    stp d14, d15, [sp, #0x90]
+    mov x2, sp
+    str x2, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0x00]
+    ldp x21, x22, [sp, #0x10]
+    ldp x23, x24, [sp, #0x20]
+    ldp x25, x26, [sp, #0x30]
+    ldp x27, x28, [sp, #0x40]
+    ldp x29, x30, [sp, #0x50]
+    ldp d8,  d9,  [sp, #0x60]
+    ldp d10, d11, [sp, #0x70]
+    ldp d12, d13, [sp, #0x80]
+    ldp d14, d15, [sp, #0x90]
+    add sp, sp, #0xa0
+    ret
+    .size DKJobFiberSwitchContext, .-DKJobFiberSwitchContext
+
+    .globl DKJobFiberEntry
+    .hidden DKJobFiberEntry
+    .type DKJobFiberEntry, %function
+    .align 4
+DKJobFiberEntry:
+    mov x0, x19
+    blr x20
+    brk #0
+    .size DKJobFiberEntry, .-DKJobFiberEntry
+    .popsection
+)");
+#endif
+#endif
+
+namespace DKFoundation::Private
+{
+    struct JobEntry
+    {
+        DKObject<DKOperation> operation;
+        DKObject<DKJobSystem::Counter> counter;
+    };
+
+    struct JobFiberContext
+    {
+#if DKGL_JOB_FIBER_WIN32
+        LPVOID fiber = NULL;
+#else
+        void* sp = NULL;
+#endif
+    };
+
+    class JobSystemImpl;
+    struct JobFiber
+    {
+        JobFiberContext context;
+        JobSystemImpl* system;
+        JobEntry job;
+        DKTimer::Tick sliceBegin; // profiler, begin of current run slice.
+        void* stack;            // reserved pages, (lowest page is guard page)
+        JobFiber* next;         // link of free-list or counter's wait-list
+        int64_t waitTarget;
+    };
+
+    enum JobFiberAction
+    {
+        JobFiberActionFinished,
+        JobFiberActionYield,
+        JobFiberActionWait,
+    };
+
+    // Worker thread state, fiber switches to worker's context with action
+    // to be handled by worker. (after leaving fiber's stack)
+    struct JobWorker
+    {
+        JobSystemImpl* system;
+        JobFiberContext context;
+        JobFiber* current;
+        JobFiberAction action;
+        DKJobSystem::Counter* waitCounter;
+        int64_t waitTarget;
+    };
+
+    // Fiber can be resumed on other thread, the address of thread-local
+    // storage must not be cached across context switch.
+    static thread_local JobWorker* currentJobWorker = NULL;
+    NOINLINE static JobWorker* CurrentJobWorker()
+    {
+        return currentJobWorker;
+    }
+    NOINLINE static void SetCurrentJobWorker(JobWorker* worker)
+    {
+        currentJobWorker = worker;
+    }
+
+    // Threads waiting for counters are rare, all counters share one condition.
+    static DKCondition jobCounterCond;
+
+    FORCEINLINE void JobFiberSwitch(JobFiberContext& from, JobFiberContext& to)
+    {
+#if DKGL_JOB_FIBER_ASM
+        DKJobFiberSwitchContext(&from.sp, to.sp);
+#elif DKGL_JOB_FIBER_WIN32
+        ::SwitchToFiber(to.fiber);
+#endif
+    }
+
+    // A job suspended by Wait() or Yield() can be resumed by other worker,
+    // each run of the job is recorded as a separate slice on the thread
+    // which runs it, suspended time is not included.
+    FORCEINLINE void JobProfileBegin(DKTimer::Tick& sliceBegin)
+    {
+        sliceBegin = profilerEnabled ? DKTimer::SystemTick() : 0;
+    }
+    FORCEINLINE void JobProfileEnd(DKTimer::Tick sliceBegin)
+    {
+        if (sliceBegin)
+            DKProfiler::Record("DKJobSystem::Job", sliceBegin, DKTimer::SystemTick());
+    }
+
+    NOINLINE static void JobRun(JobEntry& job, DKTimer::Tick& sliceBegin)
+    {
+        JobEntry entry = job;
+        job.operation = NULL;
+        job.counter = NULL;
+
+        JobProfileBegin(sliceBegin);
+        entry.operation->Perform();
+        if (entry.counter)
+            entry.counter->Decrement();
+        JobProfileEnd(sliceBegin);
+    }
+    FORCEINLINE void JobRun(JobEntry& job)
+    {
+        DKTimer::Tick sliceBegin;
+        JobRun(job, sliceBegin);
+    }
+
+#if DKGL_JOB_FIBER_ENABLED
+    static void JobFiberMain(void* p)
+    {
+        JobFiber* fiber = static_cast<JobFiber*>(p);
+        while (true)
+        {
+            JobRun(fiber->job, fiber->sliceBegin);
+
+            JobWorker* worker = CurrentJobWorker();
+            worker->action = JobFiberActionFinished;
+            JobFiberSwitch(fiber->context, worker->context);
+        }
+    }
+#if DKGL_JOB_FIBER_WIN32
+    static void WINAPI JobFiberProcWin32(LPVOID p)
+    {
+        JobFiberMain(p);
+    }
+#endif
+#endif
+
+    class JobSystemImpl
+    {
+    public:
+        JobSystemImpl(size_t numWorkers, size_t numFibers, size_t fiberStackSize)
+            : freeFibers(NULL)
+            , terminate(false)
+        {
+            size_t pageSize = DKMemoryPageSize();
+            stackSize = Max(fiberStackSize, pageSize);
+            if (stackSize % pageSize)
+                stackSize += pageSize - (stackSize % pageSize);
+
+#if DKGL_JOB_FIBER_ENABLED
+            cond.Lock();
+            for (size_t i = 0; i < numFibers; ++i)
+            {
+                JobFiber* fiber = CreateFiberNL();
+                if (fiber == NULL)
+                    break;
+                fiber->next = freeFibers;
+                freeFibers = fiber;
+            }
+            cond.Unlock();
+#endif
+            if (numWorkers == 0)
+                numWorkers = Max(DKNumberOfProcessors(), 1U);
+            workers.Reserve(numWorkers);
+            for (size_t i = 0; i < numWorkers; ++i)
+            {
+                DKObject<DKThread> thread = DKThread::Create(DKFunction([this]()
+                {
+                    WorkerProc();
+                })->Invocation());
+                if (thread)
+                    workers.Add(thread);
+            }
+            if (workers.IsEmpty())
+            {
+                DKERROR_THROW_DEBUG("Failed to create worker threads!");
+            }
+        }
+
+        ~JobSystemImpl()
+        {
+            cond.Lock();
+            terminate = true;
+            cond.Broadcast();
+            cond.Unlock();
+
+            for (DKObject<DKThread>& thread : workers)
+                thread->WaitTerminate();
+            workers.Clear();
+
+            size_t numFree = 0;
+            for (JobFiber* f = freeFibers; f; f = f->next)
+                numFree++;
+            if (numFree != fibers.Count())
+            {
+                DKLogE("DKJobSystem: %zu jobs are still suspended!", fibers.Count() - numFree);
+            }
+            for (JobFiber* fiber : fibers)
+            {
+#if DKGL_JOB_FIBER_ASM
+                DKMemoryPageRelease(fiber->stack);
+#elif DKGL_JOB_FIBER_WIN32
+                ::DeleteFiber(fiber->context.fiber);
+#endif
+                delete fiber;
+            }
+            fibers.Clear();
+        }
+
+        void Post(const DKOperation* const* ops, size_t count, DKJobSystem::Counter* counter)
+        {
+            size_t numJobs = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (ops[i])
+                    numJobs++;
+            }
+            if (numJobs == 0)
+                return;
+
+            if (counter)
+                counter->Increment(static_cast<int64_t>(numJobs));
+
+            cond.Lock();
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (ops[i])
+                {
+                    JobEntry job;
+                    job.operation = const_cast<DKOperation*>(ops[i]);
+                    job.counter = counter;
+                    jobs.PushBack(job);
+                }
+            }
+            if (numJobs > 1)
+                cond.Broadcast();
+            else
+                cond.Signal();
+            cond.Unlock();
+        }
+
+        void MakeReady(JobFiber* fiber)
+        {
+            cond.Lock();
+            readyFibers.PushBack(fiber);
+            cond.Signal();
+            cond.Unlock();
+        }
+
+        // run one pending job on current thread, used if fiber is not available.
+        bool RunPendingJob()
+        {
+            JobEntry job;
+            cond.Lock();
+            bool found = jobs.PopFront(job);
+            cond.Unlock();
+            if (found)
+                JobRun(job);
+            return found;
+        }
+
+        size_t NumberOfFibers()
+        {
+            DKCriticalSection<DKCondition> guard(cond);
+            return fibers.Count();
+        }
+
+        DKArray<DKObject<DKThread>> workers;
+
+    private:
+        JobFiber* CreateFiberNL()
+        {
+#if DKGL_JOB_FIBER_ENABLED
+            JobFiber* fiber = new JobFiber();
+            fiber->system = this;
+            fiber->stack = NULL;
+            fiber->next = NULL;
+            fiber->waitTarget = 0;
+            fiber->sliceBegin = 0;
+#if DKGL_JOB_FIBER_ASM
+            // lowest page is guard page, remains reserved. (no access)
+            size_t pageSize = DKMemoryPageSize();
+            size_t size = stackSize + pageSize;
+            uint8_t* stack = reinterpret_cast<uint8_t*>(DKMemoryPageReserve(NULL, size));
+            if (stack == NULL)
+            {
+                DKLogE("DKJobSystem: Failed to reserve fiber stack.");
+                delete fiber;
+                return NULL;
+            }
+            DKMemoryPageCommit(stack + pageSize, stackSize);
+            fiber->stack = stack;
+
+            // initial frame, popped by DKJobFiberSwitchContext.
+            uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + size) & ~uintptr_t(15);
+#if defined(__x86_64__)
+            void** frame = reinterpret_cast<void**>(top - 64);
+            frame[0] = reinterpret_cast<void*>(uintptr_t(0x0000037F00001F80ULL)); // MXCSR, x87 CW
+            frame[1] = NULL;                                        // r15
+            frame[2] = NULL;                                        // r14
+            frame[3] = reinterpret_cast<void*>(&JobFiberMain);      // r13
+            frame[4] = fiber;                                       // r12
+            frame[5] = NULL;                                        // rbx
+            frame[6] = NULL;                                        // rbp
+            frame[7] = reinterpret_cast<void*>(&DKJobFiberEntry);   // return address
+#elif defined(__aarch64__)
+            void** frame = reinterpret_cast<void**>(top - 0xa0);
+            for (int i = 0; i < 20; ++i)
+                frame[i] = NULL;
+            frame[0] = fiber;                                       // x19
+            frame[1] = reinterpret_cast<void*>(&JobFiberMain);      // x20
+            frame[11] = reinterpret_cast<void*>(&DKJobFiberEntry);  // x30 (lr)
+#endif
+            fiber->context.sp = frame;
+#elif DKGL_JOB_FIBER_WIN32
+            fiber->context.fiber = ::CreateFiber(stackSize, &JobFiberProcWin32, fiber);
+            if (fiber->context.fiber == NULL)
+            {
+                DKLogE("DKJobSystem: CreateFiber failed.");
+                delete fiber;
+                return NULL;
+            }
+#endif
+            fibers.Add(fiber);
+            return fiber;
+#else
+            return NULL;
+#endif
+        }
+
+        void WorkerProc()
+        {
+            DKThread::SetCurrentThreadName(L"DKJobWorker");
+
+            JobWorker worker = {};
+            worker.system = this;
+            SetCurrentJobWorker(&worker);
+#if DKGL_JOB_FIBER_WIN32
+            worker.context.fiber = ::ConvertThreadToFiber(NULL);
+#endif
+            cond.Lock();
+            while (true)
+            {
+#if DKGL_JOB_FIBER_ENABLED
+                JobFiber* fiber = NULL;
+                if (readyFibers.PopFront(fiber))
+                {
+                }
+                else if (jobs.Count() > 0)
+                {
+                    fiber = freeFibers;
+                    if (fiber)
+                        freeFibers = fiber->next;
+                    else
+                        fiber = CreateFiberNL();
+
+                    if (fiber)
+                    {
+                        fiber->next = NULL;
+                        jobs.PopFront(fiber->job);
+                    }
+                    else
+                    {
+                        // no fiber available, run job on this thread.
+                        JobEntry job;
+                        jobs.PopFront(job);
+                        cond.Unlock();
+                        JobRun(job);
+                        cond.Lock();
+                        continue;
+                    }
+                }
+                else if (terminate)
+                    break;
+                else
+                {
+                    cond.Wait();
+                    continue;
+                }
+                cond.Unlock();
+                RunFiber(worker, fiber);
+                cond.Lock();
+#else
+                JobEntry job;
+                if (jobs.PopFront(job))
+                {
+                    cond.Unlock();
+                    JobRun(job);
+                    cond.Lock();
+                }
+                else if (terminate)
+                    break;
+                else
+                    cond.Wait();
+#endif
+            }
+            cond.Unlock();
+#if DKGL_JOB_FIBER_WIN32
+            ::ConvertFiberToThread();
+#endif
+            SetCurrentJobWorker(NULL);
+        }
+
+        void RunFiber(JobWorker& worker, JobFiber* fiber)
+        {
+            worker.current = fiber;
+            JobFiberSwitch(worker.context, fiber->context);
+            worker.current = NULL;
+
+            // fiber switched back to worker, we are out of the fiber's stack.
+            switch (worker.action)
+            {
+            case JobFiberActionFinished:
+                cond.Lock();
+                fiber->next = freeFibers;
+                freeFibers = fiber;
+                cond.Unlock();
+                break;
+            case JobFiberActionYield:
+                MakeReady(fiber);
+                break;
+            case JobFiberActionWait:
+            {
+                DKJobSystem::Counter* counter = worker.waitCounter;
+                worker.waitCounter = NULL;
+                counter->lock.Lock();
+                if (counter->value <= worker.waitTarget)
+                {
+                    counter->lock.Unlock();
+                    MakeReady(fiber);
+                }
+                else
+                {
+                    fiber->waitTarget = worker.waitTarget;
+                    fiber->next = counter->waitingFibers;
+                    counter->waitingFibers = fiber;
+                    counter->lock.Unlock();
+                }
+            }
+                break;
+            }
+        }
+
+        DKCondition cond;
+        DKQueue<JobEntry> jobs;
+        DKQueue<JobFiber*> readyFibers;
+        DKArray<JobFiber*> fibers;
+        JobFiber* freeFibers;
+        size_t stackSize;
+        bool terminate;
+    };
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+DKJobSystem::Counter::Counter(int64_t initialValue)
+	: value(initialValue)
+	, numThreadWaiters(0)
+	, waitingFibers(NULL)
+{
+}
+
+DKJobSystem::Counter::~Counter()
+{
+	DKASSERT_DESC_DEBUG(waitingFibers == NULL, "Counter destroyed while jobs are waiting!");
+	DKASSERT_DEBUG(numThreadWaiters == 0);
+}
+
+int64_t DKJobSystem::Counter::Value() const
+{
+	return value;
+}
+
+void DKJobSystem::Counter::Increment(int64_t n)
+{
+	value.Add(n);
+}
+
+void DKJobSystem::Counter::Decrement(int64_t n)
+{
+	// counter can be destroyed by waiter as soon as value is changed,
+	// value is changed with lock held and unlock is the last access.
+	// waiters synchronize with lock before returning. (see Wait)
+	JobFiber* ready = NULL;
+	lock.Lock();
+	const int64_t v = value.Add(-n) - n;
+	const bool wakeThreads = numThreadWaiters > 0;
+	JobFiber** pp = &waitingFibers;
+	while (*pp)
+	{
+		JobFiber* fiber = *pp;
+		if (v <= fiber->waitTarget)
+		{
+			*pp = fiber->next;
+			fiber->next = ready;
+			ready = fiber;
+		}
+		else
+		{
+			pp = &fiber->next;
+		}
+	}
+	lock.Unlock();
+
+	while (ready)
+	{
+		JobFiber* fiber = ready;
+		ready = fiber->next;
+		fiber->next = NULL;
+		fiber->system->MakeReady(fiber);
+	}
+
+	if (wakeThreads)
+	{
+		jobCounterCond.Lock();
+		jobCounterCond.Broadcast();
+		jobCounterCond.Unlock();
+	}
+}
+
+#define JOB_SYSTEM	reinterpret_cast<JobSystemImpl*>(impl)
+
+DKJobSystem::DKJobSystem(size_t numWorkers, size_t numFibers, size_t fiberStackSize)
+	: impl(new JobSystemImpl(numWorkers, numFibers, fiberStackSize))
+{
+}
+
+DKJobSystem::~DKJobSystem()
+{
+	delete JOB_SYSTEM;
+}
+
+DKObject<DKJobSystem::Counter> DKJobSystem::Run(const DKOperation* job)
+{
+	return Run(&job, 1);
+}
+
+DKObject<DKJobSystem::Counter> DKJobSystem::Run(const DKOperation* const* jobs, size_t count)
+{
+	DKObject<Counter> counter = DKOBJECT_NEW Counter();
+	Run(jobs, count, counter);
+	return counter;
+}
+
+void DKJobSystem::Run(const DKOperation* const* jobs, size_t count, Counter* counter)
+{
+	if (jobs && count > 0)
+		JOB_SYSTEM->Post(jobs, count, counter);
+}
+
+void DKJobSystem::Wait(Counter* counter, int64_t target) const
+{
+	if (counter == NULL)
+		return;
+	if (counter->value <= target)
+	{
+		// value could be changed by Decrement() which still holds lock.
+		counter->lock.Lock();
+		counter->lock.Unlock();
+		return;
+	}
+
+	JobWorker* worker = CurrentJobWorker();
+	if (worker)
+	{
+#if DKGL_JOB_FIBER_ENABLED
+		if (worker->current)
+		{
+			// suspend current fiber, worker will register it to counter.
+			JobFiber* fiber = worker->current;
+			JobProfileEnd(fiber->sliceBegin);
+			worker->action = JobFiberActionWait;
+			worker->waitCounter = counter;
+			worker->waitTarget = target;
+			JobFiberSwitch(fiber->context, worker->context);
+			JobProfileBegin(fiber->sliceBegin);
+			return;
+		}
+#endif
+		// no fiber, run other jobs while waiting.
+		while (counter->value > target)
+		{
+			if (!worker->system->RunPendingJob())
+			{
+				counter->numThreadWaiters.Increment();
+				jobCounterCond.Lock();
+				if (counter->value > target)
+					jobCounterCond.WaitTimeout(0.001);
+				jobCounterCond.Unlock();
+				counter->numThreadWaiters.Decrement();
+			}
+		}
+		// wait for Decrement() which changed value to release counter.
+		counter->lock.Lock();
+		counter->lock.Unlock();
+		return;
+	}
+
+	counter->numThreadWaiters.Increment();
+	jobCounterCond.Lock();
+	while (counter->value > target)
+		jobCounterCond.Wait();
+	jobCounterCond.Unlock();
+	counter->numThreadWaiters.Decrement();
+	// wait for Decrement() which changed value to release counter.
+	counter->lock.Lock();
+	counter->lock.Unlock();
+}
+
+void DKJobSystem::Yield() const
+{
+	JobWorker* worker = CurrentJobWorker();
+	if (worker)
+	{
+#if DKGL_JOB_FIBER_ENABLED
+		if (worker->current)
+		{
+			JobFiber* fiber = worker->current;
+			JobProfileEnd(fiber->sliceBegin);
+			worker->action = JobFiberActionYield;
+			JobFiberSwitch(fiber->context, worker->context);
+			JobProfileBegin(fiber->sliceBegin);
+			return;
+		}
+#endif
+		worker->system->RunPendingJob();
+	}
+}
+
+bool DKJobSystem::IsWorkingThread() const
+{
+	JobWorker* worker = CurrentJobWorker();
+	return worker && worker->system == JOB_SYSTEM;
+}
+
+size_t DKJobSystem::NumberOfWorkers() const
+{
+	return JOB_SYSTEM->workers.Count();
+}
+
+size_t DKJobSystem::NumberOfFibers() const
+{
+	return JOB_SYSTEM->NumberOfFibers();
+}
+
+bool DKJobSystem::IsFiberSupported()
+{
+	return DKGL_JOB_FIBER_ENABLED != 0;
+}
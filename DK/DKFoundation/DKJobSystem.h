@@ -0,0 +1,119 @@
+//
+//  File: DKJobSystem.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKOperation.h"
+#include "DKAtomicNumber32.h"
+#include "DKAtomicNumber64.h"
+#include "DKSpinLock.h"
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		struct JobFiber;
+		class JobSystemImpl;
+	}
+
+	/**
+	 @brief
+	 Fiber based job system for fine-grained jobs.
+
+	 Each job runs on a fiber (user-mode context) on worker threads.
+	 A job which waits for a counter (or other jobs) suspends its fiber
+	 instead of blocking worker thread, and the worker thread continues to
+	 run other jobs. The suspended fiber is resumed by a worker thread when
+	 the counter reaches the target value.
+
+	 Fiber stacks are pooled, reserved with DKMemoryPageReserve and protected
+	 by a guard page.
+
+	 @code
+	  DKJobSystem jobs;
+	  DKObject<DKJobSystem::Counter> counter = jobs.Run(DKFunction([&]()
+	  {
+	      DKObject<DKJobSystem::Counter> sub = jobs.Run(subJobs, numSubJobs);
+	      jobs.Wait(sub);   // suspends this job's fiber.
+	  })->Invocation());
+	  jobs.Wait(counter);   // blocks calling thread. (not a worker)
+	 @endcode
+
+	 @note
+	  Fibers are supported on Win32, Linux x86-64 and Linux AArch64.
+	  On other platforms jobs run on worker threads directly, and Wait() inside
+	  a job runs other pending jobs while waiting.
+
+	  A job can be resumed on another worker thread after Wait() or Yield().
+	  Do not hold any lock, or thread-local value across Wait() or Yield().
+	 */
+	class DKGL_API DKJobSystem
+	{
+	public:
+		/// Counter of unfinished jobs.
+		/// Counter is incremented when a job is posted, decremented when
+		/// the job is finished.
+		class DKGL_API Counter
+		{
+		public:
+			Counter(int64_t initialValue = 0);
+			~Counter();
+
+			int64_t Value() const;
+			void Increment(int64_t n = 1);
+			/// decrement counter, resume waiting jobs and threads if needed.
+			void Decrement(int64_t n = 1);
+
+		private:
+			Counter(const Counter&) = delete;
+			Counter& operator = (const Counter&) = delete;
+
+			DKAtomicNumber64 value;
+			DKAtomicNumber32 numThreadWaiters;
+			DKSpinLock lock;
+			Private::JobFiber* waitingFibers;	// guarded by lock
+			friend class DKJobSystem;
+			friend class Private::JobSystemImpl;
+		};
+
+		/// numWorkers: number of worker threads, 0 for number of processors.
+		/// numFibers: number of fibers created initially, pool grows on demand.
+		/// fiberStackSize: stack size of each fiber. (excluding guard page)
+		DKJobSystem(size_t numWorkers = 0, size_t numFibers = 128, size_t fiberStackSize = 0x10000);
+		~DKJobSystem();
+
+		/// post job, returns counter which reaches zero when job is finished.
+		DKObject<Counter> Run(const DKOperation* job);
+		/// post jobs, returns counter which reaches zero when all jobs are finished.
+		DKObject<Counter> Run(const DKOperation* const* jobs, size_t count);
+		/// post jobs with counter, counter is incremented by number of jobs.
+		/// counter must be alive until Wait() for the counter returns.
+		void Run(const DKOperation* const* jobs, size_t count, Counter* counter);
+
+		/// Wait until counter value becomes less than or equal to target.
+		/// Suspends current job's fiber if called from a job of this system,
+		/// otherwise blocks calling thread.
+		void Wait(Counter* counter, int64_t target = 0) const;
+		/// Suspends current job, resumed after other ready jobs.
+		/// No effect if not called from a job.
+		void Yield() const;
+
+		/// determine current thread is running a job of this system.
+		bool IsWorkingThread() const;
+		size_t NumberOfWorkers() const;
+		/// number of fibers in pool. (including running and suspended)
+		size_t NumberOfFibers() const;
+
+		static bool IsFiberSupported();
+
+	private:
+		DKJobSystem(const DKJobSystem&) = delete;
+		DKJobSystem& operator = (const DKJobSystem&) = delete;
+		void* impl;
+	};
+}
@@ -0,0 +1,82 @@
+//
+//  File: DKJsonStreamWriter.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "DKJsonStreamWriter.h"
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+void JsonStreamWriter::Flush()
+{
+	if (used > 0)
+	{
+		total += stream->Write(buffer, used);
+		used = 0;
+	}
+}
+
+void JsonStreamWriter::Write(const char* s, size_t len)
+{
+	while (len > 0)
+	{
+		size_t n = Min(len, size_t(BufferSize) - used);
+		memcpy(&buffer[used], s, n);
+		used += n;
+		s += n;
+		len -= n;
+		if (used == BufferSize)
+			Flush();
+	}
+}
+
+void JsonStreamWriter::Write(const char* s)
+{
+	Write(s, strlen(s));
+}
+
+void JsonStreamWriter::Format(const char* fmt, ...)
+{
+	if (used + MaxToken > BufferSize)
+		Flush();
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(&buffer[used], MaxToken, fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		used += Min(size_t(n), size_t(MaxToken) - 1);
+}
+
+void JsonStreamWriter::WriteString(const char* s)
+{
+	static const char hex[] = "0123456789abcdef";
+	Write("\"", 1);
+	const char* begin = s;
+	for (; *s; ++s)
+	{
+		unsigned char c = static_cast<unsigned char>(*s);
+		if (c < 0x20 || c == '"' || c == '\\')
+		{
+			Write(begin, s - begin);
+			if (c == '"' || c == '\\')
+			{
+				char esc[2] = { '\\', static_cast<char>(c) };
+				Write(esc, 2);
+			}
+			else
+			{
+				char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+				Write(esc, 6);
+			}
+			begin = s + 1;
+		}
+	}
+	Write(begin, s - begin);
+	Write("\"", 1);
+}
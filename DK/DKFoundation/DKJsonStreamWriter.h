@@ -0,0 +1,43 @@
+//
+//  File: DKJsonStreamWriter.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKStream.h"
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		/// buffered JSON text writer, used by DKProfiler and DKMetrics.
+		/// writes tokens to the stream without building a document.
+		struct DKGL_API JsonStreamWriter
+		{
+			enum { BufferSize = 4096, MaxToken = 256 };
+
+			JsonStreamWriter(DKStream* s) : total(0), stream(s), used(0) {}
+			~JsonStreamWriter() { Flush(); }
+
+			/// write buffered text to stream.
+			void Flush();
+			void Write(const char* s, size_t len);
+			void Write(const char* s);
+			/// printf style token, truncated to MaxToken - 1 bytes.
+			void Format(const char* fmt, ...);
+			/// quoted string, escapes '"', '\\' and control characters.
+			void WriteString(const char* s);
+
+			/// bytes written to stream.
+			size_t total;
+
+		private:
+			DKStream* stream;
+			size_t used;
+			char buffer[BufferSize];
+		};
+	}
+}
@@ -0,0 +1,302 @@
+//
+//  File: DKLockProfiler.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKLockProfiler.h"
+#include "DKSpinLock.h"
+#include "DKAtomicNumber64.h"
+#include "DKTimer.h"
+#include "DKMap.h"
+#include "DKFunction.h"
+#include "DKLog.h"
+
+namespace DKFoundation::Private
+{
+    volatile bool lockProfilerEnabled = false;
+
+    // Statistics are stored in lock-free open-addressing table, because
+    // recording can be called from any lock section (including memory pool).
+    // Table is allocated when profiler is enabled first time, never freed.
+    struct LockProfileSlot
+    {
+        DKAtomicNumber64 key;   // address of lock, 0 for empty slot.
+        DKAtomicNumber64 acquisitions;
+        DKAtomicNumber64 contentions;
+        DKAtomicNumber64 waitTicks;
+        DKAtomicNumber64 holdTicks;
+        DKAtomicNumber64 maxWaitTicks;
+        DKAtomicNumber64 maxHoldTicks;
+        DKAtomicNumber64 waitHistogram[DKLockProfiler::NumHistogramBuckets];
+        DKAtomicNumber64 holdHistogram[DKLockProfiler::NumHistogramBuckets];
+
+        void Reset()
+        {
+            acquisitions = 0;
+            contentions = 0;
+            waitTicks = 0;
+            holdTicks = 0;
+            maxWaitTicks = 0;
+            maxHoldTicks = 0;
+            for (DKAtomicNumber64& v : waitHistogram)
+                v = 0;
+            for (DKAtomicNumber64& v : holdHistogram)
+                v = 0;
+        }
+    };
+
+    enum { LockProfileTableSize = 1024 };   // must be power of two
+    static LockProfileSlot* volatile lockProfileTable = NULL;
+    static LockProfileSlot* volatile lockProfileOverflow = NULL; // for locks which exceed table
+    static double lockProfileTickToMicroseconds = 0.0;
+    static double lockProfileTickToSeconds = 0.0;
+
+    static DKSpinLock lockProfilerLock;     // for table allocation, names.
+    // constructed on first use, locks can be named during static initialization.
+    static DKMap<const void*, DKString>& LockProfileNames()
+    {
+        static DKMap<const void*, DKString> names;
+        return names;
+    }
+
+    FORCEINLINE void LockProfileUpdateMax(DKAtomicNumber64& v, int64_t value)
+    {
+        int64_t prev = v;
+        while (value > prev)
+        {
+            if (v.CompareAndSet(prev, value))
+                break;
+            prev = v;
+        }
+    }
+
+    FORCEINLINE uint32_t LockProfileBucket(uint64_t ticks)
+    {
+        uint64_t us = static_cast<uint64_t>(static_cast<double>(ticks) * lockProfileTickToMicroseconds);
+        uint32_t bucket = 0;
+        while (us > 0 && bucket < DKLockProfiler::NumHistogramBuckets - 1)
+        {
+            us = us >> 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    static LockProfileSlot* LockProfileFindSlot(const void* lock, bool create)
+    {
+        LockProfileSlot* table = lockProfileTable;
+        if (table == NULL)
+            return NULL;
+
+        const int64_t key = static_cast<int64_t>(reinterpret_cast<intptr_t>(lock));
+        uint64_t hash = (static_cast<uint64_t>(key) >> 4) * 0x9E3779B97F4A7C15ULL;
+        size_t index = static_cast<size_t>(hash >> 32) & (LockProfileTableSize - 1);
+
+        for (size_t i = 0; i < LockProfileTableSize; ++i)
+        {
+            LockProfileSlot& slot = table[(index + i) & (LockProfileTableSize - 1)];
+            int64_t k = slot.key;
+            if (k == key)
+                return &slot;
+            if (k == 0)
+            {
+                if (!create)
+                    return NULL;
+                if (slot.key.CompareAndSet(0, key))
+                    return &slot;
+                if (slot.key == key)    // claimed by other thread with same lock.
+                    return &slot;
+            }
+        }
+        return create ? lockProfileOverflow : NULL;
+    }
+
+    static void LockProfileFillStatistics(const LockProfileSlot& slot, DKLockProfiler::Statistics& stat)
+    {
+        LockProfileSlot& s = const_cast<LockProfileSlot&>(slot);
+        stat.lock = reinterpret_cast<const void*>(static_cast<intptr_t>(static_cast<int64_t>(s.key)));
+        stat.acquisitions = s.acquisitions;
+        stat.contentions = s.contentions;
+        stat.totalWaitTime = static_cast<double>(s.waitTicks) * lockProfileTickToSeconds;
+        stat.maxWaitTime = static_cast<double>(s.maxWaitTicks) * lockProfileTickToSeconds;
+        stat.totalHoldTime = static_cast<double>(s.holdTicks) * lockProfileTickToSeconds;
+        stat.maxHoldTime = static_cast<double>(s.maxHoldTicks) * lockProfileTickToSeconds;
+        for (int i = 0; i < DKLockProfiler::NumHistogramBuckets; ++i)
+        {
+            stat.waitHistogram[i] = s.waitHistogram[i];
+            stat.holdHistogram[i] = s.holdHistogram[i];
+        }
+    }
+
+    uint64_t LockProfilerTick()
+    {
+        return DKTimer::SystemTick();
+    }
+
+    static thread_local uint64_t lockProfileConditionWaitTicks = 0;
+
+    uint64_t LockProfilerConditionWaitTicks()
+    {
+        return lockProfileConditionWaitTicks;
+    }
+
+    void LockProfilerAddConditionWait(uint64_t ticks)
+    {
+        lockProfileConditionWaitTicks += ticks;
+    }
+
+    void LockProfilerRecord(const void* lock, uint64_t waitTicks, uint64_t holdTicks, bool contended)
+    {
+        LockProfileSlot* slot = LockProfileFindSlot(lock, true);
+        if (slot == NULL)
+            return;
+
+        slot->acquisitions.Increment();
+        if (contended)
+            slot->contentions.Increment();
+        slot->waitTicks.Add(static_cast<int64_t>(waitTicks));
+        slot->holdTicks.Add(static_cast<int64_t>(holdTicks));
+        LockProfileUpdateMax(slot->maxWaitTicks, static_cast<int64_t>(waitTicks));
+        LockProfileUpdateMax(slot->maxHoldTicks, static_cast<int64_t>(holdTicks));
+        slot->waitHistogram[LockProfileBucket(waitTicks)].Increment();
+        slot->holdHistogram[LockProfileBucket(holdTicks)].Increment();
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+void DKLockProfiler::Enable(bool enable)
+{
+    if (enable && lockProfileTable == NULL)
+    {
+        lockProfilerLock.Lock();
+        if (lockProfileTable == NULL)
+        {
+            double freq = static_cast<double>(DKTimer::SystemTickFrequency());
+            lockProfileTickToMicroseconds = 1000000.0 / freq;
+            lockProfileTickToSeconds = 1.0 / freq;
+
+            LockProfileSlot* overflow = new LockProfileSlot();
+            overflow->key = -1;
+            lockProfileOverflow = overflow;
+            lockProfileTable = new LockProfileSlot[LockProfileTableSize];
+        }
+        lockProfilerLock.Unlock();
+    }
+    lockProfilerEnabled = enable;
+}
+
+void DKLockProfiler::SetName(const void* lock, const DKString& name)
+{
+    DKCriticalSection<DKSpinLock> guard(lockProfilerLock);
+    LockProfileNames().Update(lock, name);
+}
+
+void DKLockProfiler::Unregister(const void* lock)
+{
+    DKCriticalSection<DKSpinLock> guard(lockProfilerLock);
+    LockProfileNames().Remove(lock);
+    // slot cannot be removed from open-addressing table, reset statistics only.
+    if (LockProfileSlot* slot = LockProfileFindSlot(lock, false); slot)
+        slot->Reset();
+}
+
+void DKLockProfiler::Reset()
+{
+    LockProfileSlot* table = lockProfileTable;
+    if (table)
+    {
+        for (size_t i = 0; i < LockProfileTableSize; ++i)
+            table[i].Reset();
+        lockProfileOverflow->Reset();
+    }
+}
+
+DKArray<DKLockProfiler::Statistics> DKLockProfiler::QueryStatistics()
+{
+    DKArray<Statistics> result;
+    LockProfileSlot* table = lockProfileTable;
+    if (table)
+    {
+        auto add = [&result](const LockProfileSlot& slot)
+        {
+            if (slot.key != 0 && const_cast<LockProfileSlot&>(slot).acquisitions > 0)
+            {
+                Statistics stat;
+                LockProfileFillStatistics(slot, stat);
+                result.Add(std::move(stat));
+            }
+        };
+        for (size_t i = 0; i < LockProfileTableSize; ++i)
+            add(table[i]);
+        add(*lockProfileOverflow);
+
+        lockProfilerLock.Lock();
+        for (Statistics& stat : result)
+        {
+            if (auto p = LockProfileNames().Find(stat.lock); p)
+                stat.name = p->value;
+            else if (stat.lock == reinterpret_cast<const void*>(intptr_t(-1)))
+                stat.name = L"(others)";
+            else
+                stat.name = DKString::Format("%p", stat.lock);
+        }
+        lockProfilerLock.Unlock();
+
+        result.Sort([](const Statistics& lhs, const Statistics& rhs)
+        {
+            return lhs.totalWaitTime > rhs.totalWaitTime;
+        });
+    }
+    return result;
+}
+
+bool DKLockProfiler::QueryStatistics(const void* lock, Statistics& stat)
+{
+    LockProfileSlot* slot = LockProfileFindSlot(lock, false);
+    if (slot)
+    {
+        LockProfileFillStatistics(*slot, stat);
+        lockProfilerLock.Lock();
+        if (auto p = LockProfileNames().Find(lock); p)
+            stat.name = p->value;
+        else
+            stat.name = DKString::Format("%p", lock);
+        lockProfilerLock.Unlock();
+        return true;
+    }
+    return false;
+}
+
+void DKLockProfiler::Dump(size_t maxEntries)
+{
+    DKArray<Statistics> stats = QueryStatistics();
+    size_t count = stats.Count();
+    if (maxEntries > 0)
+        count = Min(count, maxEntries);
+
+    DKLogI("DKLockProfiler: %zu of %zu locks.", count, stats.Count());
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Statistics& s = stats.Value(i);
+        double contended = s.acquisitions > 0 ? double(s.contentions) / double(s.acquisitions) * 100.0 : 0.0;
+        DKLogI(" [%ls] acquired: %llu, contended: %llu (%.1f%%), wait: %.3fms (max: %.3fms), hold: %.3fms (max: %.3fms)",
+               (const wchar_t*)s.name,
+               (unsigned long long)s.acquisitions,
+               (unsigned long long)s.contentions,
+               contended,
+               s.totalWaitTime * 1000.0, s.maxWaitTime * 1000.0,
+               s.totalHoldTime * 1000.0, s.maxHoldTime * 1000.0);
+    }
+}
+
+DKObject<DKEventLoopTimer> DKLockProfiler::ScheduleDump(double interval, size_t maxEntries, DKEventLoop* eventLoop)
+{
+    return DKEventLoopTimer::Create(DKFunction([maxEntries]()
+    {
+        Dump(maxEntries);
+    })->Invocation(), interval, eventLoop);
+}
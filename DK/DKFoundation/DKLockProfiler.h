@@ -0,0 +1,89 @@
+//
+//  File: DKLockProfiler.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKArray.h"
+#include "DKCriticalSection.h"
+#include "DKEventLoop.h"
+#include "DKEventLoopTimer.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Lock contention profiler. (opt-in)
+
+	 When enabled, every lock section made by DKCriticalSection or
+	 DKSharedLockReadOnlySection records acquisition count, contention count,
+	 wait time and hold time histograms of the lock object.
+	 When disabled, a lock section costs only one flag test.
+
+	 Lock objects are identified by address, you can register a name for
+	 a lock object to recognize it in statistics.
+
+	 @code
+	  DKLockProfiler::SetName(&resourcePool->lock, "DKResourcePool::lock");
+	  DKLockProfiler::Enable(true);
+	  ...
+	  DKLockProfiler::Dump(10);  // print 10 most waited locks.
+	 @endcode
+
+	 @note
+	  Statistics of destroyed lock are not removed. If other lock object
+	  is created at the same address, statistics will be accumulated.
+	  Call Unregister() when the lock object is destroyed to avoid that.
+	 */
+	class DKGL_API DKLockProfiler
+	{
+	public:
+		enum { NumHistogramBuckets = 24 };
+
+		struct Statistics
+		{
+			const void* lock;
+			DKString name;
+			uint64_t acquisitions;
+			uint64_t contentions;		///< number of acquisitions which waited for other thread.
+			double totalWaitTime;		///< in seconds
+			double maxWaitTime;
+			double totalHoldTime;
+			double maxHoldTime;
+			/// bucket[0] is for less than 1 microsecond,
+			/// bucket[n] is for [2^(n-1), 2^n) microseconds,
+			/// the last bucket includes all longer time.
+			uint64_t waitHistogram[NumHistogramBuckets];
+			uint64_t holdHistogram[NumHistogramBuckets];
+		};
+
+		static void Enable(bool enable);
+		static bool IsEnabled() { return Private::lockProfilerEnabled; }
+
+		/// register name of lock object.
+		static void SetName(const void* lock, const DKString& name);
+		/// remove name and statistics of lock object.
+		static void Unregister(const void* lock);
+		/// reset all statistics, registered names are not removed.
+		static void Reset();
+
+		/// query all statistics, sorted by total wait time. (descending)
+		static DKArray<Statistics> QueryStatistics();
+		/// query statistics of a lock object.
+		static bool QueryStatistics(const void* lock, Statistics& stat);
+
+		/// print statistics to log, maxEntries = 0 for all.
+		static void Dump(size_t maxEntries = 0);
+		/// install timer which prints statistics periodically.
+		/// call Invalidate() of returned timer to stop.
+		static DKObject<DKEventLoopTimer> ScheduleDump(double interval, size_t maxEntries = 0, DKEventLoop* eventLoop = NULL);
+
+	private:
+		DKLockProfiler() = delete;
+	};
+}
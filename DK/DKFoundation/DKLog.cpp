@@ -16,10 +16,555 @@
 #include <stdlib.h>
 #include <wchar.h>
 #include <errno.h>
+#include <atomic>
 
 #include "DKLog.h"
 #include "DKString.h"
 #include "DKLogger.h"
+#include "DKArray.h"
+#include "DKMemory.h"
+#include "DKAtomicNumber64.h"
+#include "DKSpinLock.h"
+#include "DKMutex.h"
+#include "DKCondition.h"
+#include "DKCriticalSection.h"
+#include "DKThread.h"
+#include "DKFunction.h"
+
+namespace DKFoundation::Private
+{
+    volatile bool logAsyncEnabled = false;
+
+    enum : uint8_t
+    {
+        LogRecordPadding = 0,   // unused space at the end of ring
+        LogRecordFormat,        // format string and arguments
+        LogRecordText,          // formatted text (wchar_t)
+    };
+
+    // Record in ring buffer, followed by arguments, format string and
+    // strings of arguments. String arguments have offset from record.
+    struct LogRecord
+    {
+        uint32_t size;          // bytes including header, multiple of 8
+        uint8_t kind;
+        uint8_t category;
+        uint16_t numArgs;
+        uint32_t length;        // length of format string or text
+        uint32_t reserved;
+        uint64_t sequence;
+    };
+    static_assert(sizeof(LogRecord) % 8 == 0, "invalid record size");
+
+    enum { LogAwake, LogNapping, LogIdle };
+    constexpr double LogNapInterval = 0.005;
+
+    FORCEINLINE size_t LogAlign(size_t s, size_t a)
+    {
+        return (s + a - 1) & ~(a - 1);
+    }
+
+    // Single producer (owner thread), single consumer ring buffer.
+    // Rings are not removed while pipeline is alive, ring of exited thread
+    // is reused by other thread.
+    struct LogRing
+    {
+        alignas(64) std::atomic<size_t> head;   // written by producer
+        alignas(64) std::atomic<size_t> tail;   // written by consumer
+        uint8_t* buffer;
+        size_t capacity;                        // power of two
+        // lower bound of sequence of the record being written, 0 if none.
+        // records at or after this sequence are held back by consumer.
+        std::atomic<uint64_t> pendingSequence;
+        DKThread::ThreadId owner;
+        LogRing* next;
+
+        size_t readPos;                         // consumer only
+        size_t readEnd;
+
+        LogRing(size_t cap)
+            : head(0), tail(0), capacity(cap), pendingSequence(0), owner(DKThread::invalidId)
+            , next(NULL), readPos(0), readEnd(0)
+        {
+            buffer = reinterpret_cast<uint8_t*>(DKMalloc(cap));
+        }
+        ~LogRing()
+        {
+            DKFree(buffer);
+        }
+        LogRecord* RecordAt(size_t pos) const
+        {
+            return reinterpret_cast<LogRecord*>(buffer + (pos & (capacity - 1)));
+        }
+    };
+
+    class LogPipeline;
+    static LogPipeline* logPipeline = NULL;
+
+    class LogPipeline
+    {
+    public:
+        enum { BatchSize = 64 };
+
+        LogPipeline()
+            : rings(NULL), policy(DKLogOverflowPolicy::Block), ringSize(0x10000)
+            , sleepState(LogAwake), terminate(false)
+        {
+            // construct logger registry before pipeline, pipeline is destroyed first.
+            DKLogger::Broadcast(NULL, NULL, 0);
+        }
+        ~LogPipeline()
+        {
+            logAsyncEnabled = false;
+            Stop();
+            Drain();
+            logPipeline = NULL;
+            while (rings)
+            {
+                LogRing* r = rings;
+                rings = r->next;
+                delete r;
+            }
+        }
+
+        void Start()
+        {
+            if (thread == NULL)
+            {
+                terminate = false;
+                thread = DKThread::Create(DKFunction([this]()
+                {
+                    DKThread::SetCurrentThreadName(L"DKLog");
+                    ThreadProc();
+                })->Invocation());
+            }
+        }
+        void Stop()
+        {
+            if (thread)
+            {
+                cond.Lock();
+                terminate = true;
+                cond.Broadcast();
+                cond.Unlock();
+                thread->WaitTerminate();
+                thread = NULL;
+            }
+        }
+
+        LogRing* ThreadRing();
+        void ReleaseThread(DKThread::ThreadId tid);
+
+        // reserve contiguous space for a record, returns NULL if dropped.
+        uint8_t* Reserve(LogRing* ring, size_t size);
+        // assign sequence of record, consumer does not deliver records
+        // of other threads numbered after this until Commit().
+        uint64_t NextSequence(LogRing* ring)
+        {
+            // sequence starts from 1, previous value is a lower bound.
+            ring->pendingSequence.store((uint64_t)(DKAtomicNumber64::Value)sequence + 1);
+            return (uint64_t)sequence.Increment() + 1;
+        }
+        void Commit(LogRing* ring, size_t size)
+        {
+            ring->head.store(ring->head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+            ring->pendingSequence.store(0, std::memory_order_release);
+            // wake idle consumer, napping consumer is woken only if
+            // ring is filling up. (messages are collected in batches)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int state = sleepState.load(std::memory_order_relaxed);
+            if ((state == LogIdle || (state == LogNapping &&
+                ring->head.load(std::memory_order_relaxed) - ring->tail.load(std::memory_order_relaxed) > ring->capacity / 4)) &&
+                sleepState.compare_exchange_strong(state, LogAwake))
+            {
+                cond.Lock();
+                cond.Signal();
+                cond.Unlock();
+            }
+        }
+
+        // format and deliver queued messages, returns number of messages.
+        size_t Drain();
+        bool HasPendingRecords();
+
+        LogRing* rings;
+        DKSpinLock registryLock;
+        DKMutex drainLock;
+        DKMutex controlLock;
+
+        DKLogOverflowPolicy policy;
+        size_t ringSize;
+        DKAtomicNumber64 sequence;
+        DKAtomicNumber64 dropped;
+
+    private:
+        void ThreadProc();
+
+        DKObject<DKThread> thread;
+        DKCondition cond;
+        std::atomic<int> sleepState;
+        bool terminate;
+
+        // buffers of Drain()
+        DKArray<LogRing*> drainRings;
+        DKArray<DKLogCategory> batchCategories;
+        DKArray<DKString> batchMessages;
+        DKArray<DKStringFormatArgument> arguments;
+    };
+
+    struct LogThreadLocal
+    {
+        LogRing* ring = NULL;
+        bool draining = false;      // thread is consumer, do not block.
+
+        ~LogThreadLocal()
+        {
+            if (ring && logPipeline)
+                logPipeline->ReleaseThread(DKThread::CurrentThreadId());
+            ring = NULL;
+        }
+    };
+    static thread_local LogThreadLocal logThreadLocal;
+
+    LogRing* LogPipeline::ThreadRing()
+    {
+        LogThreadLocal& tl = logThreadLocal;
+        if (tl.ring && tl.ring->capacity == ringSize)
+            return tl.ring;
+
+        DKThread::ThreadId tid = DKThread::CurrentThreadId();
+        LogRing* ring = NULL;
+
+        registryLock.Lock();
+        if (tl.ring)    // buffer size changed, queued messages remain in old ring.
+        {
+            tl.ring->owner = DKThread::invalidId;
+            tl.ring = NULL;
+        }
+        for (LogRing* r = rings; r; r = r->next)
+        {
+            if (r->owner == DKThread::invalidId && r->capacity == ringSize)
+            {
+                ring = r;
+                break;
+            }
+        }
+        if (ring == NULL)
+        {
+            ring = new LogRing(ringSize);
+            if (ring->buffer == NULL)
+            {
+                delete ring;
+                registryLock.Unlock();
+                return NULL;
+            }
+            ring->next = rings;
+            rings = ring;
+        }
+        ring->owner = tid;
+        registryLock.Unlock();
+
+        tl.ring = ring;
+        return ring;
+    }
+
+    void LogPipeline::ReleaseThread(DKThread::ThreadId tid)
+    {
+        registryLock.Lock();
+        for (LogRing* r = rings; r; r = r->next)
+        {
+            if (r->owner == tid)
+            {
+                r->owner = DKThread::invalidId;
+                break;
+            }
+        }
+        registryLock.Unlock();
+    }
+
+    uint8_t* LogPipeline::Reserve(LogRing* ring, size_t size)
+    {
+        const size_t capacity = ring->capacity;
+        const size_t head = ring->head.load(std::memory_order_relaxed);
+        const size_t offset = head & (capacity - 1);
+        const size_t contiguous = capacity - offset;
+        const size_t required = contiguous < size ? contiguous + size : size;
+
+        while (head + required - ring->tail.load(std::memory_order_acquire) > capacity)
+        {
+            if (policy == DKLogOverflowPolicy::Drop || logThreadLocal.draining)
+            {
+                dropped.Increment();
+                return NULL;
+            }
+            // make room on calling thread, waits if background thread is
+            // draining messages.
+            Drain();
+        }
+        if (contiguous < size)
+        {
+            // fill end of ring with padding, record starts from beginning.
+            LogRecord* padding = ring->RecordAt(head);
+            padding->size = (uint32_t)contiguous;
+            padding->kind = LogRecordPadding;
+            ring->head.store(head + contiguous, std::memory_order_release);
+            return ring->buffer;
+        }
+        return ring->buffer + offset;
+    }
+
+    bool LogPipeline::HasPendingRecords()
+    {
+        bool pending = false;
+        registryLock.Lock();
+        for (LogRing* r = rings; r && !pending; r = r->next)
+            pending = r->head.load() != r->tail.load(std::memory_order_relaxed);
+        registryLock.Unlock();
+        return pending;
+    }
+
+    size_t LogPipeline::Drain()
+    {
+        DKCriticalSection<DKMutex> guard(drainLock);
+        LogThreadLocal& tl = logThreadLocal;
+        const bool draining = tl.draining;
+        tl.draining = true;
+
+        drainRings.Clear();
+        uint64_t pendingSequence = ~uint64_t(0);
+        registryLock.Lock();
+        for (LogRing* r = rings; r; r = r->next)
+        {
+            r->readPos = r->tail.load(std::memory_order_relaxed);
+            r->readEnd = r->head.load(std::memory_order_acquire);
+            if (r->readPos != r->readEnd)
+                drainRings.Add(r);
+        }
+        // records numbered after the oldest record not committed yet
+        // are delivered next time, to keep order across threads.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (LogRing* r = rings; r; r = r->next)
+        {
+            uint64_t seq = r->pendingSequence.load();
+            if (seq && seq < pendingSequence)
+                pendingSequence = seq;
+        }
+        registryLock.Unlock();
+
+        auto deliver = [this]()
+        {
+            for (LogRing* r : drainRings)
+                r->tail.store(r->readPos, std::memory_order_release);
+            size_t count = batchMessages.Count();
+            if (count > 0)
+            {
+                if (DKLogger::Broadcast(batchCategories, batchMessages, count) == 0)
+                {
+                    for (const DKString& str : batchMessages)
+                        fprintf(stderr, "%ls", (const wchar_t*)str);
+                }
+                batchCategories.Clear();
+                batchMessages.Clear();
+            }
+        };
+
+        size_t total = 0;
+        while (true)
+        {
+            // pick the oldest record of all threads.
+            LogRing* ring = NULL;
+            LogRecord* record = NULL;
+            for (LogRing* r : drainRings)
+            {
+                while (r->readPos != r->readEnd)
+                {
+                    LogRecord* rec = r->RecordAt(r->readPos);
+                    if (rec->kind != LogRecordPadding)
+                    {
+                        if (record == NULL || rec->sequence < record->sequence)
+                        {
+                            ring = r;
+                            record = rec;
+                        }
+                        break;
+                    }
+                    r->readPos += rec->size;
+                }
+            }
+            if (record == NULL || record->sequence >= pendingSequence)
+                break;
+
+            DKString message;
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(record + 1);
+            if (record->kind == LogRecordFormat)
+            {
+                const DKStringFormatArgument* args = reinterpret_cast<const DKStringFormatArgument*>(data);
+                arguments.Clear();
+                arguments.Add(args, record->numArgs);
+                for (DKStringFormatArgument& a : arguments)
+                {
+                    if (a.type == DKStringFormatArgument::TypeString8 || a.type == DKStringFormatArgument::TypeStringW)
+                        a.p = reinterpret_cast<const uint8_t*>(record) + a.u;
+                }
+                const char* fmt = reinterpret_cast<const char*>(args + record->numArgs);
+                DKStringFormatArgs(message, fmt, arguments, arguments.Count());
+            }
+            else
+            {
+                message.SetValue(reinterpret_cast<const wchar_t*>(data), record->length);
+            }
+            batchCategories.Add((DKLogCategory)record->category);
+            batchMessages.Add(std::move(message));
+            ring->readPos += record->size;
+            total++;
+
+            if (batchMessages.Count() >= BatchSize)
+                deliver();
+        }
+        deliver();
+        tl.draining = draining;
+        return total;
+    }
+
+    void LogPipeline::ThreadProc()
+    {
+        cond.Lock();
+        while (!terminate)
+        {
+            cond.Unlock();
+            size_t n = Drain();
+            cond.Lock();
+            if (!terminate)
+            {
+                // take a nap after delivering messages, sleep until
+                // next message if there was nothing to deliver.
+                int state = n > 0 ? LogNapping : LogIdle;
+                sleepState.store(state);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (state == LogNapping)
+                    cond.WaitTimeout(LogNapInterval);
+                else if (!HasPendingRecords())
+                    cond.WaitTimeout(1.0);
+                sleepState.store(LogAwake);
+            }
+        }
+        cond.Unlock();
+    }
+
+    static LogPipeline& GetLogPipeline()
+    {
+        static LogPipeline pipeline;
+        logPipeline = &pipeline;
+        return pipeline;
+    }
+
+    static bool LogText(DKLogCategory c, const DKString& str)
+    {
+        LogPipeline* pipeline = logPipeline;
+        LogRing* ring = pipeline->ThreadRing();
+        if (ring == NULL)
+            return false;
+
+        const size_t length = str.Length();
+        const size_t size = LogAlign(sizeof(LogRecord) + length * sizeof(wchar_t), 8);
+        if (size > ring->capacity / 2)
+            return false;
+
+        uint8_t* p = pipeline->Reserve(ring, size);
+        if (p)
+        {
+            LogRecord* record = reinterpret_cast<LogRecord*>(p);
+            record->size = (uint32_t)size;
+            record->kind = LogRecordText;
+            record->category = (uint8_t)c;
+            record->numArgs = 0;
+            record->length = (uint32_t)length;
+            record->sequence = pipeline->NextSequence(ring);
+            memcpy(record + 1, (const wchar_t*)str, length * sizeof(wchar_t));
+            pipeline->Commit(ring, size);
+        }
+        return true;
+    }
+
+    DKGL_API bool LogDeferred(DKLogCategory c, const char* fmt, const DKStringFormatArgument* args, size_t count)
+    {
+#ifndef DKGL_DEBUG_ENABLED
+        if (c == DKLogCategory::Debug) return true;
+#endif
+        LogPipeline* pipeline = logPipeline;
+        if (pipeline == NULL || fmt == NULL || count > 0xffff)
+            return false;
+
+        // record size: header, arguments, format string, strings.
+        const size_t fmtLength = strlen(fmt);
+        size_t size = sizeof(LogRecord) + sizeof(DKStringFormatArgument) * count + fmtLength + 1;
+        for (size_t i = 0; i < count; ++i)
+        {
+            switch (args[i].type)
+            {
+            case DKStringFormatArgument::TypeNone:
+                return false;
+            case DKStringFormatArgument::TypeString8:
+                if (args[i].s8)
+                    size += strlen(args[i].s8) + 1;
+                break;
+            case DKStringFormatArgument::TypeStringW:
+                if (args[i].sw)
+                    size = LogAlign(size, alignof(wchar_t)) + (wcslen(args[i].sw) + 1) * sizeof(wchar_t);
+                break;
+            default:
+                break;
+            }
+        }
+        size = LogAlign(size, 8);
+
+        LogRing* ring = pipeline->ThreadRing();
+        if (ring == NULL || size > ring->capacity / 2)
+            return false;
+
+        uint8_t* p = pipeline->Reserve(ring, size);
+        if (p)
+        {
+            LogRecord* record = reinterpret_cast<LogRecord*>(p);
+            record->size = (uint32_t)size;
+            record->kind = LogRecordFormat;
+            record->category = (uint8_t)c;
+            record->numArgs = (uint16_t)count;
+            record->length = (uint32_t)fmtLength;
+
+            DKStringFormatArgument* stored = reinterpret_cast<DKStringFormatArgument*>(record + 1);
+            char* fmtCopy = reinterpret_cast<char*>(stored + count);
+            memcpy(fmtCopy, fmt, fmtLength + 1);
+            size_t offset = reinterpret_cast<uint8_t*>(fmtCopy) - p + fmtLength + 1;
+            for (size_t i = 0; i < count; ++i)
+            {
+                stored[i] = args[i];
+                if (args[i].type == DKStringFormatArgument::TypeString8 && args[i].s8)
+                {
+                    size_t len = strlen(args[i].s8) + 1;
+                    memcpy(p + offset, args[i].s8, len);
+                    stored[i].u = offset;
+                    offset += len;
+                }
+                else if (args[i].type == DKStringFormatArgument::TypeStringW && args[i].sw)
+                {
+                    offset = LogAlign(offset, alignof(wchar_t));
+                    size_t len = (wcslen(args[i].sw) + 1) * sizeof(wchar_t);
+                    memcpy(p + offset, args[i].sw, len);
+                    stored[i].u = offset;
+                    offset += len;
+                }
+                else if (args[i].type == DKStringFormatArgument::TypeString8 || args[i].type == DKStringFormatArgument::TypeStringW)
+                {
+                    stored[i].type = DKStringFormatArgument::TypePointer;   // NULL string
+                }
+            }
+            record->sequence = pipeline->NextSequence(ring);
+            pipeline->Commit(ring, size);
+        }
+        return true;
+    }
+}
 
 namespace DKFoundation
 {
@@ -28,6 +573,8 @@ namespace DKFoundation
 #ifndef DKGL_DEBUG_ENABLED
 		if (c == DKLogCategory::Debug) return;
 #endif
+		if (Private::logAsyncEnabled && Private::LogText(c, str))
+			return;
 		if (!DKLogger::Broadcast(c, str))
 			fprintf(stderr, "%ls", (const wchar_t*)str);
 	}
@@ -41,4 +588,51 @@ namespace DKFoundation
 		DKLog(c, DKString::FormatV(fmt, ap));
 		va_end(ap);
 	}
+
+	DKGL_API void DKLogSetAsync(bool enable, DKLogOverflowPolicy policy, size_t bufferSize)
+	{
+		Private::LogPipeline& pipeline = Private::GetLogPipeline();
+		DKCriticalSection<DKMutex> guard(pipeline.controlLock);
+
+		size_t ringSize = 0x1000;
+		while (ringSize < bufferSize && ringSize < 0x4000000)
+			ringSize <<= 1;
+
+		pipeline.registryLock.Lock();
+		pipeline.policy = policy;
+		pipeline.ringSize = ringSize;
+		pipeline.registryLock.Unlock();
+
+		if (enable)
+		{
+			pipeline.Start();
+			Private::logAsyncEnabled = true;
+		}
+		else
+		{
+			Private::logAsyncEnabled = false;
+			pipeline.Stop();
+			pipeline.Drain();
+		}
+	}
+
+	DKGL_API bool DKLogIsAsync()
+	{
+		return Private::logAsyncEnabled;
+	}
+
+	DKGL_API void DKLogFlush()
+	{
+		if (Private::logPipeline)
+		{
+			while (Private::logPipeline->Drain() > 0) {}
+		}
+	}
+
+	DKGL_API uint64_t DKLogDroppedCount()
+	{
+		if (Private::logPipeline)
+			return (uint64_t)Private::logPipeline->dropped;
+		return 0;
+	}
 }
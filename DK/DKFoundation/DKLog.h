@@ -13,9 +13,42 @@ namespace DKFoundation
 {
 	enum class DKLogCategory { Verbose = 'V', Info = 'I', Debug = 'D', Warning = 'W', Error = 'E' };
 
+	enum class DKLogOverflowPolicy
+	{
+		Drop,		///< discard message if buffer of thread is full.
+		Block,		///< wait until background thread makes room.
+	};
+
 	DKGL_API void DKLog(DKLogCategory, const DKString& str);
 	DKGL_API void DKLog(DKLogCategory, const char* fmt, ...);
 
+	/**
+	 Asynchronous logging mode.
+	 Messages are written to lock-free ring buffer of calling thread with
+	 format string and arguments, a background thread formats messages and
+	 delivers them to DKLogger in batches, in order of logging.
+	 Arguments of DKLog templates (DKLogE, DKLogW...) are stored by value,
+	 strings (char*, wchar_t*) are copied. Messages with other types of
+	 arguments and messages too long for buffer are formatted on calling
+	 thread and delivered synchronously.
+	 DKLogger::Log() is usually called on background thread in this mode,
+	 but with DKLogOverflowPolicy::Block, a thread whose buffer is full
+	 delivers queued messages by itself, calling DKLogger::Log() on that
+	 thread. DKLogFlush() also delivers on calling thread.
+	 */
+	DKGL_API void DKLogSetAsync(bool enable, DKLogOverflowPolicy policy = DKLogOverflowPolicy::Block, size_t bufferSize = 0x10000);
+	DKGL_API bool DKLogIsAsync();
+	/// deliver queued messages on calling thread, for shutdown or crash handler.
+	DKGL_API void DKLogFlush();
+	/// number of messages discarded by DKLogOverflowPolicy::Drop
+	DKGL_API uint64_t DKLogDroppedCount();
+
+	namespace Private
+	{
+		extern DKGL_API volatile bool logAsyncEnabled;
+		DKGL_API bool LogDeferred(DKLogCategory, const char* fmt, const DKStringFormatArgument* args, size_t count);
+	}
+
 	template <DKLogCategory category = DKLogCategory::Verbose>
 	inline void DKLog(const DKString& str)
 	{
@@ -24,6 +57,12 @@ namespace DKFoundation
 	template <DKLogCategory category = DKLogCategory::Verbose, typename... Args> 
 	inline void DKLog(const char* fmt, Args&&... args)
 	{
+		if (Private::logAsyncEnabled)
+		{
+			const DKStringFormatArgument arguments[] = { DKStringFormatArgument(args)..., DKStringFormatArgument() };
+			if (Private::LogDeferred(category, fmt, arguments, sizeof...(Args)))
+				return;
+		}
 		DKLog(category, fmt, std::forward<Args>(args)...);
 	}
 
@@ -99,6 +99,19 @@ size_t DKLogger::Broadcast(Category c, const DKString& str)
 	return num;
 }
 
+size_t DKLogger::Broadcast(const Category* c, const DKString* str, size_t count)
+{
+	DKCriticalSection<DKSpinLock> guard(LoggerLock());
+	DKArray<DKObject<DKLogger>>& loggers = LoggerArray();
+	for (size_t i = 0; i < loggers.Count(); ++i)
+	{
+		DKLogger* logger = loggers.Value(i);
+		for (size_t k = 0; k < count; ++k)
+			logger->Log(c[k], str[k]);
+	}
+	return loggers.Count();
+}
+
 DKObject<DKLogger> DKLogger::CreateSimpleLogger(void (*fn)(Category, const DKString&))
 {
 	struct Logger : public DKLogger
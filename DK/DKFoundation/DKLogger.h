@@ -32,6 +32,8 @@ namespace DKFoundation
 		bool IsBound() const;
 
 		static size_t Broadcast(Category, const DKString&);
+		/// broadcast messages with one lock, returns number of loggers.
+		static size_t Broadcast(const Category*, const DKString*, size_t count);
 
 		static DKObject<DKLogger> CreateSimpleLogger(void(*)(Category, const DKString&));
 	protected:
@@ -30,6 +30,7 @@
 #include "DKMemory.h"
 #include "DKSpinLock.h"
 #include "DKCriticalSection.h"
+#include "DKLockProfiler.h"
 #include "DKLog.h"
 #include "DKString.h"
 #include "DKUtils.h"
@@ -233,6 +234,10 @@ namespace DKFoundation
 				if (indexAddrsCapacity > 0)
 					SystemHeapAllocator::Free(indexAddrs);
 			}
+			const void* LockObject() const
+			{
+				return &lock;
+			}
 		private:
 			FORCEINLINE size_t FindAddress(uintptr_t addr)
 			{
@@ -303,6 +308,7 @@ namespace DKFoundation
 
 			virtual size_t NumberOfAllocatedUnits() const = 0;
 			virtual size_t NumberOfUnits() const = 0;
+			virtual const void* LockObject() const = 0;
 		};
 
 		struct AllocatorUnit
@@ -346,6 +352,7 @@ namespace DKFoundation
 
 				size_t NumberOfAllocatedUnits() const override	{ return allocator.NumberOfAllocatedUnits(); }
 				size_t NumberOfUnits() const override			{ return allocator.NumberOfUnits(); }
+				const void* LockObject() const override			{ return &allocator.LockObject(); }
 
 				using Allocator = DKFixedSizeAllocator<UnitSize, Alignment, NumUnits, DKSpinLock, SystemHeapAllocator, UnitAllocator>;
 				Allocator allocator;
@@ -418,6 +425,16 @@ namespace DKFoundation
 #endif
 				maxUnitSize = allocators[NumAllocators-1].unitSize;
 			}
+			// names are allocated from this pool, call after pool is published.
+			void RegisterLockNames()
+			{
+				DKLockProfiler::SetName(backend->LockObject(), "DKMemoryPool::backend");
+				for (int i = 0; i < NumAllocators; ++i)
+				{
+					DKLockProfiler::SetName(allocators[i].allocator->LockObject(),
+											DKString::Format("DKMemoryPool::unit(%lu)", (unsigned long)allocators[i].unitSize));
+				}
+			}
 
 			~AllocatorPool()
 			{
@@ -630,14 +647,20 @@ namespace DKFoundation
 			static AllocatorPool* pool = NULL;
 			if (pool == NULL)
 			{
-				lock.Lock();
-				if (pool == NULL)
+				bool created = false;
+				if (true)
 				{
-					// It will be destroyed automatically.
-					// see DKAllocatorChain.cpp
-					pool = new AllocatorPool();
+					DKCriticalSection<DKSpinLock> guard(lock);
+					if (pool == NULL)
+					{
+						// It will be destroyed automatically.
+						// see DKAllocatorChain.cpp
+						pool = new AllocatorPool();
+						created = true;
+					}
 				}
-				lock.Unlock();
+				if (created)
+					pool->RegisterLockNames();
 			}
 			return pool;
 		}
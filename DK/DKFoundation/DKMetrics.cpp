@@ -0,0 +1,593 @@
+//
+//  File: DKMetrics.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "DKMetrics.h"
+#include "DKSpinLock.h"
+#include "DKThread.h"
+#include "DKMemory.h"
+#include "DKBuffer.h"
+#include "DKBufferStream.h"
+#include "DKStringU8.h"
+#include "DKJsonStreamWriter.h"
+#include "DKLog.h"
+
+namespace DKFoundation::Private
+{
+    enum
+    {
+        MetricsPageBits = 10,
+        MetricsPageSize = 1 << MetricsPageBits,     // slots per page
+        MetricsMaxPages = 256,
+        MetricsMaxSlots = MetricsPageSize * MetricsMaxPages,
+
+        // HDR-style buckets: values under 16 have own bucket, each power
+        // of two range above is divided into 16 linear sub-buckets.
+        MetricsSubBucketBits = 4,
+        MetricsSubBuckets = 1 << MetricsSubBucketBits,
+        MetricsMaxExponent = 44,
+        MetricsBuckets = (MetricsMaxExponent - MetricsSubBucketBits + 1) * MetricsSubBuckets,
+
+        // histogram slots: sum, ~min, max, buckets
+        // (number of records is sum of buckets)
+        MetricsHistogramSum = 0,
+        MetricsHistogramMin,
+        MetricsHistogramMax,
+        MetricsHistogramBuckets,
+        MetricsHistogramSlots = MetricsHistogramBuckets + MetricsBuckets,
+    };
+
+    using MetricsSlot = std::atomic<uint64_t>;
+
+    struct MetricsEntry
+    {
+        MetricsEntry* next;
+        char* name;                 // UTF-8, allocated from heap.
+        DKMetrics::Type type;
+        uint32_t slot;
+        void* object;               // Counter, Gauge or Histogram
+        std::atomic<int64_t> base;  // value of Gauge::Set
+    };
+
+    // Slots of one thread, written by owner thread only. Pages are never
+    // deallocated, shard of terminated thread is merged and reused.
+    struct MetricsShard
+    {
+        DKThread::ThreadId owner;
+        std::atomic<MetricsSlot*> pages[MetricsMaxPages];
+        MetricsShard* next;
+    };
+
+    static DKSpinLock metricsLock;
+    static MetricsEntry* metricsEntries = NULL;
+    static MetricsShard* metricsShards = NULL;
+    static MetricsShard* metricsRetired = NULL;     // merged values of terminated threads.
+    static uint32_t metricsNumSlots = 0;
+
+    static MetricsShard* MetricsNewShard()
+    {
+        MetricsShard* shard = new MetricsShard();
+        shard->owner = DKThread::invalidId;
+        for (auto& p : shard->pages)
+            p.store(NULL, std::memory_order_relaxed);
+        shard->next = NULL;
+        return shard;
+    }
+
+    static MetricsSlot* MetricsAllocPage(MetricsShard* shard, uint32_t index)
+    {
+        MetricsSlot* page = reinterpret_cast<MetricsSlot*>(DKMemoryHeapAlloc(sizeof(MetricsSlot) * MetricsPageSize));
+        if (page == NULL)
+            DKERROR_THROW("Out of memory!");
+        for (uint32_t i = 0; i < MetricsPageSize; ++i)
+            new(&page[i]) MetricsSlot(0);
+        shard->pages[index].store(page, std::memory_order_release);
+        return page;
+    }
+
+    // slot of shard for reading, returns NULL if page is not allocated.
+    FORCEINLINE MetricsSlot* MetricsFindSlot(MetricsShard* shard, uint32_t slot)
+    {
+        MetricsSlot* page = shard->pages[slot >> MetricsPageBits].load(std::memory_order_acquire);
+        return page ? &page[slot & (MetricsPageSize - 1)] : NULL;
+    }
+
+    FORCEINLINE uint64_t MetricsLoad(MetricsShard* shard, uint32_t slot)
+    {
+        MetricsSlot* s = MetricsFindSlot(shard, slot);
+        return s ? s->load(std::memory_order_relaxed) : 0;
+    }
+
+    static void MetricsReleaseShard(MetricsShard* shard);
+
+    struct MetricsThreadLocal
+    {
+        MetricsShard* shard = NULL;
+
+        ~MetricsThreadLocal()
+        {
+            if (shard)
+                MetricsReleaseShard(shard);
+            shard = NULL;
+        }
+    };
+    static thread_local MetricsThreadLocal metricsThreadLocal;
+
+    static MetricsShard* MetricsAcquireShard()
+    {
+        MetricsShard* shard = NULL;
+        metricsLock.Lock();
+        for (MetricsShard* s = metricsShards; s; s = s->next)
+        {
+            if (s->owner == DKThread::invalidId)
+            {
+                shard = s;
+                break;
+            }
+        }
+        if (shard == NULL)
+        {
+            shard = MetricsNewShard();
+            shard->next = metricsShards;
+            metricsShards = shard;
+        }
+        shard->owner = DKThread::CurrentThreadId();
+        metricsLock.Unlock();
+        metricsThreadLocal.shard = shard;
+        return shard;
+    }
+
+    // slot of calling thread for writing.
+    FORCEINLINE MetricsSlot& MetricsThreadSlot(uint32_t slot)
+    {
+        MetricsShard* shard = metricsThreadLocal.shard;
+        if (shard == NULL)
+            shard = MetricsAcquireShard();
+        uint32_t index = slot >> MetricsPageBits;
+        MetricsSlot* page = shard->pages[index].load(std::memory_order_relaxed);
+        if (page == NULL)
+            page = MetricsAllocPage(shard, index);
+        return page[slot & (MetricsPageSize - 1)];
+    }
+
+    // single writer, no read-modify-write instruction required.
+    FORCEINLINE void MetricsAdd(MetricsSlot& s, uint64_t n)
+    {
+        s.store(s.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    FORCEINLINE void MetricsMax(MetricsSlot& s, uint64_t n)
+    {
+        if (n > s.load(std::memory_order_relaxed))
+            s.store(n, std::memory_order_relaxed);
+    }
+
+    FORCEINLINE uint32_t MetricsBucketIndex(uint64_t ns)
+    {
+        if (ns < MetricsSubBuckets)
+            return static_cast<uint32_t>(ns);
+        ns = Min(ns, (uint64_t(1) << MetricsMaxExponent) - 1);
+#ifdef _MSC_VER
+        unsigned long msb;
+        _BitScanReverse64(&msb, ns);
+        uint32_t e = msb;
+#else
+        uint32_t e = 63 - __builtin_clzll(ns);
+#endif
+        uint32_t sub = static_cast<uint32_t>(ns >> (e - MetricsSubBucketBits)) & (MetricsSubBuckets - 1);
+        return (e - MetricsSubBucketBits + 1) * MetricsSubBuckets + sub;
+    }
+
+    // middle value of bucket range in nanoseconds.
+    static double MetricsBucketValue(uint32_t index)
+    {
+        if (index < MetricsSubBuckets)
+            return static_cast<double>(index);
+        uint32_t e = index / MetricsSubBuckets + MetricsSubBucketBits - 1;
+        uint32_t sub = index % MetricsSubBuckets;
+        uint64_t width = uint64_t(1) << (e - MetricsSubBucketBits);
+        uint64_t lower = (uint64_t(MetricsSubBuckets) + sub) << (e - MetricsSubBucketBits);
+        return static_cast<double>(lower) + static_cast<double>(width - 1) * 0.5;
+    }
+
+    static uint32_t MetricsNumSlots(DKMetrics::Type type)
+    {
+        return type == DKMetrics::TypeHistogram ? MetricsHistogramSlots : 1;
+    }
+
+    // merge shard to retired values, caller must hold metricsLock.
+    static void MetricsMergeShard(MetricsShard* shard, MetricsShard* target)
+    {
+        for (MetricsEntry* e = metricsEntries; e; e = e->next)
+        {
+            uint32_t numSlots = MetricsNumSlots(e->type);
+            for (uint32_t i = 0; i < numSlots; ++i)
+            {
+                MetricsSlot* src = MetricsFindSlot(shard, e->slot + i);
+                if (src == NULL)
+                    continue;
+                uint64_t value = src->load(std::memory_order_relaxed);
+                if (value == 0)
+                    continue;
+                src->store(0, std::memory_order_relaxed);
+
+                uint32_t slot = e->slot + i;
+                MetricsSlot* dst = MetricsFindSlot(target, slot);
+                if (dst == NULL)
+                    dst = &MetricsAllocPage(target, slot >> MetricsPageBits)[slot & (MetricsPageSize - 1)];
+                if (e->type == DKMetrics::TypeHistogram && (i == MetricsHistogramMin || i == MetricsHistogramMax))
+                    MetricsMax(*dst, value);
+                else
+                    MetricsAdd(*dst, value);
+            }
+        }
+    }
+
+    void MetricsReleaseShard(MetricsShard* shard)
+    {
+        metricsLock.Lock();
+        if (metricsRetired == NULL)
+            metricsRetired = MetricsNewShard();
+        MetricsMergeShard(shard, metricsRetired);
+        shard->owner = DKThread::invalidId;
+        metricsLock.Unlock();
+    }
+
+    static MetricsEntry* MetricsFindEntry(const char* name)
+    {
+        for (MetricsEntry* e = metricsEntries; e; e = e->next)
+        {
+            if (strcmp(e->name, name) == 0)
+                return e;
+        }
+        return NULL;
+    }
+
+    // caller must hold metricsLock.
+    static MetricsEntry* MetricsRegister(const char* name, DKMetrics::Type type)
+    {
+        if (name == NULL || name[0] == 0)
+            return NULL;
+        if (MetricsEntry* e = MetricsFindEntry(name); e)
+        {
+            if (e->type == type)
+                return e;
+            DKLogE("DKMetrics: \"%s\" is registered as other type.\n", name);
+            return NULL;
+        }
+        // slots of a metric should not span pages.
+        uint32_t numSlots = MetricsNumSlots(type);
+        uint32_t slot = metricsNumSlots;
+        if ((slot & (MetricsPageSize - 1)) + numSlots > MetricsPageSize)
+            slot = (slot + MetricsPageSize - 1) & ~uint32_t(MetricsPageSize - 1);
+        if (slot + numSlots > MetricsMaxSlots)
+        {
+            DKLogE("DKMetrics: Too many metrics, \"%s\" cannot be registered.\n", name);
+            return NULL;
+        }
+        size_t len = strlen(name);
+        char* str = reinterpret_cast<char*>(DKMemoryHeapAlloc(len + 1));
+        memcpy(str, name, len + 1);
+
+        MetricsEntry* e = new MetricsEntry();
+        e->name = str;
+        e->type = type;
+        e->slot = slot;
+        e->object = NULL;
+        e->base.store(0, std::memory_order_relaxed);
+        metricsNumSlots = slot + numSlots;
+
+        // keep list sorted by name.
+        MetricsEntry** p = &metricsEntries;
+        while (*p && strcmp((*p)->name, name) < 0)
+            p = &(*p)->next;
+        e->next = *p;
+        *p = e;
+        return e;
+    }
+
+    // sum of all shards, caller must hold metricsLock.
+    static uint64_t MetricsSum(uint32_t slot)
+    {
+        uint64_t value = metricsRetired ? MetricsLoad(metricsRetired, slot) : 0;
+        for (MetricsShard* s = metricsShards; s; s = s->next)
+            value += MetricsLoad(s, slot);
+        return value;
+    }
+
+    static uint64_t MetricsMaxOf(uint32_t slot)
+    {
+        uint64_t value = metricsRetired ? MetricsLoad(metricsRetired, slot) : 0;
+        for (MetricsShard* s = metricsShards; s; s = s->next)
+            value = Max(value, MetricsLoad(s, slot));
+        return value;
+    }
+
+    // caller must hold metricsLock.
+    static void MetricsFillStatistics(const MetricsEntry* e, DKMetrics::Statistics& stat)
+    {
+        stat.name = DKString(e->name);
+        stat.type = e->type;
+        stat.value = 0;
+        stat.count = 0;
+        stat.sum = stat.min = stat.max = stat.mean = 0.0;
+        stat.p50 = stat.p90 = stat.p99 = stat.p999 = 0.0;
+
+        switch (e->type)
+        {
+        case DKMetrics::TypeCounter:
+            stat.value = static_cast<int64_t>(MetricsSum(e->slot));
+            break;
+        case DKMetrics::TypeGauge:
+            stat.value = e->base.load(std::memory_order_relaxed) + static_cast<int64_t>(MetricsSum(e->slot));
+            break;
+        case DKMetrics::TypeHistogram:
+            {
+                uint64_t buckets[MetricsBuckets];
+                uint64_t count = 0;
+                for (uint32_t i = 0; i < MetricsBuckets; ++i)
+                {
+                    buckets[i] = MetricsSum(e->slot + MetricsHistogramBuckets + i);
+                    count += buckets[i];
+                }
+                if (count == 0)
+                    break;
+                const double ns = 1.0 / 1000000000.0;
+                double minValue = static_cast<double>(~MetricsMaxOf(e->slot + MetricsHistogramMin));
+                double maxValue = static_cast<double>(MetricsMaxOf(e->slot + MetricsHistogramMax));
+                stat.count = count;
+                stat.sum = static_cast<double>(MetricsSum(e->slot + MetricsHistogramSum)) * ns;
+                stat.min = minValue * ns;
+                stat.max = maxValue * ns;
+                stat.mean = stat.sum / static_cast<double>(count);
+
+                // counts of buckets are read while other threads recording,
+                // use sum of buckets as total count to be consistent.
+                auto percentile = [&](double p)
+                {
+                    uint64_t rank = static_cast<uint64_t>(ceil(p * static_cast<double>(count)));
+                    rank = Clamp(rank, uint64_t(1), count);
+                    uint64_t n = 0;
+                    for (uint32_t i = 0; i < MetricsBuckets; ++i)
+                    {
+                        n += buckets[i];
+                        if (n >= rank)
+                            return Clamp(MetricsBucketValue(i), minValue, maxValue) * ns;
+                    }
+                    return maxValue * ns;
+                };
+                stat.p50 = percentile(0.5);
+                stat.p90 = percentile(0.9);
+                stat.p99 = percentile(0.99);
+                stat.p999 = percentile(0.999);
+            }
+            break;
+        }
+    }
+
+    // memory pool status is published when snapshot is taken.
+    static void MetricsUpdateMemoryPool()
+    {
+        static DKMetrics::Gauge* poolSize = DKMetrics::RegisterGauge("DKMemoryPool.Size");
+        static DKMetrics::Gauge* poolAllocated = DKMetrics::RegisterGauge("DKMemoryPool.AllocatedBytes");
+        static DKMetrics::Gauge* poolReserved = DKMetrics::RegisterGauge("DKMemoryPool.ReservedBytes");
+
+        size_t numBuckets = DKMemoryPoolNumberOfBuckets();
+        DKMemoryPoolBucketStatus* buckets = reinterpret_cast<DKMemoryPoolBucketStatus*>(DKMemoryHeapAlloc(sizeof(DKMemoryPoolBucketStatus) * numBuckets));
+        if (buckets)
+        {
+            DKMemoryPoolQueryAllocationStatus(buckets, numBuckets);
+            uint64_t allocated = 0;
+            uint64_t reserved = 0;
+            for (size_t i = 0; i < numBuckets; ++i)
+            {
+                allocated += buckets[i].chunkSize * buckets[i].usedChunks;
+                reserved += buckets[i].chunkSize * buckets[i].totalChunks;
+            }
+            DKMemoryHeapFree(buckets);
+            poolAllocated->Set(static_cast<int64_t>(allocated));
+            poolReserved->Set(static_cast<int64_t>(reserved));
+        }
+        poolSize->Set(static_cast<int64_t>(DKMemoryPoolSize()));
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+void DKMetrics::Counter::Increment(uint64_t n)
+{
+	MetricsAdd(MetricsThreadSlot(slot), n);
+}
+
+uint64_t DKMetrics::Counter::Value() const
+{
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	return MetricsSum(slot);
+}
+
+void DKMetrics::Gauge::Set(int64_t value)
+{
+	reinterpret_cast<MetricsEntry*>(impl)->base.store(value, std::memory_order_relaxed);
+}
+
+void DKMetrics::Gauge::Add(int64_t delta)
+{
+	MetricsAdd(MetricsThreadSlot(slot), static_cast<uint64_t>(delta));
+}
+
+int64_t DKMetrics::Gauge::Value() const
+{
+	int64_t base = reinterpret_cast<MetricsEntry*>(impl)->base.load(std::memory_order_relaxed);
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	return base + static_cast<int64_t>(MetricsSum(slot));
+}
+
+void DKMetrics::Histogram::RecordNanoseconds(uint64_t ns)
+{
+	MetricsSlot* s = &MetricsThreadSlot(slot);	// slots are in same page.
+	MetricsAdd(s[MetricsHistogramSum], ns);
+	MetricsMax(s[MetricsHistogramMin], ~ns);
+	MetricsMax(s[MetricsHistogramMax], ns);
+	MetricsAdd(s[MetricsHistogramBuckets + MetricsBucketIndex(ns)], 1);
+}
+
+void DKMetrics::Histogram::RecordTicks(DKTimer::Tick ticks)
+{
+	static const double tickToNanoseconds = 1000000000.0 / static_cast<double>(DKTimer::SystemTickFrequency());
+	RecordNanoseconds(static_cast<uint64_t>(static_cast<double>(ticks) * tickToNanoseconds));
+}
+
+void DKMetrics::Histogram::Record(double seconds)
+{
+	RecordNanoseconds(static_cast<uint64_t>(Max(seconds, 0.0) * 1000000000.0));
+}
+
+DKMetrics::Counter* DKMetrics::RegisterCounter(const char* name)
+{
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	MetricsEntry* e = MetricsRegister(name, TypeCounter);
+	if (e && e->object == NULL)
+		e->object = new Counter(e->slot);
+	return e ? static_cast<Counter*>(e->object) : NULL;
+}
+
+DKMetrics::Gauge* DKMetrics::RegisterGauge(const char* name)
+{
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	MetricsEntry* e = MetricsRegister(name, TypeGauge);
+	if (e && e->object == NULL)
+		e->object = new Gauge(e->slot, e);
+	return e ? static_cast<Gauge*>(e->object) : NULL;
+}
+
+DKMetrics::Histogram* DKMetrics::RegisterHistogram(const char* name)
+{
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	MetricsEntry* e = MetricsRegister(name, TypeHistogram);
+	if (e && e->object == NULL)
+		e->object = new Histogram(e->slot);
+	return e ? static_cast<Histogram*>(e->object) : NULL;
+}
+
+DKArray<DKMetrics::Statistics> DKMetrics::Snapshot()
+{
+	MetricsUpdateMemoryPool();
+
+	DKArray<Statistics> result;
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	for (MetricsEntry* e = metricsEntries; e; e = e->next)
+	{
+		Statistics stat;
+		MetricsFillStatistics(e, stat);
+		result.Add(std::move(stat));
+	}
+	return result;
+}
+
+bool DKMetrics::Snapshot(const char* name, Statistics& stat)
+{
+	MetricsUpdateMemoryPool();
+
+	DKCriticalSection<DKSpinLock> guard(metricsLock);
+	if (MetricsEntry* e = MetricsFindEntry(name ? name : ""); e)
+	{
+		MetricsFillStatistics(e, stat);
+		return true;
+	}
+	return false;
+}
+
+DKString DKMetrics::ExportText()
+{
+	DKArray<Statistics> stats = Snapshot();
+	DKStringU8 text;
+	char line[512];
+	for (const Statistics& s : stats)
+	{
+		DKStringU8 name(s.name);
+		switch (s.type)
+		{
+		case TypeCounter:
+			snprintf(line, sizeof(line), "counter   %s %lld\n", (const char*)name, (long long)s.value);
+			break;
+		case TypeGauge:
+			snprintf(line, sizeof(line), "gauge     %s %lld\n", (const char*)name, (long long)s.value);
+			break;
+		case TypeHistogram:
+			snprintf(line, sizeof(line), "histogram %s count: %llu, mean: %.3fms, p50: %.3fms, p90: %.3fms, p99: %.3fms, p99.9: %.3fms, min: %.3fms, max: %.3fms\n",
+					 (const char*)name, (unsigned long long)s.count,
+					 s.mean * 1000.0, s.p50 * 1000.0, s.p90 * 1000.0, s.p99 * 1000.0, s.p999 * 1000.0,
+					 s.min * 1000.0, s.max * 1000.0);
+			break;
+		}
+		text.Append(line);
+	}
+	return DKString(text);
+}
+
+size_t DKMetrics::ExportJSON(DKStream* output)
+{
+	if (output == NULL || !output->IsWritable())
+		return 0;
+
+	DKArray<Statistics> stats = Snapshot();
+	DKArray<DKStringU8> names;
+	names.Reserve(stats.Count());
+	for (const Statistics& s : stats)
+		names.Add(DKStringU8(s.name));
+
+	JsonStreamWriter writer(output);
+	const char* sections[] = { "counters", "gauges", "histograms" };
+	const Type types[] = { TypeCounter, TypeGauge, TypeHistogram };
+	writer.Write("{");
+	for (int i = 0; i < 3; ++i)
+	{
+		writer.Format("%s\"%s\":{", i > 0 ? "," : "", sections[i]);
+		bool first = true;
+		for (size_t n = 0; n < stats.Count(); ++n)
+		{
+			const Statistics& s = stats.Value(n);
+			if (s.type != types[i])
+				continue;
+			if (!first)
+				writer.Write(",");
+			first = false;
+			writer.WriteString((const char*)names.Value(n));
+			if (s.type == TypeHistogram)
+			{
+				writer.Format(":{\"count\":%llu,\"sum\":%.9g,\"min\":%.9g,\"max\":%.9g,\"mean\":%.9g,",
+							  (unsigned long long)s.count, s.sum, s.min, s.max, s.mean);
+				writer.Format("\"p50\":%.9g,\"p90\":%.9g,\"p99\":%.9g,\"p999\":%.9g}",
+							  s.p50, s.p90, s.p99, s.p999);
+			}
+			else
+			{
+				writer.Format(":%lld", (long long)s.value);
+			}
+		}
+		writer.Write("}");
+	}
+	writer.Write("}\n");
+	writer.Flush();
+	return writer.total;
+}
+
+DKObject<DKData> DKMetrics::ExportJSON()
+{
+	DKObject<DKBuffer> buffer = DKOBJECT_NEW DKBuffer();
+	DKBufferStream stream(buffer);
+	ExportJSON(&stream);
+	return buffer.SafeCast<DKData>();
+}
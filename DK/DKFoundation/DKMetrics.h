@@ -0,0 +1,160 @@
+//
+//  File: DKMetrics.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKArray.h"
+#include "DKData.h"
+#include "DKStream.h"
+#include "DKTimer.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Registry of named counters, gauges and latency histograms.
+
+	 Metrics are registered by name once, returned objects are valid until
+	 process terminates. (registering same name again returns same object)
+	 Updates are written to per-thread shards without lock or atomic
+	 read-modify-write, shards are merged when a snapshot is taken.
+	 Shards of terminated threads are merged into registry and reused.
+
+	 - Counter: monotonically increasing value.
+	 - Gauge: current value, changed with Set() or Add(). Add() is sharded,
+	   Set() writes a shared value. Use one of them for a gauge, value is
+	   sum of shared value and all Add() deltas.
+	 - Histogram: distribution of durations in nanoseconds, HDR-style
+	   log-linear buckets with 16 sub-buckets per power of two.
+	   (relative error < 6.25%, up to 2^44 ns, larger values are clamped)
+
+	 @code
+	  static DKMetrics::Counter* requests = DKMetrics::RegisterCounter("Server.Requests");
+	  static DKMetrics::Histogram* latency = DKMetrics::RegisterHistogram("Server.Latency");
+	  requests->Increment();
+	  DKMetrics::Histogram::ScopedTimer timer(latency);
+	  ...
+	  DKLog("%ls", (const wchar_t*)DKMetrics::ExportText());
+	 @endcode
+
+	 Engine subsystems publish metrics with prefix of class name.
+	 (ex: DKOperationQueue.QueueLength, values are sum of all instances)
+
+	 @note
+	  Metric names should be unique across types. Registering a name which
+	  is already registered as other type returns NULL.
+	 */
+	class DKGL_API DKMetrics
+	{
+	public:
+		enum Type
+		{
+			TypeCounter,
+			TypeGauge,
+			TypeHistogram,
+		};
+
+		class DKGL_API Counter
+		{
+		public:
+			void Increment(uint64_t n = 1);
+			uint64_t Value() const;
+		private:
+			friend class DKMetrics;
+			Counter(uint32_t s) : slot(s) {}
+			Counter(const Counter&) = delete;
+			Counter& operator = (const Counter&) = delete;
+			const uint32_t slot;
+		};
+
+		class DKGL_API Gauge
+		{
+		public:
+			void Set(int64_t value);
+			void Add(int64_t delta);
+			void Increment()	{ Add(1); }
+			void Decrement()	{ Add(-1); }
+			int64_t Value() const;
+		private:
+			friend class DKMetrics;
+			Gauge(uint32_t s, void* e) : slot(s), impl(e) {}
+			Gauge(const Gauge&) = delete;
+			Gauge& operator = (const Gauge&) = delete;
+			const uint32_t slot;
+			void* const impl;
+		};
+
+		class DKGL_API Histogram
+		{
+		public:
+			/// record elapsed time between constructor and destructor.
+			class ScopedTimer
+			{
+			public:
+				ScopedTimer(Histogram* h) : histogram(h), start(h ? DKTimer::SystemTick() : 0) {}
+				~ScopedTimer()
+				{
+					if (histogram)
+						histogram->RecordTicks(DKTimer::SystemTick() - start);
+				}
+			private:
+				ScopedTimer(const ScopedTimer&) = delete;
+				ScopedTimer& operator = (const ScopedTimer&) = delete;
+				Histogram* histogram;
+				DKTimer::Tick start;
+			};
+
+			void RecordNanoseconds(uint64_t ns);
+			void RecordTicks(DKTimer::Tick ticks);	///< ticks of DKTimer::SystemTick
+			void Record(double seconds);
+		private:
+			friend class DKMetrics;
+			Histogram(uint32_t s) : slot(s) {}
+			Histogram(const Histogram&) = delete;
+			Histogram& operator = (const Histogram&) = delete;
+			const uint32_t slot;
+		};
+
+		/// merged value of a metric, durations are in seconds.
+		struct Statistics
+		{
+			DKString name;
+			Type type;
+			int64_t value;		///< counter, gauge
+			uint64_t count;		///< histogram: number of records
+			double sum;
+			double min;
+			double max;
+			double mean;
+			double p50;
+			double p90;
+			double p99;
+			double p999;
+		};
+
+		/// register or find metric, returns NULL if name is registered as other type.
+		static Counter* RegisterCounter(const char* name);
+		static Gauge* RegisterGauge(const char* name);
+		static Histogram* RegisterHistogram(const char* name);
+
+		/// merge all metrics, sorted by name.
+		static DKArray<Statistics> Snapshot();
+		static bool Snapshot(const char* name, Statistics& stat);
+
+		/// one metric per line.
+		static DKString ExportText();
+		/// {"counters":{...},"gauges":{...},"histograms":{name:{...}}}
+		/// returns number of bytes written.
+		static size_t ExportJSON(DKStream* output);
+		static DKObject<DKData> ExportJSON();
+
+	private:
+		DKMetrics() = delete;
+	};
+}
@@ -7,6 +7,14 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #else
 #include <pthread.h>
 #include <errno.h>
@@ -69,6 +77,98 @@ namespace DKFoundation
 			mutable DWORD ownerId;
 #endif
 		};
+#elif defined(__linux__)
+		/// same as SpinLockPause (DKSpinLock.cpp), relax the CPU while spinning.
+		FORCEINLINE void SpinLockPause()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+			__asm__ __volatile__("yield");
+#endif
+		}
+
+		/// futex based mutex, lock and unlock without system call
+		/// if there is no contention.
+		class MutexImpl
+		{
+		public:
+			enum State
+			{
+				StateFree = 0,
+				StateLocked = 1,
+				StateContended = 2, ///< locked, and there might be waiting threads.
+			};
+			MutexImpl()
+				: state(StateFree)
+#ifdef DKGL_DEBUG_ENABLED
+				, ownerId(0)
+#endif
+			{
+			}
+			~MutexImpl()
+			{
+				DKASSERT_DEBUG(state == StateFree);
+			}
+			void Lock() const
+			{
+#ifdef DKGL_DEBUG_ENABLED
+				if (ownerId == pthread_self())
+				{
+					// Dead lock!
+					DKERROR_THROW_DEBUG("dead lock detected.");
+				}
+#endif
+				int s = StateFree;
+				if (!__atomic_compare_exchange_n(&state, &s, StateLocked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				{
+					// spin briefly before sleeping, lock might be released soon.
+					for (int i = 0; i < 64 && s == StateLocked; ++i)
+					{
+						SpinLockPause();
+						s = StateFree;
+						if (__atomic_compare_exchange_n(&state, &s, StateLocked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+							break;
+					}
+					if (s != StateFree)
+					{
+						while (__atomic_exchange_n(&state, StateContended, __ATOMIC_ACQUIRE) != StateFree)
+							syscall(SYS_futex, &state, FUTEX_WAIT_PRIVATE, StateContended, NULL, NULL, 0);
+					}
+				}
+#ifdef DKGL_DEBUG_ENABLED
+				ownerId = pthread_self();
+#endif
+			}
+			bool TryLock() const
+			{
+				int s = StateFree;
+				if (__atomic_compare_exchange_n(&state, &s, StateLocked, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				{
+#ifdef DKGL_DEBUG_ENABLED
+					ownerId = pthread_self();
+#endif
+					return true;
+				}
+				return false;
+			}
+			void Unlock() const
+			{
+#ifdef DKGL_DEBUG_ENABLED
+				if (ownerId != pthread_self())
+				{
+					DKERROR_THROW_DEBUG("The current thread does not hold a lock on mutex.");
+				}
+				ownerId = 0;
+#endif
+				if (__atomic_exchange_n(&state, StateFree, __ATOMIC_RELEASE) == StateContended)
+					syscall(SYS_futex, &state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+			}
+			mutable int state;
+#ifdef DKGL_DEBUG_ENABLED
+			mutable pthread_t ownerId;
+#endif
+		};
 #else
 		class MutexImpl
 		{
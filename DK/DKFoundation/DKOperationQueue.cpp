@@ -12,6 +12,10 @@
 #include "DKTimer.h"
 #include "DKCondition.h"
 #include "DKUtils.h"
+#include "DKArray.h"
+#include "DKProfiler.h"
+#include "DKMetrics.h"
+#include "DKLockProfiler.h"
 
 namespace DKFoundation
 {
@@ -24,9 +28,30 @@ namespace DKFoundation
 #endif
 
 		static DKCondition operationStateCond;
+
+		// metrics of all operation queues.
+		struct OperationQueueMetrics
+		{
+			DKMetrics::Counter* posted = DKMetrics::RegisterCounter("DKOperationQueue.Posted");
+			DKMetrics::Counter* processed = DKMetrics::RegisterCounter("DKOperationQueue.Processed");
+			DKMetrics::Counter* cancelled = DKMetrics::RegisterCounter("DKOperationQueue.Cancelled");
+			DKMetrics::Gauge* queueLength = DKMetrics::RegisterGauge("DKOperationQueue.QueueLength");
+			DKMetrics::Gauge* runningOperations = DKMetrics::RegisterGauge("DKOperationQueue.RunningOperations");
+			DKMetrics::Gauge* threads = DKMetrics::RegisterGauge("DKOperationQueue.Threads");
+			DKMetrics::Histogram* waitTime = DKMetrics::RegisterHistogram("DKOperationQueue.WaitTime");
+			DKMetrics::Histogram* operationTime = DKMetrics::RegisterHistogram("DKOperationQueue.OperationTime");
+
+			static OperationQueueMetrics& Get()
+			{
+				static OperationQueueMetrics metrics;
+				return metrics;
+			}
+		};
+		using CompletionHandlers = DKArray<DKObject<DKOperation>>;
 		struct OperationSyncState : public DKOperationQueue::OperationSync
 		{
 			State state;
+			CompletionHandlers handlers; // guarded by operationStateCond
 
 			OperationSyncState() : state(StateUnknown)
 			{
@@ -41,18 +66,41 @@ namespace DKFoundation
 			}
 			bool Cancel()
 			{
-				DKCriticalSection<DKCondition> guard(operationStateCond);
+				operationStateCond.Lock();
 				if (state == State::StatePending)
 				{
 					state = State::StateCancelled;
+					CompletionHandlers ops = std::move(handlers);
+					operationStateCond.Unlock();
+					OperationQueueMetrics::Get().cancelled->Increment();
+					for (DKObject<DKOperation>& op : ops)
+						op->Perform();
 					return true;
 				}
+				operationStateCond.Unlock();
 				return false;
 			}
 			State OperationState()
 			{
 				return state;
 			}
+			void AddCompletionHandler(const DKOperation* handler)
+			{
+				if (handler == NULL)
+					return;
+
+				operationStateCond.Lock();
+				if (state == State::StateProcessed || state == State::StateCancelled)
+				{
+					operationStateCond.Unlock();
+					handler->Perform();
+				}
+				else
+				{
+					handlers.Add(const_cast<DKOperation*>(handler));
+					operationStateCond.Unlock();
+				}
+			}
 		};
 	}
 }
@@ -65,9 +113,12 @@ DKOperationQueue::DKOperationQueue(ThreadFilter* f)
 	, threadCount(0)
 	, maxThreadCount(0)
 	, activeThreads(0)
+	, pinWorkersToCores(false)
 	, filter(f)
 {
 	maxConcurrentOperations = Max(2, static_cast<int>(DKNumberOfProcessors()) - 1);
+	DKLockProfiler::SetName(&threadCond, "DKOperationQueue::threadCond");
+	DKLockProfiler::SetName(&operationStateCond, "DKOperationQueue::operationStateCond");
 }
 
 DKOperationQueue::~DKOperationQueue()
@@ -80,26 +131,43 @@ DKOperationQueue::~DKOperationQueue()
 
 	DKASSERT_DEBUG(activeThreads == 0);
 
+	CompletionHandlers handlers;
 	operationStateCond.Lock();
-	auto cancelOps = [](Operation& op)
+	size_t numCancelled = 0;
+	auto cancelOps = [&handlers, &numCancelled](Operation& op)
 	{
 		OperationSyncState* st = op.sync.StaticCast<OperationSyncState>();
 		if (st && st->state == OperationSync::StatePending)
+		{
 			st->state = OperationSync::StateCancelled;
+			handlers.Add(st->handlers);
+			st->handlers.Clear();
+			numCancelled++;
+		}
+		else if (st == NULL)
+			numCancelled++;
 	};
 	operationQueue.EnumerateForward(cancelOps);
+	OperationQueueMetrics::Get().cancelled->Increment(numCancelled);
+	OperationQueueMetrics::Get().queueLength->Add(-static_cast<int64_t>(operationQueue.Count()));
 	operationQueue.Clear();
 
 	operationStateCond.Broadcast();
 	operationStateCond.Unlock();
 	threadCond.Unlock();
+	DKLockProfiler::Unregister(&threadCond);
+
+	for (DKObject<DKOperation>& op : handlers)
+		op->Perform();
 }
 
 void DKOperationQueue::SetMaxConcurrentOperations(size_t maxConcurrent)
 {
-	threadCond.Lock();
-	maxConcurrentOperations = Max(maxConcurrent, 1);
-	threadCond.Unlock();
+	if (true)
+	{
+		DKCriticalSection<DKCondition> guard(threadCond);
+		maxConcurrentOperations = Max(maxConcurrent, 1);
+	}
 
 	UpdateThreadPool();
 }
@@ -110,15 +178,44 @@ size_t DKOperationQueue::MaxConcurrentOperations() const
 	return maxConcurrentOperations;
 }
 
+void DKOperationQueue::SetWorkersPinnedToCores(bool pin)
+{
+	threadCond.Lock();
+	pinWorkersToCores = pin;
+	if (pin)
+	{
+		const DKThread::Topology& topology = DKThread::CpuTopology();
+		if (pinnedCores.Count() != topology.numCores)
+		{
+			DKASSERT_DEBUG(pinnedCores.IsEmpty());
+			pinnedCores.Resize(topology.numCores, false);
+		}
+	}
+	threadCond.Broadcast(); // idle workers update affinity.
+	threadCond.Unlock();
+
+	UpdateThreadPool();
+}
+
+bool DKOperationQueue::WorkersPinnedToCores() const
+{
+	DKCriticalSection<DKCondition> guard(threadCond);
+	return pinWorkersToCores;
+}
+
 void DKOperationQueue::Post(DKOperation* operation)
 {
 	if (operation)
 	{
-		Operation op = {operation, NULL};
-		threadCond.Lock();
-		operationQueue.PushBack(op);
-		threadCond.Broadcast();
-		threadCond.Unlock();
+		Operation op = {operation, NULL, DKTimer::SystemTick()};
+		OperationQueueMetrics::Get().posted->Increment();
+		OperationQueueMetrics::Get().queueLength->Increment();
+		if (true)
+		{
+			DKCriticalSection<DKCondition> guard(threadCond);
+			operationQueue.PushBack(op);
+			threadCond.Broadcast();
+		}
 		UpdateThreadPool();
 	}
 }
@@ -129,11 +226,15 @@ DKObject<DKOperationQueue::OperationSync> DKOperationQueue::ProcessAsync(DKOpera
 	{
 		DKObject<OperationSyncState> sync = DKOBJECT_NEW OperationSyncState();
 		sync->state = OperationSync::StatePending;
-		Operation op = {operation, sync.StaticCast<OperationSync>()};
-		threadCond.Lock();
-		operationQueue.PushBack(op);
-		threadCond.Broadcast();
-		threadCond.Unlock();
+		Operation op = {operation, sync.StaticCast<OperationSync>(), DKTimer::SystemTick()};
+		OperationQueueMetrics::Get().posted->Increment();
+		OperationQueueMetrics::Get().queueLength->Increment();
+		if (true)
+		{
+			DKCriticalSection<DKCondition> guard(threadCond);
+			operationQueue.PushBack(op);
+			threadCond.Broadcast();
+		}
 		UpdateThreadPool();
 
 		return sync.StaticCast<OperationSync>();
@@ -151,8 +252,13 @@ bool DKOperationQueue::Process(DKOperation* operation)
 
 void DKOperationQueue::UpdateThreadPool()
 {
-	threadCond.Lock();
+	DKCriticalSection<DKCondition> guard(threadCond);
+	size_t prevMaxThreadCount = maxThreadCount;
 	maxThreadCount = maxConcurrentOperations;
+	if (pinWorkersToCores)	// one worker per core, configured value is kept.
+		maxThreadCount = Min(maxThreadCount, Max(pinnedCores.Count(), size_t(1)));
+	if (maxThreadCount < prevMaxThreadCount)
+		threadCond.Broadcast(); // idle workers exceeding limit terminate.
 	while (threadCount < maxThreadCount)
 	{
 		if (operationQueue.Count() > threadCount)
@@ -161,6 +267,7 @@ void DKOperationQueue::UpdateThreadPool()
 			if (thread)
 			{
 				threadCount++;
+				OperationQueueMetrics::Get().threads->Increment();
 			}
 		}
 		else
@@ -169,7 +276,6 @@ void DKOperationQueue::UpdateThreadPool()
 		}
 	}
 	//size_t numThreads = threadCount;
-	threadCond.Unlock();
 
 	//DKLog("OperationQueue running %u threads (maxConcurrent:%d)\n", (unsigned int)numThreads, maxConcurrentOperations);
 }
@@ -178,14 +284,25 @@ void DKOperationQueue::CancelAllOperations()
 {
 	threadCond.Lock();
 
+	CompletionHandlers handlers;
 	operationStateCond.Lock();
-	auto cancelOps = [](Operation& op)
+	size_t numCancelled = 0;
+	auto cancelOps = [&handlers, &numCancelled](Operation& op)
 	{
 		OperationSyncState* st = op.sync.StaticCast<OperationSyncState>();
 		if (st && st->state == OperationSync::StatePending)
+		{
 			st->state = OperationSync::StateCancelled;
+			handlers.Add(st->handlers);
+			st->handlers.Clear();
+			numCancelled++;
+		}
+		else if (st == NULL)
+			numCancelled++;
 	};
 	operationQueue.EnumerateForward(cancelOps);
+	OperationQueueMetrics::Get().cancelled->Increment(numCancelled);
+	OperationQueueMetrics::Get().queueLength->Add(-static_cast<int64_t>(operationQueue.Count()));
 	operationQueue.Clear();
 
 	operationStateCond.Broadcast();
@@ -193,6 +310,9 @@ void DKOperationQueue::CancelAllOperations()
 
 	threadCond.Broadcast();
 	threadCond.Unlock();
+
+	for (DKObject<DKOperation>& op : handlers)
+		op->Perform();
 }
 
 void DKOperationQueue::WaitForCompletion() const
@@ -231,13 +351,19 @@ size_t DKOperationQueue::RunningThreads() const
 void DKOperationQueue::OperationProc()
 {
 	DKThread::ThreadId threadId = DKThread::CurrentThreadId();
+	DKObject<DKThread> thread = DKThread::CurrentThread();
 	DKTimer timer;
 	timer.Reset();
 	size_t numOps = 0;
+	ptrdiff_t pinnedCore = -1;
+
+	if (thread && thread->Name().Length() == 0)	// keep name given by creator.
+		thread->SetName(L"DKOpQueueWorker");
 
 	threadCond.Lock();
 
-	auto PerformOperation = [this](DKOperation* op)
+	OperationQueueMetrics& metrics = OperationQueueMetrics::Get();
+	auto PerformOperation = [this, &metrics](DKOperation* op)
 	{
 		struct Wrapper : public DKOperation
 		{
@@ -252,6 +378,8 @@ void DKOperationQueue::OperationProc()
 			ThreadFilter* filter;
 			DKOperation* op;
 		};
+		DKPROFILE_SCOPE("DKOperationQueue::PerformOperation");
+		DKMetrics::Histogram::ScopedTimer timer(metrics.operationTime);
 		Wrapper wr(filter, op);
 		PerformOperationInsidePool(&wr);
 	};
@@ -269,12 +397,40 @@ void DKOperationQueue::OperationProc()
 			break; // terminate.
 		}
 
-		Operation op = {NULL, NULL};
+		if (thread && pinWorkersToCores != (pinnedCore >= 0))
+		{
+			if (pinWorkersToCores)
+			{
+				// pin to a core which has no pinned worker.
+				for (size_t i = 0; i < pinnedCores.Count(); ++i)
+				{
+					if (!pinnedCores.Value(i))
+					{
+						pinnedCores.Value(i) = true;
+						pinnedCore = i;
+						thread->SetAffinity(DKThread::CpuTopology().ProcessorsOfCore(static_cast<uint32_t>(i)));
+						break;
+					}
+				}
+			}
+			else
+			{
+				pinnedCores.Value(pinnedCore) = false;
+				pinnedCore = -1;
+				thread->SetAffinity(DKArray<uint32_t>());
+			}
+		}
+
+		Operation op = {NULL, NULL, 0};
 		if (operationQueue.PopFront(op))
 		{
 			activeThreads++;
 			threadCond.Unlock();
 
+			metrics.queueLength->Decrement();
+			metrics.runningOperations->Increment();
+			metrics.waitTime->RecordTicks(DKTimer::SystemTick() - op.postedTick);
+
 			OperationSyncState* st = op.sync.StaticCast<OperationSyncState>();
 			if (st)
 			{
@@ -287,25 +443,37 @@ void DKOperationQueue::OperationProc()
 						operationStateCond.Unlock();
 						PerformOperation(op.operation);
 						numOps++;
+						metrics.processed->Increment();
 						operationStateCond.Lock();
 						st->state = OperationSync::StateProcessed;
 					}
 					else
 					{
 						st->state = OperationSync::StateCancelled;
+						metrics.cancelled->Increment();
 					}
 					operationStateCond.Broadcast();
+					CompletionHandlers handlers = std::move(st->handlers);
+					operationStateCond.Unlock();
+
+					for (DKObject<DKOperation>& handler : handlers)
+						handler->Perform();
+				}
+				else
+				{
+					operationStateCond.Unlock();
 				}
-				operationStateCond.Unlock();
 			}
 			else if (op.operation)
 			{
 				PerformOperation(op.operation);
 				numOps++;
+				metrics.processed->Increment();
 			}
 
 			op.operation = NULL;
 			op.sync = NULL;
+			metrics.runningOperations->Decrement();
 
 			threadCond.Lock();
 			activeThreads--;
@@ -322,7 +490,11 @@ void DKOperationQueue::OperationProc()
 
 	DKLog("DKOperationQueue_Thread:0x%x terminated. (running %f seconds, %lu processed)\n", threadId, timer.Elapsed(), numOps);
 
+	if (pinnedCore >= 0)
+		pinnedCores.Value(pinnedCore) = false;
+
 	threadCount--;
+	metrics.threads->Decrement();
 	threadCond.Broadcast();
 	threadCond.Unlock();
 }
@@ -10,6 +10,7 @@
 #include "DKThread.h"
 #include "DKOperation.h"
 #include "DKQueue.h"
+#include "DKArray.h"
 #include "DKCondition.h"
 #include "DKSpinLock.h"
 
@@ -36,6 +37,11 @@ namespace DKFoundation
 			virtual bool Sync() = 0;	///< Wait until operation finished
 			virtual bool Cancel() = 0;	///< Cancellation request
 			virtual State OperationState() = 0; ///< Query state
+			/// Register a handler to be performed when the operation has been
+			/// processed or cancelled. The handler is performed on the thread
+			/// which finishes the operation, or performed immediately if the
+			/// operation has been finished already.
+			virtual void AddCompletionHandler(const DKOperation* handler) = 0;
 		};
 
 		/// threading filter.
@@ -60,6 +66,14 @@ namespace DKFoundation
 		void SetMaxConcurrentOperations(size_t maxConcurrent);
 		size_t MaxConcurrentOperations() const;
 
+		/// Spawn one worker thread per physical core, each worker is pinned
+		/// to SMT siblings of its core. (see DKThread::CpuTopology)
+		/// While pinned, number of workers is limited to number of physical
+		/// cores, MaxConcurrentOperations() is not changed and applies again
+		/// when workers are unpinned.
+		void SetWorkersPinnedToCores(bool pin);
+		bool WorkersPinnedToCores() const;
+
 		void Post(DKOperation* operation);
 		DKObject<OperationSync> ProcessAsync(DKOperation* operation);
 		bool Process(DKOperation* operation);	///< wait until done.
@@ -76,6 +90,7 @@ namespace DKFoundation
 		{
 			DKObject<DKOperation> operation;
 			DKObject<OperationSync> sync;
+			uint64_t postedTick;	// DKTimer::SystemTick
 		};
 		typedef DKQueue<Operation, DKDummyLock> OperationQueue;
 		OperationQueue operationQueue;
@@ -83,6 +98,8 @@ namespace DKFoundation
 		size_t threadCount;			// available threads count
 		size_t maxThreadCount;		// maximum threads count
 		size_t activeThreads;		// working threads count
+		bool pinWorkersToCores;
+		DKArray<bool> pinnedCores;	// cores which have pinned worker
 		DKCondition threadCond;
 		DKObject<ThreadFilter> filter;
 
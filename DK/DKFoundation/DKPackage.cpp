@@ -0,0 +1,663 @@
+//
+//  File: DKPackage.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKPackage.h"
+#include "DKFileMap.h"
+#include "DKFile.h"
+#include "DKBuffer.h"
+#include "DKDataStream.h"
+#include "DKStringU8.h"
+#include "DKHash.h"
+#include "DKEndianness.h"
+#include "DKOperationQueue.h"
+#include "DKFunction.h"
+#include "DKLog.h"
+
+// Package layout: (little-endian)
+//  [Header][entry data, aligned]...[table of contents][names]
+//  table of contents is sorted by hash of name (FNV-1a 64 of UTF-8 name).
+#define PACKAGE_MAGIC           0x4B504B44U  // 'DKPK'
+#define PACKAGE_VERSION         1
+#define PACKAGE_HEADER_SIZE     64
+#define PACKAGE_ENTRY_SIZE      48
+
+namespace DKFoundation::Private
+{
+    struct PackageHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t headerSize;
+        uint32_t alignment;
+        uint32_t numEntries;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+        uint64_t namesLength;
+        uint64_t packageLength;
+        uint32_t tocChecksum;       // CRC32 of table of contents and names
+        uint8_t reserved[12];
+    };
+    static_assert(sizeof(PackageHeader) == PACKAGE_HEADER_SIZE, "Invalid header size");
+
+    struct PackageEntry
+    {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t length;
+        uint64_t storedLength;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t compression;
+        uint32_t crc32;
+    };
+    static_assert(sizeof(PackageEntry) == PACKAGE_ENTRY_SIZE, "Invalid entry size");
+
+    template <typename T> inline void PackageByteOrder(T& v)
+    {
+        v = DKLittleEndianToSystem(v);  // same as DKSystemToLittleEndian
+    }
+    inline void PackageByteOrder(PackageHeader& h)
+    {
+        PackageByteOrder(h.magic);
+        PackageByteOrder(h.version);
+        PackageByteOrder(h.headerSize);
+        PackageByteOrder(h.alignment);
+        PackageByteOrder(h.numEntries);
+        PackageByteOrder(h.tocOffset);
+        PackageByteOrder(h.namesOffset);
+        PackageByteOrder(h.namesLength);
+        PackageByteOrder(h.packageLength);
+        PackageByteOrder(h.tocChecksum);
+    }
+    inline void PackageByteOrder(PackageEntry& e)
+    {
+        PackageByteOrder(e.hash);
+        PackageByteOrder(e.offset);
+        PackageByteOrder(e.length);
+        PackageByteOrder(e.storedLength);
+        PackageByteOrder(e.nameOffset);
+        PackageByteOrder(e.nameLength);
+        PackageByteOrder(e.compression);
+        PackageByteOrder(e.crc32);
+    }
+
+    static uint64_t PackageNameHash(const char* name, size_t length)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= uint8_t(name[i]);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static uint32_t PackageCRC32(const DKData* data)
+    {
+        const void* p = data->LockShared();
+        uint32_t crc = DKHashCRC32(p, data->Length()).digest[0];
+        data->UnlockShared();
+        return crc;
+    }
+
+    static bool IsPackageCompressionValid(uint32_t c)
+    {
+        return c <= DKPackage::CompressionZstdMax;
+    }
+
+    static DKCompressor::Method PackageCompressionMethod(DKPackage::Compression c)
+    {
+        switch (c)
+        {
+        case DKPackage::CompressionLZ4:     return DKCompressor::LZ4;
+        case DKPackage::CompressionLZ4HC:   return DKCompressor::LZ4HC;
+        case DKPackage::CompressionZstd:    return DKCompressor::Zstd;
+        case DKPackage::CompressionZstdMax: return DKCompressor::ZstdMax;
+        default:
+            break;
+        }
+        return DKCompressor::Default;
+    }
+
+    struct PackageContext
+    {
+        DKObject<DKData> data;
+        DKArray<PackageEntry> entries;  // sorted by hash
+        DKArray<char> names;
+        size_t alignment;
+
+        // index of entry, or -1 if not found.
+        size_t Find(const DKString& name) const
+        {
+            DKStringU8 str(name);
+            const char* s = (const char*)str;
+            const size_t len = str.Bytes();
+            const uint64_t hash = PackageNameHash(s, len);
+
+            size_t begin = 0;
+            size_t end = entries.Count();
+            while (begin < end)     // lower bound
+            {
+                size_t mid = (begin + end) / 2;
+                if (entries.Value(mid).hash < hash)
+                    begin = mid + 1;
+                else
+                    end = mid;
+            }
+            for (size_t i = begin; i < entries.Count() && entries.Value(i).hash == hash; ++i)
+            {
+                const PackageEntry& e = entries.Value(i);
+                if (e.nameLength == len && memcmp(&names.Value(e.nameOffset), s, len) == 0)
+                    return i;
+            }
+            return size_t(-1);
+        }
+
+        DKString EntryName(const PackageEntry& e) const
+        {
+            return DKString(DKStringU8((const DKUniChar8*)&names.Value(e.nameOffset), e.nameLength));
+        }
+
+        DKObject<DKData> EntryData(const PackageEntry& e) const
+        {
+            if (e.compression == DKPackage::CompressionStored)
+                return data->Subdata(size_t(e.offset), size_t(e.length));
+
+            DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, size_t(e.length));
+            if (buffer == NULL || buffer->Length() != e.length)
+            {
+                DKLogE("DKPackage Error: Out of memory!\n");
+                return NULL;
+            }
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(data->LockShared());
+            void* dst = buffer->LockExclusive();
+            size_t n = DKCompressor::Decompress(&src[e.offset], size_t(e.storedLength), dst, size_t(e.length));
+            buffer->UnlockExclusive();
+            data->UnlockShared();
+            if (n != e.length)
+            {
+                DKLogE("DKPackage Error: Failed to decompress entry \"%ls\"\n", (const wchar_t*)EntryName(e));
+                return NULL;
+            }
+            return buffer.SafeCast<DKData>();
+        }
+
+        bool Verify(const PackageEntry& e) const
+        {
+            DKObject<DKData> d = EntryData(e);
+            if (d && PackageCRC32(d) == e.crc32)
+                return true;
+            DKLogE("DKPackage Error: Entry \"%ls\" is corrupted.\n", (const wchar_t*)EntryName(e));
+            return false;
+        }
+
+        bool Load()
+        {
+            const size_t length = data->Length();
+            if (length < PACKAGE_HEADER_SIZE)
+                return false;
+
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(data->LockShared());
+            if (p == NULL)
+            {
+                data->UnlockShared();
+                return false;
+            }
+
+            PackageHeader header;
+            memcpy(&header, p, sizeof(header));
+            PackageByteOrder(header);
+
+            bool result = false;
+            const uint64_t tocLength = uint64_t(header.numEntries) * PACKAGE_ENTRY_SIZE;
+            if (header.magic != PACKAGE_MAGIC || header.version != PACKAGE_VERSION || header.headerSize != PACKAGE_HEADER_SIZE)
+            {
+                DKLogE("DKPackage Error: Invalid package header.\n");
+            }
+            else if (header.packageLength != length ||
+                     header.tocOffset < PACKAGE_HEADER_SIZE ||
+                     header.tocOffset > length ||
+                     tocLength > length - header.tocOffset ||
+                     header.namesOffset != header.tocOffset + tocLength ||
+                     header.namesLength > length - header.namesOffset ||
+                     header.namesLength > 0xffffffffU)
+            {
+                DKLogE("DKPackage Error: Invalid package length.\n");
+            }
+            else if (DKHashCRC32(&p[header.tocOffset], size_t(tocLength + header.namesLength)).digest[0] != header.tocChecksum)
+            {
+                DKLogE("DKPackage Error: Table of contents is corrupted.\n");
+            }
+            else
+            {
+                result = true;
+                alignment = header.alignment;
+                names.Add(reinterpret_cast<const char*>(&p[header.namesOffset]), size_t(header.namesLength));
+                entries.Reserve(header.numEntries);
+                const uint8_t* toc = &p[header.tocOffset];
+                for (uint32_t i = 0; i < header.numEntries; ++i)
+                {
+                    PackageEntry e;
+                    memcpy(&e, &toc[i * PACKAGE_ENTRY_SIZE], sizeof(e));
+                    PackageByteOrder(e);
+                    // entry data must be between header and table of contents.
+                    if (e.offset < PACKAGE_HEADER_SIZE ||
+                        e.offset > header.tocOffset ||
+                        e.storedLength > header.tocOffset - e.offset ||
+                        uint64_t(e.nameOffset) + e.nameLength > header.namesLength ||
+                        e.length > size_t(-1) ||
+                        !IsPackageCompressionValid(e.compression) ||
+                        (e.compression == DKPackage::CompressionStored && e.length != e.storedLength) ||
+                        (i > 0 && e.hash < entries.Value(i - 1).hash))
+                    {
+                        DKLogE("DKPackage Error: Invalid entry at index %u.\n", i);
+                        result = false;
+                        break;
+                    }
+                    entries.Add(e);
+                }
+            }
+            data->UnlockShared();
+            return result;
+        }
+    };
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+#define PACKAGE_IMPL	reinterpret_cast<PackageContext*>(this->impl)
+
+DKPackage::DKPackage()
+	: impl(NULL)
+{
+}
+
+DKPackage::~DKPackage()
+{
+	delete PACKAGE_IMPL;
+}
+
+DKObject<DKPackage> DKPackage::Open(const DKString& path)
+{
+	DKObject<DKFileMap> map = DKFileMap::Open(path, 0, false);
+	if (map)
+	{
+		// keep mapped, entries are views of mapped content.
+		map->SetMapOptions(DKFileMap::MapOptionPersistent);
+		map->Advise(DKFileMap::AccessRandom);
+		return Open(map.SafeCast<DKData>());
+	}
+	return NULL;
+}
+
+bool DKPackage::IsPackage(const DKString& path)
+{
+	uint32_t magic = 0;
+	DKObject<DKFile> file = DKFile::Create(path, DKFile::ModeOpenReadOnly, DKFile::ModeShareAll);
+	if (file && file->Read(&magic, sizeof(magic)) == sizeof(magic))
+		return DKLittleEndianToSystem(magic) == PACKAGE_MAGIC;
+	return false;
+}
+
+bool DKPackage::IsPackage(const DKData* data)
+{
+	uint32_t magic = 0;
+	if (data && data->IsReadable() && data->Length() >= PACKAGE_HEADER_SIZE)
+	{
+		const void* p = data->LockShared();
+		if (p)
+			memcpy(&magic, p, sizeof(magic));
+		data->UnlockShared();
+	}
+	return DKLittleEndianToSystem(magic) == PACKAGE_MAGIC;
+}
+
+DKObject<DKPackage> DKPackage::Open(DKData* data)
+{
+	if (data == NULL || !data->IsReadable())
+		return NULL;
+
+	PackageContext* ctxt = new PackageContext();
+	ctxt->data = data;
+	ctxt->alignment = 1;
+	if (ctxt->data == NULL || !ctxt->Load())
+	{
+		delete ctxt;
+		return NULL;
+	}
+	DKObject<DKPackage> package = DKObject<DKPackage>::New();
+	package->impl = ctxt;
+	return package;
+}
+
+size_t DKPackage::NumberOfEntries() const
+{
+	return PACKAGE_IMPL->entries.Count();
+}
+
+size_t DKPackage::Alignment() const
+{
+	return PACKAGE_IMPL->alignment;
+}
+
+bool DKPackage::EntryInfoAt(size_t index, EntryInfo& info) const
+{
+	const PackageContext* ctxt = PACKAGE_IMPL;
+	if (index < ctxt->entries.Count())
+	{
+		const PackageEntry& e = ctxt->entries.Value(index);
+		info.name = ctxt->EntryName(e);
+		info.offset = e.offset;
+		info.length = e.length;
+		info.storedLength = e.storedLength;
+		info.compression = static_cast<Compression>(e.compression);
+		info.crc32 = e.crc32;
+		return true;
+	}
+	return false;
+}
+
+bool DKPackage::FindEntryInfo(const DKString& name, EntryInfo& info) const
+{
+	return EntryInfoAt(PACKAGE_IMPL->Find(name), info);
+}
+
+bool DKPackage::HasEntry(const DKString& name) const
+{
+	return PACKAGE_IMPL->Find(name) != size_t(-1);
+}
+
+DKString::StringArray DKPackage::EntryNames() const
+{
+	const PackageContext* ctxt = PACKAGE_IMPL;
+	DKString::StringArray names;
+	names.Reserve(ctxt->entries.Count());
+	for (const PackageEntry& e : ctxt->entries)
+		names.Add(ctxt->EntryName(e));
+	return names;
+}
+
+DKObject<DKData> DKPackage::Data(const DKString& name) const
+{
+	const PackageContext* ctxt = PACKAGE_IMPL;
+	size_t index = ctxt->Find(name);
+	if (index != size_t(-1))
+		return ctxt->EntryData(ctxt->entries.Value(index));
+	return NULL;
+}
+
+DKObject<DKStream> DKPackage::OpenStream(const DKString& name) const
+{
+	DKObject<DKData> data = Data(name);
+	if (data)
+	{
+		DKObject<DKDataStream> stream = DKOBJECT_NEW DKDataStream(data);
+		return stream.SafeCast<DKStream>();
+	}
+	return NULL;
+}
+
+bool DKPackage::Verify() const
+{
+	const PackageContext* ctxt = PACKAGE_IMPL;
+	bool result = true;
+	for (const PackageEntry& e : ctxt->entries)
+	{
+		if (!ctxt->Verify(e))
+			result = false;
+	}
+	return result;
+}
+
+bool DKPackage::Verify(const DKString& name) const
+{
+	const PackageContext* ctxt = PACKAGE_IMPL;
+	size_t index = ctxt->Find(name);
+	if (index != size_t(-1))
+		return ctxt->Verify(ctxt->entries.Value(index));
+	return false;
+}
+
+const DKData* DKPackage::PackageData() const
+{
+	return PACKAGE_IMPL->data;
+}
+
+DKPackageBuilder::DKPackageBuilder()
+	: alignment(DefaultAlignment)
+{
+}
+
+DKPackageBuilder::~DKPackageBuilder()
+{
+}
+
+void DKPackageBuilder::SetAlignment(size_t a)
+{
+	DKASSERT_DEBUG(a > 0 && (a & (a - 1)) == 0);
+	if (a > 0 && (a & (a - 1)) == 0 && a <= 0x80000000U)
+		alignment = a;
+}
+
+bool DKPackageBuilder::AddData(const DKString& name, DKData* data, DKPackage::Compression compression)
+{
+	if (name.Length() == 0 || data == NULL || !data->IsReadable())
+		return false;
+	if (!IsPackageCompressionValid(compression))
+		return false;
+
+	Remove(name);
+	Entry e = { name, data, compression };
+	if (e.data == NULL)	// unmanaged object
+		e.data = DKBuffer::Create(data).SafeCast<DKData>();
+	entries.Add(e);
+	return true;
+}
+
+bool DKPackageBuilder::AddFile(const DKString& name, const DKString& path, DKPackage::Compression compression)
+{
+	DKObject<DKData> data = DKFileMap::Open(path, 0, false).SafeCast<DKData>();
+	if (data == NULL)
+		data = DKBuffer::Create(path).SafeCast<DKData>();
+	if (data)
+		return AddData(name, data, compression);
+	DKLogE("DKPackageBuilder Error: Cannot open file: %ls\n", (const wchar_t*)path);
+	return false;
+}
+
+void DKPackageBuilder::Remove(const DKString& name)
+{
+	for (size_t i = 0; i < entries.Count(); ++i)
+	{
+		if (entries.Value(i).name == name)
+		{
+			entries.Remove(i);
+			break;
+		}
+	}
+}
+
+void DKPackageBuilder::RemoveAll()
+{
+	entries.Clear();
+}
+
+bool DKPackageBuilder::Write(DKStream* output, size_t maxConcurrency) const
+{
+	if (output == NULL || !output->IsWritable())
+		return false;
+
+	const size_t numEntries = entries.Count();
+	if (numEntries > 0xffffffffU)
+		return false;
+
+	struct Payload
+	{
+		DKObject<DKData> data;	// stored data
+		PackageEntry entry;
+		DKStringU8 name;
+		bool failed;
+	};
+	DKArray<Payload> payloads;
+	payloads.Resize(numEntries);
+
+	// compress entries in parallel.
+	DKOperationQueue queue;
+	if (maxConcurrency > 0)
+		queue.SetMaxConcurrentOperations(maxConcurrency);
+	for (size_t i = 0; i < numEntries; ++i)
+	{
+		const Entry* entry = &entries.Value(i);
+		Payload* payload = &payloads.Value(i);
+		queue.Post(DKFunction([entry, payload]()
+		{
+			const DKData* data = entry->data;
+			const size_t length = data->Length();
+
+			payload->name = DKStringU8(entry->name);
+			payload->failed = false;
+			payload->data = entry->data;
+			payload->entry = {};
+			payload->entry.hash = PackageNameHash((const char*)payload->name, payload->name.Bytes());
+			payload->entry.length = length;
+			payload->entry.storedLength = length;
+			payload->entry.compression = DKPackage::CompressionStored;
+			payload->entry.crc32 = PackageCRC32(data);
+
+			if (entry->compression != DKPackage::CompressionStored && length > 0)
+			{
+				DKObject<DKBuffer> compressed;
+				const void* p = data->LockShared();
+				compressed = DKBuffer::Compress(DKCompressor(PackageCompressionMethod(entry->compression)), p, length);
+				data->UnlockShared();
+				if (compressed == NULL)
+				{
+					payload->failed = true;
+				}
+				else if (compressed->Length() < length)	// store original if not smaller
+				{
+					payload->data = compressed.SafeCast<DKData>();
+					payload->entry.storedLength = compressed->Length();
+					payload->entry.compression = entry->compression;
+				}
+			}
+		})->Invocation());
+	}
+	queue.WaitForCompletion();
+
+	// layout
+	const uint64_t align = alignment;
+	auto alignOffset = [align](uint64_t offset)->uint64_t
+	{
+		return (offset + align - 1) & ~(align - 1);
+	};
+	uint64_t offset = PACKAGE_HEADER_SIZE;
+	uint64_t namesLength = 0;
+	DKArray<PackageEntry> toc;
+	toc.Reserve(numEntries);
+	for (Payload& payload : payloads)
+	{
+		if (payload.failed)
+		{
+			DKLogE("DKPackageBuilder Error: Failed to compress entry \"%s\"\n", (const char*)payload.name);
+			return false;
+		}
+		offset = alignOffset(offset);
+		payload.entry.offset = offset;
+		payload.entry.nameOffset = uint32_t(namesLength);
+		payload.entry.nameLength = uint32_t(payload.name.Bytes());
+		offset += payload.entry.storedLength;
+		namesLength += payload.name.Bytes();
+		if (namesLength > 0xffffffffU)
+			return false;
+		toc.Add(payload.entry);
+	}
+	const uint64_t tocOffset = alignOffset(offset);
+	const uint64_t tocLength = uint64_t(numEntries) * PACKAGE_ENTRY_SIZE;
+
+	toc.Sort([](const PackageEntry& lhs, const PackageEntry& rhs)
+	{
+		return lhs.hash < rhs.hash;
+	});
+
+	DKObject<DKBuffer> tocData = DKBuffer::Create(NULL, size_t(tocLength + namesLength));
+	uint8_t* tocPtr = reinterpret_cast<uint8_t*>(tocData->LockExclusive());
+	for (size_t i = 0; i < numEntries; ++i)
+	{
+		PackageEntry e = toc.Value(i);
+		PackageByteOrder(e);
+		memcpy(&tocPtr[i * PACKAGE_ENTRY_SIZE], &e, sizeof(e));
+	}
+	for (const Payload& payload : payloads)
+		memcpy(&tocPtr[tocLength + payload.entry.nameOffset], (const char*)payload.name, payload.name.Bytes());
+	tocData->UnlockExclusive();
+
+	PackageHeader header = {};
+	header.magic = PACKAGE_MAGIC;
+	header.version = PACKAGE_VERSION;
+	header.headerSize = PACKAGE_HEADER_SIZE;
+	header.alignment = uint32_t(alignment);
+	header.numEntries = uint32_t(numEntries);
+	header.tocOffset = tocOffset;
+	header.namesOffset = tocOffset + tocLength;
+	header.namesLength = namesLength;
+	header.packageLength = tocOffset + tocLength + namesLength;
+	header.tocChecksum = PackageCRC32(tocData);
+	PackageByteOrder(header);
+
+	// write sequentially, output does not need to be seekable.
+	uint64_t position = 0;
+	auto write = [&](const void* p, size_t length)->bool
+	{
+		if (output->Write(p, length) == length)
+		{
+			position += length;
+			return true;
+		}
+		DKLogE("DKPackageBuilder Error: Output stream error!\n");
+		return false;
+	};
+	auto writePadding = [&](uint64_t target)->bool
+	{
+		static const uint8_t zero[256] = {};
+		while (position < target)
+		{
+			if (!write(zero, size_t(Min(target - position, uint64_t(sizeof(zero))))))
+				return false;
+		}
+		return true;
+	};
+
+	if (!write(&header, sizeof(header)))
+		return false;
+	for (const Payload& payload : payloads)
+	{
+		if (!writePadding(payload.entry.offset))
+			return false;
+		const void* p = payload.data->LockShared();
+		bool result = write(p, size_t(payload.entry.storedLength));
+		payload.data->UnlockShared();
+		if (!result)
+			return false;
+	}
+	if (!writePadding(tocOffset))
+		return false;
+	const void* p = tocData->LockShared();
+	bool result = write(p, tocData->Length());
+	tocData->UnlockShared();
+	return result;
+}
+
+bool DKPackageBuilder::Write(const DKString& path, size_t maxConcurrency) const
+{
+	DKObject<DKFile> file = DKFile::Create(path, DKFile::ModeOpenNew, DKFile::ModeShareExclusive);
+	if (file)
+		return Write(file, maxConcurrency);
+	DKLogE("DKPackageBuilder Error: Cannot create file: %ls\n", (const wchar_t*)path);
+	return false;
+}
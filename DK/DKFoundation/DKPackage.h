@@ -0,0 +1,146 @@
+//
+//  File: DKPackage.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKData.h"
+#include "DKStream.h"
+#include "DKArray.h"
+#include "DKCompressor.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Indexed asset package reader.
+
+	 Package is a single file which contains header, entry data and table of
+	 contents sorted by hash of entry name. Each entry is stored or compressed
+	 with LZ4 or Zstd independently, data of entry is aligned to package
+	 alignment. (from the beginning of file)
+
+	 Package file is mapped entirely with DKFileMap, stored entries are
+	 returned as views of mapped file (zero-copy), compressed entries are
+	 decompressed into single allocation with known size.
+	 Package is immutable, all functions are thread-safe.
+
+	 @code
+	  DKObject<DKPackage> package = DKPackage::Open("/data/assets.dkpkg");
+	  DKObject<DKData> data = package->Data("textures/sky.png");
+	 @endcode
+	 @see DKPackageBuilder
+	 */
+	class DKGL_API DKPackage
+	{
+	public:
+		enum Compression : uint32_t
+		{
+			CompressionStored = 0,
+			CompressionLZ4,
+			CompressionLZ4HC,
+			CompressionZstd,
+			CompressionZstdMax,
+		};
+		struct EntryInfo
+		{
+			DKString name;
+			uint64_t offset;		///< offset of data in package
+			uint64_t length;		///< original length
+			uint64_t storedLength;	///< length of data in package
+			Compression compression;
+			uint32_t crc32;			///< CRC32 of original data
+		};
+
+		~DKPackage();
+
+		/// test magic number without logging, to probe other formats.
+		static bool IsPackage(const DKString& path);
+		static bool IsPackage(const DKData* data);
+
+		static DKObject<DKPackage> Open(const DKString& path);
+		/// open package from data in memory (or mapped file)
+		static DKObject<DKPackage> Open(DKData* data);
+
+		size_t NumberOfEntries() const;
+		size_t Alignment() const;
+		bool EntryInfoAt(size_t index, EntryInfo& info) const;
+		bool FindEntryInfo(const DKString& name, EntryInfo& info) const;
+		bool HasEntry(const DKString& name) const;
+		DKString::StringArray EntryNames() const;
+
+		/// entry data, stored entry is zero-copy view of package data.
+		DKObject<DKData> Data(const DKString& name) const;
+		DKObject<DKStream> OpenStream(const DKString& name) const;
+
+		/// check CRC32 of entire entries.
+		bool Verify() const;
+		bool Verify(const DKString& name) const;
+
+		/// package data. (DKFileMap if opened with path)
+		const DKData* PackageData() const;
+
+	private:
+		DKPackage();
+		DKPackage(const DKPackage&) = delete;
+		DKPackage& operator = (const DKPackage&) = delete;
+		void* impl;
+		friend class DKObject<DKPackage>;
+	};
+
+	/**
+	 @brief
+	 Builds package file read by DKPackage.
+
+	 Entries are compressed in parallel with DKOperationQueue when package is
+	 written. Compressed data is stored only if it is smaller than original.
+	 @code
+	  DKPackageBuilder builder;
+	  builder.AddFile("textures/sky.png", "/src/sky.png", DKPackage::CompressionStored);
+	  builder.AddData("levels/1.json", levelData, DKPackage::CompressionZstd);
+	  builder.Write("/data/assets.dkpkg");
+	 @endcode
+	 */
+	class DKGL_API DKPackageBuilder
+	{
+	public:
+		enum { DefaultAlignment = 16 };
+
+		DKPackageBuilder();
+		~DKPackageBuilder();
+
+		/// alignment of entry data, must be power of two.
+		void SetAlignment(size_t alignment);
+		size_t Alignment() const { return alignment; }
+
+		/// add entry, replaces entry with same name.
+		bool AddData(const DKString& name, DKData* data, DKPackage::Compression compression = DKPackage::CompressionLZ4);
+		bool AddFile(const DKString& name, const DKString& path, DKPackage::Compression compression = DKPackage::CompressionLZ4);
+		void Remove(const DKString& name);
+		void RemoveAll();
+		size_t NumberOfEntries() const { return entries.Count(); }
+
+		/// compress entries and write package.
+		/// maxConcurrency: number of compression threads, 0 for default.
+		bool Write(DKStream* output, size_t maxConcurrency = 0) const;
+		bool Write(const DKString& path, size_t maxConcurrency = 0) const;
+
+	private:
+		DKPackageBuilder(const DKPackageBuilder&) = delete;
+		DKPackageBuilder& operator = (const DKPackageBuilder&) = delete;
+
+		struct Entry
+		{
+			DKString name;
+			DKObject<DKData> data;
+			DKPackage::Compression compression;
+		};
+		DKArray<Entry> entries;
+		size_t alignment;
+	};
+}
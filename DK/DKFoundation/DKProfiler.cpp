@@ -0,0 +1,393 @@
+//
+//  File: DKProfiler.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include <atomic>
+#include "DKProfiler.h"
+#include "DKSpinLock.h"
+#include "DKThread.h"
+#include "DKArray.h"
+#include "DKBuffer.h"
+#include "DKBufferStream.h"
+#include "DKStringU8.h"
+#include "DKJsonStreamWriter.h"
+#include "DKMemory.h"
+
+namespace DKFoundation::Private
+{
+    volatile bool profilerEnabled = false;
+
+    enum
+    {
+        ProfilerChunkSize = 4096,
+    };
+
+    struct ProfilerEvent
+    {
+        enum Type : uint32_t { Complete, Instant };
+        const char* name;
+        DKTimer::Tick begin;
+        DKTimer::Tick end;
+        Type type;
+    };
+
+    // Chunks are never deallocated, they are reused by next capture.
+    struct ProfilerChunk
+    {
+        ProfilerChunk* next;
+        ProfilerEvent events[ProfilerChunkSize];
+    };
+
+    enum { ProfilerMaxThreadName = 64 };
+
+    // Per-thread event buffer, only owner thread writes events.
+    // Buffers are never removed from list, released buffer can be reused
+    // by other thread in next capture.
+    struct ProfilerThread
+    {
+        DKThread::ThreadId owner;
+        uint64_t captureId;
+        uint32_t serial;            // tid of trace
+        char name[ProfilerMaxThreadName];   // UTF-8, guarded by profilerLock
+        ProfilerChunk* first;
+        ProfilerChunk* current;
+        size_t used;                // events in current chunk (owner only)
+        size_t maxEvents;
+        std::atomic<size_t> numEvents;  // committed events, read by exporter
+        std::atomic<size_t> dropped;
+        ProfilerThread* next;
+    };
+
+    static DKSpinLock profilerLock;
+    static ProfilerThread* profilerThreads = NULL;
+    static std::atomic<uint64_t> profilerCaptureId = 0;
+    static DKTimer::Tick profilerBaseTick = 0;
+    static size_t profilerMaxEvents = 0;
+    static uint32_t profilerSerial = 0;
+
+    // buffers are not deallocated, name is stored in buffer without
+    // allocating memory from pool.
+    static void ProfilerSetName(ProfilerThread* thread, const DKString& name)
+    {
+        DKStringU8 str(name);
+        const char* p = (const char*)str;
+        size_t len = Min(str.Bytes(), size_t(ProfilerMaxThreadName) - 1);
+        // don't split multi-byte sequence.
+        while (len > 0 && len < str.Bytes() && (static_cast<unsigned char>(p[len]) & 0xc0) == 0x80)
+            --len;
+        if (len > 0)
+            memcpy(thread->name, p, len);
+        thread->name[len] = 0;
+    }
+
+    static DKString ProfilerThreadName(DKThread::ThreadId tid)
+    {
+        if (DKObject<DKThread> t = DKThread::FindThread(tid); t)
+            return t->Name();
+        return "";
+    }
+
+    struct ProfilerThreadLocal
+    {
+        uint64_t captureId = 0;
+        ProfilerThread* thread = NULL;
+        DKString name;
+
+        ~ProfilerThreadLocal()
+        {
+            DKThread::ThreadId tid = DKThread::CurrentThreadId();
+            DKString threadName = name.Length() > 0 ? name : ProfilerThreadName(tid);
+
+            profilerLock.Lock();
+            for (ProfilerThread* t = profilerThreads; t; t = t->next)
+            {
+                if (t->owner == tid)
+                {
+                    if (t->name[0] == 0 && threadName.Length() > 0)
+                        ProfilerSetName(t, threadName);
+                    t->owner = DKThread::invalidId;
+                    break;
+                }
+            }
+            profilerLock.Unlock();
+        }
+    };
+    static thread_local ProfilerThreadLocal profilerThreadLocal;
+
+    // buffer of calling thread for current capture, reset when the thread
+    // records first event of capture.
+    static ProfilerThread* ProfilerThreadBuffer()
+    {
+        ProfilerThreadLocal& tl = profilerThreadLocal;
+        uint64_t captureId = profilerCaptureId.load(std::memory_order_acquire);
+        if (tl.captureId == captureId)
+            return tl.thread;
+
+        DKThread::ThreadId tid = DKThread::CurrentThreadId();
+        DKString threadName = tl.name.Length() > 0 ? tl.name : ProfilerThreadName(tid);
+        ProfilerThread* thread = NULL;
+        ProfilerThread* unused = NULL;
+
+        profilerLock.Lock();
+        if (captureId != profilerCaptureId.load(std::memory_order_relaxed))
+        {
+            profilerLock.Unlock();
+            return NULL;    // capture restarted.
+        }
+        for (ProfilerThread* t = profilerThreads; t; t = t->next)
+        {
+            if (t->owner == tid)
+            {
+                thread = t;
+                break;
+            }
+            // buffer of exited thread, which has no events of this capture.
+            if (unused == NULL && t->owner == DKThread::invalidId && t->captureId != captureId)
+                unused = t;
+        }
+        if (thread == NULL)
+        {
+            thread = unused;
+            if (thread == NULL)
+            {
+                thread = new ProfilerThread();
+                thread->first = NULL;
+                thread->next = profilerThreads;
+                profilerThreads = thread;
+            }
+            thread->owner = tid;
+        }
+        thread->captureId = captureId;
+        thread->serial = ++profilerSerial;
+        ProfilerSetName(thread, threadName);
+        thread->current = thread->first;
+        thread->used = 0;
+        thread->maxEvents = profilerMaxEvents;
+        thread->numEvents.store(0, std::memory_order_relaxed);
+        thread->dropped.store(0, std::memory_order_relaxed);
+        profilerLock.Unlock();
+
+        tl.captureId = captureId;
+        tl.thread = thread;
+        return thread;
+    }
+
+    static void ProfilerRecord(const char* name, DKTimer::Tick begin, DKTimer::Tick end, ProfilerEvent::Type type)
+    {
+        ProfilerThread* thread = ProfilerThreadBuffer();
+        if (thread == NULL)
+            return;
+
+        size_t n = thread->numEvents.load(std::memory_order_relaxed);
+        if (n >= thread->maxEvents)
+        {
+            thread->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ProfilerChunk* chunk = thread->current;
+        if (chunk == NULL || thread->used == ProfilerChunkSize)
+        {
+            ProfilerChunk* next = chunk ? chunk->next : thread->first;
+            if (next == NULL)
+            {
+                next = reinterpret_cast<ProfilerChunk*>(DKMemoryHeapAlloc(sizeof(ProfilerChunk)));
+                if (next == NULL)
+                {
+                    thread->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                next->next = NULL;
+                // link new chunk before publishing events in it.
+                if (chunk)
+                    chunk->next = next;
+                else
+                    thread->first = next;
+            }
+            thread->current = chunk = next;
+            thread->used = 0;
+        }
+        chunk->events[thread->used++] = { name, begin, end, type };
+        thread->numEvents.store(n + 1, std::memory_order_release);
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+void DKProfiler::Start(size_t maxEventsPerThread)
+{
+	profilerLock.Lock();
+	profilerMaxEvents = Max(maxEventsPerThread, size_t(1));
+	profilerBaseTick = DKTimer::SystemTick();
+	profilerSerial = 0;
+	profilerCaptureId.fetch_add(1, std::memory_order_release);
+	profilerEnabled = true;
+	profilerLock.Unlock();
+}
+
+void DKProfiler::Stop()
+{
+	profilerEnabled = false;
+}
+
+void DKProfiler::SetThreadName(const DKString& name)
+{
+	ProfilerThreadLocal& tl = profilerThreadLocal;
+	tl.name = name;
+	if (tl.thread)
+	{
+		profilerLock.Lock();
+		if (tl.thread->owner == DKThread::CurrentThreadId())
+			ProfilerSetName(tl.thread, name);
+		profilerLock.Unlock();
+	}
+}
+
+void DKProfiler::Record(const char* name, Tick begin, Tick end)
+{
+	if (profilerEnabled)
+		ProfilerRecord(name, begin, end, ProfilerEvent::Complete);
+}
+
+void DKProfiler::Mark(const char* name)
+{
+	if (profilerEnabled)
+	{
+		Tick t = DKTimer::SystemTick();
+		ProfilerRecord(name, t, t, ProfilerEvent::Instant);
+	}
+}
+
+size_t DKProfiler::NumberOfEvents()
+{
+	size_t num = 0;
+	uint64_t captureId = profilerCaptureId.load(std::memory_order_acquire);
+	profilerLock.Lock();
+	for (ProfilerThread* t = profilerThreads; t; t = t->next)
+	{
+		if (t->captureId == captureId)
+			num += t->numEvents.load(std::memory_order_acquire);
+	}
+	profilerLock.Unlock();
+	return num;
+}
+
+size_t DKProfiler::NumberOfDroppedEvents()
+{
+	size_t num = 0;
+	uint64_t captureId = profilerCaptureId.load(std::memory_order_acquire);
+	profilerLock.Lock();
+	for (ProfilerThread* t = profilerThreads; t; t = t->next)
+	{
+		if (t->captureId == captureId)
+			num += t->dropped.load(std::memory_order_relaxed);
+	}
+	profilerLock.Unlock();
+	return num;
+}
+
+size_t DKProfiler::Export(DKStream* output)
+{
+	if (output == NULL || !output->IsWritable())
+		return 0;
+
+	struct ThreadInfo
+	{
+		ProfilerThread* thread;
+		uint32_t serial;
+		size_t numEvents;
+		DKThread::ThreadId owner;
+		DKStringU8 name;
+	};
+	DKArray<ThreadInfo> threads;
+	Tick baseTick;
+
+	// Buffers and chunks are never deallocated, events committed before
+	// this point can be read without lock. Buffer can be reset by owner
+	// if new capture begins while exporting, but memory is still valid.
+	profilerLock.Lock();
+	uint64_t captureId = profilerCaptureId.load(std::memory_order_relaxed);
+	baseTick = profilerBaseTick;
+	for (ProfilerThread* t = profilerThreads; t; t = t->next)
+	{
+		if (t->captureId == captureId)
+			threads.Add({ t, t->serial, t->numEvents.load(std::memory_order_acquire), t->owner, t->name });
+	}
+	profilerLock.Unlock();
+
+	threads.Sort([](const ThreadInfo& a, const ThreadInfo& b) { return a.serial < b.serial; });
+
+	const double tickToMicroseconds = 1000000.0 / static_cast<double>(DKTimer::SystemTickFrequency());
+
+	JsonStreamWriter writer(output);
+	writer.Write("{\"traceEvents\":[\n");
+	bool first = true;
+	DKArray<ProfilerEvent> events;
+	for (ThreadInfo& info : threads)
+	{
+		if (info.name.Bytes() == 0 && info.owner != DKThread::invalidId)
+			info.name = ProfilerThreadName(info.owner);
+		if (info.name.Bytes() == 0)
+			info.name = DKStringU8::Format("Thread %u", info.serial);
+
+		writer.Write(first ? "" : ",\n");
+		first = false;
+		writer.Format("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", info.serial);
+		writer.WriteString((const char*)info.name);
+		writer.Write("}}");
+		writer.Format(",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}", info.serial, info.serial);
+
+		// copy events to sort, parent scope must be placed before children
+		// which begins at same tick.
+		events.Clear();
+		events.Reserve(info.numEvents);
+		size_t remains = info.numEvents;
+		for (ProfilerChunk* chunk = info.thread->first; chunk && remains > 0; chunk = chunk->next)
+		{
+			size_t n = Min(remains, size_t(ProfilerChunkSize));
+			events.Add(chunk->events, n);
+			remains -= n;
+		}
+		events.Sort([](const ProfilerEvent& a, const ProfilerEvent& b)
+		{
+			if (a.begin == b.begin)
+				return a.end > b.end;
+			return a.begin < b.begin;
+		});
+
+		for (const ProfilerEvent& e : events)
+		{
+			if (e.begin < baseTick)	// scope began before capture.
+				continue;
+			double ts = static_cast<double>(e.begin - baseTick) * tickToMicroseconds;
+			writer.Write(",\n{\"name\":");
+			writer.WriteString(e.name ? e.name : "");
+			if (e.type == ProfilerEvent::Instant)
+			{
+				writer.Format(",\"cat\":\"DK\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+							  ts, info.serial);
+			}
+			else
+			{
+				double dur = static_cast<double>(e.end - e.begin) * tickToMicroseconds;
+				writer.Format(",\"cat\":\"DK\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+							  ts, dur, info.serial);
+			}
+		}
+	}
+	writer.Write("\n],\"displayTimeUnit\":\"ms\"}\n");
+	writer.Flush();
+	return writer.total;
+}
+
+DKObject<DKData> DKProfiler::Export()
+{
+	DKObject<DKBuffer> buffer = DKOBJECT_NEW DKBuffer();
+	DKBufferStream stream(buffer);
+	Export(&stream);
+	return buffer.SafeCast<DKData>();
+}
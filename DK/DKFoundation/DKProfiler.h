@@ -0,0 +1,126 @@
+//
+//  File: DKProfiler.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKData.h"
+#include "DKStream.h"
+#include "DKTimer.h"
+
+namespace DKFoundation
+{
+	namespace Private
+	{
+		/// Scope profiling hooks, see DKProfiler.
+		extern DKGL_API volatile bool profilerEnabled;
+	}
+
+	/**
+	 @brief
+	 Scoped hot-path profiler. (opt-in)
+
+	 Records begin and end time of instrumented scopes while capturing.
+	 Each thread writes events into its own buffer without locking, buffers
+	 are merged when captured events are exported. Captured events can be
+	 exported as Chrome trace event format (JSON), which can be opened with
+	 chrome://tracing or Perfetto UI (https://ui.perfetto.dev).
+	 When not capturing, a scope costs only one flag test.
+
+	 Nested scopes are displayed as stacks, threads are displayed with
+	 names of DKThread or names set by SetThreadName().
+
+	 @code
+	  void MyScene::Update(double delta, DKTimeTick tick)
+	  {
+		  DKPROFILE_FUNCTION();
+		  ...
+		  {
+			  DKPROFILE_SCOPE("MyScene::Update.Animation");
+			  ...
+		  }
+	  }
+
+	  DKProfiler::Start();
+	  ...
+	  DKProfiler::Stop();
+	  DKProfiler::Export(DKFile::Create(L"trace.json", DKFile::ModeOpenNew, DKFile::ModeShareExclusive));
+	 @endcode
+
+	 @note
+	  Names of scopes and marks must be static strings (string literal),
+	  only pointers are recorded, strings are read when exported.
+	  Events beyond maxEventsPerThread are dropped until next capture.
+	 */
+	class DKGL_API DKProfiler
+	{
+	public:
+		using Tick = DKTimer::Tick;
+
+		/// Records a complete event with lifetime of this object.
+		class Scope
+		{
+		public:
+			Scope(const char* n) : name(NULL), start(0)
+			{
+				if (Private::profilerEnabled)
+				{
+					name = n;
+					start = DKTimer::SystemTick();
+				}
+			}
+			~Scope()
+			{
+				if (name)
+					DKProfiler::Record(name, start, DKTimer::SystemTick());
+			}
+		private:
+			Scope(const Scope&) = delete;
+			Scope& operator = (const Scope&) = delete;
+			const char* name;
+			Tick start;
+		};
+
+		/// start capture, events of previous capture are discarded.
+		static void Start(size_t maxEventsPerThread = 0x100000);
+		static void Stop();
+		static bool IsCapturing() { return Private::profilerEnabled; }
+
+		/// set name of calling thread to be displayed.
+		/// (default is name of DKThread or 'Thread N')
+		static void SetThreadName(const DKString& name);
+
+		/// record complete event, begin and end are DKTimer::SystemTick().
+		static void Record(const char* name, Tick begin, Tick end);
+		/// record instant event. (frame boundary, etc.)
+		static void Mark(const char* name);
+
+		/// number of events recorded and dropped in current or last capture.
+		static size_t NumberOfEvents();
+		static size_t NumberOfDroppedEvents();
+
+		/// write events as Chrome trace event format JSON,
+		/// returns number of bytes written.
+		/// events can be exported while capturing.
+		static size_t Export(DKStream* output);
+		static DKObject<DKData> Export();
+
+	private:
+		DKProfiler() = delete;
+	};
+}
+
+#define DKPROFILE_CONCAT_(a, b)		a##b
+#define DKPROFILE_CONCAT(a, b)		DKPROFILE_CONCAT_(a, b)
+
+/// profile enclosing scope with static name.
+#define DKPROFILE_SCOPE(name)		DKFoundation::DKProfiler::Scope DKPROFILE_CONCAT(dkProfileScope_, __LINE__)(name)
+/// profile enclosing function.
+#define DKPROFILE_FUNCTION()		DKPROFILE_SCOPE(__FUNCTION__)
+/// record instant event with static name.
+#define DKPROFILE_MARK(name)		do { if (DKFoundation::Private::profilerEnabled) DKFoundation::DKProfiler::Mark(name); } while (0)
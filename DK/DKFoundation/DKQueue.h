@@ -384,18 +384,18 @@ namespace DKFoundation
 				VALUE* tmp = NULL;
 				if (count > 0)
 				{
-					if (begin > 0)
+					if (begin > 0 || !std::is_trivially_copyable<VALUE>::value)
 					{
-						tmp = Allocator::Alloc(sizeof(VALUE) * count);
+						tmp = (VALUE*)Allocator::Alloc(sizeof(VALUE) * count);
 						DKASSERT_DESC_DEBUG(tmp, "Out of memory!");
 						if (tmp == NULL)
 							return;
-						memcpy(tmp, std::addressof(data[begin]), sizeof(VALUE) * count);
+						Relocate(tmp, std::addressof(data[begin]), count);
 						Allocator::Free(data);
 					}
 					else
 					{
-						tmp = Allocator::Realloc(data, sizeof(VALUE) * count);
+						tmp = (VALUE*)Allocator::Realloc(data, sizeof(VALUE) * count);
 						DKASSERT_DESC_DEBUG(tmp, "Out of memory!");
 						if (tmp == NULL)
 							return;
@@ -570,6 +570,31 @@ namespace DKFoundation
 			for (size_t i = 1; i <= count && !stop; ++i)
 				enumerator(data[begin+count-i], &stop);
 		}
+		// move objects to uninitialized (or overlapping) storage,
+		// objects which are not trivially copyable are move-constructed.
+		static void Relocate(VALUE* dst, VALUE* src, size_t n)
+		{
+			if constexpr (std::is_trivially_copyable<VALUE>::value)
+			{
+				memmove(dst, src, sizeof(VALUE) * n);
+			}
+			else if (dst < src)
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					new(std::addressof(dst[i])) VALUE(std::move(src[i]));
+					src[i].~VALUE();
+				}
+			}
+			else if (dst > src)
+			{
+				for (size_t i = n; i > 0; --i)
+				{
+					new(std::addressof(dst[i-1])) VALUE(std::move(src[i-1]));
+					src[i-1].~VALUE();
+				}
+			}
+		}
 		void ReserveFront(size_t n)
 		{
 			if (begin > n)
@@ -585,7 +610,7 @@ namespace DKFoundation
 			if (data)
 			{
 				if (count)
-					memcpy(std::addressof(dataNew[begin+offset]), std::addressof(data[begin]), sizeof(VALUE) * count);
+					Relocate(std::addressof(dataNew[begin+offset]), std::addressof(data[begin]), count);
 				Allocator::Free(data);
 			}
 			maxSize += offset;
@@ -606,7 +631,7 @@ namespace DKFoundation
 			if (data)
 			{
 				if (count)
-					memcpy(std::addressof(dataNew[begin]), std::addressof(data[begin]), sizeof(VALUE) * count);
+					Relocate(std::addressof(dataNew[begin]), std::addressof(data[begin]), count);
 				Allocator::Free(data);
 			}
 			maxSize = newSize;
@@ -624,7 +649,7 @@ namespace DKFoundation
 			if (begin2 != begin)
 			{
 				if (count > 0)
-					memmove(std::addressof(data[begin2]), std::addressof(data[begin]), sizeof(VALUE) * count);
+					Relocate(std::addressof(data[begin2]), std::addressof(data[begin]), count);
 				begin = begin2;
 			}
 		}
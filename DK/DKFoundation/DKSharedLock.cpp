@@ -16,6 +16,8 @@
 #include "DKThread.h"
 #include "DKMap.h"
 #include "DKSpinLock.h"
+#include "DKAtomicNumber32.h"
+#include "DKUtils.h"
 
 namespace DKFoundation
 {
@@ -218,56 +220,191 @@ namespace DKFoundation
 			pthread_rwlockattr_t attr;
 		};
 #endif
+
+		/// reader-biased shared lock.
+		/// each thread has reader indicator slot, writer sets writer flag
+		/// and waits until all reader indicators are drained.
+		/// readers which see writer flag wait on underlying shared lock,
+		/// which is exclusively locked by writer.
+		class ReaderBiasedSharedLockImpl
+		{
+		public:
+			enum { CacheLineSize = 64 };
+			struct alignas(CacheLineSize) ReaderSlot
+			{
+				DKAtomicNumber32 readers;
+			};
+
+			ReaderBiasedSharedLockImpl()
+				: writer(0)
+			{
+				// number of slots: power of two, twice as many as processors.
+				uint32_t n = Clamp(DKNumberOfProcessors() * 2, 8U, 256U);
+				numSlots = 1;
+				while (numSlots < n)
+					numSlots = numSlots << 1;
+				slots = new ReaderSlot[numSlots];
+			}
+			~ReaderBiasedSharedLockImpl()
+			{
+#ifdef DKGL_DEBUG_ENABLED
+				for (uint32_t i = 0; i < numSlots; ++i)
+					DKASSERT_DEBUG(slots[i].readers == 0);
+#endif
+				delete[] slots;
+			}
+			void Lock() const
+			{
+				gate.Lock();
+				writer = 1;	// atomic exchange, full barrier
+				WaitForReaders();
+			}
+			bool TryLock() const
+			{
+				if (gate.TryLock())
+				{
+					writer = 1;
+					for (uint32_t i = 0; i < numSlots; ++i)
+					{
+						if (slots[i].readers != 0)
+						{
+							writer = 0;
+							gate.Unlock();
+							return false;
+						}
+					}
+					return true;
+				}
+				return false;
+			}
+			void Unlock() const
+			{
+				DKASSERT_DEBUG(writer != 0);
+				writer = 0;
+				gate.Unlock();
+			}
+			void LockShared() const
+			{
+				DKAtomicNumber32& readers = CurrentSlot().readers;
+				while (true)
+				{
+					readers.Increment();	// full barrier
+					if (writer == 0)
+						return;
+					readers.Decrement();
+					// wait for writer.
+					gate.LockShared();
+					gate.UnlockShared();
+				}
+			}
+			bool TryLockShared() const
+			{
+				DKAtomicNumber32& readers = CurrentSlot().readers;
+				readers.Increment();
+				if (writer == 0)
+					return true;
+				readers.Decrement();
+				return false;
+			}
+			void UnlockShared() const
+			{
+#ifdef DKGL_DEBUG_ENABLED
+				DKAtomicNumber32::Value prev = CurrentSlot().readers.Decrement();
+				DKASSERT_DESC_DEBUG(prev > 0, "The current thread does not own the lock.");
+#else
+				CurrentSlot().readers.Decrement();
+#endif
+			}
+		private:
+			ReaderSlot& CurrentSlot() const
+			{
+				// thread slot index is assigned once per thread, round robin.
+				static DKAtomicNumber32 threadCounter = 0;
+				static thread_local uint32_t threadIndex = static_cast<uint32_t>(threadCounter.Increment());
+				return slots[threadIndex & (numSlots - 1)];
+			}
+			void WaitForReaders() const
+			{
+				for (uint32_t i = 0; i < numSlots; ++i)
+				{
+					while (slots[i].readers != 0)
+						DKThread::Yield();
+				}
+			}
+			SharedLockImpl gate;	// exclusively locked by writer.
+			ReaderSlot* slots;
+			uint32_t numSlots;
+			mutable DKAtomicNumber32 writer;
+		};
 	}
 }
 
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
 
-DKSharedLock::DKSharedLock()
+DKSharedLock::DKSharedLock(Policy p)
+	: policy(p)
 {
-	impl = reinterpret_cast<void*>(new SharedLockImpl());
+	if (policy == PolicyReaderBiased)
+		impl = reinterpret_cast<void*>(new ReaderBiasedSharedLockImpl());
+	else
+		impl = reinterpret_cast<void*>(new SharedLockImpl());
 	DKASSERT_DEBUG(impl != NULL);
 }
 
 DKSharedLock::~DKSharedLock()
 {
 	DKASSERT_DEBUG(impl != NULL);
-	delete reinterpret_cast<SharedLockImpl*>(impl);
+	if (policy == PolicyReaderBiased)
+		delete reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl);
+	else
+		delete reinterpret_cast<SharedLockImpl*>(impl);
 }
 
 void DKSharedLock::LockShared() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->LockShared();
 	return reinterpret_cast<SharedLockImpl*>(impl)->LockShared();
 }
 
 bool DKSharedLock::TryLockShared() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->TryLockShared();
 	return reinterpret_cast<SharedLockImpl*>(impl)->TryLockShared();
 }
 
 void DKSharedLock::UnlockShared() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->UnlockShared();
 	return reinterpret_cast<SharedLockImpl*>(impl)->UnlockShared();
 }
 
 void DKSharedLock::Lock() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->Lock();
 	return reinterpret_cast<SharedLockImpl*>(impl)->Lock();
 }
 
 bool DKSharedLock::TryLock() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->TryLock();
 	return reinterpret_cast<SharedLockImpl*>(impl)->TryLock();
 }
 
 void DKSharedLock::Unlock() const
 {
 	DKASSERT_DEBUG(impl != NULL);
+	if (policy == PolicyReaderBiased)
+		return reinterpret_cast<ReaderBiasedSharedLockImpl*>(impl)->Unlock();
 	return reinterpret_cast<SharedLockImpl*>(impl)->Unlock();
 }
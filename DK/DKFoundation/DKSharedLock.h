@@ -7,6 +7,7 @@
 
 #pragma once
 #include "../DKInclude.h"
+#include "DKCriticalSection.h"
 
 namespace DKFoundation
 {
@@ -15,13 +16,26 @@ namespace DKFoundation
 	/// LockShared(), read-lock, can be locked by some threads concurrently.
 	/// Lock (write-lock, exclusive), only one thread can have lock.
 	///
+	/// PolicyReaderBiased: readers increment a reader indicator of their own
+	/// thread slot (one cache-line per slot), a writer blocks new readers and
+	/// waits until all slots are drained. Read-locking does not touch
+	/// shared cache-line, but write-locking is expensive.
+	/// Use this policy for read-mostly objects shared by many threads.
+	///
 	/// @note
 	///  Only exclusive locking works with DKCriticalSecton.
 	///  Use DKSharedLockReadOnlySecton instead for shared-locking with scoped context.
+	///  Recursive shared-locking is not allowed, it can be dead-locked
+	///  if there is a waiting writer.
 	class DKGL_API DKSharedLock
 	{
 	public:
-		DKSharedLock();
+		enum Policy
+		{
+			PolicyDefault = 0,		///< system rw-lock (SRWLock, pthread_rwlock)
+			PolicyReaderBiased,		///< scalable reader, expensive writer
+		};
+		DKSharedLock(Policy policy = PolicyDefault);
 		~DKSharedLock();
 		void LockShared() const;
 		bool TryLockShared() const;
@@ -34,6 +48,7 @@ namespace DKFoundation
 		DKSharedLock(const DKSharedLock&) = delete;
 		DKSharedLock& operator = (const DKSharedLock&) = delete;
 		void* impl;
+		const Policy policy;
 	};
 
 	/// context scope based helper class for DKSharedLock
@@ -41,12 +56,41 @@ namespace DKFoundation
 	class DKSharedLockReadOnlySection
 	{
 	public:
-		DKSharedLockReadOnlySection(const DKSharedLock& sl) : lock(sl) { lock.LockShared(); }
-		~DKSharedLockReadOnlySection() { lock.UnlockShared(); }
+		DKSharedLockReadOnlySection(const DKSharedLock& sl)
+			: lock(sl)
+			, profiling(false)
+			, profile{}
+		{
+			if (Private::lockProfilerEnabled)
+			{
+				profiling = true;
+				uint64_t t = Private::LockProfilerTick();
+				profile.contended = !lock.TryLockShared();
+				if (profile.contended)
+					lock.LockShared();
+				profile.acquired = Private::LockProfilerTick();
+				profile.waitTicks = profile.acquired - t;
+			}
+			else
+				lock.LockShared();
+		}
+		~DKSharedLockReadOnlySection()
+		{
+			if (profiling)
+			{
+				uint64_t holdTicks = Private::LockProfilerTick() - profile.acquired;
+				lock.UnlockShared();
+				Private::LockProfilerRecord(&lock, profile.waitTicks, holdTicks, profile.contended);
+			}
+			else
+				lock.UnlockShared();
+		}
 
 	private:
 		DKSharedLockReadOnlySection(const DKSharedLockReadOnlySection&) = delete;
 		DKSharedLockReadOnlySection& operator = (const DKSharedLockReadOnlySection&) = delete;
 		const DKSharedLock& lock;
+		bool profiling;
+		Private::LockProfilingSection profile;
 	};
 }
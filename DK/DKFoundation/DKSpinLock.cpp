@@ -5,8 +5,22 @@
 //  Copyright (c) 2004-2016 Hongtae Kim. All rights reserved.
 //
 
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment (lib, "Synchronization")
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #include "DKSpinLock.h"
 #include "DKThread.h"
+#include "DKUtils.h"
 
 namespace DKFoundation
 {
@@ -16,7 +30,56 @@ namespace DKFoundation
 		{
 			SpinLockStateFree = 0,
 			SpinLockStateLocked = 1,
+			SpinLockStateContended = 2,	///< locked, and there might be parked threads.
+		};
+		enum : DKAtomicNumber32::Value
+		{
+			SpinLockMinSpin = 4,
+			SpinLockMaxSpin = 1024,	///< max number of pause instructions.
 		};
+
+		FORCEINLINE void SpinLockPause(uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+				_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+				__asm__ __volatile__("yield");
+#endif
+			}
+		}
+
+		// DKAtomicNumber32 is used as 32-bit wait address.
+		static_assert(sizeof(DKAtomicNumber32) == sizeof(DKAtomicNumber32::Value), "Invalid atomic size");
+
+		FORCEINLINE void SpinLockPark(DKAtomicNumber32& state)
+		{
+#if defined(__linux__)
+			syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAIT_PRIVATE, SpinLockStateContended, NULL, NULL, 0);
+#elif defined(_WIN32)
+			LONG cmp = SpinLockStateContended;
+			::WaitOnAddress(&state, &cmp, sizeof(LONG), INFINITE);
+#else
+			DKThread::Yield();
+#endif
+		}
+
+		FORCEINLINE void SpinLockUnpark(DKAtomicNumber32& state)
+		{
+#if defined(__linux__)
+			syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#elif defined(_WIN32)
+			::WakeByAddressSingle(&state);
+#endif
+		}
+
+		static bool SpinLockShouldSpin()
+		{
+			// spinning is useless on single processor system.
+			static const bool multiProcessors = DKNumberOfProcessors() > 1;
+			return multiProcessors;
+		}
 	}
 }
 
@@ -25,17 +88,47 @@ using namespace DKFoundation::Private;
 
 DKSpinLock::DKSpinLock()
 	: state(SpinLockStateFree)
+	, spinLimit(SpinLockMaxSpin / 4)
 {
 }
 
 DKSpinLock::~DKSpinLock()
 {
+	DKASSERT_DEBUG(state == SpinLockStateFree);
 }
 
 void DKSpinLock::Lock() const
 {
-	while (!TryLock())
-		DKThread::Yield();
+	if (state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked))
+		return;
+
+	// spin with exponential backoff.
+	if (SpinLockShouldSpin())
+	{
+		const DKAtomicNumber32::Value limit = spinLimit;
+		DKAtomicNumber32::Value spins = 0;
+		for (DKAtomicNumber32::Value backoff = 1; spins < limit; backoff = backoff << 1)
+		{
+			backoff = Min(backoff, limit - spins);
+			SpinLockPause(backoff);
+			spins += backoff;
+			if (state == SpinLockStateFree && state.CompareAndSet(SpinLockStateFree, SpinLockStateLocked))
+			{
+				// acquired while spinning, spin a bit longer next time.
+				if (limit < SpinLockMaxSpin)
+					spinLimit = Min(limit + limit / 8 + 1, (DKAtomicNumber32::Value)SpinLockMaxSpin);
+				return;
+			}
+		}
+		// spinning did not help, spin shorter next time.
+		if (limit > SpinLockMinSpin)
+			spinLimit = Max(limit - limit / 8 - 1, (DKAtomicNumber32::Value)SpinLockMinSpin);
+	}
+
+	// park until unlocked. a thread which acquires lock from here keeps
+	// state as contended, because there might be other parked threads.
+	while (state.Exchange(SpinLockStateContended) != SpinLockStateFree)
+		SpinLockPark(state);
 }
 
 bool DKSpinLock::TryLock() const
@@ -45,5 +138,7 @@ bool DKSpinLock::TryLock() const
 
 void DKSpinLock::Unlock() const
 {
-	state = SpinLockStateFree;
+	DKASSERT_DEBUG(state != SpinLockStateFree);
+	if (state.Exchange(SpinLockStateFree) == SpinLockStateContended)
+		SpinLockUnpark(state);
 }
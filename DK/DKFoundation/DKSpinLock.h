@@ -11,8 +11,12 @@
 
 namespace DKFoundation
 {
-	/// a busy-waiting locking class.
+	/// an adaptive spin-then-park locking class.
 	/// atomic variable used internally.
+	/// Lock() spins with exponential backoff for a while, and then parks the
+	/// calling thread until the lock has been released. (futex on Linux,
+	/// WaitOnAddress on Windows, yield on other platforms)
+	/// The spin count is adjusted by recent lock acquisitions.
 	/// use this class for short period locking.
 	/// (such as small computation, without I/O.)
 	class DKGL_API DKSpinLock
@@ -28,5 +32,6 @@ namespace DKFoundation
 		DKSpinLock(const DKSpinLock&) = delete;
 		DKSpinLock& operator = (const DKSpinLock&) = delete;
 		mutable DKAtomicNumber32 state;
+		mutable DKAtomicNumber32 spinLimit;
 	};
 }
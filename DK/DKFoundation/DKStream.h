@@ -11,12 +11,25 @@
 namespace DKFoundation
 {
 	/// a simple stream interface.
+	///
+	/// Positional I/O (ReadAt, WriteAt) does not use current position of
+	/// stream, like pread/pwrite. Vectored I/O (ReadV, WriteV) transfers
+	/// multiple buffers with single call, like readv/writev.
+	/// Default implementations of these functions use Read/Write and
+	/// SetCurrentPosition, subclasses can override to provide native ones.
 	class DKStream
 	{
 	public:
 		using Position = uint64_t;
 		enum : Position { PositionError = ~Position(0) };
 
+		/// buffer for vectored I/O
+		struct IOVector
+		{
+			void* data;
+			size_t length;
+		};
+
 		DKStream() {}
 		virtual ~DKStream() {}
 
@@ -31,5 +44,80 @@ namespace DKFoundation
 		virtual bool IsReadable() const = 0;
 		virtual bool IsWritable() const = 0;
 		virtual bool IsSeekable() const = 0;
+
+		/// read at given position. (stream must be seekable)
+		/// default implementation restores current position after reading.
+		virtual size_t ReadAt(Position pos, void* p, size_t s)
+		{
+			IOVector v = { p, s };
+			return ReadVAt(pos, &v, 1);
+		}
+		/// write at given position. (stream must be seekable)
+		/// default implementation restores current position after writing.
+		virtual size_t WriteAt(Position pos, const void* p, size_t s)
+		{
+			IOVector v = { const_cast<void*>(p), s };
+			return WriteVAt(pos, &v, 1);
+		}
+		/// scatter read from current position.
+		/// returns total bytes read, stops at first short read.
+		virtual size_t ReadV(const IOVector* v, size_t count)
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (v[i].length == 0)
+					continue;
+				size_t r = Read(v[i].data, v[i].length);
+				if (r == (size_t)-1)
+					return total > 0 ? total : r;
+				total += r;
+				if (r < v[i].length)
+					break;
+			}
+			return total;
+		}
+		/// gather write to current position.
+		/// returns total bytes written, stops at first short write.
+		virtual size_t WriteV(const IOVector* v, size_t count)
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (v[i].length == 0)
+					continue;
+				size_t r = Write(v[i].data, v[i].length);
+				if (r == (size_t)-1)
+					return total > 0 ? total : r;
+				total += r;
+				if (r < v[i].length)
+					break;
+			}
+			return total;
+		}
+		/// scatter read at given position. (stream must be seekable)
+		virtual size_t ReadVAt(Position pos, const IOVector* v, size_t count)
+		{
+			if (!IsSeekable())
+				return (size_t)-1;
+			Position cur = CurrentPosition();
+			if (SetCurrentPosition(pos) != pos)
+				return 0;
+			size_t r = ReadV(v, count);
+			SetCurrentPosition(cur);
+			return r;
+		}
+		/// gather write at given position. (stream must be seekable)
+		virtual size_t WriteVAt(Position pos, const IOVector* v, size_t count)
+		{
+			if (!IsSeekable())
+				return (size_t)-1;
+			Position cur = CurrentPosition();
+			if (SetCurrentPosition(pos) != pos)
+				return 0;
+			size_t r = WriteV(v, count);
+			SetCurrentPosition(cur);
+			return r;
+		}
 	};
 }
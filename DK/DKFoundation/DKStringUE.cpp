@@ -813,7 +813,60 @@ namespace DKFoundation
 			return offset;
 		}
 
-		template <typename UTF8StringPrinter> void PrintV(UTF8StringPrinter& printer, const char* fmt, va_list ap)
+		// arguments from va_list
+		struct VAListArguments
+		{
+			va_list ap;
+			VAListArguments(va_list v)		{ va_copy(ap, v); }
+			~VAListArguments()				{ va_end(ap); }
+			template <typename T> T Next()	{ return va_arg(ap, T); }
+		};
+		// arguments stored by DKStringFormatArgument, argument is converted
+		// to requested type. pointer of mismatched type is NULL.
+		struct StoredArguments
+		{
+			const DKStringFormatArgument* args;
+			size_t count;
+			template <typename T> T Next()
+			{
+				if (count == 0)
+					return T();
+				const DKStringFormatArgument& a = *args;
+				args++;
+				count--;
+
+				using Arg = DKStringFormatArgument;
+				if constexpr (std::is_pointer<T>::value)
+				{
+					using CharT = typename std::remove_cv<typename std::remove_pointer<T>::type>::type;
+					if constexpr (std::is_same<CharT, char>::value)
+						return a.type == Arg::TypeString8 ? (T)a.s8 : T();
+					else if constexpr (std::is_same<CharT, wchar_t>::value)
+						return a.type == Arg::TypeStringW ? (T)a.sw : T();
+					else if (a.type == Arg::TypeSigned || a.type == Arg::TypeUnsigned)
+						return (T)(uintptr_t)a.u;
+					else if (a.type == Arg::TypeReal)
+						return T();
+					return (T)a.p;
+				}
+				else
+				{
+					switch (a.type)
+					{
+					case Arg::TypeSigned:	return (T)a.i;
+					case Arg::TypeUnsigned:	return (T)a.u;
+					case Arg::TypeReal:		return (T)a.r;
+					case Arg::TypePointer:
+					case Arg::TypeString8:
+					case Arg::TypeStringW:	return (T)(uintptr_t)a.p;
+					default:				break;
+					}
+					return T();
+				}
+			}
+		};
+
+		template <typename UTF8StringPrinter, typename Arguments> void PrintArgs(UTF8StringPrinter& printer, const char* fmt, Arguments& args)
 		{
 			DKArray<char> tmp;
 			tmp.Resize(1024);
@@ -859,11 +912,11 @@ namespace DKFoundation
 						format[formatLen++] = '#';
 
 					if (info.widthFromArg)
-						info.width = va_arg(ap, int);
+						info.width = args.template Next<int>();
 					if (info.width >= 0)
 						formatLen += snprintf(&format[formatLen], sizeof(format) - formatLen, "%u", info.width);
 					if (info.precisionFromArg)
-						info.precision = va_arg(ap, int);
+						info.precision = args.template Next<int>();
 					if (info.precision >= 0)
 						formatLen += snprintf(&format[formatLen], sizeof(format) - formatLen, ".%u", info.precision);
 
@@ -888,11 +941,11 @@ namespace DKFoundation
 						{
 							int n = 0;
 							if (info.length == sizeof(long long))
-								n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, long long));
+								n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<long long>());
 							else if (info.length == sizeof(long))
-								n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, long));
+								n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<long>());
 							else
-								n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, int));
+								n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<int>());
 							if (n > 0)
 								utf8buff.Add(&tmp.Value(0), n);
 						}
@@ -901,16 +954,16 @@ namespace DKFoundation
 						{
 							int n = 0;
 							if (info.length == sizeof(long double))
-								n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, long double));
+								n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<long double>());
 							else
-								n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, double));
+								n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<double>());
 							if (n > 0)
 								utf8buff.Add(&tmp.Value(0), n);
 						}
 						break;
 					case 'p':	// pointer
 						{
-							int n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, void*));
+							int n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<void*>());
 							if (n > 0)
 								utf8buff.Add(&tmp.Value(0), n);
 						}
@@ -922,21 +975,21 @@ namespace DKFoundation
 					case 'c':
 						if (info.length < sizeof(long))
 						{
-							int n = snprintf(&tmp.Value(0), tmp.Count(), format, va_arg(ap, int));
+							int n = snprintf(&tmp.Value(0), tmp.Count(), format, args.template Next<int>());
 							if (n > 0)
 								utf8buff.Add(&tmp.Value(0), n);
 							break;
 						}
 					case 'C':		// wchar_t -> utf-8
 						{
-							wchar_t str[2] = { va_arg(ap, wchar_t), 0 };
+							wchar_t str[2] = { args.template Next<wchar_t>(), 0 };
 							ConvertUniChars((const StringWTraits::BaseCharT*)str, 1, utf8buff);
 						}
 						break;
 					case 's':
 						if (info.length < sizeof(long))
 						{
-							char* str = va_arg(ap, char*);
+							char* str = args.template Next<char*>();
 							if (str)
 							{
 								size_t len;
@@ -951,7 +1004,7 @@ namespace DKFoundation
 						}
 					case 'S':		// wchar_t -> utf-8
 						{
-							wchar_t* str = va_arg(ap, wchar_t*);
+							wchar_t* str = args.template Next<wchar_t*>();
 							if (str)
 							{
 								ConvertUniChars((const StringWTraits::BaseCharT*)str, UniCharLength(str), utf8buff);
@@ -982,6 +1035,12 @@ namespace DKFoundation
 				utf8buff.Clear();
 			}
 		}
+
+		template <typename UTF8StringPrinter> void PrintV(UTF8StringPrinter& printer, const char* fmt, va_list ap)
+		{
+			VAListArguments args(ap);
+			PrintArgs(printer, fmt, args);
+		}
 	}
 
 	DKGL_API DKStringEncoding DKStringWEncoding()
@@ -1100,11 +1159,15 @@ namespace DKFoundation
 		strOut = (const DKUniCharW*)NULL;
 		if (fmt && fmt[0])
 		{
-			auto printer = [&strOut](const DKUniChar8* str, size_t len)
+			// collect UTF-8 pieces, convert once.
+			DKArray<DKUniChar8> buff;
+			buff.Reserve(256);
+			auto printer = [&buff](const DKUniChar8* str, size_t len)
 			{
-				strOut.Append(str, len);
+				buff.Add(str, len);
 			};
 			Private::PrintV(printer, fmt, v);
+			strOut.SetValue((const DKUniChar8*)buff, buff.Count());
 		}
 		else
 			strOut.SetValue(DKStringW::empty);
@@ -1128,6 +1191,41 @@ namespace DKFoundation
 		strOut.SetValue(DKStringW::empty);
 	}
 
+	DKGL_API void DKStringFormatArgs(DKStringU8& strOut, const DKUniChar8* fmt, const DKStringFormatArgument* args, size_t count)
+	{
+		strOut = (const DKUniChar8*)NULL;
+		if (fmt && fmt[0])
+		{
+			auto printer = [&strOut](const DKUniChar8* str, size_t len)
+			{
+				strOut.Append(str, len);
+			};
+			Private::StoredArguments arguments = { args, count };
+			Private::PrintArgs(printer, fmt, arguments);
+		}
+		else
+			strOut.SetValue(DKStringU8::empty);
+	}
+
+	DKGL_API void DKStringFormatArgs(DKStringW& strOut, const DKUniChar8* fmt, const DKStringFormatArgument* args, size_t count)
+	{
+		strOut = (const DKUniCharW*)NULL;
+		if (fmt && fmt[0])
+		{
+			DKArray<DKUniChar8> buff;
+			buff.Reserve(256);
+			auto printer = [&buff](const DKUniChar8* str, size_t len)
+			{
+				buff.Add(str, len);
+			};
+			Private::StoredArguments arguments = { args, count };
+			Private::PrintArgs(printer, fmt, arguments);
+			strOut.SetValue((const DKUniChar8*)buff, buff.Count());
+		}
+		else
+			strOut.SetValue(DKStringW::empty);
+	}
+
 	DKGL_API bool DKStringSetValue(DKStringU8& strOut, const DKStringW& strIn)
 	{
 		const DKUniCharW* s = strIn;
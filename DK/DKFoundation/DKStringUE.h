@@ -59,6 +59,77 @@ namespace DKFoundation
 	DKGL_API void DKStringFormatV(DKStringW& strOut, const DKUniChar8* fmt, va_list v);
 	DKGL_API void DKStringFormatV(DKStringW& strOut, const DKUniCharW* fmt, va_list v);
 
+	/// Stored argument of printf-style format, for deferred formatting.
+	/// (see DKStringFormatArgs)
+	/// Integers, floating point numbers and pointers are stored by value,
+	/// strings (char*, wchar_t*) are stored by pointer, other types are
+	/// not supported. (TypeNone)
+	struct DKStringFormatArgument
+	{
+		enum Type : uint8_t
+		{
+			TypeNone = 0,
+			TypeSigned,
+			TypeUnsigned,
+			TypeReal,
+			TypePointer,
+			TypeString8,
+			TypeStringW,
+		};
+		Type type;
+		union
+		{
+			int64_t i;
+			uint64_t u;
+			double r;
+			const void* p;
+			const char* s8;
+			const wchar_t* sw;
+		};
+
+		DKStringFormatArgument() : type(TypeNone), u(0) {}
+		template <typename T, typename = std::enable_if_t<!std::is_same<std::decay_t<T>, DKStringFormatArgument>::value>>
+		DKStringFormatArgument(const T& v) : type(TypeNone), u(0)
+		{
+			using U = std::decay_t<T>;
+			if constexpr (std::is_enum<U>::value)
+			{
+				using I = std::underlying_type_t<U>;
+				if (std::is_signed<I>::value) { type = TypeSigned; i = static_cast<int64_t>(v); }
+				else { type = TypeUnsigned; u = static_cast<uint64_t>(v); }
+			}
+			else if constexpr (std::is_integral<U>::value)
+			{
+				if (std::is_signed<U>::value) { type = TypeSigned; i = static_cast<int64_t>(v); }
+				else { type = TypeUnsigned; u = static_cast<uint64_t>(v); }
+			}
+			else if constexpr (std::is_floating_point<U>::value)
+			{
+				type = TypeReal; r = static_cast<double>(v);
+			}
+			else if constexpr (std::is_same<U, char*>::value || std::is_same<U, const char*>::value)
+			{
+				type = TypeString8; s8 = v;
+			}
+			else if constexpr (std::is_same<U, wchar_t*>::value || std::is_same<U, const wchar_t*>::value)
+			{
+				type = TypeStringW; sw = v;
+			}
+			else if constexpr (std::is_null_pointer<U>::value)
+			{
+				type = TypePointer; p = NULL;
+			}
+			else if constexpr (std::is_pointer<U>::value)
+			{
+				type = TypePointer; p = reinterpret_cast<const void*>(v);
+			}
+		}
+	};
+	/// format with stored arguments, argument is converted to type of
+	/// conversion specifier. string of mismatched argument is "(null)".
+	DKGL_API void DKStringFormatArgs(DKStringU8& strOut, const DKUniChar8* fmt, const DKStringFormatArgument* args, size_t count);
+	DKGL_API void DKStringFormatArgs(DKStringW& strOut, const DKUniChar8* fmt, const DKStringFormatArgument* args, size_t count);
+
 	DKGL_API bool DKStringSetValue(DKStringU8& strOut, const DKStringW& strIn);
 	DKGL_API bool DKStringSetValue(DKStringW& strOut, const DKStringU8& strIn);
 
@@ -14,6 +14,17 @@
 #include <sched.h>		// to using sched_yield() in DKThread::Yield()
 #include <errno.h>
 #include <limits.h>
+#include <stdio.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <math.h>
+#endif
+#if defined(__APPLE__) && defined(__MACH__)
+#include <sys/sysctl.h>
 #endif
 
 #include "DKThread.h"
@@ -25,6 +36,7 @@
 #include "DKSpinLock.h"
 #include "DKFunction.h"
 #include "DKLog.h"
+#include "DKUtils.h"
 
 #ifndef POSIX_USE_SELECT_SLEEP
 /// Set POSIX_USE_SELECT_SLEEP to 1 if you want use 'select' instead of 'nanosleep'.
@@ -53,6 +65,10 @@ namespace DKFoundation::Private
         DKThread::ThreadId		id;
         DKObject<DKOperation>	op;
         bool					running;
+        DKString				name;
+#if defined(__linux__)
+        pid_t					kernelId;	// for setpriority
+#endif
     };
     typedef DKMap<DKThread::ThreadId, ThreadContext> RunningThreadsMap;
     static RunningThreadsMap runningThreads;
@@ -77,6 +93,9 @@ namespace DKFoundation::Private
         ctxt.id = tid;
         ctxt.op = param->op;
         ctxt.running = false;
+#if defined(__linux__)
+        ctxt.kernelId = (pid_t)syscall(SYS_gettid);
+#endif
         param->id = tid;
         threadCond.Broadcast();
 
@@ -197,6 +216,263 @@ namespace DKFoundation::Private
         }
         return NULL;
     }
+
+    static uint32_t TopologyIndex(DKMap<uint64_t, uint32_t>& indices, uint64_t key)
+    {
+        if (auto p = indices.Find(key); p)
+            return p->value;
+        uint32_t index = static_cast<uint32_t>(indices.Count());
+        indices.Insert(key, index);
+        return index;
+    }
+
+#if defined(__linux__)
+    static bool ReadSysfsUInt(const char* path, uint32_t& value)
+    {
+        bool result = false;
+        if (FILE* fp = fopen(path, "r"); fp)
+        {
+            unsigned int v;
+            if (fscanf(fp, "%u", &v) == 1)
+            {
+                value = v;
+                result = true;
+            }
+            fclose(fp);
+        }
+        return result;
+    }
+    // parse cpu list format. (ex: "0-3,8,10-11")
+    static bool ReadSysfsCpuList(const char* path, DKArray<uint32_t>& cpus)
+    {
+        bool result = false;
+        if (FILE* fp = fopen(path, "r"); fp)
+        {
+            unsigned int first, last;
+            while (fscanf(fp, "%u", &first) == 1)
+            {
+                last = first;
+                int c = fgetc(fp);
+                if (c == '-')
+                {
+                    if (fscanf(fp, "%u", &last) != 1)
+                        break;
+                    c = fgetc(fp);
+                }
+                for (unsigned int cpu = first; cpu <= last; ++cpu)
+                    cpus.Add(cpu);
+                result = true;
+                if (c != ',')
+                    break;
+            }
+            fclose(fp);
+        }
+        return result;
+    }
+#endif
+
+    static DKThread::Topology QueryCpuTopology()
+    {
+        DKThread::Topology topology;
+        DKMap<uint64_t, uint32_t> cores, packages, nodes, caches;
+
+#ifdef _WIN32
+        DKMap<uint32_t, DKThread::ProcessorInfo> infos;
+        DWORD buffSize = 0;
+        if (!GetLogicalProcessorInformationEx(RelationAll, 0, &buffSize) &&
+            GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+        {
+            uint8_t* buffer = new uint8_t[buffSize];
+            if (GetLogicalProcessorInformationEx(RelationAll, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)buffer, &buffSize))
+            {
+                auto enumerate = [&](auto&& fn)
+                {
+                    for (DWORD offset = 0; offset < buffSize; )
+                    {
+                        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)&buffer[offset];
+                        offset += info->Size;
+                        fn(info);
+                    }
+                };
+                auto forEachProcessor = [&](const GROUP_AFFINITY& ga, auto&& fn)
+                {
+                    for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+                    {
+                        if (ga.Mask & (KAFFINITY(1) << bit))
+                        {
+                            uint32_t id = uint32_t(ga.Group) * 64 + bit;
+                            DKThread::ProcessorInfo& p = infos.Value(id);
+                            p.id = id;
+                            fn(p);
+                        }
+                    }
+                };
+                // last level cache
+                BYTE cacheLevel = 0;
+                enumerate([&](SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info)
+                {
+                    if (info->Relationship == RelationCache)
+                        cacheLevel = Max(cacheLevel, info->Cache.Level);
+                });
+                uint64_t entry = 0;
+                enumerate([&](SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info)
+                {
+                    entry++;
+                    if (info->Relationship == RelationProcessorCore)
+                    {
+                        uint32_t core = TopologyIndex(cores, entry);
+                        for (WORD i = 0; i < info->Processor.GroupCount; ++i)
+                            forEachProcessor(info->Processor.GroupMask[i], [core](DKThread::ProcessorInfo& p) { p.core = core; });
+                    }
+                    else if (info->Relationship == RelationProcessorPackage)
+                    {
+                        uint32_t package = TopologyIndex(packages, entry);
+                        for (WORD i = 0; i < info->Processor.GroupCount; ++i)
+                            forEachProcessor(info->Processor.GroupMask[i], [package](DKThread::ProcessorInfo& p) { p.package = package; });
+                    }
+                    else if (info->Relationship == RelationNumaNode)
+                    {
+                        uint32_t node = TopologyIndex(nodes, info->NumaNode.NodeNumber);
+                        forEachProcessor(info->NumaNode.GroupMask, [node](DKThread::ProcessorInfo& p) { p.numaNode = node; });
+                    }
+                    else if (info->Relationship == RelationCache && info->Cache.Level == cacheLevel)
+                    {
+                        uint32_t cache = TopologyIndex(caches, entry);
+                        forEachProcessor(info->Cache.GroupMask, [cache](DKThread::ProcessorInfo& p) { p.cacheDomain = cache; });
+                    }
+                });
+            }
+            delete[] buffer;
+        }
+        infos.EnumerateForward([&topology](const DKMap<uint32_t, DKThread::ProcessorInfo>::Pair& pair)
+        {
+            topology.processors.Add(pair.value);
+        });
+#elif defined(__linux__)
+        // cpu ids can be sparse. (offline or hot-plugged processors)
+        DKArray<uint32_t> onlineCpus;
+        if (!ReadSysfsCpuList("/sys/devices/system/cpu/online", onlineCpus))
+        {
+            uint32_t numProcessors = DKNumberOfProcessors();
+            for (uint32_t cpu = 0; cpu < numProcessors; ++cpu)
+                onlineCpus.Add(cpu);
+        }
+        char path[256];
+        for (uint32_t cpu : onlineCpus)
+        {
+            DKThread::ProcessorInfo info = { cpu, 0, 0, 0, 0 };
+
+            uint32_t packageId = 0, coreId = cpu;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+            ReadSysfsUInt(path, packageId);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu);
+            ReadSysfsUInt(path, coreId);
+            info.package = TopologyIndex(packages, packageId);
+            info.core = TopologyIndex(cores, (uint64_t(packageId) << 32) | coreId);
+
+            // NUMA node: cpuN/nodeM link
+            uint32_t nodeId = 0;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+            if (DIR* dir = opendir(path); dir)
+            {
+                while (const struct dirent* entry = readdir(dir))
+                {
+                    if (sscanf(entry->d_name, "node%u", &nodeId) == 1)
+                        break;
+                }
+                closedir(dir);
+            }
+            info.numaNode = TopologyIndex(nodes, nodeId);
+
+            // last level cache: first processor of shared_cpu_list
+            uint32_t cacheLevel = 0, cacheKey = packageId;
+            for (uint32_t index = 0; index < 16; ++index)
+            {
+                uint32_t level = 0, firstCpu = 0;
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, index);
+                if (!ReadSysfsUInt(path, level))
+                    break;
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+                if (level >= cacheLevel && ReadSysfsUInt(path, firstCpu))
+                {
+                    cacheLevel = level;
+                    cacheKey = firstCpu;
+                }
+            }
+            info.cacheDomain = TopologyIndex(caches, cacheKey);
+
+            topology.processors.Add(info);
+        }
+#else
+        uint32_t numProcessors = DKNumberOfProcessors();
+        uint32_t numCores = Clamp(DKNumberOfCpuCores(), 1U, numProcessors);
+        uint32_t numPackages = 1;
+#if defined(__APPLE__) && defined(__MACH__)
+        int value = 0;
+        size_t len = sizeof(value);
+        if (sysctlbyname("hw.packages", &value, &len, NULL, 0) == 0 && value > 0)
+            numPackages = value;
+#endif
+        // assume SMT siblings have successive ids.
+        for (uint32_t cpu = 0; cpu < numProcessors; ++cpu)
+        {
+            uint32_t core = cpu * numCores / numProcessors;
+            uint32_t package = core * numPackages / numCores;
+            DKThread::ProcessorInfo info = { cpu, core, package, 0, package };
+            TopologyIndex(cores, core);
+            TopologyIndex(packages, package);
+            TopologyIndex(nodes, 0);
+            TopologyIndex(caches, package);
+            topology.processors.Add(info);
+        }
+#endif
+        topology.numCores = Max(static_cast<uint32_t>(cores.Count()), 1U);
+        topology.numPackages = Max(static_cast<uint32_t>(packages.Count()), 1U);
+        topology.numNumaNodes = Max(static_cast<uint32_t>(nodes.Count()), 1U);
+        topology.numCacheDomains = Max(static_cast<uint32_t>(caches.Count()), 1U);
+        return topology;
+    }
+
+    static bool SetSystemThreadName(DKThread::ThreadId tid, const DKString& name)
+    {
+#ifdef _WIN32
+        // SetThreadDescription is available on Windows 10 1607 or later.
+        typedef HRESULT (WINAPI *SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+        static SetThreadDescriptionFunc setThreadDescription = reinterpret_cast<SetThreadDescriptionFunc>(
+            ::GetProcAddress(::GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription"));
+        if (setThreadDescription)
+        {
+            HANDLE hThread = OpenThread(THREAD_SET_LIMITED_INFORMATION, FALSE, (DWORD)tid);
+            if (hThread)
+            {
+                bool ret = SUCCEEDED(setThreadDescription(hThread, (const wchar_t*)name));
+                CloseHandle(hThread);
+                return ret;
+            }
+        }
+        return false;
+#else
+        DKStringU8 str(name);
+        const char* s = (const char*)str;
+        // Linux limits name to 16 bytes including null, truncate at UTF-8 boundary.
+        char buff[16] = {};
+        size_t len = strlen(s);
+        if (len >= sizeof(buff))
+        {
+            len = sizeof(buff) - 1;
+            while (len > 0 && (s[len] & 0xC0) == 0x80)
+                len--;
+        }
+        memcpy(buff, s, len);
+#if defined(__APPLE__) && defined(__MACH__)
+        if (tid == DKThread::CurrentThreadId())
+            return pthread_setname_np(buff) == 0;
+        return false;
+#else
+        return pthread_setname_np((pthread_t)tid, buff) == 0;
+#endif
+#endif
+    }
 }
 using namespace DKFoundation;
 using namespace DKFoundation::Private;
@@ -378,7 +654,22 @@ bool DKThread::SetPriority(double p)
 	int min_priority = sched_get_priority_min(policy);
 	int max_priority = sched_get_priority_max(policy);
 
-	schedule.sched_priority = (int)p * (max_priority - min_priority) + min_priority;
+#if defined(__linux__)
+	if (min_priority == max_priority)
+	{
+		// SCHED_OTHER has no static priority, use nice value of thread. (-10 ~ 10)
+		pid_t kernelId = 0;
+		threadCond.Lock();
+		if (RunningThreadsMap::Pair* pair = runningThreads.Find(tid); pair)
+			kernelId = pair->value.kernelId;
+		threadCond.Unlock();
+		if (kernelId == 0)
+			return false;
+		int nice = static_cast<int>(floor((0.5 - p) * 20.0 + 0.5));
+		return setpriority(PRIO_PROCESS, kernelId, nice) == 0;
+	}
+#endif
+	schedule.sched_priority = static_cast<int>(p * (max_priority - min_priority)) + min_priority;
 	return pthread_setschedparam((pthread_t)tid, policy, &schedule) == 0;
 #endif
 }
@@ -429,6 +720,162 @@ double DKThread::Priority() const
 	}
 	int min_priority = sched_get_priority_min(policy);
 	int max_priority = sched_get_priority_max(policy);
+	if (min_priority == max_priority)
+	{
+#if defined(__linux__)
+		pid_t kernelId = 0;
+		threadCond.Lock();
+		if (RunningThreadsMap::Pair* pair = runningThreads.Find(tid); pair)
+			kernelId = pair->value.kernelId;
+		threadCond.Unlock();
+		if (kernelId != 0)
+		{
+			errno = 0;
+			int nice = getpriority(PRIO_PROCESS, kernelId);
+			if (errno == 0)
+				return Clamp(0.5 - double(nice) / 20.0, 0.0, 1.0);
+		}
+#endif
+		return 0.5;
+	}
 	return (double)(schedule.sched_priority - min_priority) / (double)(max_priority - min_priority);
 #endif
 }
+
+bool DKThread::SetAffinity(const DKArray<uint32_t>& processors)
+{
+	ThreadId tid = Id();
+	if (tid == invalidId)
+		return false;
+#ifdef _WIN32
+	HANDLE hThread = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE, (DWORD)tid);
+	if (hThread)
+	{
+		GROUP_AFFINITY groupAffinity = {};
+		if (processors.IsEmpty())
+		{
+			::GetThreadGroupAffinity(hThread, &groupAffinity);
+			DWORD count = ::GetActiveProcessorCount(groupAffinity.Group);
+			groupAffinity.Mask = (count >= sizeof(KAFFINITY) * 8) ? ~KAFFINITY(0) : ((KAFFINITY(1) << count) - 1);
+		}
+		else
+		{
+			groupAffinity.Group = static_cast<WORD>(processors.Value(0) / 64);
+			for (uint32_t id : processors)
+			{
+				if (id / 64 == groupAffinity.Group)
+					groupAffinity.Mask |= KAFFINITY(1) << (id % 64);
+			}
+		}
+		bool ret = ::SetThreadGroupAffinity(hThread, &groupAffinity, NULL) != 0;
+		if (!ret)
+			DKLogE("SetThreadGroupAffinity Error: %ls", (const wchar_t*)GetWin32ErrorString(GetLastError()));
+		CloseHandle(hThread);
+		return ret;
+	}
+	DKLogE("DKThread::SetAffinity Error: OpenThread Error");
+	return false;
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if (processors.IsEmpty())
+	{
+		for (const ProcessorInfo& info : CpuTopology().processors)
+			CPU_SET(info.id, &cpuSet);
+	}
+	else
+	{
+		for (uint32_t id : processors)
+		{
+			if (id < CPU_SETSIZE)
+				CPU_SET(id, &cpuSet);
+		}
+	}
+	return pthread_setaffinity_np((pthread_t)tid, sizeof(cpuSet), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+DKArray<uint32_t> DKThread::Affinity() const
+{
+	DKArray<uint32_t> processors;
+	ThreadId tid = Id();
+	if (tid == invalidId)
+		return processors;
+#ifdef _WIN32
+	HANDLE hThread = OpenThread(THREAD_QUERY_INFORMATION, FALSE, (DWORD)tid);
+	if (hThread)
+	{
+		GROUP_AFFINITY groupAffinity = {};
+		if (::GetThreadGroupAffinity(hThread, &groupAffinity))
+		{
+			for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+			{
+				if (groupAffinity.Mask & (KAFFINITY(1) << bit))
+					processors.Add(uint32_t(groupAffinity.Group) * 64 + bit);
+			}
+		}
+		CloseHandle(hThread);
+	}
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if (pthread_getaffinity_np((pthread_t)tid, sizeof(cpuSet), &cpuSet) == 0)
+	{
+		for (uint32_t id = 0; id < CPU_SETSIZE; ++id)
+		{
+			if (CPU_ISSET(id, &cpuSet))
+				processors.Add(id);
+		}
+	}
+#else
+	for (const ProcessorInfo& info : CpuTopology().processors)
+		processors.Add(info.id);
+#endif
+	return processors;
+}
+
+bool DKThread::SetName(const DKString& name)
+{
+	ThreadId tid = Id();
+	if (tid == invalidId)
+		return false;
+
+	threadCond.Lock();
+	if (RunningThreadsMap::Pair* pair = runningThreads.Find(tid); pair)
+		pair->value.name = name;
+	threadCond.Unlock();
+
+	return SetSystemThreadName(tid, name);
+}
+
+DKString DKThread::Name() const
+{
+	ThreadId tid = Id();
+	if (tid != invalidId)
+	{
+		DKCriticalSection<DKCondition> guard(threadCond);
+		if (RunningThreadsMap::Pair* pair = runningThreads.Find(tid); pair)
+			return pair->value.name;
+	}
+	return "";
+}
+
+bool DKThread::SetCurrentThreadName(const DKString& name)
+{
+	ThreadId tid = CurrentThreadId();
+
+	threadCond.Lock();
+	if (RunningThreadsMap::Pair* pair = runningThreads.Find(tid); pair)
+		pair->value.name = name;
+	threadCond.Unlock();
+
+	return SetSystemThreadName(tid, name);
+}
+
+const DKThread::Topology& DKThread::CpuTopology()
+{
+	static const Topology topology = QueryCpuTopology();
+	return topology;
+}
@@ -9,6 +9,8 @@
 #include "../DKInclude.h"
 #include "DKObject.h"
 #include "DKOperation.h"
+#include "DKArray.h"
+#include "DKString.h"
 
 #ifdef _WIN32
 #undef Yield	// see WinBase.h
@@ -24,6 +26,51 @@ namespace DKFoundation
 	public:
 		typedef uintptr_t ThreadId;
 
+		/// logical processor information.
+		/// core, package, numaNode and cacheDomain are zero-based indices.
+		struct ProcessorInfo
+		{
+			uint32_t id;			///< logical processor id of OS. (group * 64 + number for Win32)
+			uint32_t core;			///< physical core, SMT siblings have same core.
+			uint32_t package;		///< physical package (socket)
+			uint32_t numaNode;		///< NUMA node
+			uint32_t cacheDomain;	///< processors sharing last level cache.
+		};
+		/// CPU topology of system.
+		struct Topology
+		{
+			DKArray<ProcessorInfo> processors;
+			uint32_t numCores;
+			uint32_t numPackages;
+			uint32_t numNumaNodes;
+			uint32_t numCacheDomains;
+
+			/// logical processor ids of physical core. (SMT siblings)
+			DKArray<uint32_t> ProcessorsOfCore(uint32_t core) const
+			{
+				return Filter([core](const ProcessorInfo& p) { return p.core == core; });
+			}
+			DKArray<uint32_t> ProcessorsOfNumaNode(uint32_t node) const
+			{
+				return Filter([node](const ProcessorInfo& p) { return p.numaNode == node; });
+			}
+			DKArray<uint32_t> ProcessorsOfCacheDomain(uint32_t domain) const
+			{
+				return Filter([domain](const ProcessorInfo& p) { return p.cacheDomain == domain; });
+			}
+		private:
+			template <typename Pred> DKArray<uint32_t> Filter(Pred&& pred) const
+			{
+				DKArray<uint32_t> ids;
+				for (const ProcessorInfo& p : processors)
+				{
+					if (pred(p))
+						ids.Add(p.id);
+				}
+				return ids;
+			}
+		};
+
 		/// waiting for join.
 		void WaitTerminate() const;
 		/// get thread-id (system thread-id)
@@ -37,6 +84,26 @@ namespace DKFoundation
 		/// Get thread priority
 		double Priority() const;
 
+		/// Set processor affinity with logical processor ids of Topology.
+		/// empty array to allow all processors.
+		/// Win32: processors must be in same processor group.
+		/// @note Not supported on Apple platforms. (returns false)
+		bool SetAffinity(const DKArray<uint32_t>& processors);
+		/// Get logical processor ids which the thread can run on.
+		DKArray<uint32_t> Affinity() const;
+
+		/// Set thread name, which can be shown in debugger or profiler.
+		/// The name can be truncated by system. (15 characters for Linux)
+		/// @note Apple platforms: only current thread can be named by system,
+		///  name of other thread is stored but returns false.
+		bool SetName(const DKString& name);
+		DKString Name() const;
+		/// Set name of current thread, including threads not created by DKThread.
+		static bool SetCurrentThreadName(const DKString& name);
+
+		/// CPU topology of system, queried once.
+		static const Topology& CpuTopology();
+
 		/// find thread specified by id.
 		static DKObject<DKThread> FindThread(ThreadId id);
 		/// get current thread as DKThread object.
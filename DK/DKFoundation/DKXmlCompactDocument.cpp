@@ -0,0 +1,667 @@
+//
+//  File: DKXmlCompactDocument.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKXmlCompactDocument.h"
+#include "DKFileMap.h"
+#include "DKArray.h"
+#include "DKMemory.h"
+
+namespace DKFoundation::Private
+{
+    // fixed size pages, records are not moved when arena grows.
+    template <typename T, int PageBits> class CompactArena
+    {
+    public:
+        enum { PageSize = 1 << PageBits, PageMask = PageSize - 1 };
+
+        CompactArena() : count(0) {}
+        ~CompactArena()
+        {
+            for (T* page : pages)
+                DKFree(page);
+        }
+        uint32_t Add()
+        {
+            if ((count & PageMask) == 0)
+                pages.Add(reinterpret_cast<T*>(DKMalloc(sizeof(T) * PageSize)));
+            return count++;
+        }
+        T& operator [] (uint32_t index)
+        {
+            DKASSERT_DEBUG(index < count);
+            return pages.Value(index >> PageBits)[index & PageMask];
+        }
+        const T& operator [] (uint32_t index) const
+        {
+            DKASSERT_DEBUG(index < count);
+            return pages.Value(index >> PageBits)[index & PageMask];
+        }
+        uint32_t Count() const { return count; }
+        size_t MemoryUsage() const { return pages.Count() * sizeof(T) * PageSize; }
+
+    private:
+        DKArray<T*> pages;
+        uint32_t count;
+    };
+
+    // string in source data, or in arena if decoded.
+    struct CompactString
+    {
+        enum : uint32_t { ArenaFlag = 0x80000000U };
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct CompactNode
+    {
+        uint8_t type;               // DKXmlNode::NodeType
+        uint32_t parent;            // 0: document
+        uint32_t firstChild;        // 0: none
+        uint32_t nextSibling;       // 0: none
+        uint32_t numChildren;
+        uint32_t firstAttribute;
+        uint32_t numAttributes;
+        CompactString name;
+        CompactString value;
+    };
+
+    struct CompactAttribute
+    {
+        CompactString name;
+        CompactString value;
+    };
+
+    struct CompactDocumentContext
+    {
+        using StringView = DKXmlReader::StringView;
+
+        DKObject<DKData> data;
+        const char* source;
+        CompactArena<CompactNode, 12> nodes;    // nodes[0] is document
+        CompactArena<CompactAttribute, 12> attributes;
+        DKArray<char> strings;
+        DKString errorDesc;
+
+        CompactDocumentContext() : source(NULL) {}
+        ~CompactDocumentContext()
+        {
+            // LockShared() can return NULL for empty data, it is still locked.
+            if (data)
+                data->UnlockShared();
+        }
+
+        StringView String(const CompactString& s) const
+        {
+            if (s.length & CompactString::ArenaFlag)
+                return { (const char*)strings + s.offset, s.length & ~CompactString::ArenaFlag };
+            return { source + s.offset, s.length };
+        }
+
+        CompactString SourceString(const StringView& sv) const
+        {
+            return { uint32_t(sv.data - source), uint32_t(sv.length) };
+        }
+
+        bool DecodedString(const StringView& sv, bool attribute, DKStringU8& tmp, CompactString& output)
+        {
+            if (!DKXmlReader::NeedsDecoding(sv, attribute))
+            {
+                output = SourceString(sv);
+                return true;
+            }
+            if (!DKXmlReader::Decode(sv, tmp, attribute))
+                return false;
+            if (strings.Count() + tmp.Bytes() > CompactString::ArenaFlag)
+                return false;
+            output = { uint32_t(strings.Count()), uint32_t(tmp.Bytes()) | CompactString::ArenaFlag };
+            strings.Add((const char*)(const DKUniChar8*)tmp, tmp.Bytes());
+            return true;
+        }
+
+        bool Build(size_t length)
+        {
+            if (length >= CompactString::ArenaFlag)
+            {
+                errorDesc = L"Document is too large";
+                return false;
+            }
+            DKXmlReader reader;
+            if (!reader.Open(source, length))
+            {
+                errorDesc = reader.ErrorDescription();
+                return false;
+            }
+
+            CompactNode& document = nodes[nodes.Add()];
+            memset(&document, 0, sizeof(CompactNode));
+            document.type = DKXmlNode::NodeTypeUnknown;
+
+            DKArray<uint32_t> elements;     // open elements
+            DKArray<uint32_t> lastChild;    // last child of document, elements
+            lastChild.Add(0);
+            DKStringU8 tmp;
+
+            auto addNode = [&](DKXmlNode::NodeType type)->uint32_t
+            {
+                uint32_t parent = elements.Count() > 0 ? elements.Value(elements.Count() - 1) : 0;
+                uint32_t index = nodes.Add();
+                CompactNode& node = nodes[index];
+                memset(&node, 0, sizeof(CompactNode));
+                node.type = type;
+                node.parent = parent;
+
+                uint32_t& last = lastChild.Value(lastChild.Count() - 1);
+                if (last)
+                    nodes[last].nextSibling = index;
+                else
+                    nodes[parent].firstChild = index;
+                last = index;
+                nodes[parent].numChildren++;
+                return index;
+            };
+
+            while (true)
+            {
+                switch (reader.Next())
+                {
+                case DKXmlReader::TokenStartElement:
+                    {
+                        uint32_t index = addNode(DKXmlNode::NodeTypeElement);
+                        CompactNode& node = nodes[index];
+                        node.name = SourceString(reader.Name());
+                        node.numAttributes = uint32_t(reader.NumberOfAttributes());
+                        node.firstAttribute = attributes.Count();
+                        for (size_t i = 0; i < reader.NumberOfAttributes(); ++i)
+                        {
+                            const DKXmlReader::Attribute& attr = reader.AttributeAt(i);
+                            CompactAttribute& ca = attributes[attributes.Add()];
+                            ca.name = SourceString(attr.name);
+                            if (!DecodedString(attr.value, true, tmp, ca.value))
+                            {
+                                errorDesc = DKString::Format("Invalid attribute value (line %zu)", reader.LineNumber());
+                                return false;
+                            }
+                        }
+                        elements.Add(index);
+                        lastChild.Add(0);
+                    }
+                    break;
+                case DKXmlReader::TokenEndElement:
+                    elements.Remove(elements.Count() - 1);
+                    lastChild.Remove(lastChild.Count() - 1);
+                    break;
+                case DKXmlReader::TokenText:
+                case DKXmlReader::TokenComment:
+                    {
+                        bool text = reader.Token() == DKXmlReader::TokenText;
+                        CompactNode& node = nodes[addNode(text ? DKXmlNode::NodeTypePCData : DKXmlNode::NodeTypeComment)];
+                        if (text)
+                        {
+                            if (!DecodedString(reader.Value(), false, tmp, node.value))
+                            {
+                                errorDesc = DKString::Format("Invalid character data (line %zu)", reader.LineNumber());
+                                return false;
+                            }
+                        }
+                        else
+                            node.value = SourceString(reader.Value());
+                    }
+                    break;
+                case DKXmlReader::TokenCData:
+                    nodes[addNode(DKXmlNode::NodeTypeCData)].value = SourceString(reader.Value());
+                    break;
+                case DKXmlReader::TokenProcessingInstruction:
+                case DKXmlReader::TokenDocumentType:
+                    {
+                        bool pi = reader.Token() == DKXmlReader::TokenProcessingInstruction;
+                        CompactNode& node = nodes[addNode(pi ? DKXmlNode::NodeTypeInstruction : DKXmlNode::NodeTypeDocTypeDecl)];
+                        node.name = SourceString(reader.Name());
+                        node.value = SourceString(reader.Value());
+                    }
+                    break;
+                case DKXmlReader::TokenEndDocument:
+                    return true;
+                default:
+                    errorDesc = reader.ErrorDescription();
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        DKObject<DKXmlNamespace> FindNamespace(uint32_t index, const StringView& prefix) const;
+        DKObject<DKXmlNode> CreateNode(uint32_t index) const;
+    };
+}
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+#define COMPACT_CONTEXT(doc)	reinterpret_cast<CompactDocumentContext*>((doc)->impl)
+
+namespace DKFoundation::Private
+{
+    static bool IsNamespaceDeclaration(const DKXmlReader::StringView& name)
+    {
+        return name.length >= 5 && memcmp(name.data, "xmlns", 5) == 0 && (name.length == 5 || name.data[5] == ':');
+    }
+
+    static void SplitName(const DKXmlReader::StringView& name, DKXmlReader::StringView& prefix, DKXmlReader::StringView& localName)
+    {
+        const char* colon = reinterpret_cast<const char*>(memchr(name.data, ':', name.length));
+        if (colon)
+        {
+            prefix = { name.data, size_t(colon - name.data) };
+            localName = { colon + 1, name.length - prefix.length - 1 };
+        }
+        else
+        {
+            prefix = { name.data, 0 };
+            localName = name;
+        }
+    }
+
+    // find namespace declared with prefix, from element to ancestors.
+    DKObject<DKXmlNamespace> CompactDocumentContext::FindNamespace(uint32_t index, const StringView& prefix) const
+    {
+        for (; index != 0; index = nodes[index].parent)
+        {
+            const CompactNode& node = nodes[index];
+            for (uint32_t i = 0; i < node.numAttributes; ++i)
+            {
+                const CompactAttribute& attr = attributes[node.firstAttribute + i];
+                StringView name = String(attr.name);
+                if (!IsNamespaceDeclaration(name))
+                    continue;
+                if (name.length == 5 ? prefix.length == 0 : (name.length - 6 == prefix.length && memcmp(name.data + 6, prefix.data, prefix.length) == 0))
+                {
+                    StringView uri = String(attr.value);
+                    if (uri.length == 0)	// xmlns=""
+                        return NULL;
+                    DKObject<DKXmlNamespace> ns = DKObject<DKXmlNamespace>::New();
+                    ns->prefix = prefix.ToString();
+                    ns->URI = uri.ToString();
+                    return ns;
+                }
+            }
+        }
+        return NULL;
+    }
+
+    DKObject<DKXmlNode> CompactDocumentContext::CreateNode(uint32_t index) const
+    {
+        const CompactNode& node = nodes[index];
+        switch (node.type)
+        {
+        case DKXmlNode::NodeTypeElement:
+            {
+                DKObject<DKXmlElement> e = DKObject<DKXmlElement>::New();
+                StringView prefix, localName;
+                SplitName(String(node.name), prefix, localName);
+                e->name = localName.ToString();
+                e->ns = FindNamespace(index, prefix);
+                e->attributes.Reserve(node.numAttributes);
+                for (uint32_t i = 0; i < node.numAttributes; ++i)
+                {
+                    const CompactAttribute& ca = attributes[node.firstAttribute + i];
+                    StringView name = String(ca.name);
+                    if (IsNamespaceDeclaration(name))
+                    {
+                        DKXmlNamespace ns;
+                        if (name.length > 6)
+                            ns.prefix = StringView{ name.data + 6, name.length - 6 }.ToString();
+                        ns.URI = String(ca.value).ToString();
+                        e->namespaces.Add(ns);
+                        continue;
+                    }
+                    DKXmlAttribute attr;
+                    SplitName(name, prefix, localName);
+                    if (prefix.length > 0 && prefix != "xml")
+                        attr.ns = FindNamespace(index, prefix);
+                    attr.name = localName.ToString();
+                    attr.value = String(ca.value).ToString();
+                    e->attributes.Add(attr);
+                }
+                e->nodes.Reserve(node.numChildren);
+                for (uint32_t child = node.firstChild; child; child = nodes[child].nextSibling)
+                {
+                    DKObject<DKXmlNode> n = CreateNode(child);
+                    if (n)
+                        e->nodes.Add(n);
+                }
+                return e.SafeCast<DKXmlNode>();
+            }
+        case DKXmlNode::NodeTypePCData:
+            {
+                DKObject<DKXmlPCData> c = DKObject<DKXmlPCData>::New();
+                c->value = String(node.value).ToString();
+                return c.SafeCast<DKXmlNode>();
+            }
+        case DKXmlNode::NodeTypeCData:
+            {
+                DKObject<DKXmlCData> c = DKObject<DKXmlCData>::New();
+                c->value = String(node.value).ToStringU8();
+                return c.SafeCast<DKXmlNode>();
+            }
+        case DKXmlNode::NodeTypeComment:
+            {
+                DKObject<DKXmlComment> c = DKObject<DKXmlComment>::New();
+                c->value = String(node.value).ToString();
+                return c.SafeCast<DKXmlNode>();
+            }
+        case DKXmlNode::NodeTypeInstruction:
+            {
+                DKObject<DKXmlInstruction> ins = DKObject<DKXmlInstruction>::New();
+                ins->target = String(node.name).ToString();
+                ins->data = String(node.value).ToString();
+                return ins.SafeCast<DKXmlNode>();
+            }
+        case DKXmlNode::NodeTypeDocTypeDecl:
+            {
+                DKObject<DKXmlDocTypeDecl> dtd = DKObject<DKXmlDocTypeDecl>::New();
+                dtd->name = String(node.name).ToString();
+                return dtd.SafeCast<DKXmlNode>();
+            }
+        }
+        return NULL;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DKXmlCompactDocument::Node
+DKXmlCompactDocument::NodeType DKXmlCompactDocument::Node::Type() const
+{
+	if (document)
+		return (NodeType)COMPACT_CONTEXT(document)->nodes[index].type;
+	return DKXmlNode::NodeTypeUnknown;
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::Node::Parent() const
+{
+	if (document)
+	{
+		uint32_t parent = COMPACT_CONTEXT(document)->nodes[index].parent;
+		if (parent)
+			return Node(document, parent);
+	}
+	return Node();
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::Node::FirstChild() const
+{
+	if (document)
+	{
+		uint32_t child = COMPACT_CONTEXT(document)->nodes[index].firstChild;
+		if (child)
+			return Node(document, child);
+	}
+	return Node();
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::Node::NextSibling() const
+{
+	if (document)
+	{
+		uint32_t next = COMPACT_CONTEXT(document)->nodes[index].nextSibling;
+		if (next)
+			return Node(document, next);
+	}
+	return Node();
+}
+
+size_t DKXmlCompactDocument::Node::NumberOfChildren() const
+{
+	if (document)
+		return COMPACT_CONTEXT(document)->nodes[index].numChildren;
+	return 0;
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::Node::FirstChildElement(const char* name) const
+{
+	Node n = FirstChild();
+	if (n.IsValid() && (n.Type() != DKXmlNode::NodeTypeElement || (name && n.Name() != name)))
+		return n.NextSiblingElement(name);
+	return n;
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::Node::NextSiblingElement(const char* name) const
+{
+	if (document)
+	{
+		const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+		for (uint32_t next = ctxt->nodes[index].nextSibling; next; next = ctxt->nodes[next].nextSibling)
+		{
+			const CompactNode& node = ctxt->nodes[next];
+			if (node.type == DKXmlNode::NodeTypeElement && (name == NULL || ctxt->String(node.name) == name))
+				return Node(document, next);
+		}
+	}
+	return Node();
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::Name() const
+{
+	if (document)
+	{
+		const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+		return ctxt->String(ctxt->nodes[index].name);
+	}
+	return { "", 0 };
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::Prefix() const
+{
+	StringView prefix, localName;
+	SplitName(Name(), prefix, localName);
+	return prefix;
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::LocalName() const
+{
+	StringView prefix, localName;
+	SplitName(Name(), prefix, localName);
+	return localName;
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::NamespaceURI() const
+{
+	if (Type() == DKXmlNode::NodeTypeElement)
+	{
+		const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+		StringView prefix = Prefix();
+		if (prefix == "xml")
+			return { "http://www.w3.org/XML/1998/namespace", 36 };
+		for (uint32_t i = index; i != 0; i = ctxt->nodes[i].parent)
+		{
+			const CompactNode& node = ctxt->nodes[i];
+			for (uint32_t k = 0; k < node.numAttributes; ++k)
+			{
+				const CompactAttribute& attr = ctxt->attributes[node.firstAttribute + k];
+				StringView name = ctxt->String(attr.name);
+				if (IsNamespaceDeclaration(name) &&
+					(name.length == 5 ? prefix.length == 0 : (name.length - 6 == prefix.length && memcmp(name.data + 6, prefix.data, prefix.length) == 0)))
+					return ctxt->String(attr.value);
+			}
+		}
+	}
+	return { "", 0 };
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::Value() const
+{
+	if (document)
+	{
+		const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+		return ctxt->String(ctxt->nodes[index].value);
+	}
+	return { "", 0 };
+}
+
+DKStringU8 DKXmlCompactDocument::Node::Text() const
+{
+	DKArray<char> text;
+	for (Node n = FirstChild(); n.IsValid(); n = n.NextSibling())
+	{
+		NodeType t = n.Type();
+		if (t == DKXmlNode::NodeTypePCData || t == DKXmlNode::NodeTypeCData)
+		{
+			StringView value = n.Value();
+			text.Add(value.data, value.length);
+		}
+	}
+	return DKStringU8((const DKUniChar8*)(const char*)text, text.Count());
+}
+
+size_t DKXmlCompactDocument::Node::NumberOfAttributes() const
+{
+	if (document)
+		return COMPACT_CONTEXT(document)->nodes[index].numAttributes;
+	return 0;
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::AttributeName(size_t i) const
+{
+	DKASSERT_DEBUG(i < NumberOfAttributes());
+	const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+	return ctxt->String(ctxt->attributes[ctxt->nodes[index].firstAttribute + uint32_t(i)].name);
+}
+
+DKXmlCompactDocument::StringView DKXmlCompactDocument::Node::AttributeValue(size_t i) const
+{
+	DKASSERT_DEBUG(i < NumberOfAttributes());
+	const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+	return ctxt->String(ctxt->attributes[ctxt->nodes[index].firstAttribute + uint32_t(i)].value);
+}
+
+bool DKXmlCompactDocument::Node::FindAttribute(const char* name, StringView& value) const
+{
+	if (document)
+	{
+		const CompactDocumentContext* ctxt = COMPACT_CONTEXT(document);
+		const CompactNode& node = ctxt->nodes[index];
+		for (uint32_t i = 0; i < node.numAttributes; ++i)
+		{
+			const CompactAttribute& attr = ctxt->attributes[node.firstAttribute + i];
+			if (ctxt->String(attr.name) == name)
+			{
+				value = ctxt->String(attr.value);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+DKObject<DKXmlNode> DKXmlCompactDocument::Node::CreateNode() const
+{
+	if (document)
+		return COMPACT_CONTEXT(document)->CreateNode(index);
+	return NULL;
+}
+
+DKObject<DKXmlElement> DKXmlCompactDocument::Node::CreateElement() const
+{
+	if (Type() == DKXmlNode::NodeTypeElement)
+		return CreateNode().SafeCast<DKXmlElement>();
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DKXmlCompactDocument
+DKXmlCompactDocument::DKXmlCompactDocument()
+	: impl(NULL)
+{
+}
+
+DKXmlCompactDocument::~DKXmlCompactDocument()
+{
+	delete COMPACT_CONTEXT(this);
+}
+
+DKObject<DKXmlCompactDocument> DKXmlCompactDocument::Open(const DKString& file, DKString* desc)
+{
+	DKObject<DKFileMap> map = DKFileMap::Open(file, 0, false);
+	if (map)
+	{
+		map->Advise(DKFileMap::AccessSequential);
+		return Open(map.SafeCast<DKData>(), desc);
+	}
+	if (desc)
+		desc->SetValue(L"Cannot open file");
+	return NULL;
+}
+
+DKObject<DKXmlCompactDocument> DKXmlCompactDocument::Open(const DKData* data, DKString* desc)
+{
+	if (data == NULL)
+	{
+		if (desc)
+			desc->SetValue(L"Invalid data");
+		return NULL;
+	}
+
+	CompactDocumentContext* ctxt = new CompactDocumentContext();
+	ctxt->data = const_cast<DKData*>(data);
+	ctxt->source = reinterpret_cast<const char*>(data->LockShared());
+	if (ctxt->Build(data->Length()))
+	{
+		DKObject<DKXmlCompactDocument> document = DKObject<DKXmlCompactDocument>::New();
+		document->impl = ctxt;
+		if (desc)
+			desc->SetValue(L"");
+		return document;
+	}
+	if (desc)
+		desc->SetValue(ctxt->errorDesc);
+	delete ctxt;
+	return NULL;
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::FirstNode() const
+{
+	uint32_t first = COMPACT_CONTEXT(this)->nodes[0].firstChild;
+	if (first)
+		return Node(this, first);
+	return Node();
+}
+
+DKXmlCompactDocument::Node DKXmlCompactDocument::RootElement() const
+{
+	Node n = FirstNode();
+	if (n.IsValid() && n.Type() != DKXmlNode::NodeTypeElement)
+		return n.NextSiblingElement();
+	return n;
+}
+
+size_t DKXmlCompactDocument::NumberOfNodes() const
+{
+	return COMPACT_CONTEXT(this)->nodes.Count() - 1;
+}
+
+size_t DKXmlCompactDocument::NumberOfAttributes() const
+{
+	return COMPACT_CONTEXT(this)->attributes.Count();
+}
+
+size_t DKXmlCompactDocument::MemoryUsage() const
+{
+	const CompactDocumentContext* ctxt = COMPACT_CONTEXT(this);
+	return ctxt->nodes.MemoryUsage() + ctxt->attributes.MemoryUsage() + ctxt->strings.Capacity();
+}
+
+DKObject<DKXmlDocument> DKXmlCompactDocument::CreateDocument() const
+{
+	DKObject<DKXmlDocTypeDecl> dtd = NULL;
+	DKObject<DKXmlElement> root = NULL;
+	for (Node n = FirstNode(); n.IsValid(); n = n.NextSibling())
+	{
+		if (n.Type() == DKXmlNode::NodeTypeDocTypeDecl)
+			dtd = n.CreateNode().SafeCast<DKXmlDocTypeDecl>();
+		else if (n.Type() == DKXmlNode::NodeTypeElement)
+			root = n.CreateElement();
+	}
+	return DKOBJECT_NEW DKXmlDocument(dtd, root);
+}
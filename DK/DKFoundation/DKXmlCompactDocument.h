@@ -0,0 +1,138 @@
+//
+//  File: DKXmlCompactDocument.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKStringU8.h"
+#include "DKData.h"
+#include "DKXmlReader.h"
+#include "DKXmlDocument.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Read-only XML DOM with compact memory layout.
+
+	 Nodes and attributes are stored in arena pages and linked with indices,
+	 names and values are slices of source data. Only values which contain
+	 references are decoded and copied to string arena. Destroying document
+	 releases arena pages, nodes are not deallocated individually.
+	 Source data (ex: DKFileMap) is retained and locked while document alive.
+
+	 Nodes are accessed with Node handles, handle is valid while document
+	 object exists. Use Node::CreateElement() to build DKXmlElement of
+	 sub-tree for DKVariant, DKSerializer or other interfaces which use
+	 DKXmlElement.
+
+	 @code
+	  DKObject<DKXmlCompactDocument> doc = DKXmlCompactDocument::Open(path);
+	  for (DKXmlCompactNode n = doc->RootElement().FirstChildElement("DKVariant"); n.IsValid(); n = n.NextSiblingElement("DKVariant"))
+	  {
+		  DKVariant v(n.CreateElement());
+		  ...
+	  }
+	 @endcode
+
+	 @note
+	  Document is parsed with DKXmlReader, it should be encoded with UTF-8
+	  and internal subset of DTD is not processed. (see DKXmlReader.h)
+	  Namespace prefixes are not validated, resolved by NamespaceURI().
+	  Use DKXmlDocument for other documents.
+	 */
+	class DKGL_API DKXmlCompactDocument
+	{
+	public:
+		using StringView = DKXmlReader::StringView;
+		using NodeType = DKXmlDocument::Node::NodeType;
+
+		class DKGL_API Node
+		{
+		public:
+			Node() : document(NULL), index(0) {}
+
+			bool IsValid() const					{ return document != NULL; }
+			bool operator == (const Node& n) const	{ return document == n.document && index == n.index; }
+			bool operator != (const Node& n) const	{ return !operator == (n); }
+
+			/// NodeTypeElement, NodeTypePCData, NodeTypeCData, NodeTypeComment,
+			/// NodeTypeInstruction or NodeTypeDocTypeDecl
+			NodeType Type() const;
+
+			/// Parent() of top-level nodes is not valid.
+			Node Parent() const;
+			Node FirstChild() const;
+			Node NextSibling() const;
+			size_t NumberOfChildren() const;
+			/// find element by qualified name, any element if name is NULL.
+			Node FirstChildElement(const char* name = NULL) const;
+			Node NextSiblingElement(const char* name = NULL) const;
+
+			/// qualified name of element, target of instruction, name of DTD.
+			StringView Name() const;
+			StringView Prefix() const;
+			StringView LocalName() const;
+			/// namespace URI of element, resolved with declarations of ancestors.
+			StringView NamespaceURI() const;
+			/// decoded text of PCData, CData, comment, data of instruction.
+			StringView Value() const;
+			/// concatenated text of PCData, CData child nodes.
+			DKStringU8 Text() const;
+
+			/// attributes include namespace declarations. (xmlns)
+			size_t NumberOfAttributes() const;
+			StringView AttributeName(size_t index) const;
+			StringView AttributeValue(size_t index) const;	///< decoded value
+			bool FindAttribute(const char* name, StringView& value) const;
+
+			/// create DKXmlDocument node of this node and sub-tree.
+			DKObject<DKXmlNode> CreateNode() const;
+			/// returns NULL if node is not an element.
+			DKObject<DKXmlElement> CreateElement() const;
+
+		private:
+			friend class DKXmlCompactDocument;
+			Node(const DKXmlCompactDocument* d, uint32_t i) : document(d), index(i) {}
+			const DKXmlCompactDocument* document;
+			uint32_t index;
+		};
+
+		~DKXmlCompactDocument();
+
+		/// open local file with DKFileMap.
+		static DKObject<DKXmlCompactDocument> Open(const DKString& file, DKString* desc = NULL);
+		/// data is retained and locked while document alive.
+		static DKObject<DKXmlCompactDocument> Open(const DKData* data, DKString* desc = NULL);
+
+		/// first top-level node (declarations, comments, root element)
+		Node FirstNode() const;
+		Node RootElement() const;
+
+		size_t NumberOfNodes() const;
+		size_t NumberOfAttributes() const;
+		/// bytes allocated for nodes, attributes and decoded strings.
+		size_t MemoryUsage() const;
+
+		/// create DKXmlDocument object of entire document.
+		/// @note only the DTD and the root element are kept, top-level
+		///  comments and processing instructions outside of the root element
+		///  are dropped. (DKXmlDocument::Open keeps them)
+		DKObject<DKXmlDocument> CreateDocument() const;
+
+	private:
+		DKXmlCompactDocument();
+		DKXmlCompactDocument(const DKXmlCompactDocument&) = delete;
+		DKXmlCompactDocument& operator = (const DKXmlCompactDocument&) = delete;
+		friend class DKObject<DKXmlCompactDocument>;
+
+		void* impl;
+	};
+
+	typedef DKXmlCompactDocument::Node		DKXmlCompactNode;
+}
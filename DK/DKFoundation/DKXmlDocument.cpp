@@ -6,7 +6,10 @@
 //
 
 #include "DKXmlDocument.h"
+#include "DKXmlReader.h"
 #include "DKBuffer.h"
+#include "DKFileMap.h"
+#include "DKDataStream.h"
 #include "DKStack.h"
 #include "DKLog.h"
 
@@ -204,6 +207,157 @@ private:
 	}
 };
 
+// ReaderBuilder : building DKXmlDocument object with DKXmlReader.
+// returns NULL if document cannot be built without DKXmlParser.
+// (DTD, unresolved namespace, not well-formed, etc.)
+class DKXmlDocument::ReaderBuilder
+{
+public:
+	static DKObject<DKXmlDocument> Build(const DKData* data)
+	{
+		DKXmlReader reader;
+		if (!reader.Open(data))
+			return NULL;
+
+		DKObject<DKXmlDocument> document = DKObject<DKXmlDocument>::New();
+		DKArray<DKXmlElement*> elements;
+		DKStringU8 str;
+
+		auto addNode = [&](DKXmlNode* node)
+		{
+			if (elements.Count() > 0)
+				elements.Value(elements.Count() - 1)->nodes.Add(node);
+			else
+				document->nodes.Add(node);
+		};
+		// find namespace declared with prefix, in element stack.
+		auto findNamespace = [&](const DKXmlReader::StringView& prefixView, bool& found)->DKXmlNamespace*
+		{
+			found = true;
+			DKString prefix = prefixView.ToString();
+			for (size_t i = elements.Count(); i > 0; --i)
+			{
+				DKXmlElement* e = elements.Value(i - 1);
+				for (DKXmlNamespace& ns : e->namespaces)
+				{
+					if (ns.prefix == prefix)
+					{
+						if (ns.URI.Length() == 0)	// xmlns=""
+							return NULL;
+						return &ns;
+					}
+				}
+			}
+			found = prefix.Length() == 0;	// no default namespace
+			return NULL;
+		};
+
+		while (true)
+		{
+			switch (reader.Next())
+			{
+			case DKXmlReader::TokenStartElement:
+				{
+					DKObject<DKXmlElement> e = DKObject<DKXmlElement>::New();
+					// namespace declarations
+					for (size_t i = 0; i < reader.NumberOfAttributes(); ++i)
+					{
+						const DKXmlReader::StringView& name = reader.AttributeAt(i).name;
+						if (name.length >= 5 && memcmp(name.data, "xmlns", 5) == 0 && (name.length == 5 || name.data[5] == ':'))
+						{
+							if (!reader.DecodeAttribute(i, str))
+								return NULL;
+							DKXmlNamespace ns;
+							if (name.length > 6)
+								ns.prefix = DKXmlReader::StringView{ name.data + 6, name.length - 6 }.ToString();
+							ns.URI = DKString(str);
+							e->namespaces.Add(ns);
+						}
+					}
+					if (elements.Count() > 0)
+						elements.Value(elements.Count() - 1)->nodes.Add(e.SafeCast<DKXmlNode>());
+					else
+						document->SetRootElement(e);
+					elements.Add(e);
+
+					bool found;
+					e->name = reader.LocalName().ToString();
+					e->ns = findNamespace(reader.Prefix(), found);
+					if (!found)
+						return NULL;
+
+					e->attributes.Reserve(reader.NumberOfAttributes() - e->namespaces.Count());
+					for (size_t i = 0; i < reader.NumberOfAttributes(); ++i)
+					{
+						DKXmlReader::StringView name = reader.AttributeAt(i).name;
+						if (name.length >= 5 && memcmp(name.data, "xmlns", 5) == 0 && (name.length == 5 || name.data[5] == ':'))
+							continue;
+						if (!reader.DecodeAttribute(i, str))
+							return NULL;
+
+						DKXmlAttribute attr;
+						attr.value = DKString(str);
+						const char* colon = reinterpret_cast<const char*>(memchr(name.data, ':', name.length));
+						if (colon)
+						{
+							DKXmlReader::StringView prefix = { name.data, size_t(colon - name.data) };
+							name = { colon + 1, name.length - prefix.length - 1 };
+							if (prefix != "xml")
+							{
+								attr.ns = findNamespace(prefix, found);
+								if (!found)
+									return NULL;
+							}
+						}
+						attr.name = name.ToString();
+						e->attributes.Add(attr);
+					}
+				}
+				break;
+			case DKXmlReader::TokenEndElement:
+				elements.Remove(elements.Count() - 1);
+				break;
+			case DKXmlReader::TokenText:
+				{
+					if (!reader.DecodeValue(str))
+						return NULL;
+					DKObject<DKXmlPCData> c = DKObject<DKXmlPCData>::New();
+					c->value = DKString(str);
+					addNode(c);
+				}
+				break;
+			case DKXmlReader::TokenCData:
+				{
+					DKObject<DKXmlCData> c = DKObject<DKXmlCData>::New();
+					c->value = reader.Value().ToStringU8();
+					addNode(c);
+				}
+				break;
+			case DKXmlReader::TokenComment:
+				{
+					DKObject<DKXmlComment> c = DKObject<DKXmlComment>::New();
+					c->value = reader.Value().ToString();
+					addNode(c);
+				}
+				break;
+			case DKXmlReader::TokenProcessingInstruction:
+				{
+					DKObject<DKXmlInstruction> ins = DKObject<DKXmlInstruction>::New();
+					ins->target = reader.Name().ToString();
+					ins->data = reader.Value().ToString();
+					addNode(ins);
+				}
+				break;
+			case DKXmlReader::TokenEndDocument:
+				return document;
+			default:	// DTD or error
+				return NULL;
+			}
+		}
+		return NULL;
+	}
+};
+
 DKXmlDocument::DKXmlDocument()
 {
 }
@@ -225,6 +379,22 @@ DKXmlDocument::~DKXmlDocument()
 
 DKObject<DKXmlDocument> DKXmlDocument::Open(Type t, const DKString& fileOrURL, DKString* desc)
 {
+	if (t == TypeXML && fileOrURL.Find(L"://") < 0)	// local file
+	{
+		DKObject<DKFileMap> map = DKFileMap::Open(fileOrURL, 0, false);
+		if (map)
+		{
+			map->Advise(DKFileMap::AccessSequential);
+			DKObject<DKXmlDocument> document = ReaderBuilder::Build(map);
+			if (document)
+			{
+				if (desc)
+					desc->SetValue(L"");
+				return document;
+			}
+		}
+	}
+
 	DocumentBuilder doc;
 	bool ret = t == TypeXML ? doc.BeginXml(fileOrURL) : doc.BeginHtml(fileOrURL);
 	if (ret)
@@ -245,6 +415,17 @@ DKObject<DKXmlDocument> DKXmlDocument::Open(Type t, const DKString& fileOrURL, D
 
 DKObject<DKXmlDocument> DKXmlDocument::Open(Type t, const DKData* buffer, DKString* desc)
 {
+	if (t == TypeXML && buffer)
+	{
+		DKObject<DKXmlDocument> document = ReaderBuilder::Build(buffer);
+		if (document)
+		{
+			if (desc)
+				desc->SetValue(L"");
+			return document;
+		}
+	}
+
 	DocumentBuilder doc;
 	bool ret = t == TypeXML ? doc.BeginXml(buffer) : doc.BeginHtml(buffer);
 	if (ret)
@@ -265,6 +446,17 @@ DKObject<DKXmlDocument> DKXmlDocument::Open(Type t, const DKData* buffer, DKStri
 
 DKObject<DKXmlDocument> DKXmlDocument::Open(Type t, DKStream* stream, DKString* desc)
 {
+	if (t == TypeXML && stream && stream->IsReadable())
+	{
+		// read data once, for DKXmlReader and DKXmlParser.
+		DKObject<DKDataStream> ds = DKObject<DKStream>(stream).SafeCast<DKDataStream>();
+		if (ds)
+			return Open(t, ds->Data(), desc);
+		DKObject<DKBuffer> buffer = DKBuffer::Create(stream);
+		if (buffer)
+			return Open(t, buffer, desc);
+	}
+
 	DocumentBuilder doc;
 	bool ret = t == TypeXML ? doc.BeginXml(stream) : doc.BeginHtml(stream);
 	if (ret)
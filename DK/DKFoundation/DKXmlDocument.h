@@ -17,6 +17,8 @@ namespace DKFoundation
 	/// XML DOM class, provides parse and generate DOM of XML, HTML.
 	/// this class uses DKXmlParser internally. (see DKXmlParser.h)
 	/// this class provides DOM includes DTD.
+	/// UTF-8 XML documents without DTD are parsed with DKXmlReader (faster),
+	/// other documents are parsed with DKXmlParser.
 	class DKGL_API DKXmlDocument
 	{
 	public:
@@ -146,6 +148,7 @@ namespace DKFoundation
 	private:
 		DKArray<DKObject<Node>> nodes; // all nodes of DOM.
 		class DocumentBuilder;
+		class ReaderBuilder;
 	};
 
 	typedef DKXmlDocument::Namespace		DKXmlNamespace;
@@ -0,0 +1,650 @@
+//
+//  File: DKXmlReader.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include "DKXmlReader.h"
+
+namespace DKFoundation::Private
+{
+    inline bool IsXmlSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+    inline bool IsXmlNameStartChar(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || uint8_t(c) >= 0x80;
+    }
+    inline bool IsXmlNameChar(char c)
+    {
+        return IsXmlNameStartChar(c) || (c >= '0' && c <= '9') || c == '-' || c == '.';
+    }
+    inline const char* SkipXmlSpace(const char* p, const char* end)
+    {
+        while (p < end && IsXmlSpace(*p))
+            ++p;
+        return p;
+    }
+    inline bool XmlStartsWith(const char* p, const char* end, const char* str, size_t len)
+    {
+        return size_t(end - p) >= len && memcmp(p, str, len) == 0;
+    }
+    // find string, returns NULL if not found.
+    inline const char* FindXmlString(const char* p, const char* end, const char* str, size_t len)
+    {
+        while (size_t(end - p) >= len)
+        {
+            p = reinterpret_cast<const char*>(memchr(p, str[0], size_t(end - p) - len + 1));
+            if (p == NULL)
+                return NULL;
+            if (memcmp(p, str, len) == 0)
+                return p;
+            ++p;
+        }
+        return NULL;
+    }
+    inline const char* ParseXmlName(const char* p, const char* end)
+    {
+        if (p < end && IsXmlNameStartChar(*p))
+        {
+            ++p;
+            while (p < end && IsXmlNameChar(*p))
+                ++p;
+        }
+        return p;
+    }
+    inline void AppendUTF8(DKArray<char>& output, uint32_t c)
+    {
+        char buff[4];
+        size_t n;
+        if (c < 0x80)
+        {
+            buff[0] = char(c);
+            n = 1;
+        }
+        else if (c < 0x800)
+        {
+            buff[0] = char(0xc0 | (c >> 6));
+            buff[1] = char(0x80 | (c & 0x3f));
+            n = 2;
+        }
+        else if (c < 0x10000)
+        {
+            buff[0] = char(0xe0 | (c >> 12));
+            buff[1] = char(0x80 | ((c >> 6) & 0x3f));
+            buff[2] = char(0x80 | (c & 0x3f));
+            n = 3;
+        }
+        else
+        {
+            buff[0] = char(0xf0 | (c >> 18));
+            buff[1] = char(0x80 | ((c >> 12) & 0x3f));
+            buff[2] = char(0x80 | ((c >> 6) & 0x3f));
+            buff[3] = char(0x80 | (c & 0x3f));
+            n = 4;
+        }
+        output.Add(buff, n);
+    }
+    // decode character or predefined entity reference (without '&', ';')
+    inline bool DecodeXmlReference(const char* p, size_t len, DKArray<char>& output)
+    {
+        if (len >= 2 && p[0] == '#')
+        {
+            uint32_t c = 0;
+            if (p[1] == 'x')
+            {
+                if (len < 3)
+                    return false;
+                for (size_t i = 2; i < len; ++i)
+                {
+                    char h = p[i];
+                    uint32_t d;
+                    if (h >= '0' && h <= '9')       d = h - '0';
+                    else if (h >= 'a' && h <= 'f')  d = h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F')  d = h - 'A' + 10;
+                    else return false;
+                    c = c * 16 + d;
+                    if (c > 0x10ffff)
+                        return false;
+                }
+            }
+            else
+            {
+                for (size_t i = 1; i < len; ++i)
+                {
+                    if (p[i] < '0' || p[i] > '9')
+                        return false;
+                    c = c * 10 + (p[i] - '0');
+                    if (c > 0x10ffff)
+                        return false;
+                }
+            }
+            if (c == 0 || (c >= 0xd800 && c <= 0xdfff))
+                return false;
+            AppendUTF8(output, c);
+            return true;
+        }
+        struct { const char* name; size_t length; char c; } entities[] = {
+            { "lt", 2, '<' }, { "gt", 2, '>' }, { "amp", 3, '&' }, { "quot", 4, '"' }, { "apos", 4, '\'' },
+        };
+        for (auto& e : entities)
+        {
+            if (e.length == len && memcmp(e.name, p, len) == 0)
+            {
+                output.Add(e.c);
+                return true;
+            }
+        }
+        return false;   // undefined entity
+    }
+}
+
+using namespace DKFoundation;
+using namespace DKFoundation::Private;
+
+DKXmlReader::DKXmlReader()
+	: begin(NULL)
+	, end(NULL)
+	, cursor(NULL)
+	, tokenBegin(NULL)
+	, token(TokenNone)
+	, name({ NULL, 0 })
+	, value({ NULL, 0 })
+	, emptyElement(false)
+	, rootClosed(false)
+{
+}
+
+DKXmlReader::~DKXmlReader()
+{
+	Close();
+}
+
+bool DKXmlReader::Open(const DKData* d)
+{
+	Close();
+	if (d)
+	{
+		const void* p = d->LockShared();
+		if (p)
+		{
+			this->data = const_cast<DKData*>(d);
+			if (Open(p, d->Length()))
+				return true;
+			// keep error state
+			this->data->UnlockShared();
+			this->data = NULL;
+			return false;
+		}
+		d->UnlockShared();
+	}
+	return false;
+}
+
+bool DKXmlReader::Open(const void* p, size_t length)
+{
+	if (this->data == NULL)
+		Close();
+
+	begin = reinterpret_cast<const char*>(p);
+	end = begin + length;
+	cursor = begin;
+	tokenBegin = begin;
+	token = TokenNone;
+	name = { begin, 0 };
+	value = { begin, 0 };
+	emptyElement = false;
+	rootClosed = false;
+	attributes.Clear();
+	elements.Clear();
+	errorDesc = L"";
+
+	if (p == NULL)
+	{
+		SetError("Document is empty");
+		return false;
+	}
+	if (XmlStartsWith(cursor, end, "\xef\xbb\xbf", 3))	// UTF-8 BOM
+		cursor += 3;
+	if (end - cursor >= 2 && (cursor[0] == 0 || cursor[1] == 0 || XmlStartsWith(cursor, end, "\xfe\xff", 2) || XmlStartsWith(cursor, end, "\xff\xfe", 2)))
+	{
+		SetError("Unsupported encoding");
+		return false;
+	}
+	return ParseDeclaration();
+}
+
+void DKXmlReader::Close()
+{
+	if (this->data)
+		this->data->UnlockShared();
+	this->data = NULL;
+	begin = end = cursor = tokenBegin = NULL;
+	token = TokenNone;
+	name = { NULL, 0 };
+	value = { NULL, 0 };
+	attributes.Clear();
+	elements.Clear();
+}
+
+DKXmlReader::TokenType DKXmlReader::SetError(const char* mesg)
+{
+	token = TokenError;
+	errorDesc = DKString::Format("%s (line %zu)", mesg, LineNumber());
+	attributes.Clear();
+	return token;
+}
+
+bool DKXmlReader::ParseDeclaration()
+{
+	// <?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+	if (!XmlStartsWith(cursor, end, "<?xml", 5) || cursor + 5 >= end || !IsXmlSpace(cursor[5]))
+		return true;
+
+	tokenBegin = cursor;
+	const char* declEnd = FindXmlString(cursor, end, "?>", 2);
+	if (declEnd == NULL)
+	{
+		SetError("Blank needed here");
+		return false;
+	}
+	const char* p = cursor + 5;
+	while (true)
+	{
+		p = SkipXmlSpace(p, declEnd);
+		if (p >= declEnd)
+			break;
+		const char* n = p;
+		p = ParseXmlName(p, declEnd);
+		StringView attr = { n, size_t(p - n) };
+		p = SkipXmlSpace(p, declEnd);
+		if (attr.IsEmpty() || p >= declEnd || *p != '=')
+		{
+			SetError("Malformed XML declaration");
+			return false;
+		}
+		p = SkipXmlSpace(p + 1, declEnd);
+		if (p >= declEnd || (*p != '"' && *p != '\''))
+		{
+			SetError("Malformed XML declaration");
+			return false;
+		}
+		const char* q = reinterpret_cast<const char*>(memchr(p + 1, *p, size_t(declEnd - p - 1)));
+		if (q == NULL)
+		{
+			SetError("Malformed XML declaration");
+			return false;
+		}
+		StringView val = { p + 1, size_t(q - p - 1) };
+		p = q + 1;
+		if (attr == "encoding")
+		{
+			DKString enc = val.ToString();
+			if (enc.CompareNoCase(L"UTF-8") && enc.CompareNoCase(L"UTF8") &&
+				enc.CompareNoCase(L"US-ASCII") && enc.CompareNoCase(L"ASCII"))
+			{
+				SetError("Unsupported encoding");
+				return false;
+			}
+		}
+	}
+	cursor = declEnd + 2;
+	return true;
+}
+
+DKXmlReader::TokenType DKXmlReader::Next()
+{
+	if (token == TokenError || token == TokenEndDocument || begin == NULL)
+		return token;
+
+	attributes.Clear();
+	if (emptyElement)	// close empty element '<name/>'
+	{
+		emptyElement = false;
+		value = { name.data, 0 };
+		elements.Remove(elements.Count() - 1);
+		rootClosed = elements.Count() == 0;
+		return token = TokenEndElement;
+	}
+
+	while (true)
+	{
+		tokenBegin = cursor;
+		if (cursor >= end)
+		{
+			if (elements.Count() > 0)
+				return SetError("Premature end of data");
+			if (!rootClosed)
+				return SetError("Start tag expected, '<' not found");
+			name = value = { end, 0 };
+			return token = TokenEndDocument;
+		}
+		if (*cursor != '<')
+		{
+			const char* p = reinterpret_cast<const char*>(memchr(cursor, '<', size_t(end - cursor)));
+			if (p == NULL)
+				p = end;
+			if (elements.Count() == 0)
+			{
+				// only white-spaces allowed outside of root element.
+				if (SkipXmlSpace(cursor, p) != p)
+					return SetError(rootClosed ? "Extra content at the end of the document" : "Start tag expected, '<' not found");
+				cursor = p;
+				continue;
+			}
+			name = { cursor, 0 };
+			value = { cursor, size_t(p - cursor) };
+			cursor = p;
+			return token = TokenText;
+		}
+		return token = ParseMarkup();
+	}
+}
+
+DKXmlReader::TokenType DKXmlReader::ParseMarkup()
+{
+	DKASSERT_DEBUG(*cursor == '<');
+	if (XmlStartsWith(cursor, end, "</", 2))
+		return ParseEndElement();
+	if (XmlStartsWith(cursor, end, "<?", 2))
+		return ParseProcessingInstruction();
+	if (XmlStartsWith(cursor, end, "<!--", 4))
+	{
+		const char* p = cursor + 4;
+		const char* q = FindXmlString(p, end, "--", 2);
+		if (q == NULL)
+			return SetError("Comment not terminated");
+		if (q + 2 >= end || q[2] != '>')
+			return SetError("Double hyphen within comment");
+		name = { p, 0 };
+		value = { p, size_t(q - p) };
+		cursor = q + 3;
+		return TokenComment;
+	}
+	if (XmlStartsWith(cursor, end, "<![CDATA[", 9))
+	{
+		if (elements.Count() == 0)
+			return SetError("CData section not allowed here");
+		const char* p = cursor + 9;
+		const char* q = FindXmlString(p, end, "]]>", 3);
+		if (q == NULL)
+			return SetError("CData section not finished");
+		name = { p, 0 };
+		value = { p, size_t(q - p) };
+		cursor = q + 3;
+		return TokenCData;
+	}
+	if (XmlStartsWith(cursor, end, "<!DOCTYPE", 9))
+	{
+		if (elements.Count() > 0 || rootClosed)
+			return SetError("DOCTYPE not allowed here");
+		const char* p = SkipXmlSpace(cursor + 9, end);
+		const char* n = p;
+		p = ParseXmlName(p, end);
+		if (p == n)
+			return SetError("DOCTYPE improperly terminated");
+		name = { n, size_t(p - n) };
+		p = SkipXmlSpace(p, end);
+		const char* v = p;
+		// find '>' outside of internal subset and quoted strings.
+		int subset = 0;
+		while (p < end)
+		{
+			char c = *p;
+			if (c == '"' || c == '\'')
+			{
+				const char* q = reinterpret_cast<const char*>(memchr(p + 1, c, size_t(end - p - 1)));
+				if (q == NULL)
+					break;
+				p = q;
+			}
+			else if (c == '[')
+				subset++;
+			else if (c == ']')
+				subset--;
+			else if (c == '>' && subset <= 0)
+				break;
+			++p;
+		}
+		if (p >= end)
+			return SetError("DOCTYPE improperly terminated");
+		value = { v, size_t(p - v) };
+		cursor = p + 1;
+		return TokenDocumentType;
+	}
+	return ParseStartElement();
+}
+
+DKXmlReader::TokenType DKXmlReader::ParseStartElement()
+{
+	if (elements.Count() == 0 && rootClosed)
+		return SetError("Extra content at the end of the document");
+
+	const char* p = cursor + 1;
+	const char* n = p;
+	p = ParseXmlName(p, end);
+	if (p == n)
+		return SetError("StartTag: invalid element name");
+	name = { n, size_t(p - n) };
+	value = { p, 0 };
+
+	while (true)
+	{
+		const char* q = SkipXmlSpace(p, end);
+		if (q >= end)
+			return SetError("Couldn't find end of Start Tag");
+		if (*q == '>')
+		{
+			p = q + 1;
+			break;
+		}
+		if (*q == '/')
+		{
+			if (q + 1 >= end || q[1] != '>')
+				return SetError("Couldn't find end of Start Tag");
+			emptyElement = true;
+			p = q + 2;
+			break;
+		}
+		if (q == p)
+			return SetError("attributes construct error");
+
+		// attribute
+		const char* an = q;
+		q = ParseXmlName(q, end);
+		if (q == an)
+			return SetError("attributes construct error");
+		Attribute attr;
+		attr.name = { an, size_t(q - an) };
+		q = SkipXmlSpace(q, end);
+		if (q >= end || *q != '=')
+			return SetError("Specification mandates value for attribute");
+		q = SkipXmlSpace(q + 1, end);
+		if (q >= end || (*q != '"' && *q != '\''))
+			return SetError("AttValue: \" or ' expected");
+		const char* ve = reinterpret_cast<const char*>(memchr(q + 1, *q, size_t(end - q - 1)));
+		if (ve == NULL)
+			return SetError("AttValue: ' expected");
+		attr.value = { q + 1, size_t(ve - q - 1) };
+		if (memchr(attr.value.data, '<', attr.value.length))
+			return SetError("Unescaped '<' not allowed in attributes values");
+		for (const Attribute& a : attributes)
+		{
+			if (a.name == attr.name)
+				return SetError("Attribute redefined");
+		}
+		attributes.Add(attr);
+		p = ve + 1;
+	}
+	elements.Add(name);
+	cursor = p;
+	return TokenStartElement;
+}
+
+DKXmlReader::TokenType DKXmlReader::ParseEndElement()
+{
+	const char* p = cursor + 2;
+	const char* n = p;
+	p = ParseXmlName(p, end);
+	name = { n, size_t(p - n) };
+	value = { p, 0 };
+	p = SkipXmlSpace(p, end);
+	if (p >= end || *p != '>')
+		return SetError("expected '>'");
+	if (elements.Count() == 0 || elements.Value(elements.Count() - 1) != name)
+		return SetError("Opening and ending tag mismatch");
+	elements.Remove(elements.Count() - 1);
+	rootClosed = elements.Count() == 0;
+	cursor = p + 1;
+	return TokenEndElement;
+}
+
+DKXmlReader::TokenType DKXmlReader::ParseProcessingInstruction()
+{
+	const char* p = cursor + 2;
+	const char* n = p;
+	p = ParseXmlName(p, end);
+	if (p == n)
+		return SetError("xmlParsePI : no target name");
+	name = { n, size_t(p - n) };
+	if (name.length == 3 && (n[0] | 0x20) == 'x' && (n[1] | 0x20) == 'm' && (n[2] | 0x20) == 'l')
+		return SetError("XML declaration allowed only at the start of the document");
+
+	const char* q = FindXmlString(p, end, "?>", 2);
+	if (q == NULL)
+		return SetError("PI not terminated");
+	if (q != p)
+	{
+		if (!IsXmlSpace(*p))
+			return SetError("ParsePI: PI needs space");
+		p = SkipXmlSpace(p, q);
+	}
+	value = { p, size_t(q - p) };
+	cursor = q + 2;
+	return TokenProcessingInstruction;
+}
+
+DKXmlReader::StringView DKXmlReader::Prefix() const
+{
+	const char* p = reinterpret_cast<const char*>(memchr(name.data, ':', name.length));
+	if (p)
+		return { name.data, size_t(p - name.data) };
+	return { name.data, 0 };
+}
+
+DKXmlReader::StringView DKXmlReader::LocalName() const
+{
+	const char* p = reinterpret_cast<const char*>(memchr(name.data, ':', name.length));
+	if (p)
+		return { p + 1, name.length - size_t(p + 1 - name.data) };
+	return name;
+}
+
+bool DKXmlReader::FindAttribute(const char* attrName, StringView& attrValue) const
+{
+	for (const Attribute& a : attributes)
+	{
+		if (a.name == attrName)
+		{
+			attrValue = a.value;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool DKXmlReader::ValueNeedsDecoding() const
+{
+	return token == TokenText && NeedsDecoding(value, false);
+}
+
+bool DKXmlReader::DecodeValue(DKStringU8& str) const
+{
+	if (token == TokenText)
+		return Decode(value, str, false);
+	str = value.ToStringU8();
+	return true;
+}
+
+bool DKXmlReader::DecodeAttribute(size_t index, DKStringU8& str) const
+{
+	if (index < attributes.Count())
+		return Decode(attributes.Value(index).value, str, true);
+	return false;
+}
+
+bool DKXmlReader::NeedsDecoding(const StringView& str, bool attribute)
+{
+	const char* p = str.data;
+	const char* e = str.data + str.length;
+	for (; p < e; ++p)
+	{
+		char c = *p;
+		if (c == '&' || c == '\r' || (attribute && (c == '\n' || c == '\t')))
+			return true;
+	}
+	return false;
+}
+
+bool DKXmlReader::Decode(const StringView& str, DKStringU8& output, bool attribute)
+{
+	if (!NeedsDecoding(str, attribute))
+	{
+		output = str.ToStringU8();
+		return true;
+	}
+
+	DKArray<char> buffer;
+	buffer.Reserve(str.length);
+	const char* p = str.data;
+	const char* e = str.data + str.length;
+	while (p < e)
+	{
+		char c = *p;
+		if (c == '&')
+		{
+			const char* q = reinterpret_cast<const char*>(memchr(p + 1, ';', size_t(e - p - 1)));
+			if (q == NULL || !DecodeXmlReference(p + 1, size_t(q - p - 1), buffer))
+				return false;
+			p = q + 1;
+			continue;
+		}
+		if (c == '\r')		// line-break normalization
+		{
+			if (p + 1 < e && p[1] == '\n')
+				++p;
+			c = '\n';
+		}
+		if (attribute && (c == '\n' || c == '\t'))
+			c = ' ';
+		buffer.Add(c);
+		++p;
+	}
+	if (buffer.Count() > 0)
+		output.SetValue((const DKUniChar8*)(const char*)buffer, buffer.Count());
+	else
+		output = DKStringU8();
+	return true;
+}
+
+size_t DKXmlReader::Offset() const
+{
+	return size_t(tokenBegin - begin);
+}
+
+size_t DKXmlReader::LineNumber() const
+{
+	size_t line = 1;
+	const char* p = begin;
+	while (p && p < tokenBegin)
+	{
+		p = reinterpret_cast<const char*>(memchr(p, '\n', size_t(tokenBegin - p)));
+		if (p == NULL)
+			break;
+		++line;
+		++p;
+	}
+	return line;
+}
@@ -0,0 +1,152 @@
+//
+//  File: DKXmlReader.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKInclude.h"
+#include "DKObject.h"
+#include "DKString.h"
+#include "DKStringU8.h"
+#include "DKData.h"
+#include "DKArray.h"
+
+namespace DKFoundation
+{
+	/**
+	 @brief
+	 Pull style XML reader.
+
+	 Reads UTF-8 XML document token by token with Next(). Names and values of
+	 tokens are string views into input data, no memory is allocated for each
+	 token. Values are raw text of document, entity and character references
+	 are decoded only when DecodeValue() or DecodeAttribute() is called.
+	 Input data (ex: DKFileMap) is locked while reader is open.
+
+	 @code
+	  DKXmlReader reader;
+	  reader.Open(DKFileMap::Open(path, 0, false));
+	  while (reader.Next() == DKXmlReader::TokenStartElement)
+	  {
+		  if (reader.Name() == "mesh")
+			  ...
+	  }
+	 @endcode
+
+	 @note
+	  Document must be encoded with UTF-8. (or ASCII)
+	  Document type declaration is reported as single token, internal
+	  subset is not processed. Only predefined entities and character
+	  references can be decoded.
+	  Namespace prefixes are not resolved by reader.
+	  Use DKXmlParser (libxml2) for full XML or HTML support.
+	 */
+	class DKGL_API DKXmlReader
+	{
+	public:
+		/// UTF-8 string in input data, not null-terminated.
+		struct StringView
+		{
+			const char* data;
+			size_t length;
+
+			bool IsEmpty() const { return length == 0; }
+			bool operator == (const char* str) const { return strlen(str) == length && memcmp(data, str, length) == 0; }
+			bool operator != (const char* str) const { return !operator == (str); }
+			bool operator == (const StringView& sv) const { return length == sv.length && memcmp(data, sv.data, length) == 0; }
+			bool operator != (const StringView& sv) const { return !operator == (sv); }
+			DKStringU8 ToStringU8() const { return DKStringU8((const DKUniChar8*)data, length); }
+			DKString ToString() const { return DKString((const DKUniChar8*)data, length); }
+		};
+		struct Attribute
+		{
+			StringView name;
+			StringView value;	///< raw value, use DecodeAttribute()
+		};
+		enum TokenType
+		{
+			TokenNone = 0,
+			TokenStartElement,			///< Name(), attributes
+			TokenEndElement,			///< Name()
+			TokenText,					///< Value()
+			TokenCData,					///< Value()
+			TokenComment,				///< Value()
+			TokenProcessingInstruction,	///< Name() is target, Value() is data
+			TokenDocumentType,			///< Name(), Value() is rest of declaration
+			TokenEndDocument,
+			TokenError,					///< ErrorDescription()
+		};
+
+		DKXmlReader();
+		~DKXmlReader();
+
+		/// open reader with data, data is retained and locked until closed.
+		bool Open(const DKData* data);
+		/// open reader with memory, memory must be valid until closed.
+		bool Open(const void* p, size_t length);
+		void Close();
+
+		/// read next token, returns TokenEndDocument at the end,
+		/// TokenError if document is not well-formed.
+		TokenType Next();
+
+		TokenType Token() const					{ return token; }
+		StringView Name() const					{ return name; }
+		StringView Value() const				{ return value; }
+		/// element name split by ':'
+		StringView Prefix() const;
+		StringView LocalName() const;
+		/// element is closed with '/>', TokenEndElement follows.
+		bool IsEmptyElement() const				{ return emptyElement; }
+		/// number of open elements (includes current start element)
+		size_t Depth() const					{ return elements.Count(); }
+
+		size_t NumberOfAttributes() const		{ return attributes.Count(); }
+		const Attribute& AttributeAt(size_t index) const { return attributes.Value(index); }
+		bool FindAttribute(const char* name, StringView& value) const;
+
+		/// true if Value() has references or line breaks to be decoded.
+		bool ValueNeedsDecoding() const;
+		/// decode value of text token (entities, line breaks)
+		bool DecodeValue(DKStringU8& str) const;
+		/// decode attribute value (entities, whitespace normalization)
+		bool DecodeAttribute(size_t index, DKStringU8& str) const;
+
+		static bool NeedsDecoding(const StringView& str, bool attribute);
+		static bool Decode(const StringView& str, DKStringU8& output, bool attribute);
+
+		/// byte offset of current token in input
+		size_t Offset() const;
+		/// line number of current token, counted from 1.
+		size_t LineNumber() const;
+		const DKString& ErrorDescription() const { return errorDesc; }
+
+	private:
+		DKXmlReader(const DKXmlReader&) = delete;
+		DKXmlReader& operator = (const DKXmlReader&) = delete;
+
+		TokenType SetError(const char* mesg);
+		bool ParseDeclaration();
+		TokenType ParseStartElement();
+		TokenType ParseEndElement();
+		TokenType ParseMarkup();
+		TokenType ParseProcessingInstruction();
+
+		DKObject<DKData> data;
+		const char* begin;
+		const char* end;
+		const char* cursor;
+		const char* tokenBegin;
+
+		TokenType token;
+		StringView name;
+		StringView value;
+		bool emptyElement;
+		bool rootClosed;
+		DKArray<Attribute> attributes;
+		DKArray<StringView> elements;
+		DKString errorDesc;
+	};
+}
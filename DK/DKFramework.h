@@ -55,6 +55,7 @@ namespace DKFramework {}
 #include "DKFramework/DKGraphicsDeviceContext.h"
 #include "DKFramework/DKHingeConstraint.h"
 #include "DKFramework/DKImage.h"
+#include "DKFramework/DKJson.h"
 #include "DKFramework/DKLine.h"
 #include "DKFramework/DKLinearTransform2.h"
 #include "DKFramework/DKLinearTransform3.h"
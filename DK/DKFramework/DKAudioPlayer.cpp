@@ -52,6 +52,22 @@ namespace DKFramework
 			SourceStreamMap		sourceStreamMap;
 			DKSpinLock			queueLock;
 			DKCondition			playbackCond;
+
+			struct AudioPlayerMetrics
+			{
+				DKMetrics::Counter* buffersQueued = DKMetrics::RegisterCounter("DKAudioPlayer.BuffersQueued");
+				DKMetrics::Counter* bytesStreamed = DKMetrics::RegisterCounter("DKAudioPlayer.BytesStreamed");
+				DKMetrics::Counter* enqueueFailures = DKMetrics::RegisterCounter("DKAudioPlayer.EnqueueFailures");
+				DKMetrics::Counter* underruns = DKMetrics::RegisterCounter("DKAudioPlayer.Underruns");
+				DKMetrics::Gauge* activeSources = DKMetrics::RegisterGauge("DKAudioPlayer.ActiveSources");
+				DKMetrics::Histogram* decodeTime = DKMetrics::RegisterHistogram("DKAudioPlayer.DecodeTime");
+
+				static AudioPlayerMetrics& Get()
+				{
+					static AudioPlayerMetrics metrics;
+					return metrics;
+				}
+			};
 		}
 	}
 }
@@ -96,8 +112,14 @@ private:
 				buffer.Resize(ss.bufferSize);
 				unsigned char* buff = buffer;
 
+				AudioPlayerMetrics& metrics = AudioPlayerMetrics::Get();
 				ss.bufferPos = ss.stream->TimePos();
-				size_t bytesRead = ss.stream->Read(buff, ss.bufferSize);
+				size_t bytesRead;
+				if (true)
+				{
+					DKMetrics::Histogram::ScopedTimer timer(metrics.decodeTime);
+					bytesRead = ss.stream->Read(buff, ss.bufferSize);
+				}
 				if (bytesRead > 0 && bytesRead != (size_t)-1)
 				{
 					if (!ss.buffering)
@@ -111,14 +133,22 @@ private:
 						ss.streamCallback->Invoke(buff, bytesRead, ss.bufferPos);
 					if (ss.source->EnqueueBuffer(ss.stream->Frequency(), ss.stream->Bits(), ss.stream->Channels(), buff, bytesRead, ss.bufferPos))
 					{
+						metrics.buffersQueued->Increment();
+						metrics.bytesStreamed->Increment(bytesRead);
 						if (ss.source->State() != DKAudioSource::StatePlaying)
+						{
+							// source drained all queued buffers before we could feed it.
+							if (ss.playing)
+								metrics.underruns->Increment();
 							ss.source->Play();
+						}
 
 						ss.playing = true;
 					}
 					else		// EnqueueBuffer failed.
 					{
 						DKLog("AudioQueue: buffer enqueue failed!\n");
+						metrics.enqueueFailures->Increment();
 
 						ss.buffering = false;
 						ss.playing = false;
@@ -219,6 +249,8 @@ private:
 			CriticalSection section(queueLock);
 			sourceStreamMap.EnumerateForward([this](SourceStreamMap::Pair& pair) {this->FeedBuffer(pair); });
 
+			AudioPlayerMetrics::Get().activeSources->Set((int64_t)this->activeSources);
+
 			for (size_t i = 0; i < operations.Count(); ++i)
 				operations.Value(i)->Perform();
 			operations.Clear();
@@ -226,6 +258,7 @@ private:
 		CriticalSection section(queueLock);
 		sourceStreamMap.EnumerateForward([this](SourceStreamMap::Pair& pair) {this->Cleanup(pair); });
 		sourceStreamMap.Clear();
+		AudioPlayerMetrics::Get().activeSources->Set(0);
 
 		playbackCond.Unlock();
 		alContext->Unbind();
@@ -146,6 +146,7 @@ void DKDynamicsScene::Update(double tickDelta, DKTimeTick tick)
 {
 	DKASSERT_DEBUG(context && context->world);
 	DKASSERT_DEBUG(dynamic_cast<btDiscreteDynamicsWorld*>(context->world));
+	DKPROFILE_SCOPE("DKDynamicsScene::Update");
 
 	if (tick && tick == context->tick)
 		return;
@@ -156,17 +157,21 @@ void DKDynamicsScene::Update(double tickDelta, DKTimeTick tick)
 
 	PrepareUpdateNode();
 
-	if (dynamicsFixedFPS > 0.001)	// fixed frame rate for calculate physics (frame per second)
+	if (true)
 	{
-		const double fixedTimeStep = 1.0 / dynamicsFixedFPS;
-		int maxSubStep = ceil(tickDelta * dynamicsFixedFPS) + 1;
-		DKASSERT_DEBUG( maxSubStep > 0 );
-		DKASSERT_DEBUG( tickDelta < maxSubStep * fixedTimeStep );
-		static_cast<btDiscreteDynamicsWorld*>(context->world)->stepSimulation(tickDelta, maxSubStep, fixedTimeStep);
-	}
-	else
-	{
-		static_cast<btDiscreteDynamicsWorld*>(context->world)->stepSimulation(tickDelta);
+		DKPROFILE_SCOPE("DKDynamicsScene::Update.StepSimulation");
+		if (dynamicsFixedFPS > 0.001)	// fixed frame rate for calculate physics (frame per second)
+		{
+			const double fixedTimeStep = 1.0 / dynamicsFixedFPS;
+			int maxSubStep = ceil(tickDelta * dynamicsFixedFPS) + 1;
+			DKASSERT_DEBUG( maxSubStep > 0 );
+			DKASSERT_DEBUG( tickDelta < maxSubStep * fixedTimeStep );
+			static_cast<btDiscreteDynamicsWorld*>(context->world)->stepSimulation(tickDelta, maxSubStep, fixedTimeStep);
+		}
+		else
+		{
+			static_cast<btDiscreteDynamicsWorld*>(context->world)->stepSimulation(tickDelta);
+		}
 	}
 
 	UpdateObjectSceneStates();
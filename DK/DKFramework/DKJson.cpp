@@ -0,0 +1,1329 @@
+//
+//  File: DKJson.cpp
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DKJSON_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DKJSON_NEON 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "DKJson.h"
+
+namespace DKFramework::Private
+{
+    FORCEINLINE int JsonTrailingZeros(uint64_t x)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return (int)index;
+#else
+        return __builtin_ctzll(x);
+#endif
+    }
+
+    // bit is set from opening quote to character before closing quote.
+    FORCEINLINE uint64_t JsonPrefixXor(uint64_t x)
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    // character classes of 64 bytes block, bit N is for byte N.
+    struct JsonBlock
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t whitespace;
+        uint64_t op;            // { } [ ] : ,
+    };
+
+#if DKJSON_SSE2
+    FORCEINLINE void JsonClassify(const uint8_t* p, JsonBlock& block)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lower = _mm_set1_epi8(0x20);      // '[' | 0x20 = '{', ']' | 0x20 = '}'
+        const __m128i openBrace = _mm_set1_epi8('{');
+        const __m128i closeBrace = _mm_set1_epi8('}');
+        const __m128i colon = _mm_set1_epi8(':');
+        const __m128i comma = _mm_set1_epi8(',');
+
+        block = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+            __m128i l = _mm_or_si128(v, lower);
+            __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, openBrace), _mm_cmpeq_epi8(l, closeBrace)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+            const int shift = i * 16;
+            block.quote |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+            block.backslash |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+            block.whitespace |= uint64_t(uint32_t(_mm_movemask_epi8(ws))) << shift;
+            block.op |= uint64_t(uint32_t(_mm_movemask_epi8(op))) << shift;
+        }
+    }
+
+    // find first '"', '\\', control or non-ASCII character.
+    FORCEINLINE const char* JsonScanString(const char* p, const char* end)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x20);     // signed, includes 0x80~0xff
+        while (end - p >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmplt_epi8(v, control));
+            int mask = _mm_movemask_epi8(special);
+            if (mask)
+                return p + JsonTrailingZeros(uint64_t(mask));
+            p += 16;
+        }
+        while (p < end && *p != '"' && *p != '\\' && uint8_t(*p) >= 0x20 && uint8_t(*p) < 0x80)
+            ++p;
+        return p;
+    }
+#elif DKJSON_NEON
+    FORCEINLINE uint64_t JsonNeonMask(uint8x16_t v0, uint8x16_t v1, uint8x16_t v2, uint8x16_t v3)
+    {
+        const uint8x16_t bits = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+        uint8x16_t sum0 = vpaddq_u8(vandq_u8(v0, bits), vandq_u8(v1, bits));
+        uint8x16_t sum1 = vpaddq_u8(vandq_u8(v2, bits), vandq_u8(v3, bits));
+        sum0 = vpaddq_u8(sum0, sum1);
+        sum0 = vpaddq_u8(sum0, sum0);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+    }
+
+    FORCEINLINE void JsonClassify(const uint8_t* p, JsonBlock& block)
+    {
+        uint8x16_t quote[4], backslash[4], ws[4], op[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            uint8x16_t v = vld1q_u8(p + i * 16);
+            uint8x16_t l = vorrq_u8(v, vdupq_n_u8(0x20));
+            quote[i] = vceqq_u8(v, vdupq_n_u8('"'));
+            backslash[i] = vceqq_u8(v, vdupq_n_u8('\\'));
+            ws[i] = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')), vceqq_u8(v, vdupq_n_u8('\t'))),
+                             vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r'))));
+            op[i] = vorrq_u8(vorrq_u8(vceqq_u8(l, vdupq_n_u8('{')), vceqq_u8(l, vdupq_n_u8('}'))),
+                             vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')), vceqq_u8(v, vdupq_n_u8(','))));
+        }
+        block.quote = JsonNeonMask(quote[0], quote[1], quote[2], quote[3]);
+        block.backslash = JsonNeonMask(backslash[0], backslash[1], backslash[2], backslash[3]);
+        block.whitespace = JsonNeonMask(ws[0], ws[1], ws[2], ws[3]);
+        block.op = JsonNeonMask(op[0], op[1], op[2], op[3]);
+    }
+
+    FORCEINLINE const char* JsonScanString(const char* p, const char* end)
+    {
+        while (end - p >= 16)
+        {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))),
+                                          vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vcgeq_u8(v, vdupq_n_u8(0x80))));
+            if (vmaxvq_u8(special))
+                break;
+            p += 16;
+        }
+        while (p < end && *p != '"' && *p != '\\' && uint8_t(*p) >= 0x20 && uint8_t(*p) < 0x80)
+            ++p;
+        return p;
+    }
+#else
+    FORCEINLINE void JsonClassify(const uint8_t* p, JsonBlock& block)
+    {
+        block = { 0, 0, 0, 0 };
+        for (int i = 0; i < 64; ++i)
+        {
+            const uint64_t bit = uint64_t(1) << i;
+            switch (p[i])
+            {
+            case '"':   block.quote |= bit; break;
+            case '\\':  block.backslash |= bit; break;
+            case ' ': case '\t': case '\n': case '\r':
+                block.whitespace |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                block.op |= bit; break;
+            }
+        }
+    }
+
+    FORCEINLINE const char* JsonScanString(const char* p, const char* end)
+    {
+        while (p < end && *p != '"' && *p != '\\' && uint8_t(*p) >= 0x20 && uint8_t(*p) < 0x80)
+            ++p;
+        return p;
+    }
+#endif
+
+    // characters escaped by backslash. odd-length sequence of backslashes
+    // escapes next character, carry is set if block ends with escape.
+    FORCEINLINE uint64_t JsonEscaped(uint64_t backslash, uint64_t& carry)
+    {
+        if (backslash == 0)
+        {
+            uint64_t escaped = carry;
+            carry = 0;
+            return escaped;
+        }
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        backslash &= ~carry;
+        uint64_t followsEscape = (backslash << 1) | carry;
+        uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+        uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+        carry = sequencesStartingOnEvenBits < backslash ? 1 : 0;
+        uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+        return (evenBits ^ invertMask) & followsEscape;
+    }
+
+    FORCEINLINE bool IsJsonDelimiter(char c)
+    {
+        switch (c)
+        {
+        case ' ': case '\t': case '\n': case '\r':
+        case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+            return true;
+        }
+        return false;
+    }
+
+    // structural index: offsets of brackets, separators, opening quotes and
+    // first characters of literals, outside of strings.
+    struct JsonIndex
+    {
+        uint32_t* structurals;
+        size_t count;
+        size_t capacity;
+
+        JsonIndex() : structurals(NULL), count(0), capacity(0) {}
+        ~JsonIndex()
+        {
+            if (structurals)
+                DKFree(structurals);
+        }
+
+        const char* Build(const char* json, size_t length)
+        {
+            count = 0;
+            if (length >= 0xffffffffU)
+                return "Document is too large";
+
+            uint64_t escapedCarry = 0;
+            uint64_t inStringCarry = 0;
+            uint64_t scalarCarry = 0;
+            uint8_t tail[64];
+
+            for (size_t pos = 0; pos < length; pos += 64)
+            {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(json + pos);
+                if (length - pos < 64)
+                {
+                    memset(tail, ' ', 64);
+                    memcpy(tail, p, length - pos);
+                    p = tail;
+                }
+                JsonBlock block;
+                JsonClassify(p, block);
+
+                uint64_t quote = block.quote & ~JsonEscaped(block.backslash, escapedCarry);
+                uint64_t inString = JsonPrefixXor(quote) ^ inStringCarry;
+                inStringCarry = uint64_t(int64_t(inString) >> 63);
+
+                uint64_t scalar = ~(block.op | block.whitespace | block.quote | inString);
+                uint64_t scalarStart = scalar & ~((scalar << 1) | scalarCarry);
+                scalarCarry = scalar >> 63;
+
+                uint64_t bits = (block.op & ~inString) | (quote & inString) | scalarStart;
+                if (count + 64 > capacity)
+                {
+                    capacity = Max(capacity * 2, count + 64);
+                    structurals = reinterpret_cast<uint32_t*>(DKRealloc(structurals, sizeof(uint32_t) * capacity));
+                }
+                while (bits)
+                {
+                    structurals[count++] = uint32_t(pos + JsonTrailingZeros(bits));
+                    bits &= bits - 1;
+                }
+            }
+            if (inStringCarry)
+                return "Unclosed string";
+            if (count == 0)
+                return "Document is empty";
+            return NULL;
+        }
+    };
+
+    struct JsonParser
+    {
+        const char* json;
+        size_t length;
+        const uint32_t* structurals;
+        size_t count;
+        size_t next;                // next structural
+
+        DKUniCharW* chars;          // string buffer
+        size_t charsCapacity;
+
+        const char* error;
+        size_t errorOffset;
+
+        JsonParser(const char* j, size_t len, const JsonIndex& index)
+            : json(j), length(len), structurals(index.structurals), count(index.count), next(0)
+            , chars(NULL), charsCapacity(0), error(NULL), errorOffset(0)
+        {
+        }
+        ~JsonParser()
+        {
+            if (chars)
+                DKFree(chars);
+        }
+
+        bool Fail(const char* mesg, size_t offset)
+        {
+            if (error == NULL)
+            {
+                error = mesg;
+                errorOffset = offset;
+            }
+            return false;
+        }
+        DKString ErrorDescription() const
+        {
+            return DKString::Format("%s (offset %zu)", error, errorOffset);
+        }
+
+        char Peek() const
+        {
+            return next < count ? json[structurals[next]] : '\0';
+        }
+
+        FORCEINLINE void ReserveChars(size_t c)
+        {
+            if (c > charsCapacity)
+            {
+                charsCapacity = Max(charsCapacity * 2, c);
+                chars = reinterpret_cast<DKUniCharW*>(DKRealloc(chars, sizeof(DKUniCharW) * charsCapacity));
+            }
+        }
+
+        FORCEINLINE size_t AppendCodePoint(size_t n, uint32_t cp)
+        {
+            ReserveChars(n + 2);
+            if (sizeof(DKUniCharW) == 2 && cp > 0xffff)
+            {
+                cp -= 0x10000;
+                chars[n++] = DKUniCharW(0xd800 + (cp >> 10));
+                chars[n++] = DKUniCharW(0xdc00 + (cp & 0x3ff));
+            }
+            else
+                chars[n++] = DKUniCharW(cp);
+            return n;
+        }
+
+        static int HexValue(char c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+        bool ReadHex4(const char* p, uint32_t& value) const
+        {
+            if (json + length - p < 4)
+                return false;
+            value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                int h = HexValue(p[i]);
+                if (h < 0)
+                    return false;
+                value = (value << 4) | uint32_t(h);
+            }
+            return true;
+        }
+
+        // decode UTF-8 sequence, returns length or 0 if invalid.
+        static int DecodeUTF8(const uint8_t* p, const uint8_t* end, uint32_t& cp)
+        {
+            auto cont = [&](int i) { return p + i < end && (p[i] & 0xc0) == 0x80; };
+            uint8_t c = p[0];
+            if (c >= 0xc2 && c <= 0xdf)
+            {
+                if (!cont(1)) return 0;
+                cp = (uint32_t(c & 0x1f) << 6) | (p[1] & 0x3f);
+                return 2;
+            }
+            if (c >= 0xe0 && c <= 0xef)
+            {
+                if (!cont(1) || !cont(2)) return 0;
+                if ((c == 0xe0 && p[1] < 0xa0) || (c == 0xed && p[1] > 0x9f)) return 0;
+                cp = (uint32_t(c & 0x0f) << 12) | (uint32_t(p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+                return 3;
+            }
+            if (c >= 0xf0 && c <= 0xf4)
+            {
+                if (!cont(1) || !cont(2) || !cont(3)) return 0;
+                if ((c == 0xf0 && p[1] < 0x90) || (c == 0xf4 && p[1] > 0x8f)) return 0;
+                cp = (uint32_t(c & 0x07) << 18) | (uint32_t(p[1] & 0x3f) << 12) | (uint32_t(p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+                return 4;
+            }
+            return 0;
+        }
+
+        // pos: offset of opening quote
+        bool ParseString(uint32_t pos, DKString& str)
+        {
+            const char* p = json + pos + 1;
+            const char* end = json + length;
+            size_t n = 0;
+            while (true)
+            {
+                const char* run = JsonScanString(p, end);
+                if (run > p)
+                {
+                    ReserveChars(n + (run - p));
+                    for (; p < run; ++p)
+                        chars[n++] = DKUniCharW(*p);
+                }
+                if (p >= end)
+                    return Fail("Unclosed string", pos);
+
+                const uint8_t c = uint8_t(*p);
+                if (c == '"')
+                    break;
+                if (c == '\\')
+                {
+                    if (end - p < 2)
+                        return Fail("Unclosed string", pos);
+                    uint32_t cp;
+                    switch (p[1])
+                    {
+                    case '"':   cp = '"'; break;
+                    case '\\':  cp = '\\'; break;
+                    case '/':   cp = '/'; break;
+                    case 'b':   cp = '\b'; break;
+                    case 'f':   cp = '\f'; break;
+                    case 'n':   cp = '\n'; break;
+                    case 'r':   cp = '\r'; break;
+                    case 't':   cp = '\t'; break;
+                    case 'u':
+                        if (!ReadHex4(p + 2, cp))
+                            return Fail("Invalid unicode escape", p - json);
+                        if (cp >= 0xd800 && cp <= 0xdbff)       // surrogate pair
+                        {
+                            uint32_t low;
+                            if (end - p < 12 || p[6] != '\\' || p[7] != 'u' || !ReadHex4(p + 8, low) || low < 0xdc00 || low > 0xdfff)
+                                return Fail("Invalid unicode escape", p - json);
+                            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                            p += 6;
+                        }
+                        else if (cp >= 0xdc00 && cp <= 0xdfff)
+                            return Fail("Invalid unicode escape", p - json);
+                        p += 4;
+                        break;
+                    default:
+                        return Fail("Invalid escape character", p - json);
+                    }
+                    p += 2;
+                    n = AppendCodePoint(n, cp);
+                }
+                else if (c < 0x20)
+                {
+                    return Fail("Invalid control character in string", p - json);
+                }
+                else
+                {
+                    uint32_t cp;
+                    int len = DecodeUTF8(reinterpret_cast<const uint8_t*>(p), reinterpret_cast<const uint8_t*>(end), cp);
+                    if (len == 0)
+                        return Fail("Invalid UTF-8 sequence", p - json);
+                    p += len;
+                    n = AppendCodePoint(n, cp);
+                }
+            }
+            str.SetValue(chars, n);
+            return true;
+        }
+
+        bool ParseNumber(uint32_t pos, DKVariant& value)
+        {
+            static const double exactPowers[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+            auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+            const char* begin = json + pos;
+            const char* end = json + length;
+            const char* p = begin;
+            bool negative = false;
+            if (*p == '-')
+            {
+                negative = true;
+                ++p;
+            }
+            if (p >= end || !isDigit(*p))
+                return Fail("Invalid value", pos);
+
+            uint64_t mantissa = 0;
+            int exponent = 0;
+            bool truncated = false;
+            bool integer = true;
+            auto addDigit = [&](char c)->bool
+            {
+                if (mantissa < 1844674407370955161ULL)     // (2^64-1)/10
+                {
+                    mantissa = mantissa * 10 + uint64_t(c - '0');
+                    return true;
+                }
+                if (c != '0')
+                    truncated = true;
+                return false;
+            };
+
+            if (*p == '0')
+            {
+                ++p;
+                if (p < end && isDigit(*p))
+                    return Fail("Invalid number", pos);
+            }
+            else
+            {
+                for (; p < end && isDigit(*p); ++p)
+                {
+                    if (!addDigit(*p))
+                        ++exponent;
+                }
+            }
+            if (p < end && *p == '.')
+            {
+                integer = false;
+                ++p;
+                if (p >= end || !isDigit(*p))
+                    return Fail("Invalid number", pos);
+                for (; p < end && isDigit(*p); ++p)
+                {
+                    if (addDigit(*p))
+                        --exponent;
+                }
+            }
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                integer = false;
+                ++p;
+                bool negativeExp = false;
+                if (p < end && (*p == '+' || *p == '-'))
+                    negativeExp = *p++ == '-';
+                if (p >= end || !isDigit(*p))
+                    return Fail("Invalid number", pos);
+                int exp = 0;
+                for (; p < end && isDigit(*p); ++p)
+                {
+                    if (exp < 100000)
+                        exp = exp * 10 + (*p - '0');
+                }
+                exponent += negativeExp ? -exp : exp;
+            }
+            if (p < end && !IsJsonDelimiter(*p))
+                return Fail("Invalid number", pos);
+
+            if (integer && !truncated && exponent == 0)
+            {
+                if (negative && mantissa <= uint64_t(1) << 63)
+                {
+                    value.SetInteger(DKVariant::VInteger(0 - mantissa));
+                    return true;
+                }
+                if (!negative && mantissa < uint64_t(1) << 63)
+                {
+                    value.SetInteger(DKVariant::VInteger(mantissa));
+                    return true;
+                }
+            }
+            double d;
+            if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+            {
+                // exact, mantissa and power of 10 are representable.
+                d = double(mantissa);
+                if (exponent < 0)
+                    d /= exactPowers[-exponent];
+                else
+                    d *= exactPowers[exponent];
+                if (negative)
+                    d = -d;
+            }
+            else
+            {
+                char buffer[64];
+                size_t len = p - begin;
+                if (len < sizeof(buffer))
+                {
+                    memcpy(buffer, begin, len);
+                    buffer[len] = 0;
+                    d = strtod(buffer, NULL);
+                }
+                else
+                {
+                    DKStringU8 str((const DKUniChar8*)begin, len);
+                    d = strtod((const char*)(const DKUniChar8*)str, NULL);
+                }
+            }
+            value.SetFloat(d);
+            return true;
+        }
+
+        bool ParseLiteral(uint32_t pos, const char* literal, size_t len)
+        {
+            if (length - pos < len || memcmp(json + pos, literal, len) != 0 ||
+                (length - pos > len && !IsJsonDelimiter(json[pos + len])))
+                return Fail("Invalid value", pos);
+            return true;
+        }
+
+        bool ParseValue(DKVariant& value, int depth)
+        {
+            if (next >= count)
+                return Fail("Unexpected end of document", length);
+
+            const uint32_t pos = structurals[next++];
+            switch (json[pos])
+            {
+            case '{':
+                {
+                    if (depth >= DKJson::MaxDepth)
+                        return Fail("Maximum depth exceeded", pos);
+                    value.SetValueType(DKVariant::TypeUndefined);
+                    DKVariant::VPairs& pairs = value.Pairs();
+                    if (Peek() == '}')
+                    {
+                        ++next;
+                        return true;
+                    }
+                    DKString key;
+                    while (true)
+                    {
+                        if (Peek() != '"')
+                            return Fail("Object key expected", next < count ? structurals[next] : length);
+                        if (!ParseString(structurals[next++], key))
+                            return false;
+                        if (Peek() != ':')
+                            return Fail("':' expected", next < count ? structurals[next] : length);
+                        ++next;
+                        DKVariant item;
+                        if (!ParseValue(item, depth + 1))
+                            return false;
+                        pairs.Update(key, static_cast<DKVariant&&>(item));
+
+                        char c = Peek();
+                        ++next;
+                        if (c == '}')
+                            return true;
+                        if (c != ',')
+                            return Fail("',' or '}' expected", next <= count ? structurals[next - 1] : length);
+                    }
+                }
+            case '[':
+                {
+                    if (depth >= DKJson::MaxDepth)
+                        return Fail("Maximum depth exceeded", pos);
+                    value.SetValueType(DKVariant::TypeUndefined);
+                    DKVariant::VArray& array = value.Array();
+                    if (Peek() == ']')
+                    {
+                        ++next;
+                        return true;
+                    }
+                    while (true)
+                    {
+                        DKVariant& item = array.Value(array.Add(DKVariant()));
+                        if (!ParseValue(item, depth + 1))
+                            return false;
+
+                        char c = Peek();
+                        ++next;
+                        if (c == ']')
+                            return true;
+                        if (c != ',')
+                            return Fail("',' or ']' expected", next <= count ? structurals[next - 1] : length);
+                    }
+                }
+            case '"':
+                value.SetValueType(DKVariant::TypeString);
+                return ParseString(pos, value.String());
+            case 't':
+                if (!ParseLiteral(pos, "true", 4))
+                    return false;
+                value.SetInteger(1);
+                return true;
+            case 'f':
+                if (!ParseLiteral(pos, "false", 5))
+                    return false;
+                value.SetInteger(0);
+                return true;
+            case 'n':
+                if (!ParseLiteral(pos, "null", 4))
+                    return false;
+                value.SetValueType(DKVariant::TypeUndefined);
+                return true;
+            case '-': case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                return ParseNumber(pos, value);
+            }
+            return Fail("Invalid value", pos);
+        }
+    };
+
+    struct JsonDocumentContext
+    {
+        DKObject<DKData> data;
+        const char* json;
+        size_t length;
+        JsonIndex index;
+        uint32_t* matches;      // index of closing bracket, for opening brackets.
+
+        JsonDocumentContext() : json(NULL), length(0), matches(NULL) {}
+        ~JsonDocumentContext()
+        {
+            if (matches)
+                DKFree(matches);
+            if (data)
+                data->UnlockShared();
+        }
+
+        // match brackets, validates nesting only.
+        const char* MatchBrackets(size_t& errorOffset)
+        {
+            matches = reinterpret_cast<uint32_t*>(DKMalloc(sizeof(uint32_t) * index.count));
+            DKArray<uint32_t> stack;
+            for (size_t i = 0; i < index.count; ++i)
+            {
+                const uint32_t pos = index.structurals[i];
+                const char c = json[pos];
+                matches[i] = uint32_t(i);
+                if (c == '{' || c == '[')
+                {
+                    if (stack.Count() >= DKJson::MaxDepth)
+                    {
+                        errorOffset = pos;
+                        return "Maximum depth exceeded";
+                    }
+                    stack.Add(uint32_t(i));
+                }
+                else if (c == '}' || c == ']')
+                {
+                    if (stack.Count() == 0 || json[index.structurals[stack.Value(stack.Count() - 1)]] != (c == '}' ? '{' : '['))
+                    {
+                        errorOffset = pos;
+                        return "Mismatched bracket";
+                    }
+                    matches[stack.Value(stack.Count() - 1)] = uint32_t(i);
+                    stack.Remove(stack.Count() - 1);
+                }
+            }
+            if (stack.Count() > 0)
+            {
+                errorOffset = length;
+                return "Unexpected end of document";
+            }
+            return NULL;
+        }
+
+        // index of structural next to value at index i.
+        size_t SkipValue(size_t i) const
+        {
+            const char c = json[index.structurals[i]];
+            if (c == '{' || c == '[')
+                return matches[i] + 1;
+            return i + 1;
+        }
+
+        char CharAt(size_t i) const
+        {
+            return i < index.count ? json[index.structurals[i]] : '\0';
+        }
+
+        bool KeyEquals(JsonParser& parser, size_t i, const char* key, size_t keyLength) const
+        {
+            const uint32_t pos = index.structurals[i];
+            const char* p = json + pos + 1;
+            const char* end = JsonScanString(p, json + length);
+            while (end < json + length && *end != '"' && *end != '\\')     // non-ASCII
+                end = JsonScanString(end + 1, json + length);
+            if (end < json + length && *end == '"')
+                return size_t(end - p) == keyLength && memcmp(p, key, keyLength) == 0;
+
+            DKString str;   // escaped
+            return parser.ParseString(pos, str) && str == DKString((const DKUniChar8*)key, keyLength);
+        }
+
+        bool Locate(const char* path, size_t& result) const
+        {
+            JsonParser parser(json, length, index);
+            DKArray<char> token;
+            size_t i = 0;
+            while (*path)
+            {
+                if (*path != '/')
+                    return false;
+                ++path;
+                // reference token, unescape ~0, ~1
+                token.Clear();
+                for (; *path && *path != '/'; ++path)
+                {
+                    if (*path == '~' && (path[1] == '0' || path[1] == '1'))
+                    {
+                        token.Add(path[1] == '0' ? '~' : '/');
+                        ++path;
+                    }
+                    else
+                        token.Add(*path);
+                }
+
+                const char c = CharAt(i);
+                if (c == '{')
+                {
+                    size_t k = i + 1;
+                    if (CharAt(k) == '}')
+                        return false;
+                    while (true)
+                    {
+                        if (CharAt(k) != '"' || CharAt(k + 1) != ':' || k + 2 >= index.count)
+                            return false;
+                        if (KeyEquals(parser, k, token, token.Count()))
+                        {
+                            i = k + 2;
+                            break;
+                        }
+                        k = SkipValue(k + 2);
+                        if (CharAt(k) != ',')
+                            return false;
+                        ++k;
+                    }
+                }
+                else if (c == '[')
+                {
+                    if (token.Count() == 0 || (token.Value(0) == '0' && token.Count() > 1))
+                        return false;
+                    size_t n = 0;
+                    for (char d : token)
+                    {
+                        if (d < '0' || d > '9' || n > (index.count >> 1))
+                            return false;
+                        n = n * 10 + size_t(d - '0');
+                    }
+                    size_t k = i + 1;
+                    if (CharAt(k) == ']')
+                        return false;
+                    for (; n > 0; --n)
+                    {
+                        k = SkipValue(k);
+                        if (CharAt(k) != ',')
+                            return false;
+                        ++k;
+                    }
+                    i = k;
+                }
+                else
+                    return false;
+            }
+            result = i;
+            return i < index.count;
+        }
+    };
+
+    struct JsonWriter
+    {
+        enum { BufferSize = 4096, MaxToken = 64 };
+
+        DKStream* stream;
+        bool pretty;
+        int indent;
+        size_t used;
+        size_t total;
+        char buffer[BufferSize];
+
+        JsonWriter(DKStream* s, bool p) : stream(s), pretty(p), indent(0), used(0), total(0) {}
+
+        void Flush()
+        {
+            if (used > 0)
+            {
+                total += stream->Write(buffer, used);
+                used = 0;
+            }
+        }
+        // space for small token
+        FORCEINLINE char* Reserve(size_t n)
+        {
+            DKASSERT_DEBUG(n <= BufferSize);
+            if (used + n > BufferSize)
+                Flush();
+            return buffer + used;
+        }
+        FORCEINLINE void Put(char c)
+        {
+            if (used == BufferSize)
+                Flush();
+            buffer[used++] = c;
+        }
+        void Put(const char* s, size_t n)
+        {
+            while (n > 0)
+            {
+                if (used == BufferSize)
+                    Flush();
+                size_t len = Min(n, size_t(BufferSize) - used);
+                memcpy(buffer + used, s, len);
+                used += len;
+                s += len;
+                n -= len;
+            }
+        }
+        void NewLine()
+        {
+            if (pretty)
+            {
+                Put('\n');
+                for (int i = 0; i < indent; ++i)
+                    Put('\t');
+            }
+        }
+
+        void WriteInteger(int64_t value)
+        {
+            char* p = Reserve(24);
+            char digits[24];
+            int n = 0;
+            uint64_t v = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+            do {
+                digits[n++] = char('0' + (v % 10));
+                v /= 10;
+            } while (v);
+            size_t len = 0;
+            if (value < 0)
+                p[len++] = '-';
+            while (n > 0)
+                p[len++] = digits[--n];
+            used += len;
+        }
+
+        // shortest representation which can be restored exactly.
+        void WriteReal(double value, bool singlePrecision)
+        {
+            if (!isfinite(value))
+            {
+                Put("null", 4);
+                return;
+            }
+            if (value == floor(value) && fabs(value) < 1e15 && !(value == 0 && signbit(value)))
+            {
+                WriteInteger(int64_t(value));
+                Put(".0", 2);
+                return;
+            }
+            char* p = Reserve(MaxToken);
+            int len = 0;
+            for (int precision = singlePrecision ? 6 : 15; precision <= (singlePrecision ? 9 : 17); ++precision)
+            {
+                len = snprintf(p, MaxToken, "%.*g", precision, value);
+                if (singlePrecision ? float(strtod(p, NULL)) == float(value) : strtod(p, NULL) == value)
+                    break;
+            }
+            bool integral = true;
+            for (int i = 0; i < len; ++i)
+            {
+                if (p[i] == ',')        // decimal point of locale
+                    p[i] = '.';
+                if (p[i] == '.' || p[i] == 'e')
+                    integral = false;
+            }
+            if (integral)   // keep type as float
+            {
+                p[len++] = '.';
+                p[len++] = '0';
+            }
+            used += len;
+        }
+
+        void WriteReals(const float* values, size_t count)
+        {
+            Put('[');
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i > 0)
+                    Put(',');
+                WriteReal(values[i], true);
+            }
+            Put(']');
+        }
+
+        void WriteString(const DKUniCharW* str, size_t length)
+        {
+            static const char hex[] = "0123456789abcdef";
+            Put('"');
+            for (size_t i = 0; i < length; ++i)
+            {
+                uint32_t c = uint32_t(str[i]);
+                char* p = Reserve(8);
+                if (c < 0x80)
+                {
+                    if (c >= 0x20 && c != '"' && c != '\\')
+                    {
+                        p[0] = char(c);
+                        used += 1;
+                        continue;
+                    }
+                    p[0] = '\\';
+                    switch (c)
+                    {
+                    case '"':   p[1] = '"'; break;
+                    case '\\':  p[1] = '\\'; break;
+                    case '\b':  p[1] = 'b'; break;
+                    case '\f':  p[1] = 'f'; break;
+                    case '\n':  p[1] = 'n'; break;
+                    case '\r':  p[1] = 'r'; break;
+                    case '\t':  p[1] = 't'; break;
+                    default:
+                        p[1] = 'u'; p[2] = '0'; p[3] = '0';
+                        p[4] = hex[c >> 4]; p[5] = hex[c & 0xf];
+                        used += 6;
+                        continue;
+                    }
+                    used += 2;
+                    continue;
+                }
+                if (sizeof(DKUniCharW) == 2 && c >= 0xd800 && c <= 0xdbff && i + 1 < length &&
+                    uint32_t(str[i + 1]) >= 0xdc00 && uint32_t(str[i + 1]) <= 0xdfff)
+                {
+                    c = 0x10000 + ((c - 0xd800) << 10) + (uint32_t(str[++i]) - 0xdc00);
+                }
+                if ((c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff)
+                    c = 0xfffd;     // invalid, replacement character
+                if (c < 0x800)
+                {
+                    p[0] = char(0xc0 | (c >> 6));
+                    p[1] = char(0x80 | (c & 0x3f));
+                    used += 2;
+                }
+                else if (c < 0x10000)
+                {
+                    p[0] = char(0xe0 | (c >> 12));
+                    p[1] = char(0x80 | ((c >> 6) & 0x3f));
+                    p[2] = char(0x80 | (c & 0x3f));
+                    used += 3;
+                }
+                else
+                {
+                    p[0] = char(0xf0 | (c >> 18));
+                    p[1] = char(0x80 | ((c >> 12) & 0x3f));
+                    p[2] = char(0x80 | ((c >> 6) & 0x3f));
+                    p[3] = char(0x80 | (c & 0x3f));
+                    used += 4;
+                }
+            }
+            Put('"');
+        }
+
+        void WriteBase64(const DKData* data)
+        {
+            Put('"');
+            if (data)
+            {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(data->LockShared());
+                const size_t length = data->Length();
+                const size_t pieceLength = BufferSize / 4 * 3;
+                for (size_t i = 0; i < length; i += pieceLength)
+                {
+                    const size_t n = Min(pieceLength, length - i);
+                    char* out = Reserve(DKBuffer::Base64EncodedLength(n));
+                    used += DKBuffer::Base64Encode(p + i, n, out);
+                }
+                data->UnlockShared();
+            }
+            Put('"');
+        }
+
+        void WriteValue(const DKVariant& value)
+        {
+            switch (value.ValueType())
+            {
+            case DKVariant::TypeInteger:
+                WriteInteger(value.Integer());
+                break;
+            case DKVariant::TypeFloat:
+                WriteReal(value.Float(), false);
+                break;
+            case DKVariant::TypeVector2:
+                WriteReals(value.Vector2().val, 2);
+                break;
+            case DKVariant::TypeVector3:
+                WriteReals(value.Vector3().val, 3);
+                break;
+            case DKVariant::TypeVector4:
+                WriteReals(value.Vector4().val, 4);
+                break;
+            case DKVariant::TypeMatrix2:
+                WriteReals(value.Matrix2().val, 4);
+                break;
+            case DKVariant::TypeMatrix3:
+                WriteReals(value.Matrix3().val, 9);
+                break;
+            case DKVariant::TypeMatrix4:
+                WriteReals(value.Matrix4().val, 16);
+                break;
+            case DKVariant::TypeQuaternion:
+                WriteReals(value.Quaternion().val, 4);
+                break;
+            case DKVariant::TypeRationalNumber:
+                Put('"');
+                WriteInteger(value.RationalNumber().Numerator());
+                Put('/');
+                WriteInteger(value.RationalNumber().Denominator());
+                Put('"');
+                break;
+            case DKVariant::TypeString:
+                WriteString(value.String(), value.String().Length());
+                break;
+            case DKVariant::TypeDateTime:
+                {
+                    DKString str = value.DateTime().FormatISO8601();
+                    WriteString(str, str.Length());
+                }
+                break;
+            case DKVariant::TypeData:
+                WriteBase64(&value.Data());
+                break;
+            case DKVariant::TypeStructData:
+                WriteBase64(value.StructuredData().data);
+                break;
+            case DKVariant::TypeArray:
+                {
+                    const DKVariant::VArray& array = value.Array();
+                    Put('[');
+                    indent++;
+                    for (size_t i = 0; i < array.Count(); ++i)
+                    {
+                        if (i > 0)
+                            Put(',');
+                        NewLine();
+                        WriteValue(array.Value(i));
+                    }
+                    indent--;
+                    if (array.Count() > 0)
+                        NewLine();
+                    Put(']');
+                }
+                break;
+            case DKVariant::TypePairs:
+                {
+                    const DKVariant::VPairs& pairs = value.Pairs();
+                    Put('{');
+                    indent++;
+                    bool first = true;
+                    pairs.EnumerateForward([&](const DKVariant::VPairs::Pair& pair)
+                    {
+                        if (!first)
+                            Put(',');
+                        first = false;
+                        NewLine();
+                        WriteString(pair.key, pair.key.Length());
+                        if (pretty)
+                            Put(": ", 2);
+                        else
+                            Put(':');
+                        WriteValue(pair.value);
+                    });
+                    indent--;
+                    if (!first)
+                        NewLine();
+                    Put('}');
+                }
+                break;
+            default:
+                Put("null", 4);
+                break;
+            }
+        }
+    };
+}
+using namespace DKFramework;
+using namespace DKFramework::Private;
+
+#define JSON_CONTEXT	reinterpret_cast<JsonDocumentContext*>(this->impl)
+
+DKJson::DKJson()
+	: impl(NULL)
+{
+}
+
+DKJson::~DKJson()
+{
+	Close();
+}
+
+bool DKJson::Open(const DKData* json, DKString* desc)
+{
+	Close();
+	if (json == NULL)
+	{
+		if (desc)
+			desc->SetValue(L"Invalid data");
+		return false;
+	}
+	const void* p = json->LockShared();
+	if (Open(p, json->Length(), desc))
+	{
+		JSON_CONTEXT->data = const_cast<DKData*>(json);	// unlocked when closed
+		return true;
+	}
+	json->UnlockShared();
+	return false;
+}
+
+bool DKJson::Open(const void* json, size_t length, DKString* desc)
+{
+	Close();
+	JsonDocumentContext* ctxt = new JsonDocumentContext();
+	ctxt->json = reinterpret_cast<const char*>(json);
+	ctxt->length = length;
+
+	const char* error = ctxt->index.Build(ctxt->json, length);
+	if (error)
+	{
+		if (desc)
+			*desc = DKString::Format("%s", error);
+		delete ctxt;
+		return false;
+	}
+	size_t errorOffset = 0;
+	error = ctxt->MatchBrackets(errorOffset);
+	if (error)
+	{
+		if (desc)
+			*desc = DKString::Format("%s (offset %zu)", error, errorOffset);
+		delete ctxt;
+		return false;
+	}
+	if (desc)
+		desc->SetValue(L"");
+	this->impl = ctxt;
+	return true;
+}
+
+void DKJson::Close()
+{
+	delete JSON_CONTEXT;
+	this->impl = NULL;
+}
+
+bool DKJson::IsOpened() const
+{
+	return this->impl != NULL;
+}
+
+bool DKJson::Find(const char* path, DKVariant& value) const
+{
+	const JsonDocumentContext* ctxt = JSON_CONTEXT;
+	size_t index;
+	if (ctxt && path && ctxt->Locate(path, index))
+	{
+		JsonParser parser(ctxt->json, ctxt->length, ctxt->index);
+		parser.next = index;
+		return parser.ParseValue(value, 0);
+	}
+	return false;
+}
+
+size_t DKJson::Find(const char* const* paths, size_t count, DKVariant* values) const
+{
+	size_t found = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (Find(paths[i], values[i]))
+			found++;
+		else
+			values[i].SetValueType(DKVariant::TypeUndefined);
+	}
+	return found;
+}
+
+bool DKJson::Parse(const void* json, size_t length, DKVariant& value, DKString* desc)
+{
+	JsonIndex index;
+	const char* error = index.Build(reinterpret_cast<const char*>(json), length);
+	if (error)
+	{
+		if (desc)
+			*desc = DKString::Format("%s", error);
+		return false;
+	}
+	JsonParser parser(reinterpret_cast<const char*>(json), length, index);
+	if (parser.ParseValue(value, 0))
+	{
+		if (parser.next == parser.count)
+		{
+			if (desc)
+				desc->SetValue(L"");
+			return true;
+		}
+		parser.Fail("Unexpected data after root value", index.structurals[parser.next]);
+	}
+	if (desc)
+		*desc = parser.ErrorDescription();
+	return false;
+}
+
+bool DKJson::Parse(const DKData* json, DKVariant& value, DKString* desc)
+{
+	if (json)
+	{
+		const void* p = json->LockShared();
+		bool result = Parse(p, json->Length(), value, desc);
+		json->UnlockShared();
+		return result;
+	}
+	if (desc)
+		desc->SetValue(L"Invalid data");
+	return false;
+}
+
+size_t DKJson::Write(const DKVariant& value, DKStream* output, bool pretty)
+{
+	if (output == NULL || !output->IsWritable())
+		return 0;
+	JsonWriter writer(output, pretty);
+	writer.WriteValue(value);
+	writer.Flush();
+	return writer.total;
+}
+
+DKObject<DKData> DKJson::Write(const DKVariant& value, bool pretty)
+{
+	DKObject<DKBuffer> buffer = DKOBJECT_NEW DKBuffer();
+	DKBufferStream stream(buffer);
+	Write(value, &stream, pretty);
+	return buffer.SafeCast<DKData>();
+}
@@ -0,0 +1,93 @@
+//
+//  File: DKJson.h
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2004-2020 Hongtae Kim. All rights reserved.
+//
+
+#pragma once
+#include "../DKFoundation.h"
+#include "DKVariant.h"
+
+namespace DKFramework
+{
+	/**
+	 @brief
+	 JSON parser and writer for DKVariant.
+
+	 Parser builds structural index of document first, (positions of
+	 brackets, separators, strings and literals outside of strings) with
+	 SIMD instructions 64 bytes at a time. (SSE2, NEON) Values are built
+	 from index without tokenizing text again.
+
+	 JSON values are converted to DKVariant as follows.
+	   - object: TypePairs (duplicated keys: last value is used)
+	   - array: TypeArray
+	   - number: TypeInteger if number has no fraction or exponent and
+	     fits in int64, TypeFloat otherwise.
+	   - string: TypeString
+	   - true, false: TypeInteger (1, 0)
+	   - null: TypeUndefined
+
+	 Writer writes DKVariant to stream directly, values are encoded into
+	 small buffer without creating intermediate strings.
+	 Other types of DKVariant are written as follows.
+	   - Vector, Matrix, Quaternion: array of numbers
+	   - RationalNumber: string "numerator/denominator"
+	   - DateTime: ISO-8601 string
+	   - Data, StructData: Base64 string
+	   - Non-finite floating point number: null
+
+	 On-demand mode: Open() builds structural index only, Find() converts
+	 values at selected paths without building entire document.
+	 Paths are JSON Pointer (RFC 6901), ex: "/nodes/3/name", "" for root.
+
+	 @code
+	  DKJson json;
+	  if (json.Open(DKFileMap::Open(path, 0, false)))
+	  {
+		  DKVariant name;
+		  json.Find("/scene/nodes/0/name", name);
+	  }
+	 @endcode
+
+	 @note
+	  Document must be encoded with UTF-8 and smaller than 4GB.
+	  Nesting depth is limited to MaxDepth.
+	 */
+	class DKGL_API DKJson
+	{
+	public:
+		enum { MaxDepth = 1024 };
+
+		DKJson();
+		~DKJson();
+
+		/// open document for on-demand mode, data is retained and locked until closed.
+		bool Open(const DKData* json, DKString* desc = NULL);
+		/// open document with memory, memory must be valid until closed.
+		bool Open(const void* json, size_t length, DKString* desc = NULL);
+		void Close();
+		bool IsOpened() const;
+
+		/// find value at JSON Pointer path, returns false if not found or invalid.
+		bool Find(const char* path, DKVariant& value) const;
+		/// find values of paths, values not found are set to TypeUndefined.
+		/// returns number of values found.
+		size_t Find(const char* const* paths, size_t count, DKVariant* values) const;
+
+		/// parse entire document.
+		static bool Parse(const void* json, size_t length, DKVariant& value, DKString* desc = NULL);
+		static bool Parse(const DKData* json, DKVariant& value, DKString* desc = NULL);
+
+		/// write value as JSON text, returns number of bytes written.
+		static size_t Write(const DKVariant& value, DKStream* output, bool pretty = false);
+		static DKObject<DKData> Write(const DKVariant& value, bool pretty = false);
+
+	private:
+		DKJson(const DKJson&) = delete;
+		DKJson& operator = (const DKJson&) = delete;
+
+		void* impl;
+	};
+}
@@ -12,10 +12,14 @@ using namespace DKFramework;
 DKPropertySet::DKPropertySet()
 	: dataSet(DKVariant::TypePairs)
 {
+	DKLockProfiler::SetName(&lock, "DKPropertySet::lock");
+	DKLockProfiler::SetName(&callbackLock, "DKPropertySet::callbackLock");
 }
 
 DKPropertySet::~DKPropertySet()
 {
+	DKLockProfiler::Unregister(&lock);
+	DKLockProfiler::Unregister(&callbackLock);
 }
 
 int DKPropertySet::Import(const DKString& url, bool overwrite)
@@ -274,9 +278,12 @@ const DKVariant& DKPropertySet::Value(const DKString& key) const
 
 bool DKPropertySet::SetInitialValue(const DKString& key, const DKVariant& value)
 {
-	lock.Lock();
-	bool result = dataSet.Pairs().Insert(key, value);
-	lock.Unlock();
+	bool result = false;
+	if (true)
+	{
+		DKCriticalSection<DKSpinLock> guard(lock);
+		result = dataSet.Pairs().Insert(key, value);
+	}
 
 	if (result)
 	{
@@ -288,20 +295,20 @@ bool DKPropertySet::SetInitialValue(const DKString& key, const DKVariant& value)
 
 void DKPropertySet::SetValue(const DKString& key, const DKVariant& value)
 {
-	lock.Lock();
-
 	DKVariant oldValue;
 	bool modification = false;
 
-	const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
-	if (p)
+	if (true)
 	{
-		oldValue = p->value;
-		modification = true;
+		DKCriticalSection<DKSpinLock> guard(lock);
+		const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
+		if (p)
+		{
+			oldValue = p->value;
+			modification = true;
+		}
+		dataSet.Pairs().Update(key, value);
 	}
-	dataSet.Pairs().Update(key, value);
-
-	lock.Unlock();
 
 	if (modification)
 	{
@@ -315,25 +322,27 @@ void DKPropertySet::SetValue(const DKString& key, const DKVariant& value)
 
 void DKPropertySet::ReplaceValue(const DKString& key, Replacer* replacer)
 {
-	lock.Lock();
-
 	DKVariant oldValue;
+	DKVariant value;
 	bool modification = false;
 	bool removed = false;
 
-	const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
-	if (p)
+	if (true)
 	{
-		oldValue = p->value;
-		modification = true;
+		DKCriticalSection<DKSpinLock> guard(lock);
+		const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
+		if (p)
+		{
+			oldValue = p->value;
+			modification = true;
+		}
+		value = replacer->Invoke(oldValue);
+		removed = value.ValueType() == DKVariant::TypeUndefined;
+		if (removed)
+			dataSet.Pairs().Remove(key);
+		else
+			dataSet.Pairs().Update(key, value);
 	}
-	DKVariant value = replacer->Invoke(oldValue);
-	removed = value.ValueType() == DKVariant::TypeUndefined;
-	if (removed)
-		dataSet.Pairs().Remove(key);
-	else
-		dataSet.Pairs().Update(key, value);
-	lock.Unlock();
 
 	if (modification)
 	{
@@ -350,22 +359,22 @@ void DKPropertySet::ReplaceValue(const DKString& key, Replacer* replacer)
 
 void DKPropertySet::Remove(const DKString& key)
 {
-	lock.Lock();
-
 	DKVariant oldValue;
 	bool deletion = false;
 
-	const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
-	if (p)
+	if (true)
 	{
-		oldValue = p->value;
-		deletion = true;
+		DKCriticalSection<DKSpinLock> guard(lock);
+		const PropertyMap::Pair* p = dataSet.Pairs().Find(key);
+		if (p)
+		{
+			oldValue = p->value;
+			deletion = true;
 
-		dataSet.Pairs().Remove(key);
+			dataSet.Pairs().Remove(key);
+		}
 	}
 
-	lock.Unlock();
-
 	if (deletion)
 	{
 		CallbackObservers(key, deletionCallbacks, oldValue);
@@ -486,16 +495,18 @@ void DKPropertySet::EnumerateBackward(const Enumerator* e) const
 template <typename T, typename... Args>
 void DKPropertySet::CallbackObservers(const DKString& key, const DKMap<DKString, ObserverMap<DKObject<T>>>& target, Args&&... args) const
 {
-	callbackLock.Lock();
 	DKArray<DKObject<T>> callbacks;
-	if (auto p = target.Find(key); p)
+	if (true)
 	{
-		callbacks.Reserve(p->value.Count());
-		p->value.EnumerateForward([&callbacks](const typename decltype(p->value)::Pair& pair) {
-			callbacks.Add(pair.value);
-		});
+		DKCriticalSection<DKSpinLock> guard(callbackLock);
+		if (auto p = target.Find(key); p)
+		{
+			callbacks.Reserve(p->value.Count());
+			p->value.EnumerateForward([&callbacks](const typename decltype(p->value)::Pair& pair) {
+				callbacks.Add(pair.value);
+			});
+		}
 	}
-	callbackLock.Unlock();
 	for (T* cb : callbacks)
 		cb->Invoke(key, std::forward<Args>(args)...);
 }
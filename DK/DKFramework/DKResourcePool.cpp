@@ -8,22 +8,91 @@
 #include "DKResourcePool.h"
 #include "DKResource.h"
 
+namespace DKFramework::Private
+{
+    // metrics of all resource pools.
+    struct ResourcePoolMetrics
+    {
+        DKMetrics::Counter* hits = DKMetrics::RegisterCounter("DKResourcePool.Hits");
+        DKMetrics::Counter* misses = DKMetrics::RegisterCounter("DKResourcePool.Misses");
+        DKMetrics::Counter* loaded = DKMetrics::RegisterCounter("DKResourcePool.Loaded");
+        DKMetrics::Counter* failed = DKMetrics::RegisterCounter("DKResourcePool.LoadFailures");
+        DKMetrics::Counter* bytesLoaded = DKMetrics::RegisterCounter("DKResourcePool.BytesLoaded");
+        DKMetrics::Gauge* asyncLoads = DKMetrics::RegisterGauge("DKResourcePool.AsyncLoads");
+        DKMetrics::Histogram* loadTime = DKMetrics::RegisterHistogram("DKResourcePool.LoadTime");
+        DKMetrics::Histogram* dataLoadTime = DKMetrics::RegisterHistogram("DKResourcePool.DataLoadTime");
+
+        static ResourcePoolMetrics& Get()
+        {
+            static ResourcePoolMetrics metrics;
+            return metrics;
+        }
+    };
+
+    // reads entire file with DKAsyncFile. a read can transfer fewer bytes
+    // than requested (like pread), remaining range is resubmitted.
+    struct ResourceDataAsyncReader
+    {
+        using Completion = DKAsyncFile::Completion;
+
+        DKObject<DKAsyncFile> file;
+        uint8_t* buffer;
+        uint64_t length;
+        uint64_t offset;
+        DKObject<Completion> completion; // invoked with bytes read, or negative on error.
+
+        static bool Submit(DKObject<ResourceDataAsyncReader> reader)
+        {
+            // single read is limited by platform, (2GB on Linux)
+            size_t n = static_cast<size_t>(reader->length - reader->offset);
+            return reader->file->Read(reader->offset, &reader->buffer[reader->offset], n, DKFunction([reader](int64_t result) mutable
+            {
+                if (result > 0)
+                {
+                    reader->offset += static_cast<uint64_t>(result);
+                    if (reader->offset < reader->length)
+                    {
+                        if (Submit(reader))
+                            return;
+                        result = -1;
+                    }
+                    else
+                    {
+                        result = static_cast<int64_t>(reader->offset);
+                    }
+                }
+                else if (result == 0)   // end of file, file could be truncated.
+                {
+                    result = static_cast<int64_t>(reader->offset);
+                }
+                DKObject<Completion> completion = reader->completion;
+                reader->completion = NULL;
+                completion->Invoke(result);
+            }));
+        }
+    };
+}
+
 using namespace DKFramework;
+using namespace DKFramework::Private;
 
 DKResourcePool::DKResourcePool()
-	: allocator(NULL)
+	: lock(DKSharedLock::PolicyReaderBiased)
+	, allocator(NULL)
 {
+	DKLockProfiler::SetName(&lock, "DKResourcePool::lock");
 }
 
 DKResourcePool::~DKResourcePool()
 {
+	DKLockProfiler::Unregister(&lock);
 }
 
 bool DKResourcePool::AddLocator(Locator* loc, const DKString& name)
 {
 	if (loc && name.Length() > 0)
 	{
-		DKCriticalSection<DKSpinLock> guard(this->lock);
+		DKCriticalSection<DKSharedLock> guard(this->lock);
 
 		for (NamedLocator& nl : locators)
 		{
@@ -69,7 +138,57 @@ DKResourcePool::Locator* DKResourcePool::AddLocatorForPath(const DKString& path)
 			};
 			locator = DKOBJECT_NEW DirLocator(dir);
 		}
-		else	 // zip file with prefix (".../mydata.zip/prefix")
+		if (locator == NULL)	 // package file with prefix (".../mydata.dkpkg/prefix")
+		{
+			struct PackageLocator : public Locator
+			{
+				DKObject<DKPackage> package;
+				DKString prefix;
+
+				PackageLocator(DKPackage* p, const DKString& pf) : package(p), prefix(pf) {}
+				DKString FindSystemPath(const DKString&) const {return "";}
+				DKObject<DKStream> OpenStream(const DKString& name) const
+				{
+					return package->OpenStream(prefix + name);
+				}
+				DKObject<DKData> OpenData(const DKString& name) const
+				{
+					return package->Data(prefix + name);
+				}
+			};
+			DKObject<DKPackage> package = NULL;
+			if (DKPackage::IsPackage(path))
+				package = DKPackage::Open(path);
+			if (package)
+			{
+				locator = DKOBJECT_NEW PackageLocator(package, L"");
+			}
+			else
+			{
+				size_t len = path.Length();
+				const wchar_t* str = path;
+				for (size_t i = 1; i < len; ++i)
+				{
+#ifdef _WIN32
+					if (str[i] == L'/' || str[i] == L'\\')
+#else
+					if (str[i] == L'/')
+#endif
+					{
+						DKString file = path.Left(i);
+						if (DKDirectory::IsDirExist(file) == false)
+						{
+							if (DKPackage::IsPackage(file))
+								package = DKPackage::Open(file);
+							if (package)
+								locator = DKOBJECT_NEW PackageLocator(package, path.Right(i+1));
+							break;
+						}
+					}
+				}
+			}
+		}
+		if (locator == NULL)	 // zip file with prefix (".../mydata.zip/prefix")
 		{
 			size_t len = path.Length();
 			const wchar_t* str = path;
@@ -116,7 +235,7 @@ DKResourcePool::Locator* DKResourcePool::FindLocator(const DKString& name)
 {
 	if (name.Length() > 0)
 	{
-		DKCriticalSection<DKSpinLock> guard(this->lock);
+		DKSharedLockReadOnlySection guard(this->lock);
 		for (NamedLocator& loc : locators)
 		{
 			if (loc.name == name)
@@ -130,7 +249,7 @@ void DKResourcePool::RemoveLocator(const DKString& name)
 {
 	if (name.Length() > 0)
 	{
-		DKCriticalSection<DKSpinLock> guard(this->lock);
+		DKCriticalSection<DKSharedLock> guard(this->lock);
 		for (size_t i = 0; i < locators.Count(); ++i)
 		{
 			if (locators.Value(i).name == name)
@@ -144,14 +263,14 @@ void DKResourcePool::RemoveLocator(const DKString& name)
 
 void DKResourcePool::RemoveAllLocators()
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	locators.Clear();
 }
 
 DKString::StringArray DKResourcePool::AllLocatorNames() const
 {
 	DKString::StringArray names;
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKSharedLockReadOnlySection guard(this->lock);
 	names.Reserve(locators.Count());
 	for (const NamedLocator& loc : locators)
 	{
@@ -163,7 +282,7 @@ DKString::StringArray DKResourcePool::AllLocatorNames() const
 
 DKString DKResourcePool::ResourceFilePath(const DKString& name) const
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	for (const NamedLocator& loc : locators)
 	{
 		DKString path = loc.locator->FindSystemPath(name);
@@ -182,7 +301,7 @@ DKObject<DKStream> DKResourcePool::OpenResourceStream(const DKString& name) cons
 		return stream.SafeCast<DKStream>();
 	}
 
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	for (const NamedLocator& loc : locators)
 	{
 		DKObject<DKStream> s = loc.locator->OpenStream(name);
@@ -192,11 +311,27 @@ DKObject<DKStream> DKResourcePool::OpenResourceStream(const DKString& name) cons
 	return NULL;
 }
 
+DKObject<DKData> DKResourcePool::OpenLocatorData(const DKString& name) const
+{
+	DKCriticalSection<DKSharedLock> guard(this->lock);
+	for (const NamedLocator& loc : locators)
+	{
+		// locator can provide data without copy. (package)
+		DKObject<DKData> data = loc.locator->OpenData(name);
+		if (data)
+			return data;
+		DKObject<DKStream> s = loc.locator->OpenStream(name);
+		if (s)
+			return DKBuffer::Create(s).SafeCast<DKData>();
+	}
+	return NULL;
+}
+
 void DKResourcePool::AddResource(const DKString& name, DKResource* res)
 {
 	if (name.Length() > 0 && res)
 	{
-		DKCriticalSection<DKSpinLock> guard(this->lock);
+		DKCriticalSection<DKSharedLock> guard(this->lock);
 		resources.Update(name, res);
 	}
 }
@@ -205,45 +340,45 @@ void DKResourcePool::AddResourceData(const DKString& name, DKData* data)
 {
 	if (name.Length() > 0 && data)
 	{
-		DKCriticalSection<DKSpinLock> guard(this->lock);
+		DKCriticalSection<DKSharedLock> guard(this->lock);
 		resourceData.Update(name, data);
 	}
 }
 
 void DKResourcePool::RemoveResource(const DKString& name)
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	resources.Remove(name);
 }
 
 void DKResourcePool::RemoveResourceData(const DKString& name)
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	resourceData.Remove(name);
 }
 
 void DKResourcePool::RemoveAllResourceData()
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	resourceData.Clear();
 }
 
 void DKResourcePool::RemoveAllResources()
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	resources.Clear();
 }
 
 void DKResourcePool::RemoveAll()
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	resources.Clear();
 	resourceData.Clear();
 }
 
 void DKResourcePool::ClearUnreferencedObjects()
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	using ResInfo = DKMapPair<DKString, DKObject<DKResource>::Ref>;
 	using DataInfo = DKMapPair<DKString, DKObject<DKData>::Ref>;
 
@@ -287,7 +422,7 @@ void DKResourcePool::ClearUnreferencedObjects()
 
 DKObject<DKResource> DKResourcePool::FindResource(const DKString& name) const
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKSharedLockReadOnlySection guard(this->lock);
 	const ResourceMap::Pair* p = resources.Find(name);
 	if (p)
 		return p->value;
@@ -297,7 +432,7 @@ DKObject<DKResource> DKResourcePool::FindResource(const DKString& name) const
 
 DKObject<DKData> DKResourcePool::FindResourceData(const DKString& name) const
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKSharedLockReadOnlySection guard(this->lock);
 	const DataMap::Pair* p = resourceData.Find(name);
 	if (p)
 		return p->value;
@@ -307,9 +442,15 @@ DKObject<DKData> DKResourcePool::FindResourceData(const DKString& name) const
 
 DKObject<DKResource> DKResourcePool::LoadResource(const DKString& name)
 {
+	ResourcePoolMetrics& metrics = ResourcePoolMetrics::Get();
 	DKObject<DKResource> ret = FindResource(name);
 	if (ret)
+	{
+		metrics.hits->Increment();
 		return ret;
+	}
+	metrics.misses->Increment();
+	DKMetrics::Histogram::ScopedTimer timer(metrics.loadTime);
 
 	if (name.Length() > 0)
 	{
@@ -343,18 +484,36 @@ DKObject<DKResource> DKResourcePool::LoadResource(const DKString& name)
 		ret->SetName(name);
 
 		AddResource(name, ret);
-		
+		metrics.loaded->Increment();
+
 		DKLog("Resource \"%ls\" loaded.\n", (const wchar_t*)name);
 	}
+	else
+	{
+		metrics.failed->Increment();
+	}
 	return ret;
 }
 
 DKObject<DKData> DKResourcePool::LoadResourceData(const DKString& name, bool mapFileIfPossible)
 {
+	ResourcePoolMetrics& metrics = ResourcePoolMetrics::Get();
 	DKObject<DKData> ret = FindResourceData(name);
 	if (ret)
+	{
+		metrics.hits->Increment();
 		return ret;
+	}
+	metrics.misses->Increment();
+	return LoadNewResourceData(name, mapFileIfPossible);
+}
+
+DKObject<DKData> DKResourcePool::LoadNewResourceData(const DKString& name, bool mapFileIfPossible)
+{
+	ResourcePoolMetrics& metrics = ResourcePoolMetrics::Get();
+	DKMetrics::Histogram::ScopedTimer timer(metrics.dataLoadTime);
 
+	DKObject<DKData> ret = NULL;
 	if (name.Length() > 0)
 	{
 		if (name.Left(7).CompareNoCase(L"http://") && name.Left(6).CompareNoCase(L"ftp://") && name.Left(7).CompareNoCase(L"file://"))
@@ -369,10 +528,8 @@ DKObject<DKData> DKResourcePool::LoadResourceData(const DKString& name, bool map
 			}
 			else	// file could not be located. (or could be zip-file contents)
 			{
-				// open stream first (includes zip-file contents)
-				DKObject<DKStream> stream = OpenResourceStream(name);
-				if (stream)
-					ret = DKBuffer::Create(stream);
+				// open stream first (includes zip-file, package contents)
+				ret = OpenLocatorData(name);
 				if (ret == NULL && mapFileIfPossible)
 					ret = DKFileMap::Open(name, 0, false);
 				if (ret == NULL)
@@ -388,18 +545,101 @@ DKObject<DKData> DKResourcePool::LoadResourceData(const DKString& name, bool map
 	if (ret)
 	{
 		AddResourceData(name, ret);
-		
+		metrics.loaded->Increment();
+		metrics.bytesLoaded->Increment(ret->Length());
+
 		DKLog("Resource Data \"%ls\" loaded. (%llu bytes)\n", (const wchar_t*)name, ret->Length());	
 	}
+	else
+	{
+		metrics.failed->Increment();
+	}
 	
 	return ret;
 }
 
+DKFuture<DKObject<DKData>> DKResourcePool::LoadResourceDataAsync(const DKString& name)
+{
+	ResourcePoolMetrics& metrics = ResourcePoolMetrics::Get();
+	if (DKObject<DKData> data = FindResourceData(name); data)
+	{
+		metrics.hits->Increment();
+		return DKFuture<DKObject<DKData>>::Ready(data);
+	}
+	metrics.misses->Increment();
+
+	DKString path = ResourceFilePath(name);
+	DKObject<DKAsyncFile> file = NULL;
+	if (path.Length() > 0)
+	{
+		file = DKAsyncFile::Open(path, DKFile::ModeOpenReadOnly, DKFile::ModeShareRead);
+		if (file == NULL)
+		{
+			DKLogE("Failed to open resource data \"%ls\".", (const wchar_t*)name);
+			metrics.failed->Increment();
+			return DKFuture<DKObject<DKData>>::Cancelled();
+		}
+	}
+
+	uint64_t length = file ? file->Length() : 0;
+	if (length == 0 || length > size_t(-1))
+	{
+		// not a regular file. (zip-file contents, URL, empty file)
+		DKObject<DKData> data = LoadNewResourceData(name, false);
+		if (data)
+			return DKFuture<DKObject<DKData>>::Ready(data);
+		return DKFuture<DKObject<DKData>>::Cancelled();
+	}
+
+	DKObject<DKBuffer> buffer = DKBuffer::Create(NULL, static_cast<size_t>(length), Allocator());
+	void* p = buffer->LockExclusive();
+	buffer->UnlockExclusive();	// buffer is not shared until loading is done.
+
+	metrics.asyncLoads->Increment();
+	DKTimer::Tick start = DKTimer::SystemTick();
+
+	DKPromise<DKObject<DKData>> promise;
+	DKFuture<DKObject<DKData>> future = promise.Future();
+	DKObject<ResourceDataAsyncReader> reader = DKOBJECT_NEW ResourceDataAsyncReader();
+	reader->file = file;
+	reader->buffer = reinterpret_cast<uint8_t*>(p);
+	reader->length = length;
+	reader->offset = 0;
+	reader->completion = DKFunction([this, name, buffer, length, promise, start](int64_t result)
+	{
+		ResourcePoolMetrics& metrics = ResourcePoolMetrics::Get();
+		metrics.asyncLoads->Decrement();
+		metrics.dataLoadTime->RecordTicks(DKTimer::SystemTick() - start);
+		if (result >= 0 && static_cast<uint64_t>(result) == length)
+		{
+			DKObject<DKData> data = DKObject<DKBuffer>(buffer).SafeCast<DKData>();
+			AddResourceData(name, data);
+			metrics.loaded->Increment();
+			metrics.bytesLoaded->Increment(length);
+			DKLog("Resource Data \"%ls\" loaded. (%llu bytes)\n", (const wchar_t*)name, length);
+			promise.SetValue(data);
+		}
+		else
+		{
+			DKLogE("Failed to load resource data \"%ls\". (result: %lld)", (const wchar_t*)name, result);
+			metrics.failed->Increment();
+			promise.Cancel();
+		}
+	});
+	if (!ResourceDataAsyncReader::Submit(reader))
+	{
+		metrics.asyncLoads->Decrement();
+		metrics.failed->Increment();
+		promise.Cancel();
+	}
+	return future;
+}
+
 DKObject<DKResourcePool> DKResourcePool::Clone() const
 {	
 	DKObject<DKResourcePool> pool = DKObject<DKResourcePool>::New();
 
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKSharedLockReadOnlySection guard(this->lock);
 	pool->locators = this->locators;
 	pool->allocator = this->allocator;
 	pool->resources = this->resources;
@@ -410,19 +650,19 @@ DKObject<DKResourcePool> DKResourcePool::Clone() const
 
 void DKResourcePool::SetAllocator(DKMemoryLocation loc)
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	this->allocator = &DKAllocator::DefaultAllocator(loc);
 }
 
 void DKResourcePool::SetAllocator(DKAllocator* alloc)
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKCriticalSection<DKSharedLock> guard(this->lock);
 	this->allocator = alloc;
 }
 
 DKAllocator& DKResourcePool::Allocator() const
 {
-	DKCriticalSection<DKSpinLock> guard(this->lock);
+	DKSharedLockReadOnlySection guard(this->lock);
 	
 	if (this->allocator)
 		return *this->allocator;
@@ -52,6 +52,8 @@ namespace DKFramework
 			virtual ~Locator() {}
 			virtual DKString FindSystemPath(const DKString&) const = 0;
 			virtual DKObject<DKStream> OpenStream(const DKString&) const = 0;
+			/// optional, load data without copying stream. (package)
+			virtual DKObject<DKData> OpenData(const DKString&) const { return NULL; }
 		};
 
 		DKResourcePool();
@@ -77,6 +79,10 @@ namespace DKFramework
 		DKObject<DKResource> LoadResource(const DKString& name);
 		/// load resource data. recycles if data loaded already.
 		DKObject<DKData> LoadResourceData(const DKString& name, bool mapFileIfPossible = true);
+		/// load resource data asynchronously. recycles if data loaded already.
+		/// files in file-system directory are read with DKAsyncFile, others are
+		/// loaded on calling thread. pool must be alive until loading is done.
+		DKFuture<DKObject<DKData>> LoadResourceDataAsync(const DKString& name);
 
 		/// insert resource object into pool.
 		void AddResource(const DKString& name, DKResource* res);
@@ -114,13 +120,16 @@ namespace DKFramework
 			DKObject<Locator> locator;
 		};
 		DKArray<NamedLocator> locators;
+		DKObject<DKData> OpenLocatorData(const DKString& name) const;
+		/// load resource data and add it to pool, without lookup.
+		DKObject<DKData> LoadNewResourceData(const DKString& name, bool mapFileIfPossible);
 
 		typedef DKMap<DKString, DKObject<DKResource>>						ResourceMap;
 		typedef DKMap<DKString, DKObject<DKData>>			DataMap;
 		ResourceMap			resources;
 		DataMap				resourceData;
 
-		DKSpinLock lock;
+		DKSharedLock lock;	// reader-biased, lookups are much more frequent.
 		mutable DKAllocator* allocator;
 	};
 }
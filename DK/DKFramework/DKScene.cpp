@@ -906,6 +906,7 @@ void DKScene::Update(double tickDelta, DKTimeTick tick)
 {
 	DKASSERT_DEBUG(context);
 	DKASSERT_DEBUG(context->world);
+	DKPROFILE_SCOPE("DKScene::Update");
 
 	if (true)
 	{
@@ -920,6 +921,7 @@ void DKScene::Update(double tickDelta, DKTimeTick tick)
 
 	if (true)
 	{
+		DKPROFILE_SCOPE("DKScene::Update.Collision");
 		DKCriticalSection<DKSpinLock> guard(context->lock);
 
 		int updated = 0;
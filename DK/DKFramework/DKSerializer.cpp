@@ -1806,13 +1806,9 @@ bool DKSerializer::DeserializeBinaryOperations(DKStream* s, DKArray<DKObject<Des
 
 			if (data)
 			{
+				// view of chunk, shares storage with stream data.
 				DKStream::Position pos = s->CurrentPosition();
-				const char* ptr = (const char*)data->LockShared();
-				const void* p = &ptr[pos];
-
-				entityLoader(objectKey, containerKey, type, ctype, unpackedSize, DKData::StaticData(p, dataLength), loader, restoreEntities, this->entityMap);
-
-				data->UnlockShared();
+				entityLoader(objectKey, containerKey, type, ctype, unpackedSize, data->Subdata(pos, dataLength), loader, restoreEntities, this->entityMap);
 				pos += dataLength;
 				s->SetCurrentPosition(pos);
 			}
@@ -1926,6 +1922,13 @@ bool DKSerializer::Deserialize(const DKData* d, DKResourceLoader* p) const
 
 		if (validHeader)		// format is binary
 		{
+			DKObject<DKData> source = const_cast<DKData*>(d);
+			if (source.IsManaged())
+			{
+				// chunks can be views of source, without copying.
+				DKDataStream stream(source);
+				return DeserializeBinary(&stream, p);
+			}
 			const void* ptr = d->LockShared();
 			DKObject<DKData> data = DKData::StaticData(ptr, d->Length());
 			DKDataStream stream(data);
@@ -2094,6 +2097,13 @@ bool DKSerializer::RestoreObject(const DKData* d, DKResourceLoader* p, Selector*
 
 		if (validHeader)
 		{
+			DKObject<DKData> source = const_cast<DKData*>(d);
+			if (source.IsManaged())
+			{
+				// chunks can be views of source, without copying.
+				DKDataStream stream(source);
+				return DeserializeBinary(&stream, p, sel);
+			}
 			const void* ptr2 = d->LockShared();
 			DKObject<DKData> data = DKData::StaticData(ptr2, d->Length());
 			DKDataStream stream(data);
@@ -1732,17 +1732,28 @@ bool DKVariant::ImportStream(DKStream* stream)
 					{
 						if (stream->RemainLength() >= len)
 						{
-							DKBuffer val;
-							val.SetContent(0, len);
-							void* p = val.LockExclusive();
-							if (stream->Read(p, len) != len)
+							DKDataStream* dataStream = dynamic_cast<DKDataStream*>(stream);
+							DKData* source = dataStream ? dataStream->Data() : NULL;
+							if (source)
 							{
-								val.UnlockExclusive();
-								errorDesc = L"Failed to read from stream.";
-								goto FAILED;
+								// view of source data, SetData() copies it only if
+								// source is not immutable.
+								DKStream::Position pos = stream->CurrentPosition();
+								this->SetData(source->Subdata(pos, len));
+								stream->SetCurrentPosition(pos + len);
+							}
+							else
+							{
+								void* p = DKMalloc(len);
+								if (stream->Read(p, len) != len)
+								{
+									DKFree(p);
+									errorDesc = L"Failed to read from stream.";
+									goto FAILED;
+								}
+								// immutable data, SetData() does not copy again.
+								this->SetData(DKData::StaticData(p, len, true, DKFunction([p]() { DKFree(p); })->Invocation()));
 							}
-							val.UnlockExclusive();
-							this->SetData(val);
 						}
 						else
 						{
@@ -2224,6 +2235,8 @@ DKVariant& DKVariant::SetData(const VData* v)
 
 DKVariant& DKVariant::SetData(const void* p, size_t s)
 {
+	if (p)	// copied once by ImmutableData()
+		return SetData(DKData::StaticData(p, s));
 	return SetData(DKBuffer::Create(p, s));
 }
 
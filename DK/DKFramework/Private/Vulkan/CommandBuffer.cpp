@@ -76,6 +76,7 @@ void CommandBuffer::AddCompletedHandler(DKOperation* op)
 
 bool CommandBuffer::Commit()
 {
+    DKPROFILE_SCOPE("Vulkan::CommandBuffer::Commit");
     GraphicsDevice* dev = (GraphicsDevice*)DKGraphicsDeviceInterface::Instance(queue->Device());
     VkDevice device = dev->device;
 
@@ -78,6 +78,7 @@ DKObject<DKSwapChain> CommandQueue::CreateSwapChain(DKWindow* window)
 
 bool CommandQueue::Submit(const VkSubmitInfo* submits, uint32_t submitCount, DKOperation* callback)
 {
+	DKPROFILE_SCOPE("Vulkan::CommandQueue::Submit");
 	GraphicsDevice* dev = (GraphicsDevice*)DKGraphicsDeviceInterface::Instance(device);
 
 #if DKGL_QUEUE_COMPLETION_SYNC_TIMELINE_SEMAPHORE
@@ -33,6 +33,7 @@ ComputeCommandEncoder::Encoder::~Encoder()
 
 bool ComputeCommandEncoder::Encoder::Encode(VkCommandBuffer commandBuffer)
 {
+    DKPROFILE_SCOPE("Vulkan::ComputeCommandEncoder::Encode");
     // recording commands
     EncodingState state = { this };
     // collect image layout transition
@@ -33,6 +33,7 @@ CopyCommandEncoder::Encoder::~Encoder()
 
 bool CopyCommandEncoder::Encoder::Encode(VkCommandBuffer commandBuffer)
 {
+    DKPROFILE_SCOPE("Vulkan::CopyCommandEncoder::Encode");
     // recording commands
     EncodingState state = { this };
     for (EncoderCommand* c : setupCommands)
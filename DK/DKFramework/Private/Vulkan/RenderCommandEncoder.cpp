@@ -64,6 +64,7 @@ RenderCommandEncoder::Encoder::~Encoder()
 
 bool RenderCommandEncoder::Encoder::Encode(VkCommandBuffer commandBuffer)
 {
+    DKPROFILE_SCOPE("Vulkan::RenderCommandEncoder::Encode");
     EncodingState state = { this };
 
     // initialize render pass
@@ -509,6 +509,7 @@ void SwapChain::SetupFrame()
 
 bool SwapChain::Present(DKGpuEvent** waitEvents, size_t numEvents)
 {
+    DKPROFILE_SCOPE("Vulkan::SwapChain::Present");
     DKArray<VkSemaphore> waitSemaphores;
     waitSemaphores.Reserve(numEvents + 1);
 